@@ -1,13 +1,122 @@
 #include <stdio.h>
 #include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <cmath>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 const int FONT_SIZE = 40;
+
+// Etiquetas de la prueba de rasterizado en segundo plano
+const int LABEL_COUNT = 300;
+const int LABEL_FONT_SIZE = 12;
+
+// Paquete con el contenido de romfs/, generado por make
+const char* ROMFS_PACK = "romfs.pak";
+// Archivo empaquetado con el contenido de romfs/: una cabecera, un índice
+// ordenado por el hash del nombre, los nombres y los datos de cada entrada
+// alineados a 4 KB. Se mapea entero y cada entrada se abre como un SDL_RWops
+// sobre el mapeo, sin copias ni llamadas al sistema; las comprimidas con LZ4
+// se descomprimen a un buffer que libera el propio SDL_RWops. Lo genera
+// romfs_packer al compilar; es una copia de la suya
+class LPackFile {
+    public:
+        // Versión del formato y alineación de los datos de cada entrada
+        static const Uint32 VERSION = 1;
+        static const Uint64 ALIGN = 4096;
+
+        // Cómo están guardados los datos de una entrada
+        enum Codec {
+            CODEC_NONE = 0,
+            CODEC_LZ4 = 1
+        };
+
+        // El CRC del índice cubre las entradas y los nombres; el de la
+        // cabecera, los campos anteriores
+        struct Header {
+            char magic[ 4 ];
+            Uint32 version;
+            Uint32 count;
+            Uint32 namesSize;
+            Uint32 indexCrc;
+            Uint32 headerCrc;
+        };
+
+        // Entrada del índice; el nombre no termina en cero
+        struct Entry {
+            Uint64 hash;
+            Uint64 offset;
+            Uint64 size;
+            Uint64 storedSize;
+            Uint32 nameOffset;
+            Uint16 nameLength;
+            Uint8 codec;
+            Uint8 reserved;
+        };
+
+        // Inicializa las variables
+        LPackFile();
+
+        // Libera el mapeo
+        ~LPackFile();
+
+        // Mapea el paquete y comprueba el índice. Los nombres que empiezan por
+        // root/ se buscan sin ese prefijo. Falso si no existe o está dañado
+        bool open( std::string path, std::string root );
+
+        // Libera el mapeo; los SDL_RWops abiertos sin comprimir dejan de valer
+        void close();
+
+        bool isOpen();
+
+        // Abre name desde el paquete, o el archivo suelto si no hay paquete o
+        // no está en él. Se cierra con SDL_RWclose o con el freesrc de quien
+        // lo lea. Se puede llamar desde varios hilos a la vez
+        SDL_RWops* openRW( std::string name );
+
+        // Entradas del índice
+        int getEntryCount();
+
+        // FNV-1a de 64 bits del nombre
+        static Uint64 hashName( const char* name, size_t length );
+
+        // CRC-32 de zlib; sólo se usa con el índice, sin tabla
+        static Uint32 crc32( const void* data, size_t length );
+
+        // Descomprime un bloque LZ4 que debe ocupar exactamente destinationSize
+        static bool decompressLZ4( const Uint8* source, size_t sourceSize, Uint8* destination, size_t destinationSize );
+
+    private:
+        // Busca un nombre sin el prefijo de root
+        const Entry* find( const char* name, size_t length );
+
+        // Cierre de un SDL_RWops sobre un buffer descomprimido
+        static int closeDecompressed( SDL_RWops* context );
+
+        std::string mRoot;
+
+        // Mapeo del paquete e índice dentro de él
+        Uint8* mMapping;
+        size_t mMappingSize;
+        const Header* mHeader;
+        const Entry* mEntries;
+        const char* mNames;
+};
+
 // Texture weapper class
 class LTexture {
     public:
@@ -58,6 +167,149 @@ class LTexture {
         int mHeight;
 };
 
+// Atlas de glifos: cada glifo se rasteriza una sola vez y el texto se dibuja
+// como quads de una única textura, sin crear texturas al cambiar el texto
+class LGlyphAtlas {
+    public:
+        // Dimensiones de la textura del atlas
+        static const int ATLAS_SIZE = 512;
+
+        // Inicializa las variables
+        LGlyphAtlas();
+
+        // Libera la memoria
+        ~LGlyphAtlas();
+
+        // Crea el atlas vacío para la fuente dada
+        bool loadFromFont( TTF_Font* font );
+
+        // Libera el atlas
+        void free();
+
+        // Renderiza el texto en un punto dado
+        void render( int x, int y, const char* text, SDL_Color color );
+
+        // Obtiene las dimensiones del texto sin renderizarlo
+        int getTextWidth( const char* text );
+        int getTextHeight();
+
+        // Estadísticas de la caché
+        double getHitRate();
+        double getOccupancy();
+
+    private:
+        struct Glyph {
+            SDL_Rect clip;
+            int advance;
+            bool loaded;
+        };
+
+        // Obtiene el glifo, rasterizándolo la primera vez
+        Glyph& getGlyph( Uint8 ch );
+
+        // La textura del atlas
+        SDL_Texture* mTexture;
+        TTF_Font* mFont;
+
+        // Un glifo por cada byte Latin-1
+        Glyph mGlyphs[ 256 ];
+
+        // Empaquetado por estantes
+        int mShelfX;
+        int mShelfY;
+        int mShelfHeight;
+        int mUsedPixels;
+
+        // Aciertos y fallos de la caché
+        Uint64 mHits;
+        Uint64 mMisses;
+
+        // Buffer para expandir un glifo a ARGB antes de subirlo
+        Uint32* mPixels;
+};
+
+// Rasteriza texto en hilos de trabajo. Los hilos sólo crean superficies con
+// SDL_ttf; el hilo de render las sube a texturas en upload(). Las texturas se
+// guardan en una caché LRU por (tamaño, color, texto) de una misma fuente
+class LTextRasterizer {
+    public:
+        // Inicializa las variables
+        LTextRasterizer();
+
+        // Libera la memoria
+        ~LTextRasterizer();
+
+        // Arranca los hilos para la fuente dada
+        bool start( std::string fontPath, int workers, int cacheSize );
+
+        // Detiene los hilos y libera las texturas
+        void stop();
+
+        // Devuelve la textura si ya está lista; si no, pide su rasterizado
+        // y devuelve NULL
+        SDL_Texture* get( int size, SDL_Color color, const std::string& text, int* w, int* h );
+
+        // Sube las superficies terminadas, sólo desde el hilo de render
+        int upload();
+
+        // Peticiones aún sin subir
+        int getPending();
+
+        // Estadísticas de la caché
+        Uint64 getHits();
+        Uint64 getMisses();
+        Uint64 getEvictions();
+
+    private:
+        // Un texto pedido a los hilos
+        struct Job {
+            std::string key;
+            std::string text;
+            int size;
+            SDL_Color color;
+            SDL_Surface* surface;
+        };
+
+        // Una textura de la caché
+        struct Entry {
+            SDL_Texture* texture;
+            int width;
+            int height;
+            std::list<std::string>::iterator lru;
+        };
+
+        // Bucle de cada hilo de trabajo
+        static int workerMain( void* data );
+
+        // Clave de la caché
+        static std::string makeKey( int size, SDL_Color color, const std::string& text );
+
+        // Ruta de la fuente; cada hilo abre su propio TTF_Font
+        std::string mFontPath;
+
+        // Hilos y colas protegidas por mMutex
+        std::vector<SDL_Thread*> mWorkers;
+        SDL_mutex* mMutex;
+        SDL_cond* mCondition;
+        std::deque<Job*> mQueue;
+        std::vector<Job*> mDone;
+        bool mQuit;
+
+        // Caché; las entradas sin textura están en cola
+        std::unordered_map<std::string, Entry> mCache;
+        std::list<std::string> mLRU;
+        int mCacheSize;
+        int mPending;
+
+        Uint64 mHits;
+        Uint64 mMisses;
+        Uint64 mEvictions;
+};
+
+// Archivos de romfs/, desde el paquete si existe. Cada fuente que se abre lee
+// del mismo mapeo
+LPackFile gRomfs;
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -67,6 +319,12 @@ bool loadMedia();
 // Libera la memoria y termina SDL
 void close();
 
+// Texto de la etiqueta i
+std::string getLabelText( int i );
+
+// Compara el tiempo del hilo principal al rasterizar etiquetas con y sin hilos
+void benchmarkLabels( int labels, int workers );
+
 // Ventana donde se renderizará
 SDL_Window* gWindow = NULL;
 
@@ -76,9 +334,248 @@ SDL_Renderer* gRenderer = NULL;
 // Fuente usada globalmente
 TTF_Font *gFont = NULL;
 
-// Textura
-LTexture gTextTexture;
-LTexture gTextTexture2;
+// Atlas de glifos de la fuente global
+LGlyphAtlas gTextAtlas;
+
+// Rasterizador en segundo plano de las etiquetas
+LTextRasterizer gLabelRasterizer;
+
+LPackFile::LPackFile() {
+    // Inicializa las variables
+    mMapping = NULL;
+    mMappingSize = 0;
+    mHeader = NULL;
+    mEntries = NULL;
+    mNames = NULL;
+}
+
+LPackFile::~LPackFile() {
+    close();
+}
+
+bool LPackFile::open( std::string path, std::string root ) {
+    close();
+
+    int descriptor = ::open( path.c_str(), O_RDONLY );
+    if( descriptor < 0 ) {
+        return false;
+    }
+    struct stat info;
+    if( fstat( descriptor, &info ) != 0 || info.st_size < (off_t)sizeof( Header ) ) {
+        ::close( descriptor );
+        return false;
+    }
+    void* mapping = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+    ::close( descriptor );
+    if( mapping == MAP_FAILED ) {
+        printf( "No se pudo mapear %s: %s\n", path.c_str(), strerror( errno ) );
+        return false;
+    }
+    mMapping = (Uint8*)mapping;
+    mMappingSize = info.st_size;
+
+    // La cabecera y el índice se comprueban antes de usarlos; los datos de
+    // las entradas no se tocan hasta abrirlas
+    const Header* header = (const Header*)mMapping;
+    Uint64 indexSize = (Uint64)header->count * sizeof( Entry ) + header->namesSize;
+    bool valid = memcmp( header->magic, "RPAK", 4 ) == 0 && header->version == VERSION
+        && header->headerCrc == crc32( header, offsetof( Header, headerCrc ) )
+        && indexSize <= mMappingSize - sizeof( Header )
+        && header->indexCrc == crc32( mMapping + sizeof( Header ), indexSize );
+    const Entry* entries = (const Entry*)( mMapping + sizeof( Header ) );
+    for( Uint32 i = 0; i < header->count && valid; ++i ) {
+        const Entry& entry = entries[ i ];
+        valid = entry.offset <= mMappingSize && entry.storedSize <= mMappingSize - entry.offset
+            && (Uint64)entry.nameOffset + entry.nameLength <= header->namesSize
+            && ( entry.codec == CODEC_LZ4 || ( entry.codec == CODEC_NONE && entry.storedSize == entry.size ) )
+            && ( i == 0 || entries[ i - 1 ].hash <= entry.hash );
+    }
+    if( !valid ) {
+        printf( "%s no es un paquete válido!\n", path.c_str() );
+        close();
+        return false;
+    }
+
+    mHeader = header;
+    mEntries = entries;
+    mNames = (const char*)( mMapping + sizeof( Header ) + (Uint64)header->count * sizeof( Entry ) );
+    mRoot = root.empty() ? root : root + "/";
+    return true;
+}
+
+void LPackFile::close() {
+    if( mMapping != NULL ) {
+        munmap( mMapping, mMappingSize );
+        mMapping = NULL;
+        mMappingSize = 0;
+        mHeader = NULL;
+        mEntries = NULL;
+        mNames = NULL;
+    }
+}
+
+bool LPackFile::isOpen() {
+    return mHeader != NULL;
+}
+
+SDL_RWops* LPackFile::openRW( std::string name ) {
+    const Entry* entry = NULL;
+    if( mHeader != NULL && name.compare( 0, mRoot.size(), mRoot ) == 0 ) {
+        entry = find( name.c_str() + mRoot.size(), name.size() - mRoot.size() );
+    }
+    if( entry == NULL || entry->size == 0 ) {
+        return SDL_RWFromFile( name.c_str(), "rb" );
+    }
+
+    // Sin comprimir se lee directamente del mapeo; como la entrada empieza en
+    // una página se puede pedir que se lea por adelantado
+    const Uint8* data = mMapping + entry->offset;
+    if( entry->codec == CODEC_NONE ) {
+        madvise( (void*)data, entry->storedSize, MADV_WILLNEED );
+        return SDL_RWFromConstMem( data, entry->size );
+    }
+
+    Uint8* buffer = (Uint8*)malloc( entry->size );
+    if( buffer == NULL || !decompressLZ4( data, entry->storedSize, buffer, entry->size ) ) {
+        ::free( buffer );
+        SDL_SetError( "%s está dañado en el paquete", name.c_str() );
+        return NULL;
+    }
+    SDL_RWops* context = SDL_RWFromConstMem( buffer, entry->size );
+    if( context == NULL ) {
+        ::free( buffer );
+        return NULL;
+    }
+    context->close = closeDecompressed;
+    return context;
+}
+
+int LPackFile::getEntryCount() {
+    return mHeader != NULL ? mHeader->count : 0;
+}
+
+const LPackFile::Entry* LPackFile::find( const char* name, size_t length ) {
+    // Búsqueda binaria del hash; con colisiones se compara el nombre
+    Uint64 hash = hashName( name, length );
+    size_t low = 0, high = mHeader->count;
+    while( low < high ) {
+        size_t middle = ( low + high ) / 2;
+        if( mEntries[ middle ].hash < hash ) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for( size_t i = low; i < mHeader->count && mEntries[ i ].hash == hash; ++i ) {
+        if( mEntries[ i ].nameLength == length && memcmp( mNames + mEntries[ i ].nameOffset, name, length ) == 0 ) {
+            return &mEntries[ i ];
+        }
+    }
+    return NULL;
+}
+
+int LPackFile::closeDecompressed( SDL_RWops* context ) {
+    ::free( context->hidden.mem.base );
+    SDL_FreeRW( context );
+    return 0;
+}
+
+Uint64 LPackFile::hashName( const char* name, size_t length ) {
+    Uint64 hash = 14695981039346656037ull;
+    for( size_t i = 0; i < length; ++i ) {
+        hash = ( hash ^ (Uint8)name[ i ] ) * 1099511628211ull;
+    }
+    return hash;
+}
+
+Uint32 LPackFile::crc32( const void* data, size_t length ) {
+    const Uint8* p = (const Uint8*)data;
+    Uint32 crc = 0xFFFFFFFF;
+    while( length-- > 0 ) {
+        crc ^= *p++;
+        for( int bit = 0; bit < 8; ++bit ) {
+            crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ) );
+        }
+    }
+    return ~crc;
+}
+
+bool LPackFile::decompressLZ4( const Uint8* source, size_t sourceSize, Uint8* destination, size_t destinationSize ) {
+    size_t in = 0, out = 0;
+    while( in < sourceSize ) {
+        // Token: literales en los 4 bits altos, coincidencia en los bajos; 15
+        // sigue en bytes de 255 hasta uno menor
+        Uint8 token = source[ in++ ];
+        size_t literals = token >> 4;
+        if( literals == 15 ) {
+            Uint8 extra;
+            do {
+                if( in >= sourceSize ) {
+                    return false;
+                }
+                extra = source[ in++ ];
+                literals += extra;
+            } while( extra == 255 );
+        }
+        if( literals > sourceSize - in || literals > destinationSize - out ) {
+            return false;
+        }
+        if( literals <= 16 && sourceSize - in >= 16 && destinationSize - out >= 16 ) {
+            // Casi siempre son pocos: se copian 16 de golpe, lo que sobra se
+            // pisa después
+            memcpy( destination + out, source + in, 16 );
+        } else {
+            memcpy( destination + out, source + in, literals );
+        }
+        in += literals;
+        out += literals;
+
+        // La última secuencia sólo lleva literales
+        if( in == sourceSize ) {
+            break;
+        }
+        if( sourceSize - in < 2 ) {
+            return false;
+        }
+        size_t offset = source[ in ] | ( source[ in + 1 ] << 8 );
+        in += 2;
+        size_t length = ( token & 15 ) + 4;
+        if( ( token & 15 ) == 15 ) {
+            Uint8 extra;
+            do {
+                if( in >= sourceSize ) {
+                    return false;
+                }
+                extra = source[ in++ ];
+                length += extra;
+            } while( extra == 255 );
+        }
+        if( offset == 0 || offset > out || length > destinationSize - out ) {
+            return false;
+        }
+
+        // Una coincidencia cercana se solapa con lo que va copiando: se copia
+        // en trozos del tamaño de la distancia, que crece con cada copia
+        Uint8* target = destination + out;
+        const Uint8* match = target - offset;
+        if( offset >= 16 && destinationSize - out >= length + 16 ) {
+            for( size_t i = 0; i < length; i += 16 ) {
+                memcpy( target + i, match + i, 16 );
+            }
+        } else if( offset >= length ) {
+            memcpy( target, match, length );
+        } else {
+            size_t copied = 0;
+            while( copied < length ) {
+                size_t chunk = offset + copied < length - copied ? offset + copied : length - copied;
+                memcpy( target + copied, match, chunk );
+                copied += chunk;
+            }
+        }
+        out += length;
+    }
+    return out == destinationSize;
+}
 
 LTexture::LTexture() {
     // Inicializa la textura
@@ -102,7 +599,7 @@ bool LTexture::loadFromFile( std::string path ) {
     SDL_Texture* newTexture = NULL;
 
     // Carga la imagen del path especificado
-    SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
+    SDL_Surface* loadedSurface = IMG_Load_RW( gRomfs.openRW( path ), 1 );
     if( loadedSurface == NULL ) {
         printf( "No se pudo cargar la imagen %s! SDL_image Error: %s\n", path.c_str(), 
                 IMG_GetError() );
@@ -217,6 +714,417 @@ void LTexture::setHeight( int h ) {
     mHeight = h;
 }
 
+LGlyphAtlas::LGlyphAtlas() {
+    // Inicializa las variables
+    mTexture = NULL;
+    mFont = NULL;
+    mPixels = NULL;
+    free();
+}
+
+LGlyphAtlas::~LGlyphAtlas() {
+    // Libera la memoria
+    free();
+}
+
+bool LGlyphAtlas::loadFromFont( TTF_Font* font ) {
+    // Maneja el atlas preexistente
+    free();
+
+    // Textura ARGB en blanco; el color se aplica con la modulación
+    mTexture = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+            ATLAS_SIZE, ATLAS_SIZE );
+    if( mTexture == NULL ) {
+        printf( "No se pudo crear la textura del atlas! SDL Error: %s\n", SDL_GetError() );
+        return false;
+    }
+    SDL_SetTextureBlendMode( mTexture, SDL_BLENDMODE_BLEND );
+
+    // Limpia el atlas a transparente
+    mPixels = new Uint32[ ATLAS_SIZE * ATLAS_SIZE ];
+    memset( mPixels, 0, ATLAS_SIZE * ATLAS_SIZE * sizeof( Uint32 ) );
+    SDL_UpdateTexture( mTexture, NULL, mPixels, ATLAS_SIZE * sizeof( Uint32 ) );
+
+    mFont = font;
+    return true;
+}
+
+void LGlyphAtlas::free() {
+    // Libera la textura si existe
+    if( mTexture != NULL ) {
+        SDL_DestroyTexture( mTexture );
+        mTexture = NULL;
+    }
+    delete[] mPixels;
+    mPixels = NULL;
+    mFont = NULL;
+
+    // Vacía la caché
+    for( int i = 0; i < 256; ++i ) {
+        mGlyphs[ i ].loaded = false;
+    }
+    mShelfX = 0;
+    mShelfY = 0;
+    mShelfHeight = 0;
+    mUsedPixels = 0;
+    mHits = 0;
+    mMisses = 0;
+}
+
+LGlyphAtlas::Glyph& LGlyphAtlas::getGlyph( Uint8 ch ) {
+    Glyph& glyph = mGlyphs[ ch ];
+    if( glyph.loaded ) {
+        ++mHits;
+        return glyph;
+    }
+    ++mMisses;
+
+    // Un glifo sin espacio o sin imagen se queda con el clip vacío
+    glyph.loaded = true;
+    glyph.clip = { 0, 0, 0, 0 };
+    glyph.advance = 0;
+
+    int minX, maxX, minY, maxY;
+    if( TTF_GlyphMetrics( mFont, ch, &minX, &maxX, &minY, &maxY, &glyph.advance ) != 0 ) {
+        return glyph;
+    }
+
+    // Los glifos sin tinta (p. ej. el espacio) sólo tienen avance
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface* glyphSurface = TTF_RenderGlyph_Solid( mFont, ch, white );
+    if( glyphSurface == NULL ) {
+        return glyph;
+    }
+
+    // Busca un hueco en el estante actual o abre uno nuevo
+    int w = glyphSurface->w;
+    int h = glyphSurface->h;
+    if( mShelfX + w + 1 > ATLAS_SIZE ) {
+        mShelfX = 0;
+        mShelfY += mShelfHeight + 1;
+        mShelfHeight = 0;
+    }
+    if( w + 1 > ATLAS_SIZE || mShelfY + h + 1 > ATLAS_SIZE ) {
+        printf( "Warning: el atlas de glifos está lleno, no cabe '%c'!\n", ch );
+        SDL_FreeSurface( glyphSurface );
+        return glyph;
+    }
+
+    // Expande los píxeles indexados a blanco opaco o transparente
+    Uint8* src = (Uint8*)glyphSurface->pixels;
+    for( int y = 0; y < h; ++y ) {
+        for( int x = 0; x < w; ++x ) {
+            mPixels[ y * w + x ] = src[ y * glyphSurface->pitch + x ] != 0 ? 0xFFFFFFFF : 0;
+        }
+    }
+
+    glyph.clip = { mShelfX, mShelfY, w, h };
+    SDL_UpdateTexture( mTexture, &glyph.clip, mPixels, w * sizeof( Uint32 ) );
+
+    mShelfX += w + 1;
+    if( h > mShelfHeight ) {
+        mShelfHeight = h;
+    }
+    mUsedPixels += w * h;
+
+    SDL_FreeSurface( glyphSurface );
+    return glyph;
+}
+
+void LGlyphAtlas::render( int x, int y, const char* text, SDL_Color color ) {
+    if( mTexture == NULL ) {
+        return;
+    }
+
+    // Todos los glifos comparten textura, así que el renderizador los agrupa
+    SDL_SetTextureColorMod( mTexture, color.r, color.g, color.b );
+    for( const char* c = text; *c != '\0'; ++c ) {
+        Glyph& glyph = getGlyph( (Uint8)*c );
+        if( glyph.clip.w > 0 ) {
+            SDL_Rect renderQuad = { x, y, glyph.clip.w, glyph.clip.h };
+            SDL_RenderCopy( gRenderer, mTexture, &glyph.clip, &renderQuad );
+        }
+        x += glyph.advance;
+    }
+}
+
+int LGlyphAtlas::getTextWidth( const char* text ) {
+    int width = 0;
+    for( const char* c = text; *c != '\0'; ++c ) {
+        width += getGlyph( (Uint8)*c ).advance;
+    }
+    return width;
+}
+
+int LGlyphAtlas::getTextHeight() {
+    return mFont != NULL ? TTF_FontHeight( mFont ) : 0;
+}
+
+double LGlyphAtlas::getHitRate() {
+    Uint64 total = mHits + mMisses;
+    return total > 0 ? (double)mHits / total : 0.0;
+}
+
+double LGlyphAtlas::getOccupancy() {
+    return (double)mUsedPixels / ( ATLAS_SIZE * ATLAS_SIZE );
+}
+
+// FreeType no permite abrir caras a la vez desde varios hilos
+SDL_mutex* gFontOpenMutex = NULL;
+
+LTextRasterizer::LTextRasterizer() {
+    // Inicializa las variables
+    mMutex = NULL;
+    mCondition = NULL;
+    mQuit = false;
+    mCacheSize = 0;
+    mPending = 0;
+    mHits = 0;
+    mMisses = 0;
+    mEvictions = 0;
+}
+
+LTextRasterizer::~LTextRasterizer() {
+    // Libera la memoria
+    stop();
+}
+
+bool LTextRasterizer::start( std::string fontPath, int workers, int cacheSize ) {
+    // Maneja los hilos preexistentes
+    stop();
+
+    mFontPath = fontPath;
+    mCacheSize = cacheSize;
+    mQuit = false;
+    if( gFontOpenMutex == NULL ) {
+        gFontOpenMutex = SDL_CreateMutex();
+    }
+    mMutex = SDL_CreateMutex();
+    mCondition = SDL_CreateCond();
+    if( gFontOpenMutex == NULL || mMutex == NULL || mCondition == NULL ) {
+        printf( "No se pudo crear el mutex del rasterizador! SDL Error: %s\n", SDL_GetError() );
+        return false;
+    }
+
+    for( int i = 0; i < workers; ++i ) {
+        SDL_Thread* thread = SDL_CreateThread( workerMain, "TextRasterizer", this );
+        if( thread == NULL ) {
+            printf( "No se pudo crear el hilo del rasterizador! SDL Error: %s\n", SDL_GetError() );
+            return false;
+        }
+        mWorkers.push_back( thread );
+    }
+    return true;
+}
+
+void LTextRasterizer::stop() {
+    // Despierta a los hilos y espera a que terminen
+    if( mMutex != NULL ) {
+        SDL_LockMutex( mMutex );
+        mQuit = true;
+        SDL_CondBroadcast( mCondition );
+        SDL_UnlockMutex( mMutex );
+    }
+    for( size_t i = 0; i < mWorkers.size(); ++i ) {
+        SDL_WaitThread( mWorkers[ i ], NULL );
+    }
+    mWorkers.clear();
+
+    // Descarta los trabajos sin terminar o sin subir
+    for( size_t i = 0; i < mQueue.size(); ++i ) {
+        delete mQueue[ i ];
+    }
+    mQueue.clear();
+    for( size_t i = 0; i < mDone.size(); ++i ) {
+        SDL_FreeSurface( mDone[ i ]->surface );
+        delete mDone[ i ];
+    }
+    mDone.clear();
+
+    // Libera las texturas de la caché
+    for( std::unordered_map<std::string, Entry>::iterator it = mCache.begin(); it != mCache.end(); ++it ) {
+        if( it->second.texture != NULL ) {
+            SDL_DestroyTexture( it->second.texture );
+        }
+    }
+    mCache.clear();
+    mLRU.clear();
+    mPending = 0;
+
+    if( mCondition != NULL ) {
+        SDL_DestroyCond( mCondition );
+        mCondition = NULL;
+    }
+    if( mMutex != NULL ) {
+        SDL_DestroyMutex( mMutex );
+        mMutex = NULL;
+    }
+}
+
+std::string LTextRasterizer::makeKey( int size, SDL_Color color, const std::string& text ) {
+    // Tamaño y color en binario seguidos del texto
+    std::string key( sizeof( int ) + sizeof( SDL_Color ), '\0' );
+    memcpy( &key[ 0 ], &size, sizeof( int ) );
+    memcpy( &key[ sizeof( int ) ], &color, sizeof( SDL_Color ) );
+    key += text;
+    return key;
+}
+
+SDL_Texture* LTextRasterizer::get( int size, SDL_Color color, const std::string& text, int* w, int* h ) {
+    std::string key = makeKey( size, color, text );
+    std::unordered_map<std::string, Entry>::iterator it = mCache.find( key );
+    if( it != mCache.end() ) {
+        // Aún en cola
+        if( it->second.texture == NULL ) {
+            return NULL;
+        }
+
+        // Pasa al frente de la LRU
+        ++mHits;
+        mLRU.splice( mLRU.begin(), mLRU, it->second.lru );
+        *w = it->second.width;
+        *h = it->second.height;
+        return it->second.texture;
+    }
+
+    // Reserva la entrada y encola el trabajo
+    ++mMisses;
+    Entry entry = { NULL, 0, 0, mLRU.end() };
+    mCache[ key ] = entry;
+
+    Job* job = new Job();
+    job->key = key;
+    job->text = text;
+    job->size = size;
+    job->color = color;
+    job->surface = NULL;
+
+    SDL_LockMutex( mMutex );
+    mQueue.push_back( job );
+    SDL_CondSignal( mCondition );
+    SDL_UnlockMutex( mMutex );
+
+    ++mPending;
+    return NULL;
+}
+
+int LTextRasterizer::upload() {
+    // Recoge los trabajos terminados sin retener el mutex al subirlos
+    std::vector<Job*> done;
+    SDL_LockMutex( mMutex );
+    done.swap( mDone );
+    SDL_UnlockMutex( mMutex );
+
+    for( size_t i = 0; i < done.size(); ++i ) {
+        Job* job = done[ i ];
+        Entry& entry = mCache[ job->key ];
+        if( job->surface != NULL ) {
+            entry.texture = SDL_CreateTextureFromSurface( gRenderer, job->surface );
+            if( entry.texture == NULL ) {
+                printf( "No se pudo crear la textura desde el texto renderizado! SDL Error: %s\n",
+                        SDL_GetError() );
+            }
+            entry.width = job->surface->w;
+            entry.height = job->surface->h;
+            SDL_FreeSurface( job->surface );
+        }
+
+        // Sin textura se quita de la caché para volver a pedirlo
+        if( entry.texture == NULL ) {
+            mCache.erase( job->key );
+        } else {
+            mLRU.push_front( job->key );
+            entry.lru = mLRU.begin();
+        }
+        delete job;
+        --mPending;
+    }
+
+    // Expulsa las texturas menos usadas
+    while( (int)mLRU.size() > mCacheSize ) {
+        std::unordered_map<std::string, Entry>::iterator it = mCache.find( mLRU.back() );
+        SDL_DestroyTexture( it->second.texture );
+        mCache.erase( it );
+        mLRU.pop_back();
+        ++mEvictions;
+    }
+
+    return done.size();
+}
+
+int LTextRasterizer::workerMain( void* data ) {
+    LTextRasterizer* rasterizer = (LTextRasterizer*)data;
+
+    // Fuentes abiertas por este hilo, una por tamaño
+    std::vector< std::pair<int, TTF_Font*> > fonts;
+
+    while( true ) {
+        // Espera un trabajo
+        SDL_LockMutex( rasterizer->mMutex );
+        while( rasterizer->mQueue.empty() && !rasterizer->mQuit ) {
+            SDL_CondWait( rasterizer->mCondition, rasterizer->mMutex );
+        }
+        if( rasterizer->mQuit ) {
+            SDL_UnlockMutex( rasterizer->mMutex );
+            break;
+        }
+        Job* job = rasterizer->mQueue.front();
+        rasterizer->mQueue.pop_front();
+        SDL_UnlockMutex( rasterizer->mMutex );
+
+        // Busca o abre la fuente de este tamaño
+        TTF_Font* font = NULL;
+        for( size_t i = 0; i < fonts.size(); ++i ) {
+            if( fonts[ i ].first == job->size ) {
+                font = fonts[ i ].second;
+            }
+        }
+        if( font == NULL ) {
+            SDL_LockMutex( gFontOpenMutex );
+            font = TTF_OpenFontRW( gRomfs.openRW( rasterizer->mFontPath ), 1, job->size );
+            SDL_UnlockMutex( gFontOpenMutex );
+            if( font == NULL ) {
+                printf( "Falló la carga de la fuente! SDL_ttf Error: %s\n", TTF_GetError() );
+            } else {
+                fonts.push_back( std::make_pair( job->size, font ) );
+            }
+        }
+
+        // Rasteriza fuera del hilo de render
+        if( font != NULL ) {
+            job->surface = TTF_RenderUTF8_Solid( font, job->text.c_str(), job->color );
+        }
+
+        SDL_LockMutex( rasterizer->mMutex );
+        rasterizer->mDone.push_back( job );
+        SDL_UnlockMutex( rasterizer->mMutex );
+    }
+
+    // Cierra las fuentes de este hilo
+    SDL_LockMutex( gFontOpenMutex );
+    for( size_t i = 0; i < fonts.size(); ++i ) {
+        TTF_CloseFont( fonts[ i ].second );
+    }
+    SDL_UnlockMutex( gFontOpenMutex );
+    return 0;
+}
+
+int LTextRasterizer::getPending() {
+    return mPending;
+}
+
+Uint64 LTextRasterizer::getHits() {
+    return mHits;
+}
+
+Uint64 LTextRasterizer::getMisses() {
+    return mMisses;
+}
+
+Uint64 LTextRasterizer::getEvictions() {
+    return mEvictions;
+}
+
 bool init() {
     // Bandera
     bool success = true;
@@ -274,33 +1182,54 @@ bool init() {
 bool loadMedia() {
     // Bandera
     bool success = true;
+
+    // Un solo archivo mapeado en vez de abrir cada uno
+    if( gRomfs.open( ROMFS_PACK, "romfs" ) ) {
+        printf( "Leyendo %s: %d entradas\n", ROMFS_PACK, gRomfs.getEntryCount() );
+    } else {
+        printf( "Warning: No se encontró %s, se leen los archivos de romfs/\n", ROMFS_PACK );
+    }
     
     // Abre la fuente
-    gFont = TTF_OpenFont( "romfs/lazy.ttf", FONT_SIZE );
+    gFont = TTF_OpenFontRW( gRomfs.openRW( "romfs/lazy.ttf" ), 1, FONT_SIZE );
     if( gFont == NULL ) {
         printf( "Falló la carga de la fuente! SDL_ttf Error: %s\n", TTF_GetError() );
         success = false;
     } else {
-        // Renderiza el texto
-        SDL_Color textColor = { 0xFF, 0xFF, 0xFF };
-        if( !gTextTexture.loadFromRendererText( "No matter where you are", textColor ) ) {
-            printf( "Falló la carga de la textura del texto!\n" );
+        // Crea el atlas; los glifos se rasterizan al usarse por primera vez
+        if( !gTextAtlas.loadFromFont( gFont ) ) {
+            printf( "Falló la carga del atlas de glifos!\n" );
+            success = false;
+        }
+
+        // Arranca los hilos del rasterizador de etiquetas
+        if( !gLabelRasterizer.start( "romfs/lazy.ttf", 4, 1024 ) ) {
+            printf( "Falló el arranque del rasterizador!\n" );
             success = false;
         }
-        gTextTexture2.loadFromRendererText( "everyone is connected...", textColor );
     }
 
     return success;
 }
 
 void close() {
-    // Libera la textura cargada
-    gTextTexture.free();
-    gTextTexture2.free();
+    // Estadísticas del atlas de glifos
+    printf( "Atlas de glifos: %.2f%% aciertos, %.2f%% ocupado\n",
+            gTextAtlas.getHitRate() * 100.0, gTextAtlas.getOccupancy() * 100.0 );
+
+    // Estadísticas del rasterizador
+    printf( "Rasterizador: %llu aciertos, %llu fallos, %llu expulsiones\n",
+            (unsigned long long)gLabelRasterizer.getHits(), (unsigned long long)gLabelRasterizer.getMisses(),
+            (unsigned long long)gLabelRasterizer.getEvictions() );
+
+    // Libera el atlas y detiene los hilos
+    gTextAtlas.free();
+    gLabelRasterizer.stop();
 
-    // Libera la fuente global
+    // Libera la fuente global; las fuentes leen del paquete hasta cerrarse
     TTF_CloseFont( gFont );
     gFont = NULL;
+    gRomfs.close();
 
     // Destruye la ventana
     SDL_DestroyRenderer( gRenderer );
@@ -314,7 +1243,90 @@ void close() {
     SDL_Quit();
 }
 
+std::string getLabelText( int i ) {
+    char text[ 64 ];
+    snprintf( text, sizeof( text ), "Etiqueta %d: everyone is connected", i );
+    return text;
+}
+
+void benchmarkLabels( int labels, int workers ) {
+    SDL_Color textColor = { 0xFF, 0xFF, 0xFF, 0xFF };
+    double ms = 1000.0 / SDL_GetPerformanceFrequency();
+
+    // Síncrono: todo el rasterizado ocurre en el hilo principal
+    std::vector<LTexture> textures( labels );
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int i = 0; i < labels; ++i ) {
+        textures[ i ].loadFromRendererText( getLabelText( i ), textColor );
+    }
+    Uint64 syncTicks = SDL_GetPerformanceCounter() - start;
+
+    // Con hilos: el hilo principal sólo pide y sube texturas cada frame
+    LTextRasterizer rasterizer;
+    rasterizer.start( "romfs/lazy.ttf", workers, 1024 );
+    Uint64 mainTicks = 0;
+    Uint64 worstFrame = 0;
+    int frames = 0;
+    int ready = 0;
+    Uint64 wallStart = SDL_GetPerformanceCounter();
+    while( ready < labels ) {
+        start = SDL_GetPerformanceCounter();
+        ready = 0;
+        for( int i = 0; i < labels; ++i ) {
+            int w, h;
+            if( rasterizer.get( FONT_SIZE, textColor, getLabelText( i ), &w, &h ) != NULL ) {
+                ++ready;
+            }
+        }
+        rasterizer.upload();
+        Uint64 frameTicks = SDL_GetPerformanceCounter() - start;
+        mainTicks += frameTicks;
+        if( frameTicks > worstFrame ) {
+            worstFrame = frameTicks;
+        }
+        ++frames;
+
+        // El resto del frame queda libre para el juego
+        SDL_Delay( 1 );
+    }
+    Uint64 wallTicks = SDL_GetPerformanceCounter() - wallStart;
+    rasterizer.stop();
+
+    printf( "%d etiquetas, %d hilos\n", labels, workers );
+    printf( "  sincrono:  %.2f ms en el hilo principal, en un solo frame\n", syncTicks * ms );
+    printf( "  con hilos: %.2f ms en el hilo principal en %d frames (peor frame %.2f ms), %.2f ms en total\n",
+            mainTicks * ms, frames, worstFrame * ms, wallTicks * ms );
+    printf( "  ahorro en el hilo principal: %.2f ms (%.0f%%)\n", ( syncTicks - (double)mainTicks ) * ms,
+            100.0 * ( 1.0 - (double)mainTicks / syncTicks ) );
+}
+
 int main( int argc, char* argv[] ) {
+    // Modo de medición sin ventana, con un renderizador por software
+    if( argc > 1 && strcmp( argv[ 1 ], "--bench" ) == 0 ) {
+        SDL_Init( 0 );
+        TTF_Init();
+        gRomfs.open( ROMFS_PACK, "romfs" );
+        gFont = TTF_OpenFontRW( gRomfs.openRW( "romfs/lazy.ttf" ), 1, FONT_SIZE );
+        SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+                SDL_PIXELFORMAT_ARGB8888 );
+        gRenderer = target != NULL ? SDL_CreateSoftwareRenderer( target ) : NULL;
+        if( gFont == NULL || gRenderer == NULL ) {
+            printf( "Falló la inicialización! SDL Error: %s\n", SDL_GetError() );
+            return -1;
+        }
+
+        benchmarkLabels( 100, 4 );
+        benchmarkLabels( LABEL_COUNT, 4 );
+        benchmarkLabels( 1000, 4 );
+
+        SDL_DestroyRenderer( gRenderer );
+        SDL_FreeSurface( target );
+        TTF_CloseFont( gFont );
+        TTF_Quit();
+        SDL_Quit();
+        return 0;
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -330,6 +1342,15 @@ int main( int argc, char* argv[] ) {
 
     SDL_Event e; 
 
+    // Color del texto
+    SDL_Color textColor = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+    const char* text = "No matter where you are";
+    const char* text2 = "everyone is connected...";
+
+    // Muestra las etiquetas rasterizadas en segundo plano
+    bool showLabels = false;
+
     while( !quit ) {
         while( SDL_PollEvent( &e ) != 0 ) {
             switch( e.type ) {
@@ -344,7 +1365,11 @@ int main( int argc, char* argv[] ) {
                               printf( "Bye!\n" );
                               quit = true;
                               break;
-                    
+
+                          // Activa o desactiva las etiquetas
+                          case SDLK_l:
+                              showLabels = !showLabels;
+                              break;
                       }
             }
 
@@ -354,13 +1379,28 @@ int main( int argc, char* argv[] ) {
         SDL_SetRenderDrawColor( gRenderer, 0x00, 0x00, 0x00, 0xFF );
         SDL_RenderClear( gRenderer );
         
-        // Renderiza la textura del texto
-        gTextTexture.render( ( SCREEN_WIDTH - gTextTexture.getWidth() ) / 2, 
-                ( SCREEN_HEIGHT - gTextTexture.getHeight() ) / 2 - FONT_SIZE );
+        // Renderiza el texto desde el atlas
+        gTextAtlas.render( ( SCREEN_WIDTH - gTextAtlas.getTextWidth( text ) ) / 2, 
+                ( SCREEN_HEIGHT - gTextAtlas.getTextHeight() ) / 2 - FONT_SIZE, text, textColor );
  
-        gTextTexture2.render( ( SCREEN_WIDTH - gTextTexture2.getWidth() ) / 2,
-                ( SCREEN_HEIGHT - gTextTexture2.getHeight() ) / 2 );
+        gTextAtlas.render( ( SCREEN_WIDTH - gTextAtlas.getTextWidth( text2 ) ) / 2,
+                ( SCREEN_HEIGHT - gTextAtlas.getTextHeight() ) / 2, text2, textColor );
+
+        // Las etiquetas aparecen según los hilos las terminan
+        if( showLabels ) {
+            SDL_Color labelColor = { 0xFF, 0xFF, 0x00, 0xFF };
+            for( int i = 0; i < LABEL_COUNT; ++i ) {
+                int w, h;
+                SDL_Texture* texture = gLabelRasterizer.get( LABEL_FONT_SIZE, labelColor, getLabelText( i ), &w, &h );
+                if( texture != NULL ) {
+                    SDL_Rect renderQuad = { ( i * 97 ) % ( SCREEN_WIDTH - w ), ( i * 53 ) % ( SCREEN_HEIGHT - h ), w, h };
+                    SDL_RenderCopy( gRenderer, texture, NULL, &renderQuad );
+                }
+            }
+        }
 
+        // Sube las etiquetas terminadas
+        gLabelRasterizer.upload();
 
         // Actualiza la pantalla
         SDL_RenderPresent( gRenderer );
@@ -1,22 +1,38 @@
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <math.h>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_mixer.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MIXER_SSE2 1
+#endif
+
 // La musica que será tocada
 Mix_Music *gMusic = NULL;
 
-// Los efectos de sonido que se usarán
-Mix_Chunk *gScratch = NULL;
-Mix_Chunk *gHigh = NULL;
-Mix_Chunk *gMedium = NULL;
-Mix_Chunk *gLow = NULL;
-
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 const int FONT_SIZE = 40;
 
+// Muestras por buffer del mezclador propio
+const int MIXER_SAMPLES = 512;
+
+// Paquete con el contenido de romfs/, generado por make
+const char* ROMFS_PACK = "romfs.pak";
+
 // Texture weapper class
 class LTexture {
     public:
@@ -71,9 +87,266 @@ class LTexture {
         int mHeight;
 };
 
+// Archivo empaquetado con el contenido de romfs/: una cabecera, un índice
+// ordenado por el hash del nombre, los nombres y los datos de cada entrada
+// alineados a 4 KB. Se mapea entero y cada entrada se abre como un SDL_RWops
+// sobre el mapeo, sin copias ni llamadas al sistema; las comprimidas con LZ4
+// se descomprimen a un buffer que libera el propio SDL_RWops. Lo genera
+// romfs_packer al compilar; es una copia de la suya
+class LPackFile {
+    public:
+        // Versión del formato y alineación de los datos de cada entrada
+        static const Uint32 VERSION = 1;
+        static const Uint64 ALIGN = 4096;
+
+        // Cómo están guardados los datos de una entrada
+        enum Codec {
+            CODEC_NONE = 0,
+            CODEC_LZ4 = 1
+        };
+
+        // El CRC del índice cubre las entradas y los nombres; el de la
+        // cabecera, los campos anteriores
+        struct Header {
+            char magic[ 4 ];
+            Uint32 version;
+            Uint32 count;
+            Uint32 namesSize;
+            Uint32 indexCrc;
+            Uint32 headerCrc;
+        };
+
+        // Entrada del índice; el nombre no termina en cero
+        struct Entry {
+            Uint64 hash;
+            Uint64 offset;
+            Uint64 size;
+            Uint64 storedSize;
+            Uint32 nameOffset;
+            Uint16 nameLength;
+            Uint8 codec;
+            Uint8 reserved;
+        };
+
+        // Inicializa las variables
+        LPackFile();
+
+        // Libera el mapeo
+        ~LPackFile();
+
+        // Mapea el paquete y comprueba el índice. Los nombres que empiezan por
+        // root/ se buscan sin ese prefijo. Falso si no existe o está dañado
+        bool open( std::string path, std::string root );
+
+        // Libera el mapeo; los SDL_RWops abiertos sin comprimir dejan de valer
+        void close();
+
+        bool isOpen();
+
+        // Abre name desde el paquete, o el archivo suelto si no hay paquete o
+        // no está en él. Se cierra con SDL_RWclose o con el freesrc de quien
+        // lo lea. Se puede llamar desde varios hilos a la vez
+        SDL_RWops* openRW( std::string name );
+
+        // Entradas del índice
+        int getEntryCount();
+
+        // FNV-1a de 64 bits del nombre
+        static Uint64 hashName( const char* name, size_t length );
+
+        // CRC-32 de zlib, sin tabla; se usa con el índice y con los WAV de la
+        // caché de efectos, que son pequeños
+        static Uint32 crc32( const void* data, size_t length );
+
+        // Descomprime un bloque LZ4 que debe ocupar exactamente destinationSize
+        static bool decompressLZ4( const Uint8* source, size_t sourceSize, Uint8* destination, size_t destinationSize );
+
+    private:
+        // Busca un nombre sin el prefijo de root
+        const Entry* find( const char* name, size_t length );
+
+        // Cierre de un SDL_RWops sobre un buffer descomprimido
+        static int closeDecompressed( SDL_RWops* context );
+
+        std::string mRoot;
+
+        // Mapeo del paquete e índice dentro de él
+        Uint8* mMapping;
+        size_t mMappingSize;
+        const Header* mHeader;
+        const Entry* mEntries;
+        const char* mNames;
+};
+
+// Caché de efectos de sonido ya decodificados y convertidos a float mono a
+// la frecuencia del mezclador, todos en un mismo bloque de memoria. Lo
+// convertido se guarda en un archivo para no repetir la decodificación
+class LSampleCache {
+    public:
+        // Inicializa las variables
+        LSampleCache();
+
+        // Registra un WAV y devuelve su handle; se carga en build
+        int addFile( std::string path );
+
+        // Lee el archivo de caché si es válido; si no, decodifica y convierte
+        // todos los efectos y lo vuelve a escribir
+        bool build( int frequency, std::string cachePath );
+
+        // Libera las muestras
+        void free();
+
+        // Muestras de un efecto
+        const float* getData( int handle );
+        Uint32 getLength( int handle );
+
+        // Indica si la última carga vino del archivo de caché
+        bool isFromCache();
+
+    private:
+        // Ubicación de un efecto en el bloque
+        struct Entry {
+            std::string path;
+            Sint32 sourceSize;
+            Uint32 sourceCrc;
+            Uint32 offset;
+            Uint32 length;
+        };
+
+        // Carga el archivo de caché; falso si no coincide con los efectos
+        bool loadCache( int frequency, std::string cachePath );
+
+        // Guarda el bloque en el archivo de caché
+        void saveCache( int frequency, std::string cachePath );
+
+        // Decodifica un WAV y lo añade al final del bloque
+        bool decode( Entry& entry, int frequency );
+
+        // Hash de las rutas registradas
+        Uint32 hashPaths();
+
+        std::vector<Entry> mEntries;
+        std::vector<float> mArena;
+        bool mFromCache;
+};
+
+// Mezclador por software sobre un dispositivo de audio propio, en paralelo
+// al de SDL_mixer que sigue tocando la música. Cada voz tiene ganancia y
+// paneo; cuando no quedan voces libres se roba la de menor prioridad
+class LMixer {
+    public:
+        // Voces simultáneas
+        static const int MAX_VOICES = 512;
+
+        // Inicializa las variables
+        LMixer();
+
+        // Cierra el dispositivo
+        ~LMixer();
+
+        // Abre el dispositivo en float o int16 estéreo
+        bool open( int frequency, int samples );
+
+        // Prepara el mezclador sin dispositivo, para las mediciones
+        void openOffline( int frequency, SDL_AudioFormat format, int samples );
+
+        // Cierra el dispositivo y detiene las voces
+        void close();
+
+        // Toca un efecto de la caché con ganancia, paneo de -1 a 1 y
+        // prioridad; devuelve la voz usada o -1 si todas tienen más prioridad
+        int play( LSampleCache& cache, int sample, float gain, float pan, int priority );
+
+        // Detiene todas las voces
+        void stopAll();
+
+        // Mezcla las voces activas en el formato del dispositivo
+        void mix( Uint8* stream, int len );
+
+        // Usa o no la versión vectorial
+        void setSimd( bool simd );
+
+        int getFrequency();
+        int getActiveVoices();
+        int getSteals();
+        int getRejected();
+
+        // Tiempo de mezcla por callback como fracción de lo que dura el buffer
+        double getAverageLoad();
+        double getPeakLoad();
+        void resetLoad();
+
+    private:
+        struct Voice {
+            const float* data;
+            Uint32 length;
+            Uint32 position;
+            float gainLeft;
+            float gainRight;
+            int priority;
+            Uint32 serial;
+            bool active;
+        };
+
+        // Callback del dispositivo
+        static void audioCallback( void* userdata, Uint8* stream, int len );
+
+        // Reserva los acumuladores para el tamaño de buffer
+        void setup( const SDL_AudioSpec& spec );
+
+        // Suma una voz a los acumuladores
+        static void accumulateScalar( const float* source, int count, float gainLeft, float gainRight,
+                float* left, float* right );
+
+        // Convierte los acumuladores al formato de salida saturando
+        static void convertScalar( const float* left, const float* right, int frames,
+                SDL_AudioFormat format, Uint8* stream );
+
+#if defined(MIXER_SSE2)
+        static void accumulateSSE2( const float* source, int count, float gainLeft, float gainRight,
+                float* left, float* right );
+        static void convertSSE2( const float* left, const float* right, int frames,
+                SDL_AudioFormat format, Uint8* stream );
+#endif
+
+        SDL_AudioDeviceID mDevice;
+        SDL_AudioSpec mSpec;
+        bool mSimd;
+
+        Voice mVoices[ MAX_VOICES ];
+        Uint32 mSerial;
+
+        // Acumuladores planos por canal
+        std::vector<float> mLeft;
+        std::vector<float> mRight;
+
+        std::atomic<int> mActiveVoices;
+        int mSteals;
+        int mRejected;
+
+        // Tiempo de mezcla en ticks del contador de rendimiento
+        std::atomic<Uint64> mMixTicks;
+        std::atomic<Uint64> mBufferTicks;
+        std::atomic<Uint64> mPeakTicks;
+        std::atomic<Uint64> mPeakBufferTicks;
+};
+
+// Archivos de romfs/, desde el paquete si existe
+LPackFile gRomfs;
+
 // Mouse button sprites
 LTexture gSplashTexture;
 
+// Mezclador de los efectos de sonido
+LMixer gMixer;
+
+// Los efectos de sonido que se usarán y sus handles en la caché
+LSampleCache gSamples;
+int gScratch = gSamples.addFile( "romfs/scratch.wav" );
+int gHigh = gSamples.addFile( "romfs/high.wav" );
+int gMedium = gSamples.addFile( "romfs/medium.wav" );
+int gLow = gSamples.addFile( "romfs/low.wav" );
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -83,6 +356,12 @@ bool loadMedia();
 // Libera la memoria y termina SDL
 void close();
 
+// Mide la carga del mezclador con un número fijo de voces
+void benchmarkMixer( int voices, SDL_AudioFormat format, int buffers );
+
+// Ruta de un archivo temporal para las mediciones, fuera de romfs/
+std::string getTempPath( const char* name );
+
 // Ventana donde se renderizará
 SDL_Window* gWindow = NULL;
 
@@ -111,7 +390,7 @@ bool LTexture::loadFromFile( std::string path ) {
     SDL_Texture* newTexture = NULL;
 
     // Carga la imagen del path especificado
-    SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
+    SDL_Surface* loadedSurface = IMG_Load_RW( gRomfs.openRW( path ), 1 );
     if( loadedSurface == NULL ) {
         printf( "No se pudo cargar la imagen %s! SDL_image Error: %s\n", path.c_str(), 
                 IMG_GetError() );
@@ -229,6 +508,751 @@ void LTexture::setHeight( int h ) {
 }
 
 
+LPackFile::LPackFile() {
+    // Inicializa las variables
+    mMapping = NULL;
+    mMappingSize = 0;
+    mHeader = NULL;
+    mEntries = NULL;
+    mNames = NULL;
+}
+
+LPackFile::~LPackFile() {
+    close();
+}
+
+bool LPackFile::open( std::string path, std::string root ) {
+    close();
+
+    int descriptor = ::open( path.c_str(), O_RDONLY );
+    if( descriptor < 0 ) {
+        return false;
+    }
+    struct stat info;
+    if( fstat( descriptor, &info ) != 0 || info.st_size < (off_t)sizeof( Header ) ) {
+        ::close( descriptor );
+        return false;
+    }
+    void* mapping = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+    ::close( descriptor );
+    if( mapping == MAP_FAILED ) {
+        printf( "No se pudo mapear %s: %s\n", path.c_str(), strerror( errno ) );
+        return false;
+    }
+    mMapping = (Uint8*)mapping;
+    mMappingSize = info.st_size;
+
+    // La cabecera y el índice se comprueban antes de usarlos; los datos de
+    // las entradas no se tocan hasta abrirlas
+    const Header* header = (const Header*)mMapping;
+    Uint64 indexSize = (Uint64)header->count * sizeof( Entry ) + header->namesSize;
+    bool valid = memcmp( header->magic, "RPAK", 4 ) == 0 && header->version == VERSION
+        && header->headerCrc == crc32( header, offsetof( Header, headerCrc ) )
+        && indexSize <= mMappingSize - sizeof( Header )
+        && header->indexCrc == crc32( mMapping + sizeof( Header ), indexSize );
+    const Entry* entries = (const Entry*)( mMapping + sizeof( Header ) );
+    for( Uint32 i = 0; i < header->count && valid; ++i ) {
+        const Entry& entry = entries[ i ];
+        valid = entry.offset <= mMappingSize && entry.storedSize <= mMappingSize - entry.offset
+            && (Uint64)entry.nameOffset + entry.nameLength <= header->namesSize
+            && ( entry.codec == CODEC_LZ4 || ( entry.codec == CODEC_NONE && entry.storedSize == entry.size ) )
+            && ( i == 0 || entries[ i - 1 ].hash <= entry.hash );
+    }
+    if( !valid ) {
+        printf( "%s no es un paquete válido!\n", path.c_str() );
+        close();
+        return false;
+    }
+
+    mHeader = header;
+    mEntries = entries;
+    mNames = (const char*)( mMapping + sizeof( Header ) + (Uint64)header->count * sizeof( Entry ) );
+    mRoot = root.empty() ? root : root + "/";
+    return true;
+}
+
+void LPackFile::close() {
+    if( mMapping != NULL ) {
+        munmap( mMapping, mMappingSize );
+        mMapping = NULL;
+        mMappingSize = 0;
+        mHeader = NULL;
+        mEntries = NULL;
+        mNames = NULL;
+    }
+}
+
+bool LPackFile::isOpen() {
+    return mHeader != NULL;
+}
+
+SDL_RWops* LPackFile::openRW( std::string name ) {
+    const Entry* entry = NULL;
+    if( mHeader != NULL && name.compare( 0, mRoot.size(), mRoot ) == 0 ) {
+        entry = find( name.c_str() + mRoot.size(), name.size() - mRoot.size() );
+    }
+    if( entry == NULL || entry->size == 0 ) {
+        return SDL_RWFromFile( name.c_str(), "rb" );
+    }
+
+    // Sin comprimir se lee directamente del mapeo; como la entrada empieza en
+    // una página se puede pedir que se lea por adelantado
+    const Uint8* data = mMapping + entry->offset;
+    if( entry->codec == CODEC_NONE ) {
+        madvise( (void*)data, entry->storedSize, MADV_WILLNEED );
+        return SDL_RWFromConstMem( data, entry->size );
+    }
+
+    Uint8* buffer = (Uint8*)malloc( entry->size );
+    if( buffer == NULL || !decompressLZ4( data, entry->storedSize, buffer, entry->size ) ) {
+        ::free( buffer );
+        SDL_SetError( "%s está dañado en el paquete", name.c_str() );
+        return NULL;
+    }
+    SDL_RWops* context = SDL_RWFromConstMem( buffer, entry->size );
+    if( context == NULL ) {
+        ::free( buffer );
+        return NULL;
+    }
+    context->close = closeDecompressed;
+    return context;
+}
+
+int LPackFile::getEntryCount() {
+    return mHeader != NULL ? mHeader->count : 0;
+}
+
+const LPackFile::Entry* LPackFile::find( const char* name, size_t length ) {
+    // Búsqueda binaria del hash; con colisiones se compara el nombre
+    Uint64 hash = hashName( name, length );
+    size_t low = 0, high = mHeader->count;
+    while( low < high ) {
+        size_t middle = ( low + high ) / 2;
+        if( mEntries[ middle ].hash < hash ) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for( size_t i = low; i < mHeader->count && mEntries[ i ].hash == hash; ++i ) {
+        if( mEntries[ i ].nameLength == length && memcmp( mNames + mEntries[ i ].nameOffset, name, length ) == 0 ) {
+            return &mEntries[ i ];
+        }
+    }
+    return NULL;
+}
+
+int LPackFile::closeDecompressed( SDL_RWops* context ) {
+    ::free( context->hidden.mem.base );
+    SDL_FreeRW( context );
+    return 0;
+}
+
+Uint64 LPackFile::hashName( const char* name, size_t length ) {
+    Uint64 hash = 14695981039346656037ull;
+    for( size_t i = 0; i < length; ++i ) {
+        hash = ( hash ^ (Uint8)name[ i ] ) * 1099511628211ull;
+    }
+    return hash;
+}
+
+Uint32 LPackFile::crc32( const void* data, size_t length ) {
+    const Uint8* p = (const Uint8*)data;
+    Uint32 crc = 0xFFFFFFFF;
+    while( length-- > 0 ) {
+        crc ^= *p++;
+        for( int bit = 0; bit < 8; ++bit ) {
+            crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ) );
+        }
+    }
+    return ~crc;
+}
+
+bool LPackFile::decompressLZ4( const Uint8* source, size_t sourceSize, Uint8* destination, size_t destinationSize ) {
+    size_t in = 0, out = 0;
+    while( in < sourceSize ) {
+        // Token: literales en los 4 bits altos, coincidencia en los bajos; 15
+        // sigue en bytes de 255 hasta uno menor
+        Uint8 token = source[ in++ ];
+        size_t literals = token >> 4;
+        if( literals == 15 ) {
+            Uint8 extra;
+            do {
+                if( in >= sourceSize ) {
+                    return false;
+                }
+                extra = source[ in++ ];
+                literals += extra;
+            } while( extra == 255 );
+        }
+        if( literals > sourceSize - in || literals > destinationSize - out ) {
+            return false;
+        }
+        if( literals <= 16 && sourceSize - in >= 16 && destinationSize - out >= 16 ) {
+            // Casi siempre son pocos: se copian 16 de golpe, lo que sobra se
+            // pisa después
+            memcpy( destination + out, source + in, 16 );
+        } else {
+            memcpy( destination + out, source + in, literals );
+        }
+        in += literals;
+        out += literals;
+
+        // La última secuencia sólo lleva literales
+        if( in == sourceSize ) {
+            break;
+        }
+        if( sourceSize - in < 2 ) {
+            return false;
+        }
+        size_t offset = source[ in ] | ( source[ in + 1 ] << 8 );
+        in += 2;
+        size_t length = ( token & 15 ) + 4;
+        if( ( token & 15 ) == 15 ) {
+            Uint8 extra;
+            do {
+                if( in >= sourceSize ) {
+                    return false;
+                }
+                extra = source[ in++ ];
+                length += extra;
+            } while( extra == 255 );
+        }
+        if( offset == 0 || offset > out || length > destinationSize - out ) {
+            return false;
+        }
+
+        // Una coincidencia cercana se solapa con lo que va copiando: se copia
+        // en trozos del tamaño de la distancia, que crece con cada copia
+        Uint8* target = destination + out;
+        const Uint8* match = target - offset;
+        if( offset >= 16 && destinationSize - out >= length + 16 ) {
+            for( size_t i = 0; i < length; i += 16 ) {
+                memcpy( target + i, match + i, 16 );
+            }
+        } else if( offset >= length ) {
+            memcpy( target, match, length );
+        } else {
+            size_t copied = 0;
+            while( copied < length ) {
+                size_t chunk = offset + copied < length - copied ? offset + copied : length - copied;
+                memcpy( target + copied, match, chunk );
+                copied += chunk;
+            }
+        }
+        out += length;
+    }
+    return out == destinationSize;
+}
+
+LSampleCache::LSampleCache() {
+    // Inicializa las variables
+    mFromCache = false;
+}
+
+int LSampleCache::addFile( std::string path ) {
+    Entry entry;
+    entry.path = path;
+    entry.sourceSize = 0;
+    entry.sourceCrc = 0;
+    entry.offset = 0;
+    entry.length = 0;
+    mEntries.push_back( entry );
+    return mEntries.size() - 1;
+}
+
+bool LSampleCache::build( int frequency, std::string cachePath ) {
+    std::vector<float>().swap( mArena );
+
+    // Tamaño y CRC actuales de cada WAV para saber si la caché sigue siendo
+    // válida; un efecto editado sin cambiar de tamaño cambia de CRC
+    std::vector<Uint8> source;
+    for( size_t i = 0; i < mEntries.size(); ++i ) {
+        mEntries[ i ].sourceSize = -1;
+        mEntries[ i ].sourceCrc = 0;
+        SDL_RWops* file = gRomfs.openRW( mEntries[ i ].path );
+        if( file == NULL ) {
+            continue;
+        }
+        Sint64 size = SDL_RWsize( file );
+        source.resize( size > 0 ? size : 0 );
+        if( size >= 0 && ( size == 0 || SDL_RWread( file, source.data(), size, 1 ) == 1 ) ) {
+            mEntries[ i ].sourceSize = size;
+            mEntries[ i ].sourceCrc = LPackFile::crc32( source.data(), source.size() );
+        }
+        SDL_RWclose( file );
+    }
+
+    mFromCache = loadCache( frequency, cachePath );
+    if( mFromCache ) {
+        return true;
+    }
+
+    // Decodifica todo una sola vez
+    std::vector<float>().swap( mArena );
+    for( size_t i = 0; i < mEntries.size(); ++i ) {
+        if( !decode( mEntries[ i ], frequency ) ) {
+            return false;
+        }
+    }
+    saveCache( frequency, cachePath );
+    return true;
+}
+
+bool LSampleCache::decode( Entry& entry, int frequency ) {
+    SDL_AudioSpec spec;
+    Uint8* buffer = NULL;
+    Uint32 length = 0;
+    if( SDL_LoadWAV_RW( gRomfs.openRW( entry.path ), 1, &spec, &buffer, &length ) == NULL ) {
+        printf( "No se pudo cargar %s! SDL Error: %s\n", entry.path.c_str(), SDL_GetError() );
+        return false;
+    }
+
+    // Convierte a float mono a la frecuencia del mezclador
+    SDL_AudioCVT cvt;
+    if( SDL_BuildAudioCVT( &cvt, spec.format, spec.channels, spec.freq, AUDIO_F32SYS, 1, frequency ) < 0 ) {
+        printf( "No se pudo convertir %s! SDL Error: %s\n", entry.path.c_str(), SDL_GetError() );
+        SDL_FreeWAV( buffer );
+        return false;
+    }
+    std::vector<Uint8> converted( length * cvt.len_mult );
+    memcpy( converted.data(), buffer, length );
+    SDL_FreeWAV( buffer );
+    cvt.buf = converted.data();
+    cvt.len = length;
+    SDL_ConvertAudio( &cvt );
+
+    // Lo añade al final del bloque
+    entry.offset = mArena.size();
+    entry.length = cvt.len_cvt / sizeof( float );
+    mArena.resize( entry.offset + entry.length );
+    memcpy( &mArena[ entry.offset ], converted.data(), entry.length * sizeof( float ) );
+    return true;
+}
+
+bool LSampleCache::loadCache( int frequency, std::string cachePath ) {
+    SDL_RWops* file = SDL_RWFromFile( cachePath.c_str(), "rb" );
+    if( file == NULL ) {
+        return false;
+    }
+
+    // La cabecera debe coincidir con la frecuencia y los efectos registrados
+    char magic[ 4 ];
+    Sint32 header[ 3 ];
+    Sint32 expected[ 3 ] = { frequency, (Sint32)mEntries.size(), (Sint32)hashPaths() };
+    bool success = SDL_RWread( file, magic, 4, 1 ) == 1 && memcmp( magic, "SFX2", 4 ) == 0
+        && SDL_RWread( file, header, sizeof( header ), 1 ) == 1
+        && memcmp( header, expected, sizeof( header ) ) == 0;
+
+    for( size_t i = 0; i < mEntries.size() && success; ++i ) {
+        Sint32 sourceSize;
+        Uint32 sourceCrc;
+        success = SDL_RWread( file, &sourceSize, sizeof( Sint32 ), 1 ) == 1
+            && SDL_RWread( file, &sourceCrc, sizeof( Uint32 ), 1 ) == 1
+            && SDL_RWread( file, &mEntries[ i ].offset, sizeof( Uint32 ), 1 ) == 1
+            && SDL_RWread( file, &mEntries[ i ].length, sizeof( Uint32 ), 1 ) == 1
+            && sourceSize == mEntries[ i ].sourceSize && sourceCrc == mEntries[ i ].sourceCrc;
+    }
+
+    // El bloque ocupa el resto del archivo; cada efecto debe caber en él
+    Uint32 arenaLength = 0;
+    if( success ) {
+        Sint64 remaining = SDL_RWsize( file ) - SDL_RWtell( file );
+        success = remaining >= 0 && remaining % sizeof( float ) == 0
+            && remaining / sizeof( float ) <= 0xFFFFFFFF;
+        arenaLength = success ? remaining / sizeof( float ) : 0;
+    }
+    for( size_t i = 0; i < mEntries.size() && success; ++i ) {
+        success = mEntries[ i ].offset <= arenaLength
+            && mEntries[ i ].length <= arenaLength - mEntries[ i ].offset;
+    }
+
+    // Las muestras se leen de una vez al bloque
+    if( success ) {
+        mArena.resize( arenaLength );
+        success = arenaLength == 0 || SDL_RWread( file, mArena.data(), arenaLength * sizeof( float ), 1 ) == 1;
+    }
+
+    SDL_RWclose( file );
+    return success;
+}
+
+void LSampleCache::saveCache( int frequency, std::string cachePath ) {
+    SDL_RWops* file = SDL_RWFromFile( cachePath.c_str(), "wb" );
+    if( file == NULL ) {
+        printf( "Warning: No se pudo guardar la caché de audio! SDL Error: %s\n", SDL_GetError() );
+        return;
+    }
+
+    Sint32 header[ 3 ] = { frequency, (Sint32)mEntries.size(), (Sint32)hashPaths() };
+    SDL_RWwrite( file, "SFX2", 4, 1 );
+    SDL_RWwrite( file, header, sizeof( header ), 1 );
+    for( size_t i = 0; i < mEntries.size(); ++i ) {
+        SDL_RWwrite( file, &mEntries[ i ].sourceSize, sizeof( Sint32 ), 1 );
+        SDL_RWwrite( file, &mEntries[ i ].sourceCrc, sizeof( Uint32 ), 1 );
+        SDL_RWwrite( file, &mEntries[ i ].offset, sizeof( Uint32 ), 1 );
+        SDL_RWwrite( file, &mEntries[ i ].length, sizeof( Uint32 ), 1 );
+    }
+    SDL_RWwrite( file, mArena.data(), sizeof( float ), mArena.size() );
+    SDL_RWclose( file );
+}
+
+Uint32 LSampleCache::hashPaths() {
+    // FNV-1a sobre las rutas en orden de registro
+    Uint32 hash = 2166136261u;
+    for( size_t i = 0; i < mEntries.size(); ++i ) {
+        const std::string& path = mEntries[ i ].path;
+        for( size_t c = 0; c <= path.size(); ++c ) {
+            hash = ( hash ^ (Uint8)path.c_str()[ c ] ) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+void LSampleCache::free() {
+    std::vector<float>().swap( mArena );
+}
+
+const float* LSampleCache::getData( int handle ) {
+    return mArena.data() + mEntries[ handle ].offset;
+}
+
+Uint32 LSampleCache::getLength( int handle ) {
+    return handle >= 0 && handle < (int)mEntries.size() && !mArena.empty() ? mEntries[ handle ].length : 0;
+}
+
+bool LSampleCache::isFromCache() {
+    return mFromCache;
+}
+
+LMixer::LMixer() {
+    // Inicializa las variables
+    mDevice = 0;
+    SDL_zero( mSpec );
+    mSimd = true;
+    memset( mVoices, 0, sizeof( mVoices ) );
+    mSerial = 0;
+    mActiveVoices = 0;
+    mSteals = 0;
+    mRejected = 0;
+    resetLoad();
+}
+
+LMixer::~LMixer() {
+    close();
+}
+
+bool LMixer::open( int frequency, int samples ) {
+    close();
+
+    SDL_AudioSpec desired;
+    SDL_zero( desired );
+    desired.freq = frequency;
+    desired.format = AUDIO_F32SYS;
+    desired.channels = 2;
+    desired.samples = samples;
+    desired.callback = audioCallback;
+    desired.userdata = this;
+
+    // Se acepta float o int16 tal cual; con otro formato convierte SDL
+    SDL_AudioSpec obtained;
+    mDevice = SDL_OpenAudioDevice( NULL, SDL_FALSE, &desired, &obtained,
+            SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE );
+    if( mDevice != 0 && obtained.format != AUDIO_F32SYS && obtained.format != AUDIO_S16SYS ) {
+        SDL_CloseAudioDevice( mDevice );
+        mDevice = SDL_OpenAudioDevice( NULL, SDL_FALSE, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE );
+    }
+    if( mDevice == 0 ) {
+        printf( "No se pudo abrir el dispositivo del mezclador! SDL Error: %s\n", SDL_GetError() );
+        return false;
+    }
+
+    setup( obtained );
+    SDL_PauseAudioDevice( mDevice, SDL_FALSE );
+    return true;
+}
+
+void LMixer::openOffline( int frequency, SDL_AudioFormat format, int samples ) {
+    close();
+
+    SDL_AudioSpec spec;
+    SDL_zero( spec );
+    spec.freq = frequency;
+    spec.format = format;
+    spec.channels = 2;
+    spec.samples = samples;
+    setup( spec );
+}
+
+void LMixer::setup( const SDL_AudioSpec& spec ) {
+    mSpec = spec;
+    mLeft.assign( spec.samples, 0.0f );
+    mRight.assign( spec.samples, 0.0f );
+    stopAll();
+    resetLoad();
+}
+
+void LMixer::close() {
+    if( mDevice != 0 ) {
+        SDL_CloseAudioDevice( mDevice );
+        mDevice = 0;
+    }
+    stopAll();
+}
+
+int LMixer::play( LSampleCache& cache, int sample, float gain, float pan, int priority ) {
+    if( cache.getLength( sample ) == 0 ) {
+        return -1;
+    }
+
+    // Paneo de potencia constante
+    pan = pan < -1.0f ? -1.0f : ( pan > 1.0f ? 1.0f : pan );
+    float angle = ( pan + 1.0f ) * (float)M_PI / 4.0f;
+
+    if( mDevice != 0 ) {
+        SDL_LockAudioDevice( mDevice );
+    }
+
+    // Busca una voz libre; si no hay, la de menor prioridad y más antigua
+    int slot = -1;
+    int victim = 0;
+    for( int i = 0; i < MAX_VOICES; ++i ) {
+        if( !mVoices[ i ].active ) {
+            slot = i;
+            break;
+        }
+        if( mVoices[ i ].priority < mVoices[ victim ].priority
+                || ( mVoices[ i ].priority == mVoices[ victim ].priority
+                    && mVoices[ i ].serial < mVoices[ victim ].serial ) ) {
+            victim = i;
+        }
+    }
+    if( slot == -1 ) {
+        if( mVoices[ victim ].priority > priority ) {
+            ++mRejected;
+        } else {
+            ++mSteals;
+            slot = victim;
+        }
+    }
+
+    if( slot != -1 ) {
+        Voice& voice = mVoices[ slot ];
+        voice.data = cache.getData( sample );
+        voice.length = cache.getLength( sample );
+        voice.position = 0;
+        voice.gainLeft = gain * cosf( angle );
+        voice.gainRight = gain * sinf( angle );
+        voice.priority = priority;
+        voice.serial = mSerial++;
+        voice.active = true;
+    }
+
+    if( mDevice != 0 ) {
+        SDL_UnlockAudioDevice( mDevice );
+    }
+    return slot;
+}
+
+void LMixer::stopAll() {
+    if( mDevice != 0 ) {
+        SDL_LockAudioDevice( mDevice );
+    }
+    for( int i = 0; i < MAX_VOICES; ++i ) {
+        mVoices[ i ].active = false;
+    }
+    mActiveVoices = 0;
+    if( mDevice != 0 ) {
+        SDL_UnlockAudioDevice( mDevice );
+    }
+}
+
+void LMixer::audioCallback( void* userdata, Uint8* stream, int len ) {
+    ( (LMixer*)userdata )->mix( stream, len );
+}
+
+void LMixer::mix( Uint8* stream, int len ) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    int frames = len / ( 2 * SDL_AUDIO_BITSIZE( mSpec.format ) / 8 );
+    if( frames > (int)mLeft.size() ) {
+        frames = mLeft.size();
+    }
+    memset( mLeft.data(), 0, frames * sizeof( float ) );
+    memset( mRight.data(), 0, frames * sizeof( float ) );
+
+#if defined(MIXER_SSE2)
+    static bool hasSSE2 = __builtin_cpu_supports( "sse2" );
+    bool simd = mSimd && hasSSE2;
+#endif
+
+    // Acumula cada voz activa
+    int active = 0;
+    for( int i = 0; i < MAX_VOICES; ++i ) {
+        Voice& voice = mVoices[ i ];
+        if( !voice.active ) {
+            continue;
+        }
+
+        Uint32 remaining = voice.length - voice.position;
+        int count = remaining < (Uint32)frames ? remaining : frames;
+#if defined(MIXER_SSE2)
+        if( simd ) {
+            accumulateSSE2( voice.data + voice.position, count, voice.gainLeft, voice.gainRight,
+                    mLeft.data(), mRight.data() );
+        } else
+#endif
+        {
+            accumulateScalar( voice.data + voice.position, count, voice.gainLeft, voice.gainRight,
+                    mLeft.data(), mRight.data() );
+        }
+
+        voice.position += count;
+        if( voice.position >= voice.length ) {
+            voice.active = false;
+        } else {
+            ++active;
+        }
+    }
+    mActiveVoices = active;
+
+    // Convierte al formato del dispositivo
+#if defined(MIXER_SSE2)
+    if( simd ) {
+        convertSSE2( mLeft.data(), mRight.data(), frames, mSpec.format, stream );
+    } else
+#endif
+    {
+        convertScalar( mLeft.data(), mRight.data(), frames, mSpec.format, stream );
+    }
+
+    // Carga: ticks de mezcla frente a los que dura el buffer
+    Uint64 ticks = SDL_GetPerformanceCounter() - start;
+    Uint64 bufferTicks = (Uint64)frames * SDL_GetPerformanceFrequency() / mSpec.freq;
+    mMixTicks += ticks;
+    mBufferTicks += bufferTicks;
+    if( ticks * mPeakBufferTicks > mPeakTicks * bufferTicks ) {
+        mPeakTicks = ticks;
+        mPeakBufferTicks = bufferTicks;
+    }
+}
+
+void LMixer::accumulateScalar( const float* source, int count, float gainLeft, float gainRight,
+        float* left, float* right ) {
+    for( int i = 0; i < count; ++i ) {
+        left[ i ] += source[ i ] * gainLeft;
+        right[ i ] += source[ i ] * gainRight;
+    }
+}
+
+void LMixer::convertScalar( const float* left, const float* right, int frames,
+        SDL_AudioFormat format, Uint8* stream ) {
+    for( int i = 0; i < frames; ++i ) {
+        // Satura al rango de salida
+        float l = left[ i ] < -1.0f ? -1.0f : ( left[ i ] > 1.0f ? 1.0f : left[ i ] );
+        float r = right[ i ] < -1.0f ? -1.0f : ( right[ i ] > 1.0f ? 1.0f : right[ i ] );
+        if( format == AUDIO_S16SYS ) {
+            Sint16* out = (Sint16*)stream;
+            out[ 2 * i ] = (Sint16)lrintf( l * 32767.0f );
+            out[ 2 * i + 1 ] = (Sint16)lrintf( r * 32767.0f );
+        } else {
+            float* out = (float*)stream;
+            out[ 2 * i ] = l;
+            out[ 2 * i + 1 ] = r;
+        }
+    }
+}
+
+#if defined(MIXER_SSE2)
+__attribute__(( target( "sse2" ) ))
+void LMixer::accumulateSSE2( const float* source, int count, float gainLeft, float gainRight,
+        float* left, float* right ) {
+    __m128 gl = _mm_set1_ps( gainLeft );
+    __m128 gr = _mm_set1_ps( gainRight );
+
+    // Cuatro muestras por instrucción
+    int i = 0;
+    for( ; i + 4 <= count; i += 4 ) {
+        __m128 s = _mm_loadu_ps( source + i );
+        _mm_storeu_ps( left + i, _mm_add_ps( _mm_loadu_ps( left + i ), _mm_mul_ps( s, gl ) ) );
+        _mm_storeu_ps( right + i, _mm_add_ps( _mm_loadu_ps( right + i ), _mm_mul_ps( s, gr ) ) );
+    }
+    accumulateScalar( source + i, count - i, gainLeft, gainRight, left + i, right + i );
+}
+
+__attribute__(( target( "sse2" ) ))
+void LMixer::convertSSE2( const float* left, const float* right, int frames,
+        SDL_AudioFormat format, Uint8* stream ) {
+    __m128 low = _mm_set1_ps( -1.0f );
+    __m128 high = _mm_set1_ps( 1.0f );
+    __m128 scale = _mm_set1_ps( 32767.0f );
+
+    int i = 0;
+    for( ; i + 4 <= frames; i += 4 ) {
+        __m128 l = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( left + i ), low ), high );
+        __m128 r = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( right + i ), low ), high );
+        if( format == AUDIO_S16SYS ) {
+            // Intercala los canales y empaqueta a 16 bits con saturación
+            __m128i li = _mm_cvtps_epi32( _mm_mul_ps( l, scale ) );
+            __m128i ri = _mm_cvtps_epi32( _mm_mul_ps( r, scale ) );
+            __m128i packed = _mm_packs_epi32( _mm_unpacklo_epi32( li, ri ), _mm_unpackhi_epi32( li, ri ) );
+            _mm_storeu_si128( (__m128i*)( stream + i * 4 ), packed );
+        } else {
+            float* out = (float*)stream + i * 2;
+            _mm_storeu_ps( out, _mm_unpacklo_ps( l, r ) );
+            _mm_storeu_ps( out + 4, _mm_unpackhi_ps( l, r ) );
+        }
+    }
+    int bytesPerFrame = format == AUDIO_S16SYS ? 4 : 8;
+    convertScalar( left + i, right + i, frames - i, format, stream + i * bytesPerFrame );
+}
+#endif
+
+void LMixer::setSimd( bool simd ) {
+    mSimd = simd;
+}
+
+int LMixer::getFrequency() {
+    return mSpec.freq;
+}
+
+int LMixer::getActiveVoices() {
+    return mActiveVoices;
+}
+
+int LMixer::getSteals() {
+    return mSteals;
+}
+
+int LMixer::getRejected() {
+    return mRejected;
+}
+
+double LMixer::getAverageLoad() {
+    Uint64 bufferTicks = mBufferTicks;
+    return bufferTicks > 0 ? (double)mMixTicks / bufferTicks : 0.0;
+}
+
+double LMixer::getPeakLoad() {
+    Uint64 bufferTicks = mPeakBufferTicks;
+    return bufferTicks > 0 ? (double)mPeakTicks / bufferTicks : 0.0;
+}
+
+void LMixer::resetLoad() {
+    // El callback acumula sobre estos contadores; sin el bloqueo podría
+    // mezclar valores viejos y nuevos
+    if( mDevice != 0 ) {
+        SDL_LockAudioDevice( mDevice );
+    }
+    mMixTicks = 0;
+    mBufferTicks = 0;
+    mPeakTicks = 0;
+    mPeakBufferTicks = 1;
+    if( mDevice != 0 ) {
+        SDL_UnlockAudioDevice( mDevice );
+    }
+}
+
 bool init() {
     // Bandera
     bool success = true;
@@ -275,7 +1299,11 @@ bool init() {
                             Mix_GetError() );
                     success = false;
                 }
-                
+
+                // Los efectos van por un dispositivo aparte con el mezclador propio
+                if( !gMixer.open( 44100, MIXER_SAMPLES ) ) {
+                    success = false;
+                }
             }
         }
     }
@@ -286,6 +1314,13 @@ bool init() {
 bool loadMedia() {
     // Bandera
     bool success = true;
+
+    // Un solo archivo mapeado en vez de abrir cada uno
+    if( gRomfs.open( ROMFS_PACK, "romfs" ) ) {
+        printf( "Leyendo %s: %d entradas\n", ROMFS_PACK, gRomfs.getEntryCount() );
+    } else {
+        printf( "Warning: No se encontró %s, se leen los archivos de romfs/\n", ROMFS_PACK );
+    }
     
     // Carga la textura
     if( !gSplashTexture.loadFromFile( "romfs/splash.png" ) ) {
@@ -294,36 +1329,22 @@ bool loadMedia() {
     }
     
     // Carga la música
-    gMusic = Mix_LoadMUS( "romfs/beat.wav" );
-    if( gMusic == NULL ) {
-        printf( "No se pudo cargar el efecto de sonido! SDL_mixer Error: %s\n",
-                Mix_GetError() );
-        success = false;
-    }
-    gScratch = Mix_LoadWAV( "romfs/scratch.wav" );
+    gMusic = Mix_LoadMUS_RW( gRomfs.openRW( "romfs/beat.wav" ), 1 );
     if( gMusic == NULL ) {
         printf( "No se pudo cargar el efecto de sonido! SDL_mixer Error: %s\n",
                 Mix_GetError() );
         success = false;
     }
-    gHigh = Mix_LoadWAV( "romfs/high.wav" );
-    if( gMusic == NULL ) {
-        printf( "No se pudo cargar el efecto de sonido! SDL_mixer Error: %s\n",
-                Mix_GetError() );
-        success = false;
-    }
-    gMedium = Mix_LoadWAV( "romfs/medium.wav" );
-    if( gMusic == NULL ) {
-        printf( "No se pudo cargar el efecto de sonido! SDL_mixer Error: %s\n",
-                Mix_GetError() );
-        success = false;
-    }
-    gLow = Mix_LoadWAV( "romfs/low.wav" );
-    if( gMusic == NULL ) {
-        printf( "No se pudo cargar el efecto de sonido! SDL_mixer Error: %s\n",
-                Mix_GetError() );
+
+    // Carga los efectos a la frecuencia del mezclador, desde la caché si se puede
+    Uint64 start = SDL_GetPerformanceCounter();
+    if( !gSamples.build( gMixer.getFrequency(), "romfs/sfx.cache" ) ) {
+        printf( "No se pudo cargar el efecto de sonido!\n" );
         success = false;
     }
+    printf( "Carga de efectos: %.2f ms (%s)\n",
+            ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency(),
+            gSamples.isFromCache() ? "caché" : "decodificados" );
 
 
     return success;
@@ -334,18 +1355,16 @@ void close() {
     gSplashTexture.free();
 
     // Libera los efectos
-    Mix_FreeChunk( gScratch );
-    Mix_FreeChunk( gHigh );
-    Mix_FreeChunk( gMedium );
-    Mix_FreeChunk( gLow );
-    gScratch = NULL;
-    gHigh = NULL;
-    gMedium = NULL;
-    gLow = NULL;
-
-    // Libera la música
+    printf( "Mezclador: carga media %.2f%%, pico %.2f%%, %d voces robadas, %d rechazadas\n",
+            gMixer.getAverageLoad() * 100.0, gMixer.getPeakLoad() * 100.0, gMixer.getSteals(),
+            gMixer.getRejected() );
+    gMixer.close();
+    gSamples.free();
+
+    // Libera la música; se lee del paquete mientras suena
     Mix_FreeMusic( gMusic );
     gMusic = NULL;
+    gRomfs.close();
 
     // Destruye la ventana
     SDL_DestroyRenderer( gRenderer );
@@ -358,7 +1377,90 @@ void close() {
     SDL_Quit();
 }
 
+std::string getTempPath( const char* name ) {
+    // TMPDIR si está definido; si no, el directorio temporal del sistema
+    const char* dir = getenv( "TMPDIR" );
+    if( dir == NULL || dir[ 0 ] == '\0' ) {
+        dir = "/tmp";
+    }
+    std::string path = dir;
+    if( path[ path.size() - 1 ] != '/' ) {
+        path += '/';
+    }
+    return path + name;
+}
+
+void benchmarkMixer( int voices, SDL_AudioFormat format, int buffers ) {
+    // Dos mezcladores con las mismas voces: uno escalar y otro vectorial
+    LMixer scalar;
+    LMixer simd;
+    scalar.openOffline( 44100, format, MIXER_SAMPLES );
+    simd.openOffline( 44100, format, MIXER_SAMPLES );
+    scalar.setSimd( false );
+    simd.setSimd( true );
+
+    int samples[] = { gHigh, gMedium, gLow, gScratch };
+    int bytes = MIXER_SAMPLES * 2 * SDL_AUDIO_BITSIZE( format ) / 8;
+    std::vector<Uint8> scalarOut( bytes );
+    std::vector<Uint8> simdOut( bytes );
+    int mismatches = 0;
+    Uint32 seed = 1;
+
+    for( int b = 0; b < buffers; ++b ) {
+        // Mantiene el número de voces relanzando las que terminan
+        int active = scalar.getActiveVoices();
+        for( int v = active; v < voices; ++v ) {
+            seed = seed * 1103515245 + 12345;
+            int sample = samples[ ( seed >> 16 ) % 4 ];
+            float pan = ( ( seed >> 8 ) % 201 ) / 100.0f - 1.0f;
+            scalar.play( gSamples, sample, 0.05f, pan, 0 );
+            simd.play( gSamples, sample, 0.05f, pan, 0 );
+        }
+
+        scalar.mix( scalarOut.data(), bytes );
+        simd.mix( simdOut.data(), bytes );
+        if( memcmp( scalarOut.data(), simdOut.data(), bytes ) != 0 ) {
+            mismatches++;
+        }
+    }
+
+    printf( "%3d voces, %s: escalar %.2f%% (pico %.2f%%), vectorial %.2f%% (pico %.2f%%), %d diferencias\n",
+            voices, format == AUDIO_S16SYS ? "int16" : "float", scalar.getAverageLoad() * 100.0,
+            scalar.getPeakLoad() * 100.0, simd.getAverageLoad() * 100.0, simd.getPeakLoad() * 100.0,
+            mismatches );
+}
+
 int main( int argc, char* argv[] ) {
+    // Modo de medición sin dispositivo de audio
+    if( argc > 1 && strcmp( argv[ 1 ], "--bench" ) == 0 ) {
+        SDL_Init( 0 );
+        gRomfs.open( ROMFS_PACK, "romfs" );
+
+        // Carga de los efectos decodificando y desde la caché; con su propia
+        // caché para no borrar la del juego
+        std::string cachePath = getTempPath( "sfx.bench.cache" );
+        remove( cachePath.c_str() );
+        for( int i = 0; i < 2; ++i ) {
+            Uint64 start = SDL_GetPerformanceCounter();
+            if( !gSamples.build( 44100, cachePath.c_str() ) ) {
+                return -1;
+            }
+            printf( "Carga de efectos: %.3f ms (%s)\n",
+                    ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency(),
+                    gSamples.isFromCache() ? "caché" : "decodificados" );
+        }
+        remove( cachePath.c_str() );
+
+        int voiceCounts[] = { 8, 64, 256, LMixer::MAX_VOICES };
+        for( int i = 0; i < 4; ++i ) {
+            benchmarkMixer( voiceCounts[ i ], AUDIO_F32SYS, 2000 );
+            benchmarkMixer( voiceCounts[ i ], AUDIO_S16SYS, 2000 );
+        }
+
+        SDL_Quit();
+        return 0;
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -374,6 +1476,9 @@ int main( int argc, char* argv[] ) {
 
     SDL_Event e; 
 
+    // Última vez que se mostró la carga del mezclador
+    Uint32 loadTime = SDL_GetTicks();
+
     while( !quit ) {
         while( SDL_PollEvent( &e ) != 0 ) {
             switch( e.type ) {
@@ -390,19 +1495,28 @@ int main( int argc, char* argv[] ) {
                               break;
 
                           case SDLK_1:
-                              Mix_PlayChannel( -1, gHigh, 0 );
+                              gMixer.play( gSamples, gHigh, 0.8f, 0.0f, 1 );
                               break;
 
                           case SDLK_2:
-                              Mix_PlayChannel( -1, gMedium, 0 );
+                              gMixer.play( gSamples, gMedium, 0.8f, 0.0f, 1 );
                               break;
 
                           case SDLK_3:
-                              Mix_PlayChannel( -1, gLow, 0 );
+                              gMixer.play( gSamples, gLow, 0.8f, 0.0f, 1 );
                               break;
 
                           case SDLK_4:
-                              Mix_PlayChannel( -1, gScratch, 0 );
+                              // El scratch tiene prioridad sobre el resto
+                              gMixer.play( gSamples, gScratch, 0.8f, 0.0f, 2 );
+                              break;
+
+                          case SDLK_5:
+                              // Ráfaga de voces de baja prioridad repartidas en el panorama
+                              for( int i = 0; i < 128; ++i ) {
+                                  int samples[] = { gHigh, gMedium, gLow };
+                                  gMixer.play( gSamples, samples[ i % 3 ], 0.05f, ( rand() % 201 ) / 100.0f - 1.0f, 0 );
+                              }
                               break;
 
                           case SDLK_9:
@@ -433,6 +1547,16 @@ int main( int argc, char* argv[] ) {
 
             }
         }
+        // Muestra la carga del mezclador una vez por segundo
+        if( SDL_GetTicks() - loadTime >= 1000 ) {
+            char title[ 128 ];
+            snprintf( title, sizeof( title ), "SDL Tutorial 21 - %d voces, mezcla %.2f%% del buffer (pico %.2f%%)",
+                    gMixer.getActiveVoices(), gMixer.getAverageLoad() * 100.0, gMixer.getPeakLoad() * 100.0 );
+            SDL_SetWindowTitle( gWindow, title );
+            gMixer.resetLoad();
+            loadTime = SDL_GetTicks();
+        }
+
         // Limpia la pantalla
         SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
         SDL_RenderClear( gRenderer );
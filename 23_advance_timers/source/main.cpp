@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string>
+#include <string.h>
 #include <sstream>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -19,9 +20,6 @@ class LTexture {
 
         // Carga la imagen en el path especificado
         bool loadFromFile( std::string path );
- 
-        // Crea una imagen desde un font string
-        bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
 
         // Establece la modulación de color
         void setColor( Uint8 red, Uint8 green, Uint8 blue );
@@ -189,6 +187,67 @@ bool LTimer::isPaused()
     return mPaused && mStarted;
 }
 
+// Atlas de glifos: cada glifo se rasteriza una sola vez y el texto se dibuja
+// como quads de una única textura, sin crear texturas al cambiar el texto
+class LGlyphAtlas {
+    public:
+        // Dimensiones de la textura del atlas
+        static const int ATLAS_SIZE = 512;
+
+        // Inicializa las variables
+        LGlyphAtlas();
+
+        // Libera la memoria
+        ~LGlyphAtlas();
+
+        // Crea el atlas vacío para la fuente dada
+        bool loadFromFont( TTF_Font* font );
+
+        // Libera el atlas
+        void free();
+
+        // Renderiza el texto en un punto dado
+        void render( int x, int y, const char* text, SDL_Color color );
+
+        // Obtiene las dimensiones del texto sin renderizarlo
+        int getTextWidth( const char* text );
+        int getTextHeight();
+
+        // Estadísticas de la caché
+        double getHitRate();
+        double getOccupancy();
+
+    private:
+        struct Glyph {
+            SDL_Rect clip;
+            int advance;
+            bool loaded;
+        };
+
+        // Obtiene el glifo, rasterizándolo la primera vez
+        Glyph& getGlyph( Uint8 ch );
+
+        // La textura del atlas
+        SDL_Texture* mTexture;
+        TTF_Font* mFont;
+
+        // Un glifo por cada byte Latin-1
+        Glyph mGlyphs[ 256 ];
+
+        // Empaquetado por estantes
+        int mShelfX;
+        int mShelfY;
+        int mShelfHeight;
+        int mUsedPixels;
+
+        // Aciertos y fallos de la caché
+        Uint64 mHits;
+        Uint64 mMisses;
+
+        // Buffer para expandir un glifo a ARGB antes de subirlo
+        Uint32* mPixels;
+};
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -207,11 +266,12 @@ SDL_Renderer* gRenderer = NULL;
 // Fuente usada globalmente
 TTF_Font *gFont = NULL;
 
-// Textura
-LTexture gStartPromptTexture;
-LTexture gPausePromptTexture;
-LTexture gTimeTextTexture;
-LTexture gTicksTextTexture;
+// Atlas de glifos de la fuente global
+LGlyphAtlas gTextAtlas;
+
+// Textos de las instrucciones
+const char* gStartPromptText = "Press S to Start or Stop the Timer";
+const char* gPausePromptText = "Press P to Pause or Unpause the Timer";
 
 LTexture::LTexture() {
     // Inicializa la textura
@@ -266,35 +326,6 @@ bool LTexture::loadFromFile( std::string path ) {
     return mTexture != NULL;
 }
 
-bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColor ) {
-    // Manejar la textura existente
-    free();
-
-    // Renderiza desde la superficie del texto
-    SDL_Surface* textSurface = TTF_RenderText_Solid( gFont, textureText.c_str(), textColor );
-    if( textSurface == NULL ) {
-        printf( "No se pudo renderizar la superficie del texto! SDL_ttf Error: %s\n", 
-                TTF_GetError() );
-    } else {
-        // Crea una textura desde la superficie de pixeles
-        mTexture = SDL_CreateTextureFromSurface( gRenderer, textSurface );
-        if( mTexture == NULL ) {
-            printf( "No se pudo crear la textura desde el texto renderizado! SDL Error: %s\n",
-                    SDL_GetError() );
-        } else {
-            // Obtiene las dimensiones de la imagen
-            mWidth = textSurface->w;
-            mHeight = textSurface->h;
-        }
-
-        // Manejar la anterior superficie
-        SDL_FreeSurface( textSurface );
-    }
-
-    // Devuelve la textura
-    return mTexture != NULL;
-}
-
 void LTexture::setColor( Uint8 red, Uint8 green, Uint8 blue ) {
     // Textura modulada
     SDL_SetTextureColorMod( mTexture, red, green, blue );
@@ -350,6 +381,161 @@ void LTexture::setHeight( int h ) {
     mHeight = h;
 }
 
+LGlyphAtlas::LGlyphAtlas() {
+    // Inicializa las variables
+    mTexture = NULL;
+    mFont = NULL;
+    mPixels = NULL;
+    free();
+}
+
+LGlyphAtlas::~LGlyphAtlas() {
+    // Libera la memoria
+    free();
+}
+
+bool LGlyphAtlas::loadFromFont( TTF_Font* font ) {
+    // Maneja el atlas preexistente
+    free();
+
+    // Textura ARGB en blanco; el color se aplica con la modulación
+    mTexture = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+            ATLAS_SIZE, ATLAS_SIZE );
+    if( mTexture == NULL ) {
+        printf( "No se pudo crear la textura del atlas! SDL Error: %s\n", SDL_GetError() );
+        return false;
+    }
+    SDL_SetTextureBlendMode( mTexture, SDL_BLENDMODE_BLEND );
+
+    // Limpia el atlas a transparente
+    mPixels = new Uint32[ ATLAS_SIZE * ATLAS_SIZE ];
+    memset( mPixels, 0, ATLAS_SIZE * ATLAS_SIZE * sizeof( Uint32 ) );
+    SDL_UpdateTexture( mTexture, NULL, mPixels, ATLAS_SIZE * sizeof( Uint32 ) );
+
+    mFont = font;
+    return true;
+}
+
+void LGlyphAtlas::free() {
+    // Libera la textura si existe
+    if( mTexture != NULL ) {
+        SDL_DestroyTexture( mTexture );
+        mTexture = NULL;
+    }
+    delete[] mPixels;
+    mPixels = NULL;
+    mFont = NULL;
+
+    // Vacía la caché
+    for( int i = 0; i < 256; ++i ) {
+        mGlyphs[ i ].loaded = false;
+    }
+    mShelfX = 0;
+    mShelfY = 0;
+    mShelfHeight = 0;
+    mUsedPixels = 0;
+    mHits = 0;
+    mMisses = 0;
+}
+
+LGlyphAtlas::Glyph& LGlyphAtlas::getGlyph( Uint8 ch ) {
+    Glyph& glyph = mGlyphs[ ch ];
+    if( glyph.loaded ) {
+        ++mHits;
+        return glyph;
+    }
+    ++mMisses;
+
+    // Un glifo sin espacio o sin imagen se queda con el clip vacío
+    glyph.loaded = true;
+    glyph.clip = { 0, 0, 0, 0 };
+    glyph.advance = 0;
+
+    int minX, maxX, minY, maxY;
+    if( TTF_GlyphMetrics( mFont, ch, &minX, &maxX, &minY, &maxY, &glyph.advance ) != 0 ) {
+        return glyph;
+    }
+
+    // Los glifos sin tinta (p. ej. el espacio) sólo tienen avance
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface* glyphSurface = TTF_RenderGlyph_Solid( mFont, ch, white );
+    if( glyphSurface == NULL ) {
+        return glyph;
+    }
+
+    // Busca un hueco en el estante actual o abre uno nuevo
+    int w = glyphSurface->w;
+    int h = glyphSurface->h;
+    if( mShelfX + w + 1 > ATLAS_SIZE ) {
+        mShelfX = 0;
+        mShelfY += mShelfHeight + 1;
+        mShelfHeight = 0;
+    }
+    if( w + 1 > ATLAS_SIZE || mShelfY + h + 1 > ATLAS_SIZE ) {
+        printf( "Warning: el atlas de glifos está lleno, no cabe '%c'!\n", ch );
+        SDL_FreeSurface( glyphSurface );
+        return glyph;
+    }
+
+    // Expande los píxeles indexados a blanco opaco o transparente
+    Uint8* src = (Uint8*)glyphSurface->pixels;
+    for( int y = 0; y < h; ++y ) {
+        for( int x = 0; x < w; ++x ) {
+            mPixels[ y * w + x ] = src[ y * glyphSurface->pitch + x ] != 0 ? 0xFFFFFFFF : 0;
+        }
+    }
+
+    glyph.clip = { mShelfX, mShelfY, w, h };
+    SDL_UpdateTexture( mTexture, &glyph.clip, mPixels, w * sizeof( Uint32 ) );
+
+    mShelfX += w + 1;
+    if( h > mShelfHeight ) {
+        mShelfHeight = h;
+    }
+    mUsedPixels += w * h;
+
+    SDL_FreeSurface( glyphSurface );
+    return glyph;
+}
+
+void LGlyphAtlas::render( int x, int y, const char* text, SDL_Color color ) {
+    if( mTexture == NULL ) {
+        return;
+    }
+
+    // Todos los glifos comparten textura, así que el renderizador los agrupa
+    SDL_SetTextureColorMod( mTexture, color.r, color.g, color.b );
+    for( const char* c = text; *c != '\0'; ++c ) {
+        Glyph& glyph = getGlyph( (Uint8)*c );
+        if( glyph.clip.w > 0 ) {
+            SDL_Rect renderQuad = { x, y, glyph.clip.w, glyph.clip.h };
+            SDL_RenderCopy( gRenderer, mTexture, &glyph.clip, &renderQuad );
+        }
+        x += glyph.advance;
+    }
+}
+
+int LGlyphAtlas::getTextWidth( const char* text ) {
+    int width = 0;
+    for( const char* c = text; *c != '\0'; ++c ) {
+        width += getGlyph( (Uint8)*c ).advance;
+    }
+    return width;
+}
+
+int LGlyphAtlas::getTextHeight() {
+    return mFont != NULL ? TTF_FontHeight( mFont ) : 0;
+}
+
+double LGlyphAtlas::getHitRate() {
+    Uint64 total = mHits + mMisses;
+    return total > 0 ? (double)mHits / total : 0.0;
+}
+
+double LGlyphAtlas::getOccupancy() {
+    return (double)mUsedPixels / ( ATLAS_SIZE * ATLAS_SIZE );
+}
+
 bool init() {
     // Bandera
     bool success = true;
@@ -414,25 +600,23 @@ bool loadMedia() {
         printf( "Falló la carga de la fuente! SDL_ttf Error: %s\n", TTF_GetError() );
         success = false;
     } else {
-        // Renderiza el texto
-        SDL_Color textColor = { 0x00, 0x00, 0x00, 0xFF };
-        if( !gStartPromptTexture.loadFromRenderedText( "Press S to Start or Stop the Timer", 
-                    textColor ) ) {
-            printf( "Falló la carga de la textura del texto!\n" );
+        // Crea el atlas; los glifos se rasterizan al usarse por primera vez
+        if( !gTextAtlas.loadFromFont( gFont ) ) {
+            printf( "Falló la carga del atlas de glifos!\n" );
             success = false;
         }
-        gPausePromptTexture.loadFromRenderedText( "Press P to Pause or Unpause the Timer", textColor );
-        // gTicksTextTexture.loadFromRenderedText( "", textColor );
     }
 
     return success;
 }
 
 void close() {
-    // Libera la textura cargada
-    gStartPromptTexture.free();
-    gPausePromptTexture.free();
-    gTimeTextTexture.free();
+    // Estadísticas del atlas de glifos
+    printf( "Atlas de glifos: %.2f%% aciertos, %.2f%% ocupado\n",
+            gTextAtlas.getHitRate() * 100.0, gTextAtlas.getOccupancy() * 100.0 );
+
+    // Libera el atlas
+    gTextAtlas.free();
 
     // Libera la fuente global
     TTF_CloseFont( gFont );
@@ -521,24 +705,22 @@ int main( int argc, char* argv[] ) {
         ticksText.str( "" );
         ticksText << (timer.getTicks() / 1000.f );
 
-        // Renderiza el texto
-        if( !gTimeTextTexture.loadFromRenderedText( timeText.str().c_str(), textColor ) ) {
-            printf( "No se pudo renderizar la textura del tiempo!\n" );
-        }
-
-        gTicksTextTexture.loadFromRenderedText( ticksText.str().c_str(), textColor );
         // Limpia la pantalla
         SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
         SDL_RenderClear( gRenderer );
         
-        // Renderiza la textura del texto
-        gStartPromptTexture.render( ( SCREEN_WIDTH - gStartPromptTexture.getWidth() ) / 2, 0 );
-        gPausePromptTexture.render( ( SCREEN_WIDTH - gPausePromptTexture.getWidth() ) / 2,
-                ( gStartPromptTexture.getHeight() ) );
-        gTimeTextTexture.render( ( SCREEN_WIDTH - gTimeTextTexture.getWidth() ) / 2,
-                ( SCREEN_HEIGHT - gTimeTextTexture.getHeight() ) / 2 );
-        gTicksTextTexture.render( ( SCREEN_WIDTH - gTicksTextTexture.getWidth() ) / 2,
-                ( SCREEN_HEIGHT - gTicksTextTexture.getHeight() ) / 2 + FONT_SIZE );
+        // Renderiza el texto desde el atlas; cambiar el texto no crea texturas
+        std::string time = timeText.str();
+        std::string ticks = ticksText.str();
+        int textHeight = gTextAtlas.getTextHeight();
+        gTextAtlas.render( ( SCREEN_WIDTH - gTextAtlas.getTextWidth( gStartPromptText ) ) / 2, 0,
+                gStartPromptText, textColor );
+        gTextAtlas.render( ( SCREEN_WIDTH - gTextAtlas.getTextWidth( gPausePromptText ) ) / 2,
+                textHeight, gPausePromptText, textColor );
+        gTextAtlas.render( ( SCREEN_WIDTH - gTextAtlas.getTextWidth( time.c_str() ) ) / 2,
+                ( SCREEN_HEIGHT - textHeight ) / 2, time.c_str(), textColor );
+        gTextAtlas.render( ( SCREEN_WIDTH - gTextAtlas.getTextWidth( ticks.c_str() ) ) / 2,
+                ( SCREEN_HEIGHT - textHeight ) / 2 + FONT_SIZE, ticks.c_str(), textColor );
 
         // Actualiza la pantalla
         SDL_RenderPresent( gRenderer );
@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <string>
-#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+#include <new>
+#include <charconv>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
@@ -22,9 +25,6 @@ class LTexture {
 
         // Carga la imagen en el path especificado
         bool loadFromFile( std::string path );
- 
-        // Crea una imagen desde un font string
-        bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
 
         // Establece la modulación de color
         void setColor( Uint8 red, Uint8 green, Uint8 blue );
@@ -192,6 +192,109 @@ bool LTimer::isPaused()
     return mPaused && mStarted;
 }
 
+// Atlas de glifos: cada glifo se rasteriza una sola vez y el texto se dibuja
+// como quads de una única textura, sin crear texturas al cambiar el texto
+class LGlyphAtlas {
+    public:
+        // Dimensiones de la textura del atlas
+        static const int ATLAS_SIZE = 512;
+
+        // Inicializa las variables
+        LGlyphAtlas();
+
+        // Libera la memoria
+        ~LGlyphAtlas();
+
+        // Crea el atlas vacío para la fuente dada
+        bool loadFromFont( TTF_Font* font );
+
+        // Libera el atlas
+        void free();
+
+        // Renderiza el texto en un punto dado
+        void render( int x, int y, const char* text, SDL_Color color );
+
+        // Obtiene las dimensiones del texto sin renderizarlo
+        int getTextWidth( const char* text );
+        int getTextHeight();
+
+        // Estadísticas de la caché
+        double getHitRate();
+        double getOccupancy();
+
+    private:
+        struct Glyph {
+            SDL_Rect clip;
+            int advance;
+            bool loaded;
+        };
+
+        // Obtiene el glifo, rasterizándolo la primera vez
+        Glyph& getGlyph( Uint8 ch );
+
+        // La textura del atlas
+        SDL_Texture* mTexture;
+        TTF_Font* mFont;
+
+        // Un glifo por cada byte Latin-1
+        Glyph mGlyphs[ 256 ];
+
+        // Empaquetado por estantes
+        int mShelfX;
+        int mShelfY;
+        int mShelfHeight;
+        int mUsedPixels;
+
+        // Aciertos y fallos de la caché
+        Uint64 mHits;
+        Uint64 mMisses;
+
+        // Buffer para expandir un glifo a ARGB antes de subirlo
+        Uint32* mPixels;
+};
+
+// Texto de HUD con un prefijo fijo y un valor numérico. El valor se formatea
+// en un buffer propio con std::to_chars y el texto sólo se vuelve a maquetar
+// cuando lo mostrado cambia
+class LHudText {
+    public:
+        // Longitud máxima del texto, incluido el prefijo
+        static const int MAX_LENGTH = 128;
+
+        // Inicializa las variables
+        LHudText();
+
+        // Establece el texto fijo que precede al valor
+        void setPrefix( const char* prefix );
+
+        // Establece el valor a mostrar
+        void setInt( long value );
+        void setFloat( float value );
+
+        // Renderiza el texto con el atlas global
+        void render( int x, int y, SDL_Color color );
+
+        // Obtiene el texto y su ancho
+        const char* getText();
+        int getWidth();
+
+        // Veces que el texto ha tenido que maquetarse de nuevo
+        Uint64 getRelayouts();
+
+    private:
+        // Copia el valor formateado si es distinto del actual
+        void update( const char* value, int length );
+
+        // Texto mostrado y longitud del prefijo
+        char mText[ MAX_LENGTH ];
+        int mPrefixLength;
+        int mLength;
+
+        // Ancho en píxeles, -1 si hay que recalcularlo
+        int mWidth;
+        Uint64 mRelayouts;
+};
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -201,6 +304,27 @@ bool loadMedia();
 // Libera la memoria y termina SDL
 void close();
 
+// Contador de reservas en el heap, para comprobar que el HUD no reserva
+// memoria en cada fotograma
+Uint64 gHeapAllocations = 0;
+
+void* operator new( size_t size ) {
+    ++gHeapAllocations;
+    void* p = malloc( size > 0 ? size : 1 );
+    if( p == NULL ) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete( void* p ) noexcept {
+    free( p );
+}
+
+void operator delete( void* p, size_t size ) noexcept {
+    free( p );
+}
+
 // Ventana donde se renderizará
 SDL_Window* gWindow = NULL;
 
@@ -210,8 +334,8 @@ SDL_Renderer* gRenderer = NULL;
 // Fuente usada globalmente
 TTF_Font *gFont = NULL;
 
-// Textura
-LTexture gFPSTextTexture;
+// Atlas de glifos de la fuente global
+LGlyphAtlas gTextAtlas;
 
 LTexture::LTexture() {
     // Inicializa la textura
@@ -266,35 +390,6 @@ bool LTexture::loadFromFile( std::string path ) {
     return mTexture != NULL;
 }
 
-bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColor ) {
-    // Manejar la textura existente
-    free();
-
-    // Renderiza desde la superficie del texto
-    SDL_Surface* textSurface = TTF_RenderText_Solid( gFont, textureText.c_str(), textColor );
-    if( textSurface == NULL ) {
-        printf( "No se pudo renderizar la superficie del texto! SDL_ttf Error: %s\n", 
-                TTF_GetError() );
-    } else {
-        // Crea una textura desde la superficie de pixeles
-        mTexture = SDL_CreateTextureFromSurface( gRenderer, textSurface );
-        if( mTexture == NULL ) {
-            printf( "No se pudo crear la textura desde el texto renderizado! SDL Error: %s\n",
-                    SDL_GetError() );
-        } else {
-            // Obtiene las dimensiones de la imagen
-            mWidth = textSurface->w;
-            mHeight = textSurface->h;
-        }
-
-        // Manejar la anterior superficie
-        SDL_FreeSurface( textSurface );
-    }
-
-    // Devuelve la textura
-    return mTexture != NULL;
-}
-
 void LTexture::setColor( Uint8 red, Uint8 green, Uint8 blue ) {
     // Textura modulada
     SDL_SetTextureColorMod( mTexture, red, green, blue );
@@ -350,6 +445,230 @@ void LTexture::setHeight( int h ) {
     mHeight = h;
 }
 
+LGlyphAtlas::LGlyphAtlas() {
+    // Inicializa las variables
+    mTexture = NULL;
+    mFont = NULL;
+    mPixels = NULL;
+    free();
+}
+
+LGlyphAtlas::~LGlyphAtlas() {
+    // Libera la memoria
+    free();
+}
+
+bool LGlyphAtlas::loadFromFont( TTF_Font* font ) {
+    // Maneja el atlas preexistente
+    free();
+
+    // Textura ARGB en blanco; el color se aplica con la modulación
+    mTexture = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+            ATLAS_SIZE, ATLAS_SIZE );
+    if( mTexture == NULL ) {
+        printf( "No se pudo crear la textura del atlas! SDL Error: %s\n", SDL_GetError() );
+        return false;
+    }
+    SDL_SetTextureBlendMode( mTexture, SDL_BLENDMODE_BLEND );
+
+    // Limpia el atlas a transparente
+    mPixels = new Uint32[ ATLAS_SIZE * ATLAS_SIZE ];
+    memset( mPixels, 0, ATLAS_SIZE * ATLAS_SIZE * sizeof( Uint32 ) );
+    SDL_UpdateTexture( mTexture, NULL, mPixels, ATLAS_SIZE * sizeof( Uint32 ) );
+
+    mFont = font;
+    return true;
+}
+
+void LGlyphAtlas::free() {
+    // Libera la textura si existe
+    if( mTexture != NULL ) {
+        SDL_DestroyTexture( mTexture );
+        mTexture = NULL;
+    }
+    delete[] mPixels;
+    mPixels = NULL;
+    mFont = NULL;
+
+    // Vacía la caché
+    for( int i = 0; i < 256; ++i ) {
+        mGlyphs[ i ].loaded = false;
+    }
+    mShelfX = 0;
+    mShelfY = 0;
+    mShelfHeight = 0;
+    mUsedPixels = 0;
+    mHits = 0;
+    mMisses = 0;
+}
+
+LGlyphAtlas::Glyph& LGlyphAtlas::getGlyph( Uint8 ch ) {
+    Glyph& glyph = mGlyphs[ ch ];
+    if( glyph.loaded ) {
+        ++mHits;
+        return glyph;
+    }
+    ++mMisses;
+
+    // Un glifo sin espacio o sin imagen se queda con el clip vacío
+    glyph.loaded = true;
+    glyph.clip = { 0, 0, 0, 0 };
+    glyph.advance = 0;
+
+    int minX, maxX, minY, maxY;
+    if( TTF_GlyphMetrics( mFont, ch, &minX, &maxX, &minY, &maxY, &glyph.advance ) != 0 ) {
+        return glyph;
+    }
+
+    // Los glifos sin tinta (p. ej. el espacio) sólo tienen avance
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface* glyphSurface = TTF_RenderGlyph_Solid( mFont, ch, white );
+    if( glyphSurface == NULL ) {
+        return glyph;
+    }
+
+    // Busca un hueco en el estante actual o abre uno nuevo
+    int w = glyphSurface->w;
+    int h = glyphSurface->h;
+    if( mShelfX + w + 1 > ATLAS_SIZE ) {
+        mShelfX = 0;
+        mShelfY += mShelfHeight + 1;
+        mShelfHeight = 0;
+    }
+    if( w + 1 > ATLAS_SIZE || mShelfY + h + 1 > ATLAS_SIZE ) {
+        printf( "Warning: el atlas de glifos está lleno, no cabe '%c'!\n", ch );
+        SDL_FreeSurface( glyphSurface );
+        return glyph;
+    }
+
+    // Expande los píxeles indexados a blanco opaco o transparente
+    Uint8* src = (Uint8*)glyphSurface->pixels;
+    for( int y = 0; y < h; ++y ) {
+        for( int x = 0; x < w; ++x ) {
+            mPixels[ y * w + x ] = src[ y * glyphSurface->pitch + x ] != 0 ? 0xFFFFFFFF : 0;
+        }
+    }
+
+    glyph.clip = { mShelfX, mShelfY, w, h };
+    SDL_UpdateTexture( mTexture, &glyph.clip, mPixels, w * sizeof( Uint32 ) );
+
+    mShelfX += w + 1;
+    if( h > mShelfHeight ) {
+        mShelfHeight = h;
+    }
+    mUsedPixels += w * h;
+
+    SDL_FreeSurface( glyphSurface );
+    return glyph;
+}
+
+void LGlyphAtlas::render( int x, int y, const char* text, SDL_Color color ) {
+    if( mTexture == NULL ) {
+        return;
+    }
+
+    // Todos los glifos comparten textura, así que el renderizador los agrupa
+    SDL_SetTextureColorMod( mTexture, color.r, color.g, color.b );
+    for( const char* c = text; *c != '\0'; ++c ) {
+        Glyph& glyph = getGlyph( (Uint8)*c );
+        if( glyph.clip.w > 0 ) {
+            SDL_Rect renderQuad = { x, y, glyph.clip.w, glyph.clip.h };
+            SDL_RenderCopy( gRenderer, mTexture, &glyph.clip, &renderQuad );
+        }
+        x += glyph.advance;
+    }
+}
+
+int LGlyphAtlas::getTextWidth( const char* text ) {
+    int width = 0;
+    for( const char* c = text; *c != '\0'; ++c ) {
+        width += getGlyph( (Uint8)*c ).advance;
+    }
+    return width;
+}
+
+int LGlyphAtlas::getTextHeight() {
+    return mFont != NULL ? TTF_FontHeight( mFont ) : 0;
+}
+
+double LGlyphAtlas::getHitRate() {
+    Uint64 total = mHits + mMisses;
+    return total > 0 ? (double)mHits / total : 0.0;
+}
+
+double LGlyphAtlas::getOccupancy() {
+    return (double)mUsedPixels / ( ATLAS_SIZE * ATLAS_SIZE );
+}
+
+LHudText::LHudText() {
+    // Inicializa las variables
+    mText[ 0 ] = '\0';
+    mPrefixLength = 0;
+    mLength = 0;
+    mWidth = -1;
+    mRelayouts = 0;
+}
+
+void LHudText::setPrefix( const char* prefix ) {
+    // Copia el prefijo, dejando sitio para el valor
+    int length = strlen( prefix );
+    if( length > MAX_LENGTH / 2 ) {
+        length = MAX_LENGTH / 2;
+    }
+    memcpy( mText, prefix, length );
+    mText[ length ] = '\0';
+    mPrefixLength = length;
+    mLength = length;
+    mWidth = -1;
+}
+
+void LHudText::setInt( long value ) {
+    char buffer[ 32 ];
+    std::to_chars_result result = std::to_chars( buffer, buffer + sizeof( buffer ), value );
+    update( buffer, result.ptr - buffer );
+}
+
+void LHudText::setFloat( float value ) {
+    // Mismo formato que un stream por defecto: 6 cifras significativas
+    char buffer[ 32 ];
+    std::to_chars_result result = std::to_chars( buffer, buffer + sizeof( buffer ), value,
+            std::chars_format::general, 6 );
+    update( buffer, result.ptr - buffer );
+}
+
+void LHudText::update( const char* value, int length ) {
+    // Si el valor mostrado no cambia no hay nada que hacer
+    if( mLength - mPrefixLength == length && memcmp( mText + mPrefixLength, value, length ) == 0 ) {
+        return;
+    }
+
+    memcpy( mText + mPrefixLength, value, length );
+    mLength = mPrefixLength + length;
+    mText[ mLength ] = '\0';
+    mWidth = -1;
+}
+
+void LHudText::render( int x, int y, SDL_Color color ) {
+    gTextAtlas.render( x, y, mText, color );
+}
+
+const char* LHudText::getText() {
+    return mText;
+}
+
+int LHudText::getWidth() {
+    // Maqueta el texto sólo si ha cambiado
+    if( mWidth < 0 ) {
+        mWidth = gTextAtlas.getTextWidth( mText );
+        ++mRelayouts;
+    }
+    return mWidth;
+}
+
+Uint64 LHudText::getRelayouts() {
+    return mRelayouts;
+}
+
 bool init() {
     // Bandera
     bool success = true;
@@ -413,13 +732,22 @@ bool loadMedia() {
         printf( "Falló la carga de la fuente! SDL_ttf Error: %s\n", TTF_GetError() );
         success = false;
     } 
+    // Crea el atlas; los glifos se rasterizan al usarse por primera vez
+    else if( !gTextAtlas.loadFromFont( gFont ) ) {
+        printf( "Falló la carga del atlas de glifos!\n" );
+        success = false;
+    }
 
     return success;
 }
 
 void close() {
-    // Libera la textura cargada
-    gFPSTextTexture.free();
+    // Estadísticas del atlas de glifos
+    printf( "Atlas de glifos: %.2f%% aciertos, %.2f%% ocupado\n",
+            gTextAtlas.getHitRate() * 100.0, gTextAtlas.getOccupancy() * 100.0 );
+
+    // Libera el atlas
+    gTextAtlas.free();
 
     // Libera la fuente global
     TTF_CloseFont( gFont );
@@ -461,12 +789,16 @@ int main( int argc, char* argv[] ) {
 
     // Bloqueo de los FPs
     LTimer capTimer;
-    // Stream de texto en memoria
-    std::stringstream timeText;
+    // Texto de los fotogramas por segundo
+    LHudText fpsText;
+    fpsText.setPrefix( "Promedio de FPS (Con Cap): " );
 
     int countedFrames = 0;
     fpsTimer.start();
 
+    // Reservas en el heap antes del bucle principal
+    Uint64 startAllocations = gHeapAllocations;
+
     while( !quit ) {
         // Inicia el cap timer
         capTimer.start();
@@ -496,21 +828,15 @@ int main( int argc, char* argv[] ) {
             avgFPS = 0;
 
         // Texto a renderizar
-        timeText.str( "" );
-        timeText << "Promedio de FPS (Con Cap): " << avgFPS;
-
-        // Renderiza el texto
-        if( !gFPSTextTexture.loadFromRenderedText( timeText.str().c_str(), textColor ) ) {
-            printf( "No se pudo renderizar la textura del tiempo!\n" );
-        }
+        fpsText.setFloat( avgFPS );
 
         // Limpia la pantalla
         SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
         SDL_RenderClear( gRenderer );
         
-        // Renderiza la textura del texto
-        gFPSTextTexture.render( ( SCREEN_WIDTH - gFPSTextTexture.getWidth() ) / 2,
-                ( SCREEN_HEIGHT - gFPSTextTexture.getHeight() ) / 2 );
+        // Renderiza el texto desde el atlas; cambiar el texto no crea texturas
+        fpsText.render( ( SCREEN_WIDTH - fpsText.getWidth() ) / 2,
+                ( SCREEN_HEIGHT - gTextAtlas.getTextHeight() ) / 2, textColor );
 
         // Actualiza la pantalla
         SDL_RenderPresent( gRenderer );
@@ -524,6 +850,13 @@ int main( int argc, char* argv[] ) {
             SDL_Delay( SCREEN_TICKS_PER_FRAME - frameTicks );
         }
     }
+
+    // Debería ser cero: el HUD no reserva memoria
+    if( countedFrames > 0 ) {
+        printf( "Reservas en el heap por fotograma: %.3f (%d fotogramas, %llu maquetados del texto)\n",
+                (double)( gHeapAllocations - startAllocations ) / countedFrames, countedFrames,
+                (unsigned long long)fpsText.getRelayouts() );
+    }
     
     close();
     return 0;
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <sstream>
 #include <SDL2/SDL.h>
@@ -7,6 +8,22 @@
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+// Número en punto fijo 16.16, la física usa solo enteros para ser reproducible
+typedef Sint32 Fixed;
+
+// Bits de la parte fraccionaria
+const int FIXED_SHIFT = 16;
+const Fixed FIXED_ONE = 1 << FIXED_SHIFT;
+
+// Vector en punto fijo
+struct FixedVec
+{
+    Fixed x, y;
+};
+
+// Hash esperado del mundo tras 100000 ticks de la prueba de determinismo
+const Uint32 DETERMINISM_HASH = 0x85252274;
+
 // Texture weapper class
 class LTexture {
     public:
@@ -93,8 +110,8 @@ class Dot
         static const int DOT_WIDTH = 20;
         static const int DOT_HEIGHT = 20;
 
-        // Maximá eje de velocidad del punto
-        static const int DOT_VEL = 10;
+        // Maximá eje de velocidad del punto, en punto fijo
+        static const Fixed DOT_VEL = 10 * FIXED_ONE;
         
         // Inicialización de las variables
         Dot();
@@ -108,14 +125,33 @@ class Dot
         // Muestra el punto en la pantalla
         void render();
 
+        // Establece la velocidad del punto
+        void setVelocity( Fixed velX, Fixed velY );
+
+        // Obtiene la posición del punto
+        FixedVec getPosition();
+
     private:
-        // Los Offset X y Y del punto
-        int mPosX, mPosY;
+        // Los Offset X y Y del punto, en punto fijo
+        FixedVec mPos;
 
-        // La velocidad del punto
-        int mVelX, mVelY;
+        // La velocidad del punto, en punto fijo
+        FixedVec mVel;
 };
 
+// Convierte entre pixeles y punto fijo
+Fixed toFixed( int value );
+int fixedToInt( Fixed value );
+
+// Mezcla un valor en el hash del estado del mundo
+Uint32 hashState( Uint32 hash, Sint32 value );
+
+// Velocidad aleatoria reproducible para la prueba de determinismo
+Fixed randomVelocity( Uint32& seed );
+
+// Corre la física sin ventana y devuelve el hash del mundo
+Uint32 runDeterminism( int ticks );
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -378,12 +414,12 @@ bool LTimer::isPaused()
 Dot::Dot()
 {
     // Inicializa los offsets
-    mPosX = 0;
-    mPosY = 0;
+    mPos.x = 0;
+    mPos.y = 0;
 
     // Inicaliza la velocidad
-    mVelX = 0;
-    mVelY = 0;
+    mVel.x = 0;
+    mVel.y = 0;
 }
 
 void Dot::handleEvent( SDL_Event &event )
@@ -394,10 +430,10 @@ void Dot::handleEvent( SDL_Event &event )
         // Ajusta la velocidad
         switch( event.key.keysym.sym )
         {
-            case SDLK_UP: mVelY -= DOT_VEL; break;
-            case SDLK_DOWN: mVelY += DOT_VEL; break;
-            case SDLK_LEFT: mVelX -= DOT_VEL; break;
-            case SDLK_RIGHT: mVelX += DOT_VEL; break;
+            case SDLK_UP: mVel.y -= DOT_VEL; break;
+            case SDLK_DOWN: mVel.y += DOT_VEL; break;
+            case SDLK_LEFT: mVel.x -= DOT_VEL; break;
+            case SDLK_RIGHT: mVel.x += DOT_VEL; break;
         }
     }
     // Si la tecla ha sido liberada
@@ -405,10 +441,10 @@ void Dot::handleEvent( SDL_Event &event )
     {
         switch( event.key.keysym.sym )
         {
-            case SDLK_UP: mVelY += DOT_VEL; break;
-            case SDLK_DOWN: mVelY -= DOT_VEL; break;
-            case SDLK_LEFT: mVelX += DOT_VEL; break;
-            case SDLK_RIGHT: mVelX -= DOT_VEL; break;
+            case SDLK_UP: mVel.y += DOT_VEL; break;
+            case SDLK_DOWN: mVel.y -= DOT_VEL; break;
+            case SDLK_LEFT: mVel.x += DOT_VEL; break;
+            case SDLK_RIGHT: mVel.x -= DOT_VEL; break;
         }
     }
 }
@@ -416,29 +452,97 @@ void Dot::handleEvent( SDL_Event &event )
 void Dot::move()
 {
     // Mueve el punto a la izquierda
-    mPosX += mVelX;
+    mPos.x += mVel.x;
 
     // Si el punto fue muy lejos a la izquierda o derecha
-    if( ( mPosX < 0 ) || ( mPosX + DOT_WIDTH > SCREEN_WIDTH ) )
+    if( ( mPos.x < 0 ) || ( mPos.x + toFixed( DOT_WIDTH ) > toFixed( SCREEN_WIDTH ) ) )
     {
-        mPosX -= mVelX;
+        mPos.x -= mVel.x;
     }
 
-    mPosY += mVelY;
+    mPos.y += mVel.y;
 
     // Si el punto fue muy arriba o abajo
-    if( ( mPosY < 0 ) || ( mPosY + DOT_HEIGHT > SCREEN_HEIGHT ) )
+    if( ( mPos.y < 0 ) || ( mPos.y + toFixed( DOT_HEIGHT ) > toFixed( SCREEN_HEIGHT ) ) )
     {
         // Lo mueve de vuelta
-        mPosY -= mVelY;
+        mPos.y -= mVel.y;
     }
     
 }
 
 void Dot::render()
 {
-    // Muestra el punto
-    gDotTexture.render( mPosX, mPosY );
+    // Muestra el punto en el pixel donde está
+    gDotTexture.render( fixedToInt( mPos.x ), fixedToInt( mPos.y ) );
+}
+
+void Dot::setVelocity( Fixed velX, Fixed velY )
+{
+    mVel.x = velX;
+    mVel.y = velY;
+}
+
+FixedVec Dot::getPosition()
+{
+    return mPos;
+}
+
+Fixed toFixed( int value )
+{
+    return value * FIXED_ONE;
+}
+
+int fixedToInt( Fixed value )
+{
+    // Redondea hacia abajo, también con valores negativos
+    return value >> FIXED_SHIFT;
+}
+
+Uint32 hashState( Uint32 hash, Sint32 value )
+{
+    // FNV-1a byte por byte, no depende del orden de bytes del procesador
+    for( int i = 0; i < 4; ++i )
+    {
+        hash ^= ( (Uint32)value >> ( i * 8 ) ) & 0xFF;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+Fixed randomVelocity( Uint32& seed )
+{
+    // Generador congruencial propio, rand() cambia entre bibliotecas
+    seed = seed * 1664525u + 1013904223u;
+
+    // Entre -4 y 4 pixeles por frame, con parte fraccionaria
+    return (Fixed)( ( seed >> 8 ) % ( 8 * FIXED_ONE ) ) - 4 * FIXED_ONE;
+}
+
+Uint32 runDeterminism( int ticks )
+{
+    Dot dot;
+    Uint32 seed = 1;
+    Uint32 hash = 2166136261u;
+
+    for( int t = 0; t < ticks; ++t )
+    {
+        // Cambia la velocidad cada 64 ticks
+        if( t % 64 == 0 )
+        {
+            Fixed velX = randomVelocity( seed );
+            Fixed velY = randomVelocity( seed );
+            dot.setVelocity( velX, velY );
+        }
+
+        dot.move();
+
+        // Mezcla el estado de cada tick
+        hash = hashState( hash, dot.getPosition().x );
+        hash = hashState( hash, dot.getPosition().y );
+    }
+
+    return hash;
 }
 
 bool init() {
@@ -519,6 +623,14 @@ void close() {
 }
 
 int main( int argc, char* argv[] ) {
+    // Prueba de determinismo, el hash debe ser igual con cualquier compilador
+    if( argc > 1 && strcmp( argv[ 1 ], "--determinism" ) == 0 ) {
+        Uint32 hash = runDeterminism( 100000 );
+        printf( "Hash tras 100000 ticks: %08x (%s)\n", hash,
+                hash == DETERMINISM_HASH ? "ok" : "diferente" );
+        return hash == DETERMINISM_HASH ? 0 : 1;
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -1,13 +1,36 @@
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <vector>
+#include <climits>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLLIDERS_AVX2 1
+#endif
+
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+// Número en punto fijo 16.16, la física usa solo enteros para ser reproducible
+typedef Sint32 Fixed;
+
+// Bits de la parte fraccionaria
+const int FIXED_SHIFT = 16;
+const Fixed FIXED_ONE = 1 << FIXED_SHIFT;
+
+// Vector en punto fijo
+struct FixedVec
+{
+    Fixed x, y;
+};
+
+// Hash esperado del mundo tras 100000 ticks de la prueba de determinismo
+const Uint32 DETERMINISM_HASH = 0x5201d914;
+
 // Texture weapper class
 class LTexture {
     public:
@@ -87,6 +110,18 @@ class LTimer
         bool mStarted;
 };
 
+// Cajas de colisión en formato SoA con los lados ya calculados
+// Los arreglos se rellenan hasta un múltiplo de 8 con cajas vacías que nunca colisionan
+struct ColliderSet
+{
+    std::vector<int> minX, minY;
+    std::vector<int> maxX, maxY;
+
+    // Caja que envuelve a todas las demás
+    int boundsMinX, boundsMinY;
+    int boundsMaxX, boundsMaxY;
+};
+
 class Dot
 {
     public:
@@ -94,8 +129,8 @@ class Dot
         static const int DOT_WIDTH = 20;
         static const int DOT_HEIGHT = 20;
 
-        // Maximá eje de velocidad del punto
-        static const int DOT_VEL = 1;
+        // Maximá eje de velocidad del punto, en punto fijo
+        static const Fixed DOT_VEL = 1 * FIXED_ONE;
         
         // Inicialización de las variables
         Dot( int x, int y );
@@ -103,29 +138,52 @@ class Dot
         // Manejador de las teclas y ajust de la velocidad del punto
         void handleEvent( SDL_Event &event );
 
-        // Mueve el punto
-        void move( std::vector<SDL_Rect> &otherColliders );
+        // Mueve el punto y revisa colisiones contra otro punto
+        void move( Dot &other );
+
+        // Establece la velocidad del punto, en punto fijo
+        void setVelocity( Fixed velX, Fixed velY );
 
         // Muestra el punto en la pantalla
         void render();
 
-        // Obtiene las cajas de colisiones
-        std::vector<SDL_Rect>&getColliders();
+        // Obtiene las cajas de colisiones, en coordenadas locales al punto
+        ColliderSet&getColliders();
+
+        // Obtiene la posición del punto en pixeles
+        int getPosX();
+        int getPosY();
+
+        // Obtiene la posición del punto en punto fijo
+        FixedVec getPosition();
 
     private:
-        // Los Offset X y Y del punto
-        int mPosX, mPosY;
+        // Los Offset X y Y del punto, en punto fijo
+        FixedVec mPos;
 
-        // La velocidad del punto
-        int mVelX, mVelY;
+        // La velocidad del punto, en punto fijo
+        FixedVec mVel;
 
-        // Cajas de colisiones
+        // Cajas de colisiones, relativas a la esquina superior izquierda del punto
         std::vector<SDL_Rect> mColliders;
 
-        // Mueve las cajas de colisiones relativas al offset del punto
-        void shiftColliders();
+        // Las mismas cajas listas para la detección de colisiones
+        ColliderSet mBoxes;
 };
 
+// Convierte entre pixeles y punto fijo
+Fixed toFixed( int value );
+int fixedToInt( Fixed value );
+
+// Mezcla un valor en el hash del estado del mundo
+Uint32 hashState( Uint32 hash, Sint32 value );
+
+// Velocidad aleatoria reproducible para la prueba de determinismo
+Fixed randomVelocity( Uint32& seed );
+
+// Corre la física sin ventana y devuelve el hash del mundo
+Uint32 runDeterminism( int ticks );
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -135,8 +193,23 @@ bool loadMedia();
 // Libera la memoria y termina SDL
 void close();
 
-// Detector de cajas de colisiones
-bool checkCollision( std::vector<SDL_Rect>& a, std::vector<SDL_Rect>& b );
+// Llena un set de colisión desde cajas locales
+void setColliders( ColliderSet& set, std::vector<SDL_Rect>& boxes );
+
+// Detector de cajas de colisiones, cada set en coordenadas locales con su offset
+bool checkCollision( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY );
+
+// Versiones escalar y vectorial del detector
+bool checkCollisionScalar( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY );
+#if defined(COLLIDERS_AVX2)
+bool checkCollisionAVX2( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY );
+#endif
+
+// Mide el costo de mover muchos cuerpos con varias cajas de colisión
+void benchmarkColliders( int bodies, int frames );
+
+// Compara ambas versiones del detector con sets aleatorios y mide su rendimiento
+void benchmarkKernel( int boxes, int pairs );
 
 // Ventana donde se renderizará
 SDL_Window* gWindow = NULL;
@@ -391,15 +464,15 @@ bool LTimer::isPaused()
 Dot::Dot( int x, int y )
 {
     // Inicializa los offsets
-    mPosX = x;
-    mPosY = y;
+    mPos.x = toFixed( x );
+    mPos.y = toFixed( y );
 
     // Crea los SDL_Rect necesarios
     mColliders.resize( 11 );
 
     // Inicializa la velocidad
-    mVelX = 0;
-    mVelY = 0;
+    mVel.x = 0;
+    mVel.y = 0;
 
     // Inicializa el ancho-largo de las cajas de colisiones
     mColliders[ 0 ].w = 6;
@@ -435,8 +508,24 @@ Dot::Dot( int x, int y )
     mColliders[ 10 ].w = 6;
     mColliders[ 10 ].h = 1;
 
-    // Inicializa las cajas de colision relativas a la posición
-    shiftColliders();
+    // Coloca las cajas una sola vez, relativas a la esquina del punto
+    // El offset de la fila
+    int r = 0;
+
+    // Avanza por las cajas de colisión del punto
+    for( size_t set = 0; set < mColliders.size(); ++set )
+    {
+        // Centra las cajas de colisiones
+        mColliders[ set ].x = ( DOT_WIDTH - mColliders[ set ].w ) / 2;
+
+        // Pone la caja de colisión en el offset de la fila
+        mColliders[ set ].y = r;
+
+        // Mueve el offset de la fila debajo de la altura de la caja de colision
+        r += mColliders[ set ].h;
+    }
+
+    setColliders( mBoxes, mColliders );
 }
 
 void Dot::handleEvent( SDL_Event &event )
@@ -447,10 +536,10 @@ void Dot::handleEvent( SDL_Event &event )
         // Ajusta la velocidad
         switch( event.key.keysym.sym )
         {
-            case SDLK_UP: mVelY -= DOT_VEL; break;
-            case SDLK_DOWN: mVelY += DOT_VEL; break;
-            case SDLK_LEFT: mVelX -= DOT_VEL; break;
-            case SDLK_RIGHT: mVelX += DOT_VEL; break;
+            case SDLK_UP: mVel.y -= DOT_VEL; break;
+            case SDLK_DOWN: mVel.y += DOT_VEL; break;
+            case SDLK_LEFT: mVel.x -= DOT_VEL; break;
+            case SDLK_RIGHT: mVel.x += DOT_VEL; break;
         }
     }
     // Si la tecla ha sido liberada
@@ -458,69 +547,130 @@ void Dot::handleEvent( SDL_Event &event )
     {
         switch( event.key.keysym.sym )
         {
-            case SDLK_UP: mVelY += DOT_VEL; break;
-            case SDLK_DOWN: mVelY -= DOT_VEL; break;
-            case SDLK_LEFT: mVelX += DOT_VEL; break;
-            case SDLK_RIGHT: mVelX -= DOT_VEL; break;
+            case SDLK_UP: mVel.y += DOT_VEL; break;
+            case SDLK_DOWN: mVel.y -= DOT_VEL; break;
+            case SDLK_LEFT: mVel.x += DOT_VEL; break;
+            case SDLK_RIGHT: mVel.x -= DOT_VEL; break;
         }
     }
 }
 
-void Dot::move( std::vector<SDL_Rect>& otherColliders )
+void Dot::move( Dot& other )
 {
+    // Las cajas no se mueven con el punto, solo cambia el offset
     // Mueve el punto a la izquierda
-    mPosX += mVelX;
-    shiftColliders();
+    mPos.x += mVel.x;
 
     // Si el punto fue muy lejos a la izquierda o derecha
-    if( ( mPosX < 0 ) || ( mPosX + DOT_WIDTH > SCREEN_WIDTH )
-                || checkCollision( mColliders, otherColliders ) )
+    if( ( mPos.x < 0 ) || ( mPos.x + toFixed( DOT_WIDTH ) > toFixed( SCREEN_WIDTH ) )
+                || checkCollision( mBoxes, getPosX(), getPosY(),
+                    other.getColliders(), other.getPosX(), other.getPosY() ) )
     {
-        mPosX -= mVelX;
-        shiftColliders();
+        mPos.x -= mVel.x;
     }
 
-    mPosY += mVelY;
-    shiftColliders();
+    mPos.y += mVel.y;
 
     // Si el punto fue muy arriba o abajo
-    if( (mPosY < 0) || ( mPosY + DOT_HEIGHT > SCREEN_HEIGHT ) 
-            || checkCollision( mColliders, otherColliders ) )
+    if( ( mPos.y < 0 ) || ( mPos.y + toFixed( DOT_HEIGHT ) > toFixed( SCREEN_HEIGHT ) )
+            || checkCollision( mBoxes, getPosX(), getPosY(),
+                other.getColliders(), other.getPosX(), other.getPosY() ) )
     {
         // Lo mueve de vuelta
-        mPosY -= mVelY;
-        shiftColliders();
+        mPos.y -= mVel.y;
     }   
 }
 
-void Dot::shiftColliders()
+void Dot::render()
 {
-    // El offset de la fila
-    int r = 0;
+    // Muestra el punto
+    gDotTexture.render( getPosX(), getPosY() );
+}
 
-    // Avanza por las cajas de colisión del punto
-    for( int set = 0; set < mColliders.size(); ++set )
-    {
-        // Centra las cajas de colisiones
-        mColliders[ set ].x = mPosX + ( DOT_WIDTH - mColliders[ set ].w ) / 2;
+void Dot::setVelocity( Fixed velX, Fixed velY )
+{
+    mVel.x = velX;
+    mVel.y = velY;
+}
 
-        // Pone la caja de colisión en el offset de la fila
-        mColliders[ set ].y = mPosY + r;
+ColliderSet& Dot::getColliders()
+{
+    return mBoxes;
+}
 
-        // Mueve el offset de la fila debajo de la altura de la caja de colision
-        r += mColliders[ set ].h;
+int Dot::getPosX()
+{
+    return fixedToInt( mPos.x );
+}
+
+int Dot::getPosY()
+{
+    return fixedToInt( mPos.y );
+}
+
+FixedVec Dot::getPosition()
+{
+    return mPos;
+}
+
+Fixed toFixed( int value )
+{
+    return value * FIXED_ONE;
+}
+
+int fixedToInt( Fixed value )
+{
+    // Redondea hacia abajo, también con valores negativos
+    return value >> FIXED_SHIFT;
+}
+
+Uint32 hashState( Uint32 hash, Sint32 value )
+{
+    // FNV-1a byte por byte, no depende del orden de bytes del procesador
+    for( int i = 0; i < 4; ++i )
+    {
+        hash ^= ( (Uint32)value >> ( i * 8 ) ) & 0xFF;
+        hash *= 16777619u;
     }
+    return hash;
 }
 
-void Dot::render()
+Fixed randomVelocity( Uint32& seed )
 {
-    // Muestra el punto
-    gDotTexture.render( mPosX, mPosY );
+    // Generador congruencial propio, rand() cambia entre bibliotecas
+    seed = seed * 1664525u + 1013904223u;
+
+    // Entre -4 y 4 pixeles por frame, con parte fraccionaria
+    return (Fixed)( ( seed >> 8 ) % ( 8 * FIXED_ONE ) ) - 4 * FIXED_ONE;
 }
 
-std::vector<SDL_Rect>& Dot::getColliders()
+Uint32 runDeterminism( int ticks )
 {
-    return mColliders;
+    // Los mismos puntos de la lección
+    Dot dot( 0, 0 );
+    Dot otherDot( SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4 );
+
+    Uint32 seed = 1;
+    Uint32 hash = 2166136261u;
+
+    for( int t = 0; t < ticks; ++t )
+    {
+        // Cambia la velocidad cada 64 ticks
+        if( t % 64 == 0 )
+        {
+            Fixed velX = randomVelocity( seed );
+            Fixed velY = randomVelocity( seed );
+            dot.setVelocity( velX, velY );
+        }
+
+        dot.move( otherDot );
+
+        // Mezcla el estado de cada tick
+        hash = hashState( hash, dot.getPosition().x );
+        hash = hashState( hash, dot.getPosition().y );
+    }
+
+    return hash;
 }
 
 bool init() {
@@ -600,35 +750,93 @@ void close() {
     SDL_Quit();
 }
 
-bool checkCollision( std::vector<SDL_Rect>& a, std::vector<SDL_Rect>& b )
+void setColliders( ColliderSet& set, std::vector<SDL_Rect>& boxes )
+{
+    // Tamaño redondeado a un múltiplo de 8
+    int padded = ( boxes.size() + 7 ) & ~7;
+
+    // El relleno usa min = INT_MAX y max = INT_MIN, así nunca se traslapa
+    set.minX.assign( padded, INT_MAX );
+    set.minY.assign( padded, INT_MAX );
+    set.maxX.assign( padded, INT_MIN );
+    set.maxY.assign( padded, INT_MIN );
+
+    set.boundsMinX = INT_MAX;
+    set.boundsMinY = INT_MAX;
+    set.boundsMaxX = INT_MIN;
+    set.boundsMaxY = INT_MIN;
+
+    for( size_t i = 0; i < boxes.size(); ++i )
+    {
+        set.minX[ i ] = boxes[ i ].x;
+        set.minY[ i ] = boxes[ i ].y;
+        set.maxX[ i ] = boxes[ i ].x + boxes[ i ].w;
+        set.maxY[ i ] = boxes[ i ].y + boxes[ i ].h;
+
+        // Agranda la caja envolvente
+        if( set.minX[ i ] < set.boundsMinX ) set.boundsMinX = set.minX[ i ];
+        if( set.minY[ i ] < set.boundsMinY ) set.boundsMinY = set.minY[ i ];
+        if( set.maxX[ i ] > set.boundsMaxX ) set.boundsMaxX = set.maxX[ i ];
+        if( set.maxY[ i ] > set.boundsMaxY ) set.boundsMaxY = set.maxY[ i ];
+    }
+}
+
+bool checkCollision( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY )
+{
+    // Offset de A relativo a B, las cajas B se revisan en su espacio local
+    int dx = aX - bX;
+    int dy = aY - bY;
+
+    // Si las cajas envolventes no se tocan ninguna caja lo hará
+    if( ( a.boundsMaxY + dy <= b.boundsMinY ) || ( a.boundsMinY + dy >= b.boundsMaxY )
+            || ( a.boundsMaxX + dx <= b.boundsMinX ) || ( a.boundsMinX + dx >= b.boundsMaxX ) )
+    {
+        return false;
+    }
+
+#if defined(COLLIDERS_AVX2)
+    // Revisa una sola vez si el procesador soporta AVX2
+    static bool hasAVX2 = __builtin_cpu_supports( "avx2" );
+    if( hasAVX2 )
+    {
+        return checkCollisionAVX2( a, aX, aY, b, bX, bY );
+    }
+#endif
+
+    return checkCollisionScalar( a, aX, aY, b, bX, bY );
+}
+
+bool checkCollisionScalar( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY )
 {
     // Lados del rectangulo
-    int leftA, leftB;
-    int rightA, rightB;
-    int topA, topB;
-    int bottomA, bottomB;
+    int leftA, rightA, topA, bottomA;
+
+    // Offset de A relativo a B
+    int dx = aX - bX;
+    int dy = aY - bY;
 
     // Avanza a traves de las cajas A
-    for( int Abox = 0; Abox < a.size(); Abox++ )
+    for( size_t Abox = 0; Abox < a.minX.size(); Abox++ )
     {
-        // Calcula los lados de Rect A
-        leftA = a[ Abox ].x;
-        rightA = a[ Abox ].x + a[ Abox ].w;
-        topA = a[ Abox ].y;
-        bottomA = a[ Abox ].y + a[ Abox ].h;
-
-        // Avanza a travez de las cajas B
-        for( int Bbox = 0; Bbox < b.size(); Bbox++ )
+        // Las cajas de relleno de A no se traslapan con nada, y sumarles el
+        // offset desbordaría INT_MAX
+        if( a.minX[ Abox ] == INT_MAX )
+        {
+            break;
+        }
+
+        // Calcula los lados de Rect A en el espacio de B
+        leftA = a.minX[ Abox ] + dx;
+        rightA = a.maxX[ Abox ] + dx;
+        topA = a.minY[ Abox ] + dy;
+        bottomA = a.maxY[ Abox ] + dy;
+
+        // Avanza a travez de las cajas B, sus lados ya están calculados
+        for( size_t Bbox = 0; Bbox < b.minX.size(); Bbox++ )
         {
-            // Calcula los lados de Rect B
-            leftB = b[ Bbox ].x;
-            rightB = b[ Bbox ].x + b[ Bbox ].w;
-            topB = b[ Bbox ].y;
-            bottomB = b[ Bbox ].y + b[ Bbox ].h;
-            
             // Si ningun lado de A está fuera de B
-            if( ( ( bottomA <= topB ) || ( topA >= bottomB ) || ( rightA <= leftB )
-                        || ( leftA >= rightB ) ) == false )
+            if( ( bottomA > b.minY[ Bbox ] ) && ( topA < b.maxY[ Bbox ] )
+                    && ( rightA > b.minX[ Bbox ] ) && ( leftA < b.maxX[ Bbox ] ) )
             {
                 // Colisión detectada
                 return true;
@@ -636,12 +844,183 @@ bool checkCollision( std::vector<SDL_Rect>& a, std::vector<SDL_Rect>& b )
         }
     }
 
-    
     // Si ninguna set de cajas de colision se están tocando
     return false;
 }
 
+#if defined(COLLIDERS_AVX2)
+__attribute__(( target( "avx2" ) ))
+bool checkCollisionAVX2( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY )
+{
+    // Offset de A relativo a B
+    int dx = aX - bX;
+    int dy = aY - bY;
+
+    // Avanza a traves de las cajas A
+    for( size_t Abox = 0; Abox < a.minX.size(); Abox++ )
+    {
+        // Las cajas de relleno de A no se traslapan con nada
+        if( a.minX[ Abox ] == INT_MAX )
+        {
+            break;
+        }
+
+        // Copia los lados de A en los 8 carriles
+        __m256i leftA = _mm256_set1_epi32( a.minX[ Abox ] + dx );
+        __m256i rightA = _mm256_set1_epi32( a.maxX[ Abox ] + dx );
+        __m256i topA = _mm256_set1_epi32( a.minY[ Abox ] + dy );
+        __m256i bottomA = _mm256_set1_epi32( a.maxY[ Abox ] + dy );
+
+        // Revisa 8 cajas B por instrucción
+        for( size_t Bbox = 0; Bbox < b.minX.size(); Bbox += 8 )
+        {
+            __m256i leftB = _mm256_loadu_si256( (const __m256i*)&b.minX[ Bbox ] );
+            __m256i rightB = _mm256_loadu_si256( (const __m256i*)&b.maxX[ Bbox ] );
+            __m256i topB = _mm256_loadu_si256( (const __m256i*)&b.minY[ Bbox ] );
+            __m256i bottomB = _mm256_loadu_si256( (const __m256i*)&b.maxY[ Bbox ] );
+
+            // Mascara de los carriles donde ningún lado de A está fuera de B
+            __m256i hit = _mm256_and_si256(
+                    _mm256_and_si256( _mm256_cmpgt_epi32( bottomA, topB ),
+                        _mm256_cmpgt_epi32( bottomB, topA ) ),
+                    _mm256_and_si256( _mm256_cmpgt_epi32( rightA, leftB ),
+                        _mm256_cmpgt_epi32( rightB, leftA ) ) );
+
+            // Colisión detectada en algún carril
+            if( !_mm256_testz_si256( hit, hit ) )
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+#endif
+
+void benchmarkColliders( int bodies, int frames )
+{
+    // Cuerpos repartidos por la pantalla, cada uno con 11 cajas de colisión
+    std::vector<Dot> dots;
+    dots.reserve( bodies );
+    for( int i = 0; i < bodies; ++i )
+    {
+        dots.push_back( Dot( rand() % ( SCREEN_WIDTH - Dot::DOT_WIDTH ),
+                    rand() % ( SCREEN_HEIGHT - Dot::DOT_HEIGHT ) ) );
+        dots[ i ].setVelocity( toFixed( rand() % 3 - 1 ), toFixed( rand() % 3 - 1 ) );
+    }
+
+    // Cada cuerpo se mueve y revisa colisiones contra el siguiente
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int f = 0; f < frames; ++f )
+    {
+        for( int i = 0; i < bodies; ++i )
+        {
+            dots[ i ].move( dots[ ( i + 1 ) % bodies ] );
+        }
+    }
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+
+    double ns = (double)elapsed * 1000000000.0 / SDL_GetPerformanceFrequency();
+    printf( "%d cuerpos x %d frames: %.1f ns por movimiento\n", bodies, frames,
+            ns / ( (double)bodies * frames ) );
+}
+
+void benchmarkKernel( int boxes, int pairs )
+{
+    // Sets aleatorios de cajas pequeñas dentro de un área de 64x64
+    const int SETS = 256;
+    std::vector<ColliderSet> sets( SETS );
+    std::vector<SDL_Rect> rects( boxes );
+    for( int s = 0; s < SETS; ++s )
+    {
+        for( int i = 0; i < boxes; ++i )
+        {
+            rects[ i ].x = rand() % 64;
+            rects[ i ].y = rand() % 64;
+            rects[ i ].w = rand() % 4;
+            rects[ i ].h = rand() % 4;
+        }
+        setColliders( sets[ s ], rects );
+    }
+
+    // Offsets aleatorios para cada par. Con offsets de -32 a 31 casi todos los
+    // pares chocan, así que la mitad se aleja de 60 a 67 pixeles en un eje:
+    // quedan justo fuera, tocando el borde o apenas dentro
+    std::vector<int> offsets( pairs * 2 );
+    for( int p = 0; p < pairs; ++p )
+    {
+        offsets[ p * 2 ] = rand() % 64 - 32;
+        offsets[ p * 2 + 1 ] = rand() % 64 - 32;
+        if( p % 2 == 1 )
+        {
+            int edge = 60 + rand() % 8;
+            offsets[ p * 2 + rand() % 2 ] = rand() % 2 == 0 ? edge : -edge;
+        }
+    }
+
+    // Ambas versiones deben dar el mismo resultado
+    int mismatches = 0;
+    int hits = 0;
+    Uint64 scalarTicks = 0;
+    Uint64 simdTicks = 0;
+    for( int p = 0; p < pairs; ++p )
+    {
+        ColliderSet& a = sets[ p % SETS ];
+        ColliderSet& b = sets[ ( p * 7 + 1 ) % SETS ];
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        bool scalar = checkCollisionScalar( a, offsets[ p * 2 ], offsets[ p * 2 + 1 ], b, 0, 0 );
+        scalarTicks += SDL_GetPerformanceCounter() - start;
+
+        bool simd = scalar;
+#if defined(COLLIDERS_AVX2)
+        if( __builtin_cpu_supports( "avx2" ) )
+        {
+            start = SDL_GetPerformanceCounter();
+            simd = checkCollisionAVX2( a, offsets[ p * 2 ], offsets[ p * 2 + 1 ], b, 0, 0 );
+            simdTicks += SDL_GetPerformanceCounter() - start;
+        }
+#endif
+
+        if( scalar != simd )
+        {
+            mismatches++;
+        }
+        if( scalar )
+        {
+            hits++;
+        }
+    }
+
+    double freq = SDL_GetPerformanceFrequency();
+    printf( "%d cajas por set, %d pares (%d colisiones): %d diferencias\n", boxes, pairs,
+            hits, mismatches );
+    printf( "  escalar: %.0f pares/s\n", pairs * freq / ( scalarTicks > 0 ? scalarTicks : 1 ) );
+    if( simdTicks > 0 )
+    {
+        printf( "  AVX2:    %.0f pares/s\n", pairs * freq / simdTicks );
+    }
+}
+
 int main( int argc, char* argv[] ) {
+    // Prueba de determinismo, el hash debe ser igual con cualquier compilador
+    if( argc > 1 && strcmp( argv[ 1 ], "--determinism" ) == 0 ) {
+        Uint32 hash = runDeterminism( 100000 );
+        printf( "Hash tras 100000 ticks: %08x (%s)\n", hash,
+                hash == DETERMINISM_HASH ? "ok" : "diferente" );
+        return hash == DETERMINISM_HASH ? 0 : 1;
+    }
+
+    // Modo de medición sin ventana
+    if( argc > 1 && strcmp( argv[ 1 ], "--bench" ) == 0 ) {
+        benchmarkColliders( 1000, 1000 );
+        benchmarkKernel( 11, 100000 );
+        benchmarkKernel( 64, 100000 );
+        benchmarkKernel( 256, 20000 );
+        return 0;
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -685,7 +1064,7 @@ int main( int argc, char* argv[] ) {
 
         }
         
-        dot.move( otherDot.getColliders() );
+        dot.move( otherDot );
 
         // Limpia la pantalla
         SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
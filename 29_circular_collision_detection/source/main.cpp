@@ -1,12 +1,36 @@
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <cmath>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLLIDERS_AVX2 1
+#endif
+
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+// Número en punto fijo 16.16, la física usa solo enteros para ser reproducible
+typedef Sint32 Fixed;
+
+// Bits de la parte fraccionaria
+const int FIXED_SHIFT = 16;
+const Fixed FIXED_ONE = 1 << FIXED_SHIFT;
+
+// Vector en punto fijo
+struct FixedVec
+{
+    Fixed x, y;
+};
+
+// Hash esperado del mundo tras 100000 ticks de la prueba de determinismo
+const Uint32 DETERMINISM_HASH = 0xae83a96c;
+
 // Estructura del circulo
 struct Circle
 {
@@ -14,6 +38,20 @@ struct Circle
     int r;
 };
 
+// Muchos circulos guardados de forma contigua, un arreglo por campo
+struct CircleBatch
+{
+    std::vector<int> x, y;
+    std::vector<int> r;
+};
+
+// Muchas cajas guardadas de forma contigua, un arreglo por campo
+struct RectBatch
+{
+    std::vector<int> x, y;
+    std::vector<int> w, h;
+};
+
 // Texture weapper class
 class LTexture {
     public:
@@ -102,8 +140,8 @@ class Dot
         static const int DOT_WIDTH = 20;
         static const int DOT_HEIGHT = 20;
 
-        // Maximá eje de velocidad del punto
-        static const int DOT_VEL = 1;
+        // Maximá eje de velocidad del punto, en punto fijo
+        static const Fixed DOT_VEL = 1 * FIXED_ONE;
         
         // Inicialización de las variables
         Dot( int x, int y );
@@ -120,12 +158,18 @@ class Dot
         // Obtiene las cajas de colisiones
         Circle& getCollider();
 
+        // Establece la velocidad del punto, en punto fijo
+        void setVelocity( Fixed velX, Fixed velY );
+
+        // Obtiene la posición del punto en punto fijo
+        FixedVec getPosition();
+
     private:
-        // Los Offset X y Y del punto
-        int mPosX, mPosY;
+        // Los Offset X y Y del punto, en punto fijo
+        FixedVec mPos;
 
-        // La velocidad del punto
-        int mVelX, mVelY;
+        // La velocidad del punto, en punto fijo
+        FixedVec mVel;
 
         // Circulo de colisiones
         Circle mCollider;
@@ -134,6 +178,114 @@ class Dot
         void shiftColliders();
 };
 
+// Nodo del árbol de cajas envolventes
+struct TreeNode
+{
+    // Caja envolvente, agrandada en las hojas
+    int minX, minY;
+    int maxX, maxY;
+
+    // Indices de los nodos relacionados, -1 si no existen
+    int parent;
+    int child1, child2;
+
+    // Altura del nodo, 0 en las hojas
+    int height;
+
+    // Figura guardada en la hoja
+    int shape;
+};
+
+// Figura guardada en el árbol, circulo o caja
+struct TreeShape
+{
+    bool isCircle;
+    Circle circle;
+    SDL_Rect rect;
+
+    // Hoja que contiene la figura, -1 si la figura fue removida
+    int node;
+};
+
+// Árbol dinámico de cajas envolventes para circulos y cajas mezclados
+class AABBTree
+{
+    public:
+        // Margen que se agrega a las hojas para no reinsertar en cada movimiento
+        static const int FAT_MARGIN = 4;
+
+        // Inicialización de las variables
+        AABBTree();
+
+        // Agrega una figura, devuelve su identificador
+        int insert( Circle& circle );
+        int insert( SDL_Rect& rect );
+
+        // Remueve una figura
+        void remove( int id );
+
+        // Mueve una figura, devuelve true si fue reinsertada
+        bool move( int id, Circle& circle );
+        bool move( int id, SDL_Rect& rect );
+
+        // Obtiene las figuras que tocan la región
+        void query( SDL_Rect& region, std::vector<int>& results );
+        void query( Circle& region, std::vector<int>& results );
+
+        // Obtiene la primera figura que cruza el segmento, -1 si no hay ninguna
+        // fraction es la parte del segmento recorrida hasta el impacto
+        int rayCast( int x1, int y1, int x2, int y2, float& fraction );
+
+        // Obtiene una figura
+        TreeShape& getShape( int id );
+
+        // Obtiene la altura del árbol
+        int getHeight();
+
+    private:
+        // Nodos y figuras, los libres se encadenan por parent y node
+        std::vector<TreeNode> mNodes;
+        std::vector<TreeShape> mShapes;
+        int mFreeNode;
+        int mFreeShape;
+
+        // Raíz del árbol
+        int mRoot;
+
+        // Pila reutilizada por las consultas
+        std::vector<int> mStack;
+
+        int allocateNode();
+        void freeNode( int node );
+        int allocateShape();
+
+        // Agrega y remueve hojas del árbol
+        void insertLeaf( int leaf );
+        void removeLeaf( int leaf );
+
+        // Calcula la caja agrandada de una figura y la guarda en su hoja
+        void fattenLeaf( int leaf );
+
+        // Recalcula caja y altura de un nodo desde sus hijos
+        void refit( int node );
+
+        // Rota el nodo si baja el costo SAH de sus hijos
+        void rotate( int node );
+};
+
+// Convierte entre pixeles y punto fijo
+Fixed toFixed( int value );
+int fixedToInt( Fixed value );
+
+// Mezcla un valor en el hash del estado del mundo
+Uint32 hashState( Uint32 hash, Sint32 value );
+
+// Velocidad aleatoria reproducible para la prueba de determinismo
+Fixed randomVelocity( Uint32& seed );
+
+// Corre la física sin ventana y devuelve el hash del mundo
+Uint32 runDeterminism( int ticks );
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -150,7 +302,22 @@ bool checkCollision( Circle& a, Circle& b );
 bool checkCollision( Circle& a, SDL_Rect& b );
 
 // Calcula el cuadrado de la distancia entre dos puntos
-double distanceSquared( int x1, int y1, int x2, int y2 );
+int distanceSquared( int x1, int y1, int x2, int y2 );
+
+// Agrega figuras a un lote
+void addShape( CircleBatch& batch, Circle& circle );
+void addShape( RectBatch& batch, SDL_Rect& rect );
+
+// Revisa un circulo contra todo un lote, marca cada figura tocada en hits
+// Devuelve el número de colisiones
+int checkCollisions( Circle& a, CircleBatch& b, Uint8* hits );
+int checkCollisions( Circle& a, RectBatch& b, Uint8* hits );
+
+// Mide el lote contra la revisión figura por figura en una escena mixta
+void benchmarkBatches( int shapes, int queries );
+
+// Mide el árbol contra la fuerza bruta en consultas, rayos y movimientos
+void benchmarkTree( int shapes, int queries );
 
 // Ventana donde se renderizará
 SDL_Window* gWindow = NULL;
@@ -405,15 +572,15 @@ bool LTimer::isPaused()
 Dot::Dot( int x, int y )
 {
     // Inicializa los offsets
-    mPosX = x;
-    mPosY = y;
+    mPos.x = toFixed( x );
+    mPos.y = toFixed( y );
 
     // Crea los SDL_Rect necesarios
     mCollider.r = DOT_WIDTH / 2;
 
     // Inicializa la velocidad
-    mVelX = 0;
-    mVelY = 0;
+    mVel.x = 0;
+    mVel.y = 0;
 
     // Inicializa las cajas de colision relativas a la posición
     shiftColliders();
@@ -427,10 +594,10 @@ void Dot::handleEvent( SDL_Event &event )
         // Ajusta la velocidad
         switch( event.key.keysym.sym )
         {
-            case SDLK_UP: mVelY -= DOT_VEL; break;
-            case SDLK_DOWN: mVelY += DOT_VEL; break;
-            case SDLK_LEFT: mVelX -= DOT_VEL; break;
-            case SDLK_RIGHT: mVelX += DOT_VEL; break;
+            case SDLK_UP: mVel.y -= DOT_VEL; break;
+            case SDLK_DOWN: mVel.y += DOT_VEL; break;
+            case SDLK_LEFT: mVel.x -= DOT_VEL; break;
+            case SDLK_RIGHT: mVel.x += DOT_VEL; break;
         }
     }
     // Si la tecla ha sido liberada
@@ -438,10 +605,10 @@ void Dot::handleEvent( SDL_Event &event )
     {
         switch( event.key.keysym.sym )
         {
-            case SDLK_UP: mVelY += DOT_VEL; break;
-            case SDLK_DOWN: mVelY -= DOT_VEL; break;
-            case SDLK_LEFT: mVelX += DOT_VEL; break;
-            case SDLK_RIGHT: mVelX -= DOT_VEL; break;
+            case SDLK_UP: mVel.y += DOT_VEL; break;
+            case SDLK_DOWN: mVel.y -= DOT_VEL; break;
+            case SDLK_LEFT: mVel.x += DOT_VEL; break;
+            case SDLK_RIGHT: mVel.x -= DOT_VEL; break;
         }
     }
 }
@@ -449,41 +616,52 @@ void Dot::handleEvent( SDL_Event &event )
 void Dot::move( SDL_Rect& square, Circle& circle )
 {
     // Mueve el punto a la izquierda
-    mPosX += mVelX;
+    mPos.x += mVel.x;
     shiftColliders();
 
     // Si el punto fue muy lejos a la izquierda o derecha
-    if( ( mPosX - mCollider.r < 0 ) || ( mPosX + mCollider.r > SCREEN_WIDTH )
+    if( ( mPos.x - toFixed( mCollider.r ) < 0 ) || ( mPos.x + toFixed( mCollider.r ) > toFixed( SCREEN_WIDTH ) )
                 || checkCollision( mCollider, square ) || checkCollision( mCollider, circle ) )
     {
-        mPosX -= mVelX;
+        mPos.x -= mVel.x;
         shiftColliders();
     }
 
-    mPosY += mVelY;
+    mPos.y += mVel.y;
     shiftColliders();
     
     // Si el punto fue muy arriba o abajo
-    if( ( mPosY - mCollider.r < 0 ) || ( mPosY + mCollider.r > SCREEN_HEIGHT ) 
+    if( ( mPos.y - toFixed( mCollider.r ) < 0 ) || ( mPos.y + toFixed( mCollider.r ) > toFixed( SCREEN_HEIGHT ) )
             || checkCollision( mCollider, square ) || checkCollision( mCollider, circle ) )
     {
         // Lo mueve de vuelta
-        mPosY -= mVelY;
+        mPos.y -= mVel.y;
         shiftColliders();
     }   
 }
 
 void Dot::shiftColliders()
 {
-    // Alinea los colliders al centro del punto
-    mCollider.x = mPosX;
-    mCollider.y = mPosY;
+    // Alinea los colliders al pixel del centro del punto
+    mCollider.x = fixedToInt( mPos.x );
+    mCollider.y = fixedToInt( mPos.y );
 }
 
 void Dot::render()
 {
     // Muestra el punto
-    gDotTexture.render( mPosX - mCollider.r, mPosY - mCollider.r );
+    gDotTexture.render( mCollider.x - mCollider.r, mCollider.y - mCollider.r );
+}
+
+void Dot::setVelocity( Fixed velX, Fixed velY )
+{
+    mVel.x = velX;
+    mVel.y = velY;
+}
+
+FixedVec Dot::getPosition()
+{
+    return mPos;
 }
 
 bool checkCollision( Circle& a, Circle& b )
@@ -505,58 +683,1105 @@ bool checkCollision( Circle& a, Circle& b )
 
 bool checkCollision( Circle& a, SDL_Rect& b )
 {
-    // Punto más cercano a la caja de colision
-    int cX, cY;
+    // Punto más cercano a la caja de colision, el centro limitado a los lados
+    // de la caja sin saltos condicionales
+    int cX = std::max( b.x, std::min( a.x, b.x + b.w ) );
+    int cY = std::max( b.y, std::min( a.y, b.y + b.h ) );
 
-    // Encuentra el offset x más cercano
-    if( a.x < b.x )
+    // Si el punto más cercano está dentro del circulo
+    if( distanceSquared( a.x, a.y, cX, cY ) < a.r * a.r )
     {
-        cX = b.x;
+        // La caja y el circulo colisionan
+        return true;
     }
-    else if ( a.x > b.x + b.w )
+    
+    // Si no
+    return false;
+}
+
+Circle& Dot::getCollider()
+{
+    return mCollider;
+}
+
+int distanceSquared( int x1, int y1, int x2, int y2 )
+{
+    // Todo en enteros, sin convertir a double
+    int deltaX = x2 - x1;
+    int deltaY = y2 - y1;
+    return deltaX * deltaX + deltaY * deltaY;
+}
+
+void addShape( CircleBatch& batch, Circle& circle )
+{
+    batch.x.push_back( circle.x );
+    batch.y.push_back( circle.y );
+    batch.r.push_back( circle.r );
+}
+
+void addShape( RectBatch& batch, SDL_Rect& rect )
+{
+    batch.x.push_back( rect.x );
+    batch.y.push_back( rect.y );
+    batch.w.push_back( rect.w );
+    batch.h.push_back( rect.h );
+}
+
+#if defined(COLLIDERS_AVX2)
+// Revisa 8 figuras por instrucción, start es el índice de la primera figura
+// que queda para la versión escalar
+__attribute__(( target( "avx2" ) ))
+int checkCollisionsAVX2( Circle& a, CircleBatch& b, Uint8* hits, int& start )
+{
+    int count = 0;
+    int n = b.x.size();
+
+    // Copia el circulo A en los 8 carriles
+    __m256i ax = _mm256_set1_epi32( a.x );
+    __m256i ay = _mm256_set1_epi32( a.y );
+    __m256i ar = _mm256_set1_epi32( a.r );
+
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 )
     {
-        cX = b.x + b.w;
+        __m256i dx = _mm256_sub_epi32( _mm256_loadu_si256( (const __m256i*)&b.x[ i ] ), ax );
+        __m256i dy = _mm256_sub_epi32( _mm256_loadu_si256( (const __m256i*)&b.y[ i ] ), ay );
+        __m256i rr = _mm256_add_epi32( _mm256_loadu_si256( (const __m256i*)&b.r[ i ] ), ar );
+
+        // distancia^2 < ( rA + rB )^2
+        __m256i d2 = _mm256_add_epi32( _mm256_mullo_epi32( dx, dx ), _mm256_mullo_epi32( dy, dy ) );
+        __m256i hit = _mm256_cmpgt_epi32( _mm256_mullo_epi32( rr, rr ), d2 );
+
+        // Un bit por carril
+        int mask = _mm256_movemask_ps( _mm256_castsi256_ps( hit ) );
+        for( int lane = 0; lane < 8; ++lane )
+        {
+            hits[ i + lane ] = ( mask >> lane ) & 1;
+        }
+        count += __builtin_popcount( mask );
     }
-    else
+
+    start = i;
+    return count;
+}
+
+__attribute__(( target( "avx2" ) ))
+int checkCollisionsAVX2( Circle& a, RectBatch& b, Uint8* hits, int& start )
+{
+    int count = 0;
+    int n = b.x.size();
+
+    // Copia el circulo A en los 8 carriles
+    __m256i ax = _mm256_set1_epi32( a.x );
+    __m256i ay = _mm256_set1_epi32( a.y );
+    __m256i r2 = _mm256_set1_epi32( a.r * a.r );
+
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 )
+    {
+        __m256i bx = _mm256_loadu_si256( (const __m256i*)&b.x[ i ] );
+        __m256i by = _mm256_loadu_si256( (const __m256i*)&b.y[ i ] );
+        __m256i bw = _mm256_loadu_si256( (const __m256i*)&b.w[ i ] );
+        __m256i bh = _mm256_loadu_si256( (const __m256i*)&b.h[ i ] );
+
+        // Punto más cercano a cada caja
+        __m256i cx = _mm256_max_epi32( bx, _mm256_min_epi32( ax, _mm256_add_epi32( bx, bw ) ) );
+        __m256i cy = _mm256_max_epi32( by, _mm256_min_epi32( ay, _mm256_add_epi32( by, bh ) ) );
+
+        __m256i dx = _mm256_sub_epi32( cx, ax );
+        __m256i dy = _mm256_sub_epi32( cy, ay );
+        __m256i d2 = _mm256_add_epi32( _mm256_mullo_epi32( dx, dx ), _mm256_mullo_epi32( dy, dy ) );
+        __m256i hit = _mm256_cmpgt_epi32( r2, d2 );
+
+        // Un bit por carril
+        int mask = _mm256_movemask_ps( _mm256_castsi256_ps( hit ) );
+        for( int lane = 0; lane < 8; ++lane )
+        {
+            hits[ i + lane ] = ( mask >> lane ) & 1;
+        }
+        count += __builtin_popcount( mask );
+    }
+
+    start = i;
+    return count;
+}
+#endif
+
+int checkCollisions( Circle& a, CircleBatch& b, Uint8* hits )
+{
+    int count = 0;
+    int i = 0;
+
+#if defined(COLLIDERS_AVX2)
+    // Revisa una sola vez si el procesador soporta AVX2
+    static bool hasAVX2 = __builtin_cpu_supports( "avx2" );
+    if( hasAVX2 )
+    {
+        count = checkCollisionsAVX2( a, b, hits, i );
+    }
+#endif
+
+    // Las figuras que sobran se revisan una por una
+    for( ; i < (int)b.x.size(); ++i )
+    {
+        int totalRadius = a.r + b.r[ i ];
+        hits[ i ] = distanceSquared( a.x, a.y, b.x[ i ], b.y[ i ] ) < totalRadius * totalRadius;
+        count += hits[ i ];
+    }
+
+    return count;
+}
+
+int checkCollisions( Circle& a, RectBatch& b, Uint8* hits )
+{
+    int count = 0;
+    int i = 0;
+
+#if defined(COLLIDERS_AVX2)
+    // Revisa una sola vez si el procesador soporta AVX2
+    static bool hasAVX2 = __builtin_cpu_supports( "avx2" );
+    if( hasAVX2 )
     {
-        cX = a.x;
+        count = checkCollisionsAVX2( a, b, hits, i );
     }
+#endif
 
-    // Encontar el offset y más cercano
-    if( a.y < b.y )
+    // Las figuras que sobran se revisan una por una
+    for( ; i < (int)b.x.size(); ++i )
     {
-        cY = b.y;
+        int cX = std::max( b.x[ i ], std::min( a.x, b.x[ i ] + b.w[ i ] ) );
+        int cY = std::max( b.y[ i ], std::min( a.y, b.y[ i ] + b.h[ i ] ) );
+        hits[ i ] = distanceSquared( a.x, a.y, cX, cY ) < a.r * a.r;
+        count += hits[ i ];
     }
-    else if ( a.y > b.y + b.h )
+
+    return count;
+}
+
+void benchmarkBatches( int shapes, int queries )
+{
+    // Escena mixta, la mitad circulos y la mitad cajas
+    std::vector<Circle> circles( shapes / 2 );
+    std::vector<SDL_Rect> rects( shapes - shapes / 2 );
+    CircleBatch circleBatch;
+    RectBatch rectBatch;
+    for( size_t i = 0; i < circles.size(); ++i )
     {
-        cY = b.y + b.h;
+        circles[ i ].x = rand() % SCREEN_WIDTH;
+        circles[ i ].y = rand() % SCREEN_HEIGHT;
+        circles[ i ].r = 1 + rand() % 10;
+        addShape( circleBatch, circles[ i ] );
     }
-    else 
+    for( size_t i = 0; i < rects.size(); ++i )
     {
-        cY = a.y;
+        rects[ i ].x = rand() % SCREEN_WIDTH;
+        rects[ i ].y = rand() % SCREEN_HEIGHT;
+        rects[ i ].w = 1 + rand() % 20;
+        rects[ i ].h = 1 + rand() % 20;
+        addShape( rectBatch, rects[ i ] );
     }
 
-    // Si el punto más cercano está dentro del circulo
-    if( distanceSquared( a.x, a.y, cX, cY ) < a.r * a.r )
+    std::vector<Uint8> circleHits( circles.size() );
+    std::vector<Uint8> rectHits( rects.size() );
+
+    // Una figura a la vez
+    int singleCount = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int q = 0; q < queries; ++q )
     {
-        // La caja y el circulo colisionan
+        Circle query = { ( q * 37 ) % SCREEN_WIDTH, ( q * 61 ) % SCREEN_HEIGHT, 10 };
+        for( size_t i = 0; i < circles.size(); ++i )
+        {
+            singleCount += checkCollision( query, circles[ i ] );
+        }
+        for( size_t i = 0; i < rects.size(); ++i )
+        {
+            singleCount += checkCollision( query, rects[ i ] );
+        }
+    }
+    Uint64 singleTicks = SDL_GetPerformanceCounter() - start;
+
+    // Todo el lote de una vez
+    int batchCount = 0;
+    start = SDL_GetPerformanceCounter();
+    for( int q = 0; q < queries; ++q )
+    {
+        Circle query = { ( q * 37 ) % SCREEN_WIDTH, ( q * 61 ) % SCREEN_HEIGHT, 10 };
+        batchCount += checkCollisions( query, circleBatch, &circleHits[ 0 ] );
+        batchCount += checkCollisions( query, rectBatch, &rectHits[ 0 ] );
+    }
+    Uint64 batchTicks = SDL_GetPerformanceCounter() - start;
+
+    double tests = (double)shapes * queries;
+    double freq = SDL_GetPerformanceFrequency();
+    printf( "%d figuras x %d consultas\n", shapes, queries );
+    printf( "  una por una: %.2f ns por prueba (%d colisiones)\n",
+            singleTicks * 1000000000.0 / freq / tests, singleCount );
+    printf( "  por lote:    %.2f ns por prueba (%d colisiones)\n",
+            batchTicks * 1000000000.0 / freq / tests, batchCount );
+}
+
+// Perímetro de una caja, el costo SAH en 2D
+int perimeter( int minX, int minY, int maxX, int maxY )
+{
+    return 2 * ( ( maxX - minX ) + ( maxY - minY ) );
+}
+
+// Perímetro de la unión de dos nodos
+int unionPerimeter( TreeNode& a, TreeNode& b )
+{
+    return perimeter( std::min( a.minX, b.minX ), std::min( a.minY, b.minY ),
+            std::max( a.maxX, b.maxX ), std::max( a.maxY, b.maxY ) );
+}
+
+// Revisa si el segmento cruza la caja antes de maxFraction
+bool rayHitsBox( float x1, float y1, float dx, float dy, float minX, float minY,
+        float maxX, float maxY, float maxFraction, float& fraction )
+{
+    float tMin = 0.0f;
+    float tMax = maxFraction;
+
+    // Eje x
+    if( dx == 0.0f )
+    {
+        if( x1 < minX || x1 > maxX ) return false;
+    }
+    else
+    {
+        float t1 = ( minX - x1 ) / dx;
+        float t2 = ( maxX - x1 ) / dx;
+        tMin = std::max( tMin, std::min( t1, t2 ) );
+        tMax = std::min( tMax, std::max( t1, t2 ) );
+    }
+
+    // Eje y
+    if( dy == 0.0f )
+    {
+        if( y1 < minY || y1 > maxY ) return false;
+    }
+    else
+    {
+        float t1 = ( minY - y1 ) / dy;
+        float t2 = ( maxY - y1 ) / dy;
+        tMin = std::max( tMin, std::min( t1, t2 ) );
+        tMax = std::min( tMax, std::max( t1, t2 ) );
+    }
+
+    fraction = tMin;
+    return tMin <= tMax;
+}
+
+// Revisa si el segmento cruza el circulo antes de maxFraction
+bool rayHitsCircle( float x1, float y1, float dx, float dy, Circle& c, float maxFraction,
+        float& fraction )
+{
+    // Resuelve |p1 + t * d - c|^2 = r^2
+    float fx = x1 - c.x;
+    float fy = y1 - c.y;
+    float a = dx * dx + dy * dy;
+    float b = fx * dx + fy * dy;
+    float k = fx * fx + fy * fy - (float)c.r * c.r;
+
+    // El segmento empieza dentro del circulo
+    if( k <= 0.0f )
+    {
+        fraction = 0.0f;
         return true;
     }
-    
-    // Si no
-    return false;
+
+    float disc = b * b - a * k;
+    if( a == 0.0f || disc < 0.0f )
+    {
+        return false;
+    }
+
+    float t = ( -b - sqrtf( disc ) ) / a;
+    if( t < 0.0f || t > maxFraction )
+    {
+        return false;
+    }
+
+    fraction = t;
+    return true;
 }
 
-Circle& Dot::getCollider()
+AABBTree::AABBTree()
 {
-    return mCollider;
+    mFreeNode = -1;
+    mFreeShape = -1;
+    mRoot = -1;
 }
 
-double distanceSquared( int x1, int y1, int x2, int y2 )
+int AABBTree::allocateNode()
 {
-    int deltaX = x2 - x1;
-    int deltaY = y2 - y1;
-    return deltaX * deltaX + deltaY * deltaY;
+    // Usa un nodo libre si hay, si no crece el arreglo
+    int node;
+    if( mFreeNode != -1 )
+    {
+        node = mFreeNode;
+        mFreeNode = mNodes[ node ].parent;
+    }
+    else
+    {
+        node = mNodes.size();
+        mNodes.push_back( TreeNode() );
+    }
+
+    mNodes[ node ].parent = -1;
+    mNodes[ node ].child1 = -1;
+    mNodes[ node ].child2 = -1;
+    mNodes[ node ].height = 0;
+    mNodes[ node ].shape = -1;
+    return node;
+}
+
+void AABBTree::freeNode( int node )
+{
+    mNodes[ node ].parent = mFreeNode;
+    mNodes[ node ].height = -1;
+    mFreeNode = node;
+}
+
+int AABBTree::allocateShape()
+{
+    int id;
+    if( mFreeShape != -1 )
+    {
+        id = mFreeShape;
+        mFreeShape = mShapes[ id ].node;
+    }
+    else
+    {
+        id = mShapes.size();
+        mShapes.push_back( TreeShape() );
+    }
+    return id;
+}
+
+int AABBTree::insert( Circle& circle )
+{
+    int id = allocateShape();
+    mShapes[ id ].isCircle = true;
+    mShapes[ id ].circle = circle;
+
+    // Crea la hoja con la caja agrandada
+    int leaf = allocateNode();
+    mNodes[ leaf ].shape = id;
+    mShapes[ id ].node = leaf;
+    fattenLeaf( leaf );
+    insertLeaf( leaf );
+    return id;
+}
+
+int AABBTree::insert( SDL_Rect& rect )
+{
+    int id = allocateShape();
+    mShapes[ id ].isCircle = false;
+    mShapes[ id ].rect = rect;
+
+    // Crea la hoja con la caja agrandada
+    int leaf = allocateNode();
+    mNodes[ leaf ].shape = id;
+    mShapes[ id ].node = leaf;
+    fattenLeaf( leaf );
+    insertLeaf( leaf );
+    return id;
+}
+
+void AABBTree::remove( int id )
+{
+    int leaf = mShapes[ id ].node;
+    removeLeaf( leaf );
+    freeNode( leaf );
+
+    // Encadena la figura a la lista libre
+    mShapes[ id ].node = mFreeShape;
+    mFreeShape = id;
+}
+
+bool AABBTree::move( int id, Circle& circle )
+{
+    TreeShape& shape = mShapes[ id ];
+    TreeNode& leaf = mNodes[ shape.node ];
+    shape.circle = circle;
+
+    // Si la figura sigue dentro de la caja agrandada no hay que tocar el árbol
+    if( circle.x - circle.r >= leaf.minX && circle.y - circle.r >= leaf.minY
+            && circle.x + circle.r <= leaf.maxX && circle.y + circle.r <= leaf.maxY )
+    {
+        return false;
+    }
+
+    removeLeaf( shape.node );
+    fattenLeaf( shape.node );
+    insertLeaf( shape.node );
+    return true;
+}
+
+bool AABBTree::move( int id, SDL_Rect& rect )
+{
+    TreeShape& shape = mShapes[ id ];
+    TreeNode& leaf = mNodes[ shape.node ];
+    shape.rect = rect;
+
+    // Si la figura sigue dentro de la caja agrandada no hay que tocar el árbol
+    if( rect.x >= leaf.minX && rect.y >= leaf.minY
+            && rect.x + rect.w <= leaf.maxX && rect.y + rect.h <= leaf.maxY )
+    {
+        return false;
+    }
+
+    removeLeaf( shape.node );
+    fattenLeaf( shape.node );
+    insertLeaf( shape.node );
+    return true;
+}
+
+void AABBTree::fattenLeaf( int leaf )
+{
+    TreeNode& node = mNodes[ leaf ];
+    TreeShape& shape = mShapes[ node.shape ];
+
+    if( shape.isCircle )
+    {
+        node.minX = shape.circle.x - shape.circle.r - FAT_MARGIN;
+        node.minY = shape.circle.y - shape.circle.r - FAT_MARGIN;
+        node.maxX = shape.circle.x + shape.circle.r + FAT_MARGIN;
+        node.maxY = shape.circle.y + shape.circle.r + FAT_MARGIN;
+    }
+    else
+    {
+        node.minX = shape.rect.x - FAT_MARGIN;
+        node.minY = shape.rect.y - FAT_MARGIN;
+        node.maxX = shape.rect.x + shape.rect.w + FAT_MARGIN;
+        node.maxY = shape.rect.y + shape.rect.h + FAT_MARGIN;
+    }
+}
+
+void AABBTree::insertLeaf( int leaf )
+{
+    // El primer nodo es la raíz
+    if( mRoot == -1 )
+    {
+        mRoot = leaf;
+        mNodes[ leaf ].parent = -1;
+        return;
+    }
+
+    // Baja por el árbol eligiendo el hijo que menos crece según SAH
+    int index = mRoot;
+    while( mNodes[ index ].child1 != -1 )
+    {
+        TreeNode& node = mNodes[ index ];
+        int area = perimeter( node.minX, node.minY, node.maxX, node.maxY );
+        int combined = unionPerimeter( node, mNodes[ leaf ] );
+
+        // Costo de crear un padre nuevo para este nodo y la hoja
+        int cost = 2 * combined;
+
+        // Costo mínimo de bajar más, todos los ancestros crecen igual
+        int inheritance = 2 * ( combined - area );
+
+        // Costo de bajar por cada hijo
+        int childCost[ 2 ];
+        int children[ 2 ] = { node.child1, node.child2 };
+        for( int c = 0; c < 2; ++c )
+        {
+            TreeNode& child = mNodes[ children[ c ] ];
+            int grown = unionPerimeter( child, mNodes[ leaf ] );
+            if( child.child1 == -1 )
+            {
+                childCost[ c ] = grown + inheritance;
+            }
+            else
+            {
+                childCost[ c ] = grown - perimeter( child.minX, child.minY, child.maxX, child.maxY )
+                    + inheritance;
+            }
+        }
+
+        // Si crear el padre aquí es lo más barato termina
+        if( cost < childCost[ 0 ] && cost < childCost[ 1 ] )
+        {
+            break;
+        }
+
+        index = childCost[ 0 ] < childCost[ 1 ] ? children[ 0 ] : children[ 1 ];
+    }
+
+    // Crea un padre nuevo para el hermano y la hoja
+    int sibling = index;
+    int oldParent = mNodes[ sibling ].parent;
+    int newParent = allocateNode();
+    mNodes[ newParent ].parent = oldParent;
+    mNodes[ newParent ].child1 = sibling;
+    mNodes[ newParent ].child2 = leaf;
+    mNodes[ sibling ].parent = newParent;
+    mNodes[ leaf ].parent = newParent;
+
+    if( oldParent == -1 )
+    {
+        mRoot = newParent;
+    }
+    else if( mNodes[ oldParent ].child1 == sibling )
+    {
+        mNodes[ oldParent ].child1 = newParent;
+    }
+    else
+    {
+        mNodes[ oldParent ].child2 = newParent;
+    }
+
+    // Sube por el árbol ajustando cajas y rotando
+    index = newParent;
+    while( index != -1 )
+    {
+        refit( index );
+        rotate( index );
+        index = mNodes[ index ].parent;
+    }
+}
+
+void AABBTree::removeLeaf( int leaf )
+{
+    if( leaf == mRoot )
+    {
+        mRoot = -1;
+        return;
+    }
+
+    // El hermano toma el lugar del padre
+    int parent = mNodes[ leaf ].parent;
+    int grandParent = mNodes[ parent ].parent;
+    int sibling = mNodes[ parent ].child1 == leaf ? mNodes[ parent ].child2 : mNodes[ parent ].child1;
+
+    if( grandParent == -1 )
+    {
+        mRoot = sibling;
+        mNodes[ sibling ].parent = -1;
+        freeNode( parent );
+        return;
+    }
+
+    if( mNodes[ grandParent ].child1 == parent )
+    {
+        mNodes[ grandParent ].child1 = sibling;
+    }
+    else
+    {
+        mNodes[ grandParent ].child2 = sibling;
+    }
+    mNodes[ sibling ].parent = grandParent;
+    freeNode( parent );
+
+    // Sube por el árbol ajustando cajas y rotando
+    int index = grandParent;
+    while( index != -1 )
+    {
+        refit( index );
+        rotate( index );
+        index = mNodes[ index ].parent;
+    }
+}
+
+void AABBTree::refit( int index )
+{
+    TreeNode& node = mNodes[ index ];
+    TreeNode& a = mNodes[ node.child1 ];
+    TreeNode& b = mNodes[ node.child2 ];
+
+    node.minX = std::min( a.minX, b.minX );
+    node.minY = std::min( a.minY, b.minY );
+    node.maxX = std::max( a.maxX, b.maxX );
+    node.maxY = std::max( a.maxY, b.maxY );
+    node.height = 1 + std::max( a.height, b.height );
+}
+
+void AABBTree::rotate( int index )
+{
+    // Rotaciones de Kensler: cambia un hijo por un nieto del otro lado
+    // si la caja del hijo que queda se hace más pequeña
+    int b = mNodes[ index ].child1;
+    int c = mNodes[ index ].child2;
+
+    int bestCost = 0;
+    int bestSwap = -1;
+    int bestTarget = -1;
+
+    // Candidatos: B con los hijos de C, C con los hijos de B
+    int pairs[ 2 ][ 2 ] = { { b, c }, { c, b } };
+    for( int p = 0; p < 2; ++p )
+    {
+        int keep = pairs[ p ][ 0 ];
+        int other = pairs[ p ][ 1 ];
+        if( mNodes[ other ].child1 == -1 )
+        {
+            continue;
+        }
+
+        TreeNode& o = mNodes[ other ];
+        int area = perimeter( o.minX, o.minY, o.maxX, o.maxY );
+        int grandChildren[ 2 ] = { o.child1, o.child2 };
+        for( int g = 0; g < 2; ++g )
+        {
+            // keep baja al lugar de este nieto, other queda con keep y el otro nieto
+            int stays = grandChildren[ 1 - g ];
+            int cost = unionPerimeter( mNodes[ keep ], mNodes[ stays ] ) - area;
+            if( cost < bestCost )
+            {
+                bestCost = cost;
+                bestSwap = keep;
+                bestTarget = grandChildren[ g ];
+            }
+        }
+    }
+
+    // Ninguna rotación mejora el árbol
+    if( bestSwap == -1 )
+    {
+        return;
+    }
+
+    // Intercambia bestSwap (hijo de index) con bestTarget (nieto)
+    int other = mNodes[ bestTarget ].parent;
+    if( mNodes[ index ].child1 == bestSwap )
+    {
+        mNodes[ index ].child1 = bestTarget;
+    }
+    else
+    {
+        mNodes[ index ].child2 = bestTarget;
+    }
+    if( mNodes[ other ].child1 == bestTarget )
+    {
+        mNodes[ other ].child1 = bestSwap;
+    }
+    else
+    {
+        mNodes[ other ].child2 = bestSwap;
+    }
+    mNodes[ bestTarget ].parent = index;
+    mNodes[ bestSwap ].parent = other;
+
+    refit( other );
+    refit( index );
+}
+
+void AABBTree::query( SDL_Rect& region, std::vector<int>& results )
+{
+    if( mRoot == -1 )
+    {
+        return;
+    }
+
+    mStack.clear();
+    mStack.push_back( mRoot );
+    while( !mStack.empty() )
+    {
+        int index = mStack.back();
+        mStack.pop_back();
+        TreeNode& node = mNodes[ index ];
+
+        // Descarta las ramas que no tocan la región
+        if( node.maxX < region.x || node.minX > region.x + region.w
+                || node.maxY < region.y || node.minY > region.y + region.h )
+        {
+            continue;
+        }
+
+        if( node.child1 != -1 )
+        {
+            mStack.push_back( node.child1 );
+            mStack.push_back( node.child2 );
+            continue;
+        }
+
+        // Prueba exacta con la figura
+        TreeShape& shape = mShapes[ node.shape ];
+        bool hit;
+        if( shape.isCircle )
+        {
+            hit = checkCollision( shape.circle, region );
+        }
+        else
+        {
+            hit = !( ( shape.rect.y + shape.rect.h <= region.y ) || ( shape.rect.y >= region.y + region.h )
+                    || ( shape.rect.x + shape.rect.w <= region.x ) || ( shape.rect.x >= region.x + region.w ) );
+        }
+
+        if( hit )
+        {
+            results.push_back( node.shape );
+        }
+    }
+}
+
+void AABBTree::query( Circle& region, std::vector<int>& results )
+{
+    if( mRoot == -1 )
+    {
+        return;
+    }
+
+    mStack.clear();
+    mStack.push_back( mRoot );
+    while( !mStack.empty() )
+    {
+        int index = mStack.back();
+        mStack.pop_back();
+        TreeNode& node = mNodes[ index ];
+
+        // Descarta las ramas que no tocan la región
+        if( node.maxX < region.x - region.r || node.minX > region.x + region.r
+                || node.maxY < region.y - region.r || node.minY > region.y + region.r )
+        {
+            continue;
+        }
+
+        if( node.child1 != -1 )
+        {
+            mStack.push_back( node.child1 );
+            mStack.push_back( node.child2 );
+            continue;
+        }
+
+        // Prueba exacta con la figura
+        TreeShape& shape = mShapes[ node.shape ];
+        bool hit = shape.isCircle ? checkCollision( region, shape.circle )
+            : checkCollision( region, shape.rect );
+
+        if( hit )
+        {
+            results.push_back( node.shape );
+        }
+    }
+}
+
+int AABBTree::rayCast( int x1, int y1, int x2, int y2, float& fraction )
+{
+    int closest = -1;
+    fraction = 1.0f;
+    if( mRoot == -1 )
+    {
+        return closest;
+    }
+
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+
+    mStack.clear();
+    mStack.push_back( mRoot );
+    while( !mStack.empty() )
+    {
+        int index = mStack.back();
+        mStack.pop_back();
+        TreeNode& node = mNodes[ index ];
+
+        // Descarta las ramas que el segmento no alcanza antes del impacto más cercano
+        float t;
+        if( !rayHitsBox( x1, y1, dx, dy, node.minX, node.minY, node.maxX, node.maxY, fraction, t ) )
+        {
+            continue;
+        }
+
+        if( node.child1 != -1 )
+        {
+            mStack.push_back( node.child1 );
+            mStack.push_back( node.child2 );
+            continue;
+        }
+
+        // Prueba exacta con la figura
+        TreeShape& shape = mShapes[ node.shape ];
+        bool hit;
+        if( shape.isCircle )
+        {
+            hit = rayHitsCircle( x1, y1, dx, dy, shape.circle, fraction, t );
+        }
+        else
+        {
+            hit = rayHitsBox( x1, y1, dx, dy, shape.rect.x, shape.rect.y,
+                    shape.rect.x + shape.rect.w, shape.rect.y + shape.rect.h, fraction, t );
+        }
+
+        if( hit && ( closest == -1 || t < fraction ) )
+        {
+            closest = node.shape;
+            fraction = t;
+        }
+    }
+
+    return closest;
+}
+
+TreeShape& AABBTree::getShape( int id )
+{
+    return mShapes[ id ];
+}
+
+int AABBTree::getHeight()
+{
+    return mRoot == -1 ? 0 : mNodes[ mRoot ].height;
+}
+
+void benchmarkTree( int shapes, int queries )
+{
+    // Escena con mucha variación de tamaños, figuras de 1 a 200 pixeles
+    const int WORLD = 8192;
+    AABBTree tree;
+    std::vector<int> ids( shapes );
+    for( int i = 0; i < shapes; ++i )
+    {
+        int size = ( rand() % 100 ) < 95 ? 1 + rand() % 8 : 50 + rand() % 150;
+        if( i % 2 == 0 )
+        {
+            Circle circle = { rand() % WORLD, rand() % WORLD, size / 2 + 1 };
+            ids[ i ] = tree.insert( circle );
+        }
+        else
+        {
+            SDL_Rect rect = { rand() % WORLD, rand() % WORLD, size, 1 + rand() % ( size + 1 ) };
+            ids[ i ] = tree.insert( rect );
+        }
+    }
+
+    double freq = SDL_GetPerformanceFrequency();
+    printf( "%d figuras, altura del árbol %d\n", shapes, tree.getHeight() );
+
+    // Consultas por región, el árbol contra la fuerza bruta
+    std::vector<int> results;
+    int treeHits = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int q = 0; q < queries; ++q )
+    {
+        SDL_Rect region = { ( q * 7919 ) % WORLD, ( q * 104729 ) % WORLD, 128, 128 };
+        results.clear();
+        tree.query( region, results );
+        treeHits += results.size();
+    }
+    Uint64 treeTicks = SDL_GetPerformanceCounter() - start;
+
+    int bruteHits = 0;
+    start = SDL_GetPerformanceCounter();
+    for( int q = 0; q < queries; ++q )
+    {
+        SDL_Rect region = { ( q * 7919 ) % WORLD, ( q * 104729 ) % WORLD, 128, 128 };
+        for( int i = 0; i < shapes; ++i )
+        {
+            TreeShape& shape = tree.getShape( ids[ i ] );
+            if( shape.isCircle )
+            {
+                bruteHits += checkCollision( shape.circle, region );
+            }
+            else
+            {
+                SDL_Rect& r = shape.rect;
+                bruteHits += !( ( r.y + r.h <= region.y ) || ( r.y >= region.y + region.h )
+                        || ( r.x + r.w <= region.x ) || ( r.x >= region.x + region.w ) );
+            }
+        }
+    }
+    Uint64 bruteTicks = SDL_GetPerformanceCounter() - start;
+
+    printf( "  región:  árbol %.0f consultas/s, fuerza bruta %.0f consultas/s (%d / %d)\n",
+            queries * freq / treeTicks, queries * freq / bruteTicks, treeHits, bruteHits );
+
+    // Rayos de cuatro tipos: largos que cruzan el mundo, cortos que casi nunca
+    // tocan nada, fuera del mundo que nunca tocan nada y que empiezan dentro
+    // de una figura. Las figuras llegan a lo más 100 pixeles fuera del mundo
+    std::vector<SDL_Rect> rays( queries );
+    for( int q = 0; q < queries; ++q )
+    {
+        SDL_Rect& ray = rays[ q ];
+        switch( q % 4 )
+        {
+            case 0:
+                ray.x = ( q * 7919 ) % WORLD;
+                ray.y = 0;
+                ray.w = ( q * 104729 ) % WORLD - ray.x;
+                ray.h = WORLD;
+                break;
+            case 1:
+                ray.x = rand() % WORLD;
+                ray.y = rand() % WORLD;
+                ray.w = rand() % 65 - 32;
+                ray.h = rand() % 65 - 32;
+                break;
+            case 2:
+                ray.x = rand() % WORLD;
+                ray.y = -300 - rand() % 100;
+                ray.w = rand() % WORLD - ray.x;
+                ray.h = rand() % 100 - 50;
+                break;
+            default:
+            {
+                TreeShape& shape = tree.getShape( ids[ rand() % shapes ] );
+                ray.x = shape.isCircle ? shape.circle.x : shape.rect.x + shape.rect.w / 2;
+                ray.y = shape.isCircle ? shape.circle.y : shape.rect.y + shape.rect.h / 2;
+                ray.w = rand() % 513 - 256;
+                ray.h = rand() % 513 - 256;
+                break;
+            }
+        }
+    }
+
+    // Rayos, el árbol contra la fuerza bruta; una fracción de 2 es un fallo
+    std::vector<float> treeFractions( queries );
+    int treeRays = 0;
+    start = SDL_GetPerformanceCounter();
+    for( int q = 0; q < queries; ++q )
+    {
+        SDL_Rect& ray = rays[ q ];
+        float fraction;
+        bool hit = tree.rayCast( ray.x, ray.y, ray.x + ray.w, ray.y + ray.h, fraction ) != -1;
+        treeFractions[ q ] = hit ? fraction : 2.0f;
+        treeRays += hit;
+    }
+    treeTicks = SDL_GetPerformanceCounter() - start;
+
+    std::vector<float> bruteFractions( queries );
+    int bruteRays = 0;
+    start = SDL_GetPerformanceCounter();
+    for( int q = 0; q < queries; ++q )
+    {
+        SDL_Rect& ray = rays[ q ];
+        float closest = 2.0f;
+        for( int i = 0; i < shapes; ++i )
+        {
+            TreeShape& shape = tree.getShape( ids[ i ] );
+            float t;
+            bool hit;
+            if( shape.isCircle )
+            {
+                hit = rayHitsCircle( ray.x, ray.y, ray.w, ray.h, shape.circle, 1.0f, t );
+            }
+            else
+            {
+                hit = rayHitsBox( ray.x, ray.y, ray.w, ray.h, shape.rect.x, shape.rect.y,
+                        shape.rect.x + shape.rect.w, shape.rect.y + shape.rect.h, 1.0f, t );
+            }
+            if( hit && t < closest )
+            {
+                closest = t;
+            }
+        }
+        bruteFractions[ q ] = closest;
+        bruteRays += closest <= 1.0f;
+    }
+    bruteTicks = SDL_GetPerformanceCounter() - start;
+
+    // Ambos deben encontrar el mismo impacto más cercano, o ninguno
+    int rayMismatches = 0;
+    for( int q = 0; q < queries; ++q )
+    {
+        if( treeFractions[ q ] != bruteFractions[ q ] )
+        {
+            rayMismatches++;
+        }
+    }
+
+    printf( "  rayos:   árbol %.0f rayos/s, fuerza bruta %.0f rayos/s (%d / %d de %d), %d diferencias\n",
+            queries * freq / treeTicks, queries * freq / bruteTicks, treeRays, bruteRays, queries,
+            rayMismatches );
+
+    // Costo de mover todas las figuras unos pixeles por frame
+    const int FRAMES = 100;
+    int reinserts = 0;
+    start = SDL_GetPerformanceCounter();
+    for( int f = 0; f < FRAMES; ++f )
+    {
+        for( int i = 0; i < shapes; ++i )
+        {
+            TreeShape& shape = tree.getShape( ids[ i ] );
+            int dx = rand() % 3 - 1;
+            int dy = rand() % 3 - 1;
+            if( shape.isCircle )
+            {
+                Circle circle = shape.circle;
+                circle.x += dx;
+                circle.y += dy;
+                reinserts += tree.move( ids[ i ], circle );
+            }
+            else
+            {
+                SDL_Rect rect = shape.rect;
+                rect.x += dx;
+                rect.y += dy;
+                reinserts += tree.move( ids[ i ], rect );
+            }
+        }
+    }
+    Uint64 moveTicks = SDL_GetPerformanceCounter() - start;
+
+    printf( "  mover:   %.1f ns por figura, %.1f%% reinsertadas, altura final %d\n",
+            moveTicks * 1000000000.0 / freq / ( (double)shapes * FRAMES ),
+            100.0 * reinserts / ( (double)shapes * FRAMES ), tree.getHeight() );
+}
+
+Fixed toFixed( int value )
+{
+    return value * FIXED_ONE;
+}
+
+int fixedToInt( Fixed value )
+{
+    // Redondea hacia abajo, también con valores negativos
+    return value >> FIXED_SHIFT;
+}
+
+Uint32 hashState( Uint32 hash, Sint32 value )
+{
+    // FNV-1a byte por byte, no depende del orden de bytes del procesador
+    for( int i = 0; i < 4; ++i )
+    {
+        hash ^= ( (Uint32)value >> ( i * 8 ) ) & 0xFF;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+Fixed randomVelocity( Uint32& seed )
+{
+    // Generador congruencial propio, rand() cambia entre bibliotecas
+    seed = seed * 1664525u + 1013904223u;
+
+    // Entre -4 y 4 pixeles por frame, con parte fraccionaria
+    return (Fixed)( ( seed >> 8 ) % ( 8 * FIXED_ONE ) ) - 4 * FIXED_ONE;
+}
+
+Uint32 runDeterminism( int ticks )
+{
+    // El mismo muro y los mismos puntos de la lección
+    SDL_Rect wall;
+    wall.x = 300;
+    wall.y = 40;
+    wall.w = 40;
+    wall.h = 400;
+
+    Dot dot( Dot::DOT_WIDTH / 2, Dot::DOT_HEIGHT / 2 );
+    Dot otherDot( SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4 );
+
+    Uint32 seed = 1;
+    Uint32 hash = 2166136261u;
+
+    for( int t = 0; t < ticks; ++t )
+    {
+        // Cambia la velocidad cada 64 ticks
+        if( t % 64 == 0 )
+        {
+            Fixed velX = randomVelocity( seed );
+            Fixed velY = randomVelocity( seed );
+            dot.setVelocity( velX, velY );
+        }
+
+        dot.move( wall, otherDot.getCollider() );
+
+        // Mezcla el estado de cada tick
+        hash = hashState( hash, dot.getPosition().x );
+        hash = hashState( hash, dot.getPosition().y );
+    }
+
+    return hash;
 }
 
 bool init() {
@@ -637,6 +1862,21 @@ void close() {
 }
 
 int main( int argc, char* argv[] ) {
+    // Prueba de determinismo, el hash debe ser igual con cualquier compilador
+    if( argc > 1 && strcmp( argv[ 1 ], "--determinism" ) == 0 ) {
+        Uint32 hash = runDeterminism( 100000 );
+        printf( "Hash tras 100000 ticks: %08x (%s)\n", hash,
+                hash == DETERMINISM_HASH ? "ok" : "diferente" );
+        return hash == DETERMINISM_HASH ? 0 : 1;
+    }
+
+    // Modo de medición sin ventana
+    if( argc > 1 && strcmp( argv[ 1 ], "--bench" ) == 0 ) {
+        benchmarkBatches( 100000, 1000 );
+        benchmarkTree( 20000, 2000 );
+        return 0;
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string>
-#include <sstream>
+#include <string.h>
+#include <vector>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
@@ -61,6 +62,161 @@ class LTexture {
         int mHeight;
 };
 
+// Buffer de bytes con un hueco en el cursor: insertar o borrar junto al
+// cursor es O(1) amortizado y mover el cursor cuesta lo que se desplaza
+class LGapBuffer {
+    public:
+        // Inicializa las variables
+        LGapBuffer();
+
+        // Inserta bytes antes o después del cursor
+        void insert( const char* text, size_t length );
+        void insertAfter( const char* text, size_t length );
+
+        // Borra bytes antes o después del cursor
+        void eraseBefore( size_t count );
+        void eraseAfter( size_t count );
+
+        // Mueve el cursor a la posición dada
+        void moveGap( size_t position );
+
+        // Copia los bytes del rango [start, end) sin el hueco
+        void copy( size_t start, size_t end, char* dest );
+
+        // Obtiene un byte del texto
+        char at( size_t index );
+
+        // Bytes de texto y posición del cursor
+        size_t size();
+        size_t getGap();
+
+    private:
+        // Asegura espacio en el hueco para insertar
+        void reserve( size_t length );
+
+        // El texto con el hueco en [mGapStart, mGapEnd)
+        std::vector<char> mBuffer;
+        size_t mGapStart;
+        size_t mGapEnd;
+};
+
+// Caja de texto editable con cursor. Cada línea guarda su texto en un
+// LGapBuffer y se divide en tramos de unos RUN_LENGTH bytes, cada uno con su
+// textura. Los tramos a la izquierda del cursor se cuentan desde el inicio de
+// la línea y los de la derecha desde el final, así que al editar junto al
+// cursor sólo se vuelven a rasterizar los tramos que lo tocan
+class LTextEditor {
+    public:
+        // Bytes por tramo rasterizado
+        static const int RUN_LENGTH = 32;
+
+        // Inicializa las variables
+        LTextEditor();
+
+        // Libera la memoria
+        ~LTextEditor();
+
+        // Reemplaza todo el texto, el cursor queda al final
+        void setText( const char* text );
+
+        // Inserta texto en el cursor, puede contener saltos de línea
+        void insert( const char* text );
+
+        // Borra el caracter UTF-8 antes o después del cursor
+        void backspace();
+        void deleteForward();
+
+        // Mueve el cursor
+        void moveLeft();
+        void moveRight();
+        void moveUp();
+        void moveDown();
+        void moveHome();
+        void moveEnd();
+        void setCursor( int line, size_t column );
+
+        // Obtiene una copia del texto completo
+        std::string getText();
+
+        // Dimensiones del texto
+        int getLineCount();
+        size_t getLength();
+
+        // Renderiza las líneas alrededor del cursor que caben en el área dada
+        void render( SDL_Rect area, SDL_Color color );
+
+        // Tramos rasterizados desde el inicio
+        Uint64 getRasterizedRuns();
+
+        // Libera las texturas
+        void free();
+
+    private:
+        // Un tramo de la línea; sin textura ni ancho si ha cambiado
+        struct Run {
+            SDL_Texture* texture;
+            int width;
+            int height;
+        };
+
+        // Tramos de un lado del cursor. Los primeros 'measured' ya tienen
+        // ancho y 'width' es su suma
+        struct RunStack {
+            std::vector<Run> runs;
+            int measured = 0;
+            int width = 0;
+        };
+
+        // Una línea con sus tramos a cada lado del cursor
+        struct Line {
+            LGapBuffer text;
+            RunStack left;
+            RunStack right;
+        };
+
+        // Obtiene una línea por su índice y la línea del cursor
+        Line& getLine( int index );
+        Line& getCursorLine();
+
+        // Descarta los tramos salvo los que cubren los 'kept' bytes junto al
+        // ancla y ajusta el número de tramos a la longitud de ese lado
+        void invalidate( RunStack& stack, size_t kept, size_t length, bool fromEnd );
+
+        // Mueve el cursor dentro de la línea actualizando los tramos
+        void setGap( Line& line, size_t position );
+
+        // Parte la línea en el cursor o la une con la anterior
+        void splitLine();
+        void joinLine();
+
+        // Inserta bytes sin saltos de línea en el cursor
+        void insertBytes( const char* text, size_t length );
+
+        // Posición del caracter UTF-8 anterior y siguiente
+        size_t prevChar( Line& line, size_t position );
+        size_t nextChar( Line& line, size_t position );
+
+        // Obtiene los límites de un tramo sin partir caracteres UTF-8
+        void getRunBounds( Line& line, bool right, int run, size_t* start, size_t* end );
+
+        // Mide los tramos nuevos de un lado y devuelve su ancho
+        int measure( Line& line, bool right );
+
+        // Rasteriza un tramo si hace falta
+        SDL_Texture* getRunTexture( Line& line, bool right, int run );
+
+        // Líneas hasta el cursor incluido, y después del cursor en orden inverso
+        std::vector<Line> mAbove;
+        std::vector<Line> mBelow;
+        size_t mLength;
+
+        // Desplazamiento de la vista
+        int mFirstLine;
+        int mScrollX;
+
+        Uint64 mRasterizedRuns;
+};
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -70,6 +226,9 @@ bool loadMedia();
 // Libera la memoria y termina SDL
 void close();
 
+// Mide la latencia de pulsación con un texto del tamaño dado
+void benchmarkEditor( int length, int lineLength, int keystrokes );
+
 // Ventana donde se renderizará
 SDL_Window* gWindow = NULL;
 
@@ -81,7 +240,9 @@ TTF_Font *gFont = NULL;
 
 // Textura
 LTexture gPromptTextTexture;
-LTexture gInputTextTexture;
+
+// Texto editable
+LTextEditor gInputText;
 
 LTexture::LTexture() {
     // Inicializa la textura
@@ -222,6 +383,574 @@ void LTexture::setHeight( int h ) {
     mHeight = h;
 }
 
+LGapBuffer::LGapBuffer() {
+    // Inicializa las variables
+    mGapStart = 0;
+    mGapEnd = 0;
+}
+
+void LGapBuffer::reserve( size_t length ) {
+    if( mGapEnd - mGapStart >= length ) {
+        return;
+    }
+
+    // Duplica la capacidad y mueve el texto tras el hueco al final
+    size_t after = mBuffer.size() - mGapEnd;
+    size_t capacity = mBuffer.size() * 2;
+    if( capacity < size() + length + 16 ) {
+        capacity = size() + length + 16;
+    }
+    std::vector<char> buffer( capacity );
+    memcpy( buffer.data(), mBuffer.data(), mGapStart );
+    memcpy( buffer.data() + capacity - after, mBuffer.data() + mGapEnd, after );
+    mBuffer.swap( buffer );
+    mGapEnd = capacity - after;
+}
+
+void LGapBuffer::insert( const char* text, size_t length ) {
+    reserve( length );
+    memcpy( mBuffer.data() + mGapStart, text, length );
+    mGapStart += length;
+}
+
+void LGapBuffer::insertAfter( const char* text, size_t length ) {
+    reserve( length );
+    mGapEnd -= length;
+    memcpy( mBuffer.data() + mGapEnd, text, length );
+}
+
+void LGapBuffer::eraseBefore( size_t count ) {
+    mGapStart -= count;
+}
+
+void LGapBuffer::eraseAfter( size_t count ) {
+    mGapEnd += count;
+}
+
+void LGapBuffer::moveGap( size_t position ) {
+    // Desplaza sólo los bytes entre el cursor y la nueva posición
+    if( position < mGapStart ) {
+        size_t count = mGapStart - position;
+        memmove( mBuffer.data() + mGapEnd - count, mBuffer.data() + position, count );
+        mGapStart -= count;
+        mGapEnd -= count;
+    } else if( position > mGapStart ) {
+        size_t count = position - mGapStart;
+        memmove( mBuffer.data() + mGapStart, mBuffer.data() + mGapEnd, count );
+        mGapStart += count;
+        mGapEnd += count;
+    }
+}
+
+void LGapBuffer::copy( size_t start, size_t end, char* dest ) {
+    // Parte antes del hueco
+    if( start < mGapStart ) {
+        size_t count = ( end < mGapStart ? end : mGapStart ) - start;
+        memcpy( dest, mBuffer.data() + start, count );
+        dest += count;
+        start += count;
+    }
+
+    // Parte después del hueco
+    if( start < end ) {
+        memcpy( dest, mBuffer.data() + start + mGapEnd - mGapStart, end - start );
+    }
+}
+
+char LGapBuffer::at( size_t index ) {
+    return index < mGapStart ? mBuffer[ index ] : mBuffer[ index + mGapEnd - mGapStart ];
+}
+
+size_t LGapBuffer::size() {
+    return mBuffer.size() - ( mGapEnd - mGapStart );
+}
+
+size_t LGapBuffer::getGap() {
+    return mGapStart;
+}
+
+LTextEditor::LTextEditor() {
+    // Inicializa las variables
+    mLength = 0;
+    mFirstLine = 0;
+    mScrollX = 0;
+    mRasterizedRuns = 0;
+    mAbove.push_back( Line() );
+}
+
+LTextEditor::~LTextEditor() {
+    // Libera la memoria
+    free();
+}
+
+void LTextEditor::free() {
+    // Libera las texturas de todos los tramos
+    for( int i = 0; i < getLineCount(); ++i ) {
+        Line& line = getLine( i );
+        size_t gap = line.text.getGap();
+        invalidate( line.left, 0, gap, false );
+        invalidate( line.right, 0, line.text.size() - gap, true );
+    }
+}
+
+void LTextEditor::setText( const char* text ) {
+    free();
+    mAbove.clear();
+    mBelow.clear();
+    mAbove.push_back( Line() );
+    mLength = 0;
+    mFirstLine = 0;
+    mScrollX = 0;
+    insert( text );
+}
+
+LTextEditor::Line& LTextEditor::getLine( int index ) {
+    if( index < (int)mAbove.size() ) {
+        return mAbove[ index ];
+    }
+    return mBelow[ mBelow.size() - 1 - ( index - mAbove.size() ) ];
+}
+
+LTextEditor::Line& LTextEditor::getCursorLine() {
+    return mAbove.back();
+}
+
+void LTextEditor::insert( const char* text ) {
+    for( const char* c = text; *c != '\0'; ) {
+        // Inserta hasta el siguiente salto de línea de una vez
+        const char* end = c;
+        while( *end != '\0' && *end != '\n' && *end != '\r' ) {
+            ++end;
+        }
+        if( end > c ) {
+            insertBytes( c, end - c );
+        }
+
+        if( *end == '\0' ) {
+            break;
+        }
+
+        // Los '\r' del portapapeles se descartan
+        if( *end == '\n' ) {
+            splitLine();
+        }
+        c = end + 1;
+    }
+}
+
+void LTextEditor::insertBytes( const char* text, size_t length ) {
+    // Los tramos de la derecha están anclados al final y no cambian
+    Line& line = getCursorLine();
+    size_t gap = line.text.getGap();
+    line.text.insert( text, length );
+    invalidate( line.left, gap, gap + length, false );
+    mLength += length;
+}
+
+void LTextEditor::backspace() {
+    Line& line = getCursorLine();
+    size_t gap = line.text.getGap();
+    if( gap > 0 ) {
+        // Borra el caracter UTF-8 completo
+        size_t start = prevChar( line, gap );
+        line.text.eraseBefore( gap - start );
+        invalidate( line.left, start, start, false );
+        mLength -= gap - start;
+    } else if( mAbove.size() > 1 ) {
+        // Borra el salto de línea
+        joinLine();
+    }
+}
+
+void LTextEditor::deleteForward() {
+    Line& line = getCursorLine();
+    size_t gap = line.text.getGap();
+    size_t length = line.text.size();
+    if( gap < length ) {
+        // Borra el caracter UTF-8 completo
+        size_t count = nextChar( line, gap ) - gap;
+        line.text.eraseAfter( count );
+        invalidate( line.right, length - gap - count, length - gap - count, true );
+        mLength -= count;
+    } else if( !mBelow.empty() ) {
+        // Borra el salto de línea
+        moveRight();
+        joinLine();
+    }
+}
+
+void LTextEditor::splitLine() {
+    Line& line = getCursorLine();
+    size_t gap = line.text.getGap();
+    size_t length = line.text.size();
+
+    // Copia la mitad más corta; la otra se queda con el buffer
+    Line next;
+    if( length - gap <= gap ) {
+        std::vector<char> tail( length - gap );
+        line.text.copy( gap, length, tail.data() );
+        line.text.eraseAfter( length - gap );
+        next.text.insertAfter( tail.data(), tail.size() );
+    } else {
+        std::vector<char> head( gap );
+        line.text.copy( 0, gap, head.data() );
+        std::swap( line.text, next.text );
+        next.text.eraseBefore( gap );
+        line.text.insert( head.data(), head.size() );
+    }
+
+    // Los tramos de la derecha siguen anclados al final de su texto
+    std::swap( line.right, next.right );
+
+    mAbove.push_back( std::move( next ) );
+    ++mLength;
+}
+
+void LTextEditor::joinLine() {
+    // El cursor está al inicio de la línea actual
+    Line& prev = mAbove[ mAbove.size() - 2 ];
+    Line& line = getCursorLine();
+    setGap( prev, prev.text.size() );
+
+    // Copia la línea más corta dentro de la otra
+    if( line.text.size() <= prev.text.size() ) {
+        std::vector<char> text( line.text.size() );
+        line.text.copy( 0, text.size(), text.data() );
+        prev.text.insertAfter( text.data(), text.size() );
+        std::swap( prev.right, line.right );
+        mAbove.pop_back();
+    } else {
+        std::vector<char> text( prev.text.size() );
+        prev.text.copy( 0, text.size(), text.data() );
+        line.text.insert( text.data(), text.size() );
+        std::swap( prev.left, line.left );
+        std::swap( prev, line );
+        mAbove.pop_back();
+    }
+    --mLength;
+}
+
+void LTextEditor::moveLeft() {
+    Line& line = getCursorLine();
+    size_t gap = line.text.getGap();
+    if( gap > 0 ) {
+        setGap( line, prevChar( line, gap ) );
+    } else if( mAbove.size() > 1 ) {
+        moveUp();
+        moveEnd();
+    }
+}
+
+void LTextEditor::moveRight() {
+    Line& line = getCursorLine();
+    size_t gap = line.text.getGap();
+    if( gap < line.text.size() ) {
+        setGap( line, nextChar( line, gap ) );
+    } else if( !mBelow.empty() ) {
+        moveDown();
+        moveHome();
+    }
+}
+
+void LTextEditor::moveUp() {
+    if( mAbove.size() > 1 ) {
+        // Cambiar de línea sólo mueve la línea de una pila a la otra
+        size_t column = getCursorLine().text.getGap();
+        mBelow.push_back( std::move( mAbove.back() ) );
+        mAbove.pop_back();
+        setCursor( mAbove.size() - 1, column );
+    }
+}
+
+void LTextEditor::moveDown() {
+    if( !mBelow.empty() ) {
+        size_t column = getCursorLine().text.getGap();
+        mAbove.push_back( std::move( mBelow.back() ) );
+        mBelow.pop_back();
+        setCursor( mAbove.size() - 1, column );
+    }
+}
+
+void LTextEditor::moveHome() {
+    setGap( getCursorLine(), 0 );
+}
+
+void LTextEditor::moveEnd() {
+    setGap( getCursorLine(), getCursorLine().text.size() );
+}
+
+void LTextEditor::setCursor( int line, size_t column ) {
+    // Pasa las líneas de una pila a la otra hasta llegar
+    while( line < (int)mAbove.size() - 1 ) {
+        mBelow.push_back( std::move( mAbove.back() ) );
+        mAbove.pop_back();
+    }
+    while( line > (int)mAbove.size() - 1 && !mBelow.empty() ) {
+        mAbove.push_back( std::move( mBelow.back() ) );
+        mBelow.pop_back();
+    }
+
+    // Ajusta la columna al inicio de un caracter
+    Line& cursorLine = getCursorLine();
+    size_t length = cursorLine.text.size();
+    if( column > length ) {
+        column = length;
+    }
+    while( column > 0 && column < length && ( cursorLine.text.at( column ) & 0xC0 ) == 0x80 ) {
+        --column;
+    }
+    setGap( cursorLine, column );
+}
+
+void LTextEditor::setGap( Line& line, size_t position ) {
+    size_t gap = line.text.getGap();
+    size_t length = line.text.size();
+    if( position == gap ) {
+        return;
+    }
+
+    // Sólo cambian los tramos entre la posición vieja y la nueva
+    line.text.moveGap( position );
+    invalidate( line.left, position < gap ? position : gap, position, false );
+    invalidate( line.right, length - ( position > gap ? position : gap ), length - position, true );
+}
+
+size_t LTextEditor::prevChar( Line& line, size_t position ) {
+    // Retrocede sobre los bytes de continuación 10xxxxxx
+    do {
+        --position;
+    } while( position > 0 && ( line.text.at( position ) & 0xC0 ) == 0x80 );
+    return position;
+}
+
+size_t LTextEditor::nextChar( Line& line, size_t position ) {
+    size_t length = line.text.size();
+    do {
+        ++position;
+    } while( position < length && ( line.text.at( position ) & 0xC0 ) == 0x80 );
+    return position;
+}
+
+std::string LTextEditor::getText() {
+    // Una sola copia al tamaño exacto
+    std::string text( mLength, '\0' );
+    size_t offset = 0;
+    for( int i = 0; i < getLineCount(); ++i ) {
+        Line& line = getLine( i );
+        if( i > 0 ) {
+            text[ offset++ ] = '\n';
+        }
+        line.text.copy( 0, line.text.size(), &text[ offset ] );
+        offset += line.text.size();
+    }
+    return text;
+}
+
+int LTextEditor::getLineCount() {
+    return mAbove.size() + mBelow.size();
+}
+
+size_t LTextEditor::getLength() {
+    return mLength;
+}
+
+Uint64 LTextEditor::getRasterizedRuns() {
+    return mRasterizedRuns;
+}
+
+void LTextEditor::invalidate( RunStack& stack, size_t kept, size_t length, bool fromEnd ) {
+    // A la izquierda los límites se mueven hasta 3 bytes hacia delante para
+    // no partir un caracter UTF-8, así que el tramo anterior también cambia
+    int first;
+    if( fromEnd ) {
+        first = kept / RUN_LENGTH;
+    } else {
+        first = ( kept >= 4 ? kept - 4 : 0 ) / RUN_LENGTH;
+    }
+
+    for( int i = first; i < (int)stack.runs.size(); ++i ) {
+        if( stack.runs[ i ].texture != NULL ) {
+            SDL_DestroyTexture( stack.runs[ i ].texture );
+        }
+        if( i < stack.measured ) {
+            stack.width -= stack.runs[ i ].width;
+        }
+    }
+    if( stack.measured > first ) {
+        stack.measured = first;
+    }
+
+    // Tramos nuevos sin medir para el texto actual
+    Run empty = { NULL, -1, 0 };
+    stack.runs.resize( first < (int)stack.runs.size() ? first : stack.runs.size() );
+    stack.runs.resize( ( length + RUN_LENGTH - 1 ) / RUN_LENGTH, empty );
+}
+
+void LTextEditor::getRunBounds( Line& line, bool right, int run, size_t* start, size_t* end ) {
+    size_t gap = line.text.getGap();
+    size_t length = line.text.size();
+    size_t s, e, limit;
+    if( !right ) {
+        // Contados desde el inicio de la línea
+        s = run * RUN_LENGTH;
+        e = s + RUN_LENGTH < gap ? s + RUN_LENGTH : gap;
+        limit = gap;
+    } else {
+        // Contados desde el final de la línea
+        s = length - gap > (size_t)( run + 1 ) * RUN_LENGTH ? length - (size_t)( run + 1 ) * RUN_LENGTH : gap;
+        e = length - run * RUN_LENGTH;
+        limit = length;
+    }
+
+    // Avanza los límites mientras caigan en un byte de continuación UTF-8
+    while( s < limit && ( line.text.at( s ) & 0xC0 ) == 0x80 ) {
+        ++s;
+    }
+    while( e < limit && ( line.text.at( e ) & 0xC0 ) == 0x80 ) {
+        ++e;
+    }
+    *start = s;
+    *end = e;
+}
+
+int LTextEditor::measure( Line& line, bool right ) {
+    RunStack& stack = right ? line.right : line.left;
+    char buffer[ RUN_LENGTH + 8 ];
+    while( stack.measured < (int)stack.runs.size() ) {
+        Run& run = stack.runs[ stack.measured ];
+        size_t start, end;
+        getRunBounds( line, right, stack.measured, &start, &end );
+        line.text.copy( start, end, buffer );
+        buffer[ end - start ] = '\0';
+
+        // Mide el tramo sin rasterizarlo
+        int w = 0;
+        int h = 0;
+        if( end > start ) {
+            TTF_SizeUTF8( gFont, buffer, &w, &h );
+        }
+        run.width = w;
+        run.height = h;
+        stack.width += w;
+        ++stack.measured;
+    }
+    return stack.width;
+}
+
+SDL_Texture* LTextEditor::getRunTexture( Line& line, bool right, int index ) {
+    Run& run = ( right ? line.right : line.left ).runs[ index ];
+    if( run.texture != NULL ) {
+        return run.texture;
+    }
+
+    size_t start, end;
+    getRunBounds( line, right, index, &start, &end );
+    if( end == start ) {
+        return NULL;
+    }
+
+    char buffer[ RUN_LENGTH + 8 ];
+    line.text.copy( start, end, buffer );
+    buffer[ end - start ] = '\0';
+
+    // Se rasteriza en blanco y el color se aplica con la modulación
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface* textSurface = TTF_RenderUTF8_Solid( gFont, buffer, white );
+    if( textSurface == NULL ) {
+        printf( "No se pudo renderizar la superficie del texto! SDL_ttf Error: %s\n",
+                TTF_GetError() );
+        return NULL;
+    }
+    run.texture = SDL_CreateTextureFromSurface( gRenderer, textSurface );
+    if( run.texture == NULL ) {
+        printf( "No se pudo crear la textura desde el texto renderizado! SDL Error: %s\n",
+                SDL_GetError() );
+    }
+    run.height = textSurface->h;
+    SDL_FreeSurface( textSurface );
+
+    ++mRasterizedRuns;
+    return run.texture;
+}
+
+void LTextEditor::render( SDL_Rect area, SDL_Color color ) {
+    // Mantiene la línea del cursor dentro de la vista
+    int lineHeight = TTF_FontLineSkip( gFont );
+    int visibleLines = area.h / lineHeight;
+    int cursorLine = mAbove.size() - 1;
+    if( cursorLine < mFirstLine ) {
+        mFirstLine = cursorLine;
+    }
+    if( cursorLine >= mFirstLine + visibleLines ) {
+        mFirstLine = cursorLine - visibleLines + 1;
+    }
+    if( mFirstLine > getLineCount() - visibleLines ) {
+        mFirstLine = getLineCount() > visibleLines ? getLineCount() - visibleLines : 0;
+    }
+
+    // Desplazamiento horizontal para que se vea el cursor en líneas largas
+    Line& current = getCursorLine();
+    int caretX = measure( current, false );
+    int margin = area.w / 4;
+    if( caretX + measure( current, true ) <= area.w ) {
+        mScrollX = 0;
+    } else if( caretX - mScrollX > area.w - margin ) {
+        mScrollX = caretX - area.w + margin;
+    } else if( caretX - mScrollX < margin ) {
+        mScrollX = caretX > margin ? caretX - margin : 0;
+    }
+
+    for( int i = mFirstLine; i < getLineCount() && i < mFirstLine + visibleLines; ++i ) {
+        Line& line = getLine( i );
+        int y = area.y + ( i - mFirstLine ) * lineHeight;
+
+        // Las líneas que caben se centran; las largas usan el desplazamiento
+        int leftWidth = measure( line, false );
+        int lineWidth = leftWidth + measure( line, true );
+        int x = lineWidth <= area.w ? area.x + ( area.w - lineWidth ) / 2 : area.x - mScrollX;
+        int gapX = x + leftWidth;
+
+        // Tramos de la izquierda desde el cursor hasta salir por la izquierda
+        int runX = gapX;
+        for( int r = (int)line.left.runs.size() - 1; r >= 0 && runX > area.x; --r ) {
+            Run& run = line.left.runs[ r ];
+            runX -= run.width;
+            if( runX >= area.x + area.w ) {
+                continue;
+            }
+            SDL_Texture* texture = getRunTexture( line, false, r );
+            if( texture != NULL ) {
+                SDL_SetTextureColorMod( texture, color.r, color.g, color.b );
+                SDL_Rect renderQuad = { runX, y, run.width, run.height };
+                SDL_RenderCopy( gRenderer, texture, NULL, &renderQuad );
+            }
+        }
+
+        // Tramos de la derecha desde el cursor hasta salir por la derecha
+        runX = gapX;
+        for( int r = (int)line.right.runs.size() - 1; r >= 0 && runX < area.x + area.w; --r ) {
+            Run& run = line.right.runs[ r ];
+            runX += run.width;
+            if( runX <= area.x ) {
+                continue;
+            }
+            SDL_Texture* texture = getRunTexture( line, true, r );
+            if( texture != NULL ) {
+                SDL_SetTextureColorMod( texture, color.r, color.g, color.b );
+                SDL_Rect renderQuad = { runX - run.width, y, run.width, run.height };
+                SDL_RenderCopy( gRenderer, texture, NULL, &renderQuad );
+            }
+        }
+
+        // Cursor
+        if( i == cursorLine ) {
+            SDL_Rect caret = { gapX, y, 2, lineHeight };
+            SDL_SetRenderDrawColor( gRenderer, color.r, color.g, color.b, 0xFF );
+            SDL_RenderFillRect( gRenderer, &caret );
+        }
+    }
+}
+
 bool init() {
     // Bandera
     bool success = true;
@@ -310,7 +1039,7 @@ bool loadMedia() {
 void close() {
     // Libera la textura cargada
     gPromptTextTexture.free();
-    gInputTextTexture.free();
+    gInputText.free();
 
     // Libera la fuente global
     TTF_CloseFont( gFont );
@@ -328,7 +1057,94 @@ void close() {
     SDL_Quit();
 }
 
+void benchmarkEditor( int length, int lineLength, int keystrokes )
+{
+    LTextEditor editor;
+    SDL_Color textColor = { 0x00, 0x00, 0x00, 0xFF };
+    SDL_Rect area = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+
+    // Pega de una vez un texto del tamaño pedido
+    std::string paste( length, ' ' );
+    for( int i = 0; i < length; ++i )
+    {
+        paste[ i ] = ( i + 1 ) % lineLength == 0 ? '\n' : 'a' + i % 26;
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    editor.insert( paste.c_str() );
+    editor.render( area, textColor );
+    Uint64 pasteTicks = SDL_GetPerformanceCounter() - start;
+
+    // Las pulsaciones se hacen a mitad del texto
+    editor.setCursor( editor.getLineCount() / 2, lineLength / 2 );
+    editor.render( area, textColor );
+
+    // Cada pulsación escribe o borra un caracter, o parte y vuelve a unir
+    // la línea, y vuelve a dibujar
+    Uint64 rasterized = editor.getRasterizedRuns();
+    Uint64 total = 0;
+    Uint64 worst = 0;
+    for( int k = 0; k < keystrokes; ++k )
+    {
+        start = SDL_GetPerformanceCounter();
+        if( k % 64 == 62 )
+        {
+            editor.insert( "\n" );
+        }
+        else if( k % 4 == 3 )
+        {
+            editor.backspace();
+        }
+        else
+        {
+            editor.insert( k % 2 == 0 ? "x" : "ñ" );
+        }
+        editor.render( area, textColor );
+        Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+        total += ticks;
+        if( ticks > worst )
+        {
+            worst = ticks;
+        }
+    }
+
+    double us = 1000000.0 / SDL_GetPerformanceFrequency();
+    printf( "%9d bytes, %5d lineas: pegar %.0f us, pulsacion media %.1f us, peor %.1f us, %.2f tramos por pulsacion\n",
+            length, editor.getLineCount(), pasteTicks * us, total * us / keystrokes, worst * us,
+            (double)( editor.getRasterizedRuns() - rasterized ) / keystrokes );
+}
+
 int main( int argc, char* argv[] ) {
+    // Modo de medición sin ventana, con un renderizador por software
+    if( argc > 1 && strcmp( argv[ 1 ], "--bench" ) == 0 ) {
+        SDL_Init( 0 );
+        TTF_Init();
+        gFont = TTF_OpenFont( "romfs/lazy.ttf", 28 );
+        SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+                SDL_PIXELFORMAT_ARGB8888 );
+        gRenderer = target != NULL ? SDL_CreateSoftwareRenderer( target ) : NULL;
+        if( gFont == NULL || gRenderer == NULL ) {
+            printf( "Falló la inicialización! SDL Error: %s\n", SDL_GetError() );
+            return -1;
+        }
+
+        // Texto en líneas de 64 bytes y texto en una sola línea
+        int sizes[] = { 1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024 };
+        for( int i = 0; i < 4; ++i ) {
+            benchmarkEditor( sizes[ i ], 64, 2000 );
+        }
+        for( int i = 0; i < 4; ++i ) {
+            benchmarkEditor( sizes[ i ], sizes[ i ] + 1, 2000 );
+        }
+
+        SDL_DestroyRenderer( gRenderer );
+        SDL_FreeSurface( target );
+        TTF_CloseFont( gFont );
+        TTF_Quit();
+        SDL_Quit();
+        return 0;
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -346,15 +1162,12 @@ int main( int argc, char* argv[] ) {
 
     SDL_Color textColor = { 0x00, 0x00, 0x00, 0xFF };
 
-    std::string inputText = "Texto de Prueba";
-
-    gInputTextTexture.loadFromRenderedText( inputText.c_str(), textColor );
+    gInputText.setText( "Texto de Prueba" );
 
     // Activa la entrada de texto
     SDL_StartTextInput();
 
     while( !quit ) {
-        bool renderText = false;
         while( SDL_PollEvent( &e ) != 0 ) {
             switch( e.type ) {
                 case SDL_QUIT:
@@ -370,24 +1183,65 @@ int main( int argc, char* argv[] ) {
                               break;
                       }
 
-                      if( e.key.keysym.sym == SDLK_BACKSPACE && inputText.length() > 0 )
+                      if( e.key.keysym.sym == SDLK_BACKSPACE )
                       {
-                          // borra el caracter
-                          inputText.pop_back();        
-                          renderText = true;
+                          // borra el caracter antes del cursor
+                          gInputText.backspace();
                       }
 
-                      // Maneja la copia de texto (?)
-                      else if ( SDLK_c && SDL_GetModState() & KMOD_CTRL )
+                      // borra el caracter después del cursor
+                      else if( e.key.keysym.sym == SDLK_DELETE )
                       {
-                          SDL_SetClipboardText( inputText.c_str() );
+                          gInputText.deleteForward();
                       }
 
-                      // Maneja el pegado de texto (?)
-                      else if ( SDLK_v && SDL_GetModState() & KMOD_CTRL )
+                      // Mueve el cursor
+                      else if( e.key.keysym.sym == SDLK_LEFT )
+                      {
+                          gInputText.moveLeft();
+                      }
+                      else if( e.key.keysym.sym == SDLK_RIGHT )
+                      {
+                          gInputText.moveRight();
+                      }
+                      else if( e.key.keysym.sym == SDLK_UP )
                       {
-                          inputText = SDL_GetClipboardText();
-                          renderText = true;
+                          gInputText.moveUp();
+                      }
+                      else if( e.key.keysym.sym == SDLK_DOWN )
+                      {
+                          gInputText.moveDown();
+                      }
+                      else if( e.key.keysym.sym == SDLK_HOME )
+                      {
+                          gInputText.moveHome();
+                      }
+                      else if( e.key.keysym.sym == SDLK_END )
+                      {
+                          gInputText.moveEnd();
+                      }
+
+                      // Salto de línea
+                      else if( e.key.keysym.sym == SDLK_RETURN )
+                      {
+                          gInputText.insert( "\n" );
+                      }
+
+                      // Maneja la copia de texto
+                      else if ( e.key.keysym.sym == SDLK_c && SDL_GetModState() & KMOD_CTRL )
+                      {
+                          SDL_SetClipboardText( gInputText.getText().c_str() );
+                      }
+
+                      // Maneja el pegado de texto, se inserta en el cursor
+                      else if ( e.key.keysym.sym == SDLK_v && SDL_GetModState() & KMOD_CTRL )
+                      {
+                          char* clipboard = SDL_GetClipboardText();
+                          if( clipboard != NULL )
+                          {
+                              gInputText.insert( clipboard );
+                              SDL_free( clipboard );
+                          }
                       }
             }
 
@@ -399,36 +1253,22 @@ int main( int argc, char* argv[] ) {
                     && ( e.text.text[ 0 ] == 'c' || e.text.text[ 0 ] == 'C' 
                     || e.text.text[ 0 ] == 'v' || e.text.text[ 0 ] == 'V' ) ) )                 
                 {
-                    // Agrega caracteres
-                    inputText += e.text.text;
-                    renderText = true;
+                    // Agrega caracteres en el cursor
+                    gInputText.insert( e.text.text );
                 }
             }
         }
 
-        // Renderiza el texto necesario
-        if( renderText )
-        {
-            // El texto no es vacio
-            if( inputText != "" )
-            {
-                // Renderiza el nuevo texto
-                gInputTextTexture.loadFromRenderedText( inputText.c_str(), textColor );
-            }
-            // El texto es vacio
-            else 
-            {
-                gInputTextTexture.loadFromRenderedText( " ", textColor );
-            }
-        }
-
         // Limpia la pantalla
         SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
         SDL_RenderClear( gRenderer );
 
         // Rendereiza las texturas del texto
         gPromptTextTexture.render( ( SCREEN_WIDTH - gPromptTextTexture.getWidth() ) / 2, 0 );
-        gInputTextTexture.render( ( SCREEN_WIDTH - gInputTextTexture.getWidth() ) / 2, gPromptTextTexture.getHeight() );
+        // Sólo se rasterizan los tramos que han cambiado
+        SDL_Rect inputArea = { 0, gPromptTextTexture.getHeight(), SCREEN_WIDTH,
+            SCREEN_HEIGHT - gPromptTextTexture.getHeight() };
+        gInputText.render( inputArea, textColor );
  
         // Actualiza la pantalla
         SDL_RenderPresent( gRenderer );
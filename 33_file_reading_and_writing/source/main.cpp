@@ -1,6 +1,18 @@
 #include <stdio.h>
 #include <string>
-#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+#include <new>
+#include <atomic>
+#include <charconv>
+#include <vector>
+#include <algorithm>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
@@ -9,9 +21,19 @@
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
-// Numero de datos enteros
+// Numero de datos enteros de un archivo nuevo
 const int TOTAL_DATA = 10;
 
+// Archivo donde se guardan los datos
+const char* SAVE_FILE = "romfs/nums.bin";
+
+// Tiempo máximo que se espera al guardado al salir
+const Uint32 SHUTDOWN_FLUSH_MS = 2000;
+
+// Textos de fila que se reciclan al desplazar la lista; deben cubrir las
+// filas visibles
+const int ROW_POOL = 32;
+
 // Texture weapper class
 class LTexture {
     public:
@@ -23,11 +45,6 @@ class LTexture {
 
         // Carga la imagen en el path especificado
         bool loadFromFile( std::string path );
- 
-        #if defined(SDL_TTF_MAJOR_VERSION)
-        // Crea una imagen desde un font string
-        bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
-        #endif
 
         // Establece la modulación de color
         void setColor( Uint8 red, Uint8 green, Uint8 blue );
@@ -64,6 +81,359 @@ class LTexture {
         int mHeight;
 };
 
+// Atlas de glifos: cada glifo se rasteriza una sola vez y el texto se dibuja
+// como quads de una única textura, sin crear texturas al cambiar el texto
+class LGlyphAtlas {
+    public:
+        // Dimensiones de la textura del atlas
+        static const int ATLAS_SIZE = 512;
+
+        // Inicializa las variables
+        LGlyphAtlas();
+
+        // Libera la memoria
+        ~LGlyphAtlas();
+
+        // Crea el atlas vacío para la fuente dada
+        bool loadFromFont( TTF_Font* font );
+
+        // Libera el atlas
+        void free();
+
+        // Renderiza el texto en un punto dado
+        void render( int x, int y, const char* text, SDL_Color color );
+
+        // Obtiene las dimensiones del texto sin renderizarlo
+        int getTextWidth( const char* text );
+        int getTextHeight();
+
+        // Estadísticas de la caché
+        double getHitRate();
+        double getOccupancy();
+
+    private:
+        struct Glyph {
+            SDL_Rect clip;
+            int advance;
+            bool loaded;
+        };
+
+        // Obtiene el glifo, rasterizándolo la primera vez
+        Glyph& getGlyph( Uint8 ch );
+
+        // La textura del atlas
+        SDL_Texture* mTexture;
+        TTF_Font* mFont;
+
+        // Un glifo por cada byte Latin-1
+        Glyph mGlyphs[ 256 ];
+
+        // Empaquetado por estantes
+        int mShelfX;
+        int mShelfY;
+        int mShelfHeight;
+        int mUsedPixels;
+
+        // Aciertos y fallos de la caché
+        Uint64 mHits;
+        Uint64 mMisses;
+
+        // Buffer para expandir un glifo a ARGB antes de subirlo
+        Uint32* mPixels;
+};
+
+// Texto de HUD con un prefijo fijo y un valor numérico. El valor se formatea
+// en un buffer propio con std::to_chars y el texto sólo se vuelve a maquetar
+// cuando lo mostrado cambia
+class LHudText {
+    public:
+        // Longitud máxima del texto, incluido el prefijo
+        static const int MAX_LENGTH = 128;
+
+        // Inicializa las variables
+        LHudText();
+
+        // Establece el texto fijo que precede al valor
+        void setPrefix( const char* prefix );
+
+        // Establece el valor a mostrar
+        void setInt( long value );
+        void setFloat( float value );
+
+        // Renderiza el texto con el atlas global
+        void render( int x, int y, SDL_Color color );
+
+        // Obtiene el texto y su ancho
+        const char* getText();
+        int getWidth();
+
+        // Veces que el texto ha tenido que maquetarse de nuevo
+        Uint64 getRelayouts();
+
+    private:
+        // Copia el valor formateado si es distinto del actual
+        void update( const char* value, int length );
+
+        // Texto mostrado y longitud del prefijo
+        char mText[ MAX_LENGTH ];
+        int mPrefixLength;
+        int mLength;
+
+        // Ancho en píxeles, -1 si hay que recalcularlo
+        int mWidth;
+        Uint64 mRelayouts;
+};
+
+// Guarda los datos de forma atómica: cada instantánea se escribe completa en
+// un archivo temporal, se sincroniza con el disco y se renombra sobre la
+// anterior, así un corte a mitad de guardado nunca deja el archivo roto. Con
+// el diario activado los cambios sueltos se añaden a un archivo aparte en vez
+// de reescribir todo. Los enteros van en el orden de bytes de la máquina, como
+// en el formato original
+class LSaveFile {
+    public:
+        // Versión del formato y máximo de registros marcados entre guardados;
+        // con más se escribe una instantánea
+        static const Uint32 VERSION = 1;
+        static const int MAX_DIRTY = 64 * 1024;
+
+        // Inicializa las variables
+        LSaveFile();
+
+        // Lee la instantánea de path, o el formato antiguo sin cabecera, y
+        // aplica el diario. Falso si no existe o está dañada
+        bool load( std::string path, std::vector<Sint32>& records );
+
+        // Sólo comprueba la cabecera, sin leer los registros; da su número y
+        // dónde empiezan. El CRC de los registros lo comprueba load()
+        bool loadHeader( std::string path, Uint64& count, Uint64& offset );
+
+        // Aplica a records las entradas válidas del diario y recorta una
+        // cola rota
+        void replayJournal( Sint32* records );
+
+        // Activa el diario de cambios; sin él cada guardado es una instantánea
+        void setJournal( bool enabled );
+
+        // Anota que cambió un registro para el próximo guardado
+        void markDirty( Uint64 index );
+
+        // Guarda los cambios: al diario si son pocos, si no una instantánea
+        bool save( const Sint32* records, Uint64 count );
+
+        // Escribe una instantánea completa y descarta el diario. Sin records
+        // la instantánea es de ceros y el archivo se extiende sin escribirlos
+        bool saveSnapshot( const Sint32* records, Uint64 count );
+
+        // Añade los registros marcados al diario con una escritura y un fsync
+        bool appendJournal( const Sint32* records );
+
+        // Entradas en el diario desde la última instantánea
+        Uint64 getJournalEntries();
+
+        // Cambia con cada instantánea escrita
+        Uint64 getGeneration();
+
+        // Bytes escritos en disco por este objeto
+        Uint64 getBytesWritten();
+
+        // CRC-32 de zlib, continuando desde crc
+        static Uint32 crc32( const void* data, size_t length, Uint32 crc = 0 );
+
+    private:
+        // Cabecera de la instantánea; el CRC de la cabecera cubre los campos
+        // anteriores
+        struct Header {
+            char magic[ 4 ];
+            Uint32 version;
+            Uint64 generation;
+            Uint64 count;
+            Uint32 payloadCrc;
+            Uint32 headerCrc;
+        };
+
+        // El diario sólo vale para la instantánea de su misma generación
+        struct JournalHeader {
+            char magic[ 4 ];
+            Uint32 version;
+            Uint64 generation;
+            Uint32 headerCrc;
+            Uint32 reserved;
+        };
+
+        struct JournalEntry {
+            Uint64 index;
+            Sint32 value;
+            Uint32 crc;
+        };
+
+        // Sincroniza el directorio para que el renombrado sobreviva a un corte
+        void syncDirectory();
+
+        // Reserva la lista de marcados para lo que admite el diario, así
+        // marcar no reserva memoria
+        void resetDirty();
+
+        // Ordena los marcados y quita los repetidos
+        void compactDirty();
+
+        std::string mPath;
+        std::string mJournalPath;
+        bool mJournal;
+
+        // Instantánea en disco: generación, registros, CRC de los registros y
+        // si ya tiene cabecera
+        Uint64 mGeneration;
+        Uint64 mRecordCount;
+        Uint32 mPayloadCrc;
+        bool mHasSnapshot;
+
+        // Entradas ya escritas en el diario e índices marcados; si no caben
+        // el próximo guardado es una instantánea
+        Uint64 mJournalEntries;
+        std::vector<Uint64> mDirtyIndices;
+        bool mDirtyOverflow;
+
+        Uint64 mBytesWritten;
+};
+
+// Registros de un archivo de guardado mapeados en memoria en vez de leídos:
+// abrir no depende del tamaño y sólo se cargan las páginas que se miran. El
+// mapeo es privado, así que editar un registro cambia en el sitio la copia en
+// memoria de su página y guardar lleva los cambios al diario de LSaveFile; el
+// archivo sólo cambia con instantáneas completas
+class LRecordStore {
+    public:
+        // Inicializa las variables
+        LRecordStore();
+
+        // Libera el mapeo
+        ~LRecordStore();
+
+        // Mapea path y aplica el diario; si no existe lo crea con count
+        // registros a cero. Un archivo dañado no se toca
+        bool open( std::string path, Uint64 count );
+
+        // Libera el mapeo sin guardar
+        void close();
+
+        // Registros del archivo
+        Uint64 getCount();
+
+        // Lee y edita un registro
+        Sint32 get( Uint64 index );
+        void set( Uint64 index, Sint32 value );
+
+        // Guarda los cambios; tras una instantánea mapea el archivo nuevo
+        bool save();
+
+        // Bytes escritos al guardar
+        Uint64 getBytesWritten();
+
+    private:
+        // Mapea el archivo actual y libera el mapeo
+        bool map();
+        void unmap();
+
+        LSaveFile mSave;
+        std::string mPath;
+
+        // Mapeo entero del archivo y registros tras la cabecera
+        Uint8* mMapping;
+        size_t mMappingSize;
+        Sint32* mRecords;
+        Uint64 mCount;
+};
+
+// Guarda en segundo plano: el hilo principal edita su propia copia de los
+// registros y pasa los cambios en lotes ya reservados; un hilo de guardado los
+// aplica a otro mapeo del archivo y los escribe juntos, así varias ediciones
+// del mismo registro acaban en una sola entrada del diario. El bucle principal
+// sólo toma el cerrojo para entregar un lote, nunca durante una escritura
+class LSaveQueue {
+    public:
+        // Espera para juntar lotes antes de escribir, lotes reservados y
+        // cambios que caben en cada uno sin reservar memoria
+        static const int COALESCE_MS = 100;
+        static const int MAX_BATCHES = 8;
+        static const int BATCH_CHANGES = 4096;
+
+        // Inicializa las variables
+        LSaveQueue();
+
+        // Termina el hilo sin límite de tiempo
+        ~LSaveQueue();
+
+        // Mapea path, que ya debe existir, y arranca el hilo de guardado
+        bool start( std::string path );
+
+        // Anota el nuevo valor de un registro en el lote actual
+        void post( Uint64 index, Sint32 value );
+
+        // Entrega el lote actual al hilo; si no queda lote libre sigue
+        // llenando el actual
+        void submit();
+
+        // Entrega lo pendiente y espera a que se escriba como mucho timeoutMs.
+        // Si no termina a tiempo el hilo sigue por su cuenta y devuelve falso:
+        // el archivo queda en el último guardado completo
+        bool stop( Uint32 timeoutMs );
+
+        // Lotes esperando al hilo, bytes escritos, guardados hechos y su
+        // latencia en milisegundos; tras parar quedan los últimos valores
+        int getQueueDepth();
+        Uint64 getBytesWritten();
+        int getFlushes();
+        double getLastFlushMs();
+        double getMaxFlushMs();
+
+    private:
+        // Un registro cambiado
+        struct Change {
+            Uint64 index;
+            Sint32 value;
+        };
+
+        // Estado que comparte con el hilo; si el hilo se suelta al parar lo
+        // libera él al terminar
+        struct Shared {
+            SDL_mutex* mutex;
+            SDL_cond* wake;
+            SDL_cond* finishedCondition;
+
+            // Lotes libres y lotes en cola, protegidos por el cerrojo
+            std::vector< std::vector<Change> > free;
+            std::vector< std::vector<Change> > queue;
+            bool stopping;
+            bool finished;
+            bool detached;
+
+            // Copia del hilo, mapeada aparte
+            LRecordStore image;
+
+            std::atomic<int> depth;
+            std::atomic<Uint64> bytesWritten;
+            std::atomic<int> flushes;
+            std::atomic<Uint32> lastFlushUs;
+            std::atomic<Uint32> maxFlushUs;
+        };
+
+        // Hilo de guardado
+        static int saveThread( void* data );
+
+        Shared* mShared;
+        SDL_Thread* mThread;
+
+        // Lote que llena el hilo principal
+        std::vector<Change> mBatch;
+
+        // Métricas al parar
+        Uint64 mBytesWritten;
+        int mFlushes;
+        Uint32 mLastFlushUs;
+        Uint32 mMaxFlushUs;
+};
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -73,6 +443,40 @@ bool loadMedia();
 // Libera la memoria y termina SDL
 void close();
 
+// Ruta de un archivo temporal para las mediciones, fuera de romfs/
+std::string getTempPath( const char* name );
+
+// Comprueba el formato de guardado y mide cuánto tarda guardar
+int benchmarkSave();
+
+// Mide abrir y recorrer un archivo de 100M registros mapeado
+int benchmarkRecords();
+
+// Compara guardar en el bucle principal con el guardado en segundo plano
+int benchmarkAsyncSave();
+
+// Contador de reservas en el heap, para comprobar que el HUD no reserva
+// memoria en cada fotograma. Uno por hilo: las del hilo de guardado no
+// cuentan para el bucle principal
+thread_local Uint64 gHeapAllocations = 0;
+
+void* operator new( size_t size ) {
+    ++gHeapAllocations;
+    void* p = malloc( size > 0 ? size : 1 );
+    if( p == NULL ) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete( void* p ) noexcept {
+    free( p );
+}
+
+void operator delete( void* p, size_t size ) noexcept {
+    free( p );
+}
+
 // Ventana donde se renderizará
 SDL_Window* gWindow = NULL;
 
@@ -82,12 +486,20 @@ SDL_Renderer* gRenderer = NULL;
 // Fuente de texto global
 TTF_Font *gFont = NULL;
 
-// Textura
-LTexture gPromptTextTexture;
-LTexture gDataTextures[ TOTAL_DATA ];
+// Atlas de glifos de la fuente global
+LGlyphAtlas gTextAtlas;
+
+// Texto de la instrucción
+const char* gPromptText = "Enter Data: ";
+
+// Data Points, mapeados desde el archivo
+LRecordStore gRecords;
+
+// Archivo abierto; se puede pasar otro como argumento
+const char* gRecordsPath = SAVE_FILE;
 
-// Data Points
-Sint32 gData[ TOTAL_DATA ];
+// Guarda los cambios en segundo plano
+LSaveQueue gSaveQueue;
 
 LTexture::LTexture() {
     // Inicializa la textura
@@ -142,37 +554,6 @@ bool LTexture::loadFromFile( std::string path ) {
     return mTexture != NULL;
 }
 
-#if defined(SDL_TTF_MAJOR_VERSION)
-bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColor ) {
-    // Manejar la textura existente
-    free();
-
-    // Renderiza desde la superficie del texto
-    SDL_Surface* textSurface = TTF_RenderText_Solid( gFont, textureText.c_str(), textColor );
-    if( textSurface == NULL ) {
-        printf( "No se pudo renderizar la superficie del texto! SDL_ttf Error: %s\n", 
-                TTF_GetError() );
-    } else {
-        // Crea una textura desde la superficie de pixeles
-        mTexture = SDL_CreateTextureFromSurface( gRenderer, textSurface );
-        if( mTexture == NULL ) {
-            printf( "No se pudo crear la textura desde el texto renderizado! SDL Error: %s\n",
-                    SDL_GetError() );
-        } else {
-            // Obtiene las dimensiones de la imagen
-            mWidth = textSurface->w;
-            mHeight = textSurface->h;
-        }
-
-        // Manejar la anterior superficie
-        SDL_FreeSurface( textSurface );
-    }
-
-    // Devuelve la textura
-    return mTexture != NULL;
-}
-#endif
-
 void LTexture::setColor( Uint8 red, Uint8 green, Uint8 blue ) {
     // Textura modulada
     SDL_SetTextureColorMod( mTexture, red, green, blue );
@@ -228,191 +609,1552 @@ void LTexture::setHeight( int h ) {
     mHeight = h;
 }
 
-bool init() {
-    // Bandera
-    bool success = true;
-
-    // Inicia SDL
-    if( SDL_Init( SDL_INIT_VIDEO ) < 0 ) 
-    {
-        printf( "SDL no pudo inicializarse! SDL Error: %s\n", SDL_GetError() );
-        success = false; 
-    } 
-    else 
-    {
-        // Filtrado
-        if( !SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY , "1") ) 
-        {
-            printf( "Warning: Filtrado lineal de texturas no disponible!" );
-        }
+LGlyphAtlas::LGlyphAtlas() {
+    // Inicializa las variables
+    mTexture = NULL;
+    mFont = NULL;
+    mPixels = NULL;
+    free();
+}
 
-        // Crea la ventana
-        gWindow = SDL_CreateWindow( "SDL Tutorial 33 - Lectura y escritura de archivos", 
-                SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-        if( gWindow == NULL ) 
-        {
-            printf( "No se pudo iniciar la ventana! SDL Error: %s\n", SDL_GetError() );
-            success = false;
-        } 
-        else 
-        {
-            // Crea el renderizador
-            gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED 
-                    | SDL_RENDERER_PRESENTVSYNC );
-            if( gRenderer == NULL ) 
-            {
-                printf( "No se pudo crear el renderizador! SDL Error: %s\n", SDL_GetError() );
-                success = false;
-            } 
-            else 
-            {
-                // Inica el renderizador de color
-                SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+LGlyphAtlas::~LGlyphAtlas() {
+    // Libera la memoria
+    free();
+}
 
-                // Inicializa la carga de PNG
-                int imgFlags = IMG_INIT_PNG;
-                if( !( IMG_Init( imgFlags ) & imgFlags ) ) 
-                {
-                    printf( "SDL_Image no pudo inicializarse! SDL_image Error: %s\n", 
-                            IMG_GetError() );
-                    success = false;
-                }
+bool LGlyphAtlas::loadFromFont( TTF_Font* font ) {
+    // Maneja el atlas preexistente
+    free();
 
-            }
-            if( TTF_Init() == -1 )
-            {
-                printf( "SDL_ttf no pudo inicializarse! SDL_ttf Error: %s\n", TTF_GetError() );
-                success = false;
-            }
-        }
+    // Textura ARGB en blanco; el color se aplica con la modulación
+    mTexture = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+            ATLAS_SIZE, ATLAS_SIZE );
+    if( mTexture == NULL ) {
+        printf( "No se pudo crear la textura del atlas! SDL Error: %s\n", SDL_GetError() );
+        return false;
     }
+    SDL_SetTextureBlendMode( mTexture, SDL_BLENDMODE_BLEND );
 
-    return success;
+    // Limpia el atlas a transparente
+    mPixels = new Uint32[ ATLAS_SIZE * ATLAS_SIZE ];
+    memset( mPixels, 0, ATLAS_SIZE * ATLAS_SIZE * sizeof( Uint32 ) );
+    SDL_UpdateTexture( mTexture, NULL, mPixels, ATLAS_SIZE * sizeof( Uint32 ) );
+
+    mFont = font;
+    return true;
 }
 
-bool loadMedia() 
-{
-    // Color del texto
-    SDL_Color textColor = { 0x00, 0x00, 0x00, 0xFF };
-    SDL_Color highlightColor = { 0xFF, 0x00, 0x00, 0xFF };
+void LGlyphAtlas::free() {
+    // Libera la textura si existe
+    if( mTexture != NULL ) {
+        SDL_DestroyTexture( mTexture );
+        mTexture = NULL;
+    }
+    delete[] mPixels;
+    mPixels = NULL;
+    mFont = NULL;
 
-    // Carga la fuente
-    gFont = TTF_OpenFont( "romfs/lazy.ttf", 28 );
-    if( gFont == NULL )
-    {
-        printf( "Falló la carga de la fuente! SDL_ttf Error: %s\n", TTF_GetError() );
-        return false;
+    // Vacía la caché
+    for( int i = 0; i < 256; ++i ) {
+        mGlyphs[ i ].loaded = false;
     }
-    else 
-    {
-        // Renderiza el texto
-        if( !gPromptTextTexture.loadFromRenderedText( "Enter Data: ", textColor ) )
-        {
-            printf( "Falló al renderizar el texto de entrada!\n" );
-            return false;
-        }
+    mShelfX = 0;
+    mShelfY = 0;
+    mShelfHeight = 0;
+    mUsedPixels = 0;
+    mHits = 0;
+    mMisses = 0;
+}
+
+LGlyphAtlas::Glyph& LGlyphAtlas::getGlyph( Uint8 ch ) {
+    Glyph& glyph = mGlyphs[ ch ];
+    if( glyph.loaded ) {
+        ++mHits;
+        return glyph;
     }
+    ++mMisses;
 
-    // Abre el archivo para la lectura en binario
-    SDL_RWops* file = SDL_RWFromFile( "romfs/nums.bin", "r+b" );
+    // Un glifo sin espacio o sin imagen se queda con el clip vacío
+    glyph.loaded = true;
+    glyph.clip = { 0, 0, 0, 0 };
+    glyph.advance = 0;
 
-    // Comprueba si existe el archivo
-    if( file == NULL )
-    {
-        printf( "Warning: No se pudo abrir el archivo! SDL Error: %s\n", SDL_GetError() );
+    int minX, maxX, minY, maxY;
+    if( TTF_GlyphMetrics( mFont, ch, &minX, &maxX, &minY, &maxY, &glyph.advance ) != 0 ) {
+        return glyph;
+    }
 
-        // Crea el archivo para la escritura
-        file = SDL_RWFromFile( "romfs/nums.bin", "w+b" );
-        if( file != NULL )
-        {
-            printf( "Nuevo archivo creado!\n" );
+    // Los glifos sin tinta (p. ej. el espacio) sólo tienen avance
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface* glyphSurface = TTF_RenderGlyph_Solid( mFont, ch, white );
+    if( glyphSurface == NULL ) {
+        return glyph;
+    }
 
-            // Inicializa los datos
-            for( int i = 0; i < TOTAL_DATA; ++i )
-            {
-                gData[ i ] = 0;
-                SDL_RWwrite( file, &gData[ i ], sizeof(Sint32), 1 );
-            }
+    // Busca un hueco en el estante actual o abre uno nuevo
+    int w = glyphSurface->w;
+    int h = glyphSurface->h;
+    if( mShelfX + w + 1 > ATLAS_SIZE ) {
+        mShelfX = 0;
+        mShelfY += mShelfHeight + 1;
+        mShelfHeight = 0;
+    }
+    if( w + 1 > ATLAS_SIZE || mShelfY + h + 1 > ATLAS_SIZE ) {
+        printf( "Warning: el atlas de glifos está lleno, no cabe '%c'!\n", ch );
+        SDL_FreeSurface( glyphSurface );
+        return glyph;
+    }
 
-            // Cierra el archivo
-            SDL_RWclose( file );
-        }
-        else
-        {
-            printf( "Error: no se pudo crear el archivo! SDL Error: %s\n", SDL_GetError() );
-            return false;
+    // Expande los píxeles indexados a blanco opaco o transparente
+    Uint8* src = (Uint8*)glyphSurface->pixels;
+    for( int y = 0; y < h; ++y ) {
+        for( int x = 0; x < w; ++x ) {
+            mPixels[ y * w + x ] = src[ y * glyphSurface->pitch + x ] != 0 ? 0xFFFFFFFF : 0;
         }
     }
 
-    // Si el archivo existe
-    else
-    {
-        // Carga los datos
-        printf( "Leyendo archivo...!\n" );
-        for( int i = 0; i < TOTAL_DATA; ++i )
-        {
-            SDL_RWread( file, &gData[ i ], sizeof(Sint32), 1 );
-        }
+    glyph.clip = { mShelfX, mShelfY, w, h };
+    SDL_UpdateTexture( mTexture, &glyph.clip, mPixels, w * sizeof( Uint32 ) );
 
-        // Cierra el archivo
-        SDL_RWclose( file );
+    mShelfX += w + 1;
+    if( h > mShelfHeight ) {
+        mShelfHeight = h;
     }
+    mUsedPixels += w * h;
 
-    // inicializa los datos de textura
-    gDataTextures[ 0 ].loadFromRenderedText( std::to_string( gData[ 0 ] ), highlightColor );
-    for( int i = 0; i < TOTAL_DATA; ++i )
-    {
-        gDataTextures[ i ].loadFromRenderedText( std::to_string( gData[ i ] ), textColor );
+    SDL_FreeSurface( glyphSurface );
+    return glyph;
+}
+
+void LGlyphAtlas::render( int x, int y, const char* text, SDL_Color color ) {
+    if( mTexture == NULL ) {
+        return;
     }
 
+    // Todos los glifos comparten textura, así que el renderizador los agrupa
+    SDL_SetTextureColorMod( mTexture, color.r, color.g, color.b );
+    for( const char* c = text; *c != '\0'; ++c ) {
+        Glyph& glyph = getGlyph( (Uint8)*c );
+        if( glyph.clip.w > 0 ) {
+            SDL_Rect renderQuad = { x, y, glyph.clip.w, glyph.clip.h };
+            SDL_RenderCopy( gRenderer, mTexture, &glyph.clip, &renderQuad );
+        }
+        x += glyph.advance;
+    }
+}
 
-    return true;
+int LGlyphAtlas::getTextWidth( const char* text ) {
+    int width = 0;
+    for( const char* c = text; *c != '\0'; ++c ) {
+        width += getGlyph( (Uint8)*c ).advance;
+    }
+    return width;
 }
 
-void close() {
-    // Abre el archivo para escritura
-    SDL_RWops* file = SDL_RWFromFile( "romfs/nums.bin", "w+b" );
-    if( file != NULL )
-    {
-        // Guarda los datos
-        for( int i = 0; i < TOTAL_DATA; i++ )
-        {
-            SDL_RWwrite( file, &gData[ i ], sizeof(Sint32), 1 );
-        }
+int LGlyphAtlas::getTextHeight() {
+    return mFont != NULL ? TTF_FontHeight( mFont ) : 0;
+}
 
-        // Cierra el archivo
-        SDL_RWclose( file );
-    }
-    else 
-    {
-        printf( "Error: No se pudo guardar el archivo! SDL Error: %s\n", SDL_GetError() );
-    }
+double LGlyphAtlas::getHitRate() {
+    Uint64 total = mHits + mMisses;
+    return total > 0 ? (double)mHits / total : 0.0;
+}
 
-    // Libera la textura cargada
-    gPromptTextTexture.free();
-    for( int i = 0; i < TOTAL_DATA; ++i )
-    {
-        gDataTextures[ i ].free();
+double LGlyphAtlas::getOccupancy() {
+    return (double)mUsedPixels / ( ATLAS_SIZE * ATLAS_SIZE );
+}
+
+LHudText::LHudText() {
+    // Inicializa las variables
+    mText[ 0 ] = '\0';
+    mPrefixLength = 0;
+    mLength = 0;
+    mWidth = -1;
+    mRelayouts = 0;
+}
+
+void LHudText::setPrefix( const char* prefix ) {
+    // Copia el prefijo, dejando sitio para el valor
+    int length = strlen( prefix );
+    if( length > MAX_LENGTH / 2 ) {
+        length = MAX_LENGTH / 2;
     }
+    memcpy( mText, prefix, length );
+    mText[ length ] = '\0';
+    mPrefixLength = length;
+    mLength = length;
+    mWidth = -1;
+}
 
-    // Libera la fuente global
-    TTF_CloseFont( gFont );
-    gFont = NULL;
+void LHudText::setInt( long value ) {
+    char buffer[ 32 ];
+    std::to_chars_result result = std::to_chars( buffer, buffer + sizeof( buffer ), value );
+    update( buffer, result.ptr - buffer );
+}
 
-    // Destruye la ventana
-    SDL_DestroyRenderer( gRenderer );
-    SDL_DestroyWindow( gWindow );
-    gWindow = NULL;
-    gRenderer = NULL;
+void LHudText::setFloat( float value ) {
+    // Mismo formato que un stream por defecto: 6 cifras significativas
+    char buffer[ 32 ];
+    std::to_chars_result result = std::to_chars( buffer, buffer + sizeof( buffer ), value,
+            std::chars_format::general, 6 );
+    update( buffer, result.ptr - buffer );
+}
 
-    // Termina SDL
-    IMG_Quit();
-    TTF_Quit();
-    SDL_Quit();
+void LHudText::update( const char* value, int length ) {
+    // Si el valor mostrado no cambia no hay nada que hacer
+    if( mLength - mPrefixLength == length && memcmp( mText + mPrefixLength, value, length ) == 0 ) {
+        return;
+    }
+
+    memcpy( mText + mPrefixLength, value, length );
+    mLength = mPrefixLength + length;
+    mText[ mLength ] = '\0';
+    mWidth = -1;
+}
+
+void LHudText::render( int x, int y, SDL_Color color ) {
+    gTextAtlas.render( x, y, mText, color );
+}
+
+const char* LHudText::getText() {
+    return mText;
+}
+
+int LHudText::getWidth() {
+    // Maqueta el texto sólo si ha cambiado
+    if( mWidth < 0 ) {
+        mWidth = gTextAtlas.getTextWidth( mText );
+        ++mRelayouts;
+    }
+    return mWidth;
+}
+
+Uint64 LHudText::getRelayouts() {
+    return mRelayouts;
+}
+
+LSaveFile::LSaveFile() {
+    // Inicializa las variables
+    mJournal = true;
+    mGeneration = 0;
+    mRecordCount = 0;
+    mPayloadCrc = 0;
+    mHasSnapshot = false;
+    mJournalEntries = 0;
+    mDirtyOverflow = false;
+    mBytesWritten = 0;
+}
+
+bool LSaveFile::load( std::string path, std::vector<Sint32>& records ) {
+    Uint64 count, offset;
+    if( !loadHeader( path, count, offset ) ) {
+        return false;
+    }
+
+    // Los datos se leen de una vez y se comprueban antes de usarlos
+    SDL_RWops* file = SDL_RWFromFile( path.c_str(), "rb" );
+    if( file == NULL ) {
+        return false;
+    }
+    records.resize( count );
+    SDL_RWseek( file, offset, RW_SEEK_SET );
+    bool complete = count == 0 || SDL_RWread( file, records.data(), sizeof( Sint32 ), count ) == count;
+    SDL_RWclose( file );
+    if( !complete || ( mHasSnapshot && crc32( records.data(), count * sizeof( Sint32 ) ) != mPayloadCrc ) ) {
+        printf( "Los datos de %s están dañados!\n", path.c_str() );
+        return false;
+    }
+
+    if( mJournal && mHasSnapshot ) {
+        replayJournal( records.data() );
+    }
+    return true;
+}
+
+bool LSaveFile::loadHeader( std::string path, Uint64& count, Uint64& offset ) {
+    mPath = path;
+    mJournalPath = path + ".journal";
+    mGeneration = 0;
+    mRecordCount = 0;
+    mPayloadCrc = 0;
+    mHasSnapshot = false;
+    mJournalEntries = 0;
+
+    SDL_RWops* file = SDL_RWFromFile( path.c_str(), "rb" );
+    if( file == NULL ) {
+        return false;
+    }
+    Sint64 size = SDL_RWsize( file );
+    Header header;
+    bool hasHeader = size >= (Sint64)sizeof( header ) && SDL_RWread( file, &header, sizeof( header ), 1 ) == 1
+        && memcmp( header.magic, "NUMS", 4 ) == 0;
+    SDL_RWclose( file );
+
+    // Formato antiguo: sólo los enteros, sin cabecera ni comprobación. El
+    // primer guardado lo pasa al formato nuevo
+    if( !hasHeader ) {
+        if( size < 0 || size % sizeof( Sint32 ) != 0 ) {
+            printf( "%s no es un archivo de datos válido!\n", path.c_str() );
+            return false;
+        }
+        count = size / sizeof( Sint32 );
+        offset = 0;
+        mRecordCount = count;
+        resetDirty();
+        return true;
+    }
+
+    if( header.headerCrc != crc32( &header, offsetof( Header, headerCrc ) ) || header.version != VERSION
+            || (Uint64)( size - sizeof( header ) ) != header.count * sizeof( Sint32 ) ) {
+        printf( "La cabecera de %s está dañada!\n", path.c_str() );
+        return false;
+    }
+
+    count = header.count;
+    offset = sizeof( header );
+    mGeneration = header.generation;
+    mRecordCount = header.count;
+    mPayloadCrc = header.payloadCrc;
+    mHasSnapshot = true;
+    resetDirty();
+    return true;
+}
+
+void LSaveFile::setJournal( bool enabled ) {
+    mJournal = enabled;
+}
+
+void LSaveFile::markDirty( Uint64 index ) {
+    // Repetir el último registro es lo normal al mantener una tecla
+    if( index >= mRecordCount || mDirtyOverflow || ( !mDirtyIndices.empty() && mDirtyIndices.back() == index ) ) {
+        return;
+    }
+    if( mDirtyIndices.size() == mDirtyIndices.capacity() ) {
+        compactDirty();
+        if( mDirtyIndices.size() == mDirtyIndices.capacity() ) {
+            mDirtyOverflow = true;
+            return;
+        }
+    }
+    mDirtyIndices.push_back( index );
+}
+
+bool LSaveFile::save( const Sint32* records, Uint64 count ) {
+    compactDirty();
+    if( mHasSnapshot && count == mRecordCount && !mDirtyOverflow && mDirtyIndices.empty() ) {
+        return true;
+    }
+
+    // El diario crece hasta la mitad de la instantánea; a partir de ahí es
+    // más barato reescribirla que seguir repitiendo el diario al cargar
+    Uint64 snapshotBytes = sizeof( Header ) + count * sizeof( Sint32 );
+    Uint64 journalBytes = ( mJournalEntries + mDirtyIndices.size() ) * sizeof( JournalEntry );
+    if( !mJournal || !mHasSnapshot || count != mRecordCount || mDirtyOverflow || journalBytes > snapshotBytes / 2 ) {
+        return saveSnapshot( records, count );
+    }
+    return appendJournal( records );
+}
+
+bool LSaveFile::saveSnapshot( const Sint32* records, Uint64 count ) {
+    Header header;
+    memcpy( header.magic, "NUMS", 4 );
+    header.version = VERSION;
+    header.generation = mGeneration + 1;
+    header.count = count;
+    if( records != NULL ) {
+        header.payloadCrc = crc32( records, count * sizeof( Sint32 ) );
+    } else {
+        static const Uint8 zeros[ 64 * 1024 ] = {};
+        header.payloadCrc = 0;
+        for( Uint64 left = count * sizeof( Sint32 ); left > 0; ) {
+            size_t length = left < sizeof( zeros ) ? left : sizeof( zeros );
+            header.payloadCrc = crc32( zeros, length, header.payloadCrc );
+            left -= length;
+        }
+    }
+    header.headerCrc = crc32( &header, offsetof( Header, headerCrc ) );
+
+    // Sin buffer de stdio: la cabecera y los datos van en una escritura cada uno
+    std::string temp = mPath + ".tmp";
+    FILE* file = fopen( temp.c_str(), "wb" );
+    if( file == NULL ) {
+        printf( "No se pudo crear %s: %s\n", temp.c_str(), strerror( errno ) );
+        return false;
+    }
+    setvbuf( file, NULL, _IONBF, 0 );
+    bool written = fwrite( &header, sizeof( header ), 1, file ) == 1;
+    if( records != NULL ) {
+        written = written && ( count == 0 || fwrite( records, sizeof( Sint32 ), count, file ) == count );
+    } else {
+        written = written && ftruncate( fileno( file ), sizeof( header ) + count * sizeof( Sint32 ) ) == 0;
+    }
+    written = written && fsync( fileno( file ) ) == 0;
+    written = fclose( file ) == 0 && written;
+
+    // El renombrado sustituye la instantánea anterior de golpe
+    if( !written || rename( temp.c_str(), mPath.c_str() ) != 0 ) {
+        printf( "No se pudo guardar %s: %s\n", mPath.c_str(), strerror( errno ) );
+        remove( temp.c_str() );
+        return false;
+    }
+    syncDirectory();
+
+    // El diario de la generación anterior ya no vale; si el borrado no llega
+    // al disco, la generación distinta lo invalida igual
+    remove( mJournalPath.c_str() );
+    mBytesWritten += sizeof( header ) + ( records != NULL ? count * sizeof( Sint32 ) : 0 );
+    mGeneration = header.generation;
+    mRecordCount = count;
+    mPayloadCrc = header.payloadCrc;
+    mHasSnapshot = true;
+    mJournalEntries = 0;
+    resetDirty();
+    return true;
+}
+
+bool LSaveFile::appendJournal( const Sint32* records ) {
+    compactDirty();
+    if( mDirtyOverflow ) {
+        return saveSnapshot( records, mRecordCount );
+    }
+    if( mDirtyIndices.empty() ) {
+        return true;
+    }
+
+    // Cada entrada lleva su propio CRC para detectar una escritura a medias
+    std::vector<JournalEntry> entries( mDirtyIndices.size() );
+    for( size_t i = 0; i < mDirtyIndices.size(); ++i ) {
+        entries[ i ].index = mDirtyIndices[ i ];
+        entries[ i ].value = records[ mDirtyIndices[ i ] ];
+        entries[ i ].crc = crc32( &entries[ i ], offsetof( JournalEntry, crc ) );
+    }
+
+    // El primer cambio tras una instantánea empieza un diario nuevo
+    bool create = mJournalEntries == 0;
+    FILE* file = fopen( mJournalPath.c_str(), create ? "wb" : "ab" );
+    if( file == NULL ) {
+        printf( "No se pudo abrir %s: %s\n", mJournalPath.c_str(), strerror( errno ) );
+        return false;
+    }
+    setvbuf( file, NULL, _IONBF, 0 );
+    bool written = true;
+    if( create ) {
+        JournalHeader header;
+        memcpy( header.magic, "NJNL", 4 );
+        header.version = VERSION;
+        header.generation = mGeneration;
+        header.headerCrc = crc32( &header, offsetof( JournalHeader, headerCrc ) );
+        header.reserved = 0;
+        written = fwrite( &header, sizeof( header ), 1, file ) == 1;
+    }
+    written = written && fwrite( entries.data(), sizeof( JournalEntry ), entries.size(), file ) == entries.size()
+        && fsync( fileno( file ) ) == 0;
+    written = fclose( file ) == 0 && written;
+    if( !written ) {
+        printf( "No se pudo escribir %s: %s\n", mJournalPath.c_str(), strerror( errno ) );
+        return false;
+    }
+    if( create ) {
+        syncDirectory();
+    }
+
+    mJournalEntries += entries.size();
+    mBytesWritten += entries.size() * sizeof( JournalEntry ) + ( create ? sizeof( JournalHeader ) : 0 );
+    mDirtyIndices.clear();
+    return true;
+}
+
+Uint64 LSaveFile::getJournalEntries() {
+    return mJournalEntries;
+}
+
+Uint64 LSaveFile::getGeneration() {
+    return mGeneration;
+}
+
+Uint64 LSaveFile::getBytesWritten() {
+    return mBytesWritten;
+}
+
+void LSaveFile::resetDirty() {
+    // Con más marcados de los que admite el diario save() escribe una
+    // instantánea de todos modos
+    Uint64 snapshotBytes = sizeof( Header ) + mRecordCount * sizeof( Sint32 );
+    Uint64 capacity = snapshotBytes / 2 / sizeof( JournalEntry ) + 1;
+    mDirtyIndices.clear();
+    mDirtyIndices.reserve( capacity < MAX_DIRTY ? capacity : MAX_DIRTY );
+    mDirtyOverflow = false;
+}
+
+void LSaveFile::compactDirty() {
+    std::sort( mDirtyIndices.begin(), mDirtyIndices.end() );
+    mDirtyIndices.erase( std::unique( mDirtyIndices.begin(), mDirtyIndices.end() ), mDirtyIndices.end() );
+}
+
+void LSaveFile::replayJournal( Sint32* records ) {
+    FILE* file = fopen( mJournalPath.c_str(), "rb" );
+    if( file == NULL ) {
+        return;
+    }
+
+    JournalHeader header;
+    long valid = 0;
+    if( fread( &header, sizeof( header ), 1, file ) == 1 && memcmp( header.magic, "NJNL", 4 ) == 0
+            && header.headerCrc == crc32( &header, offsetof( JournalHeader, headerCrc ) )
+            && header.version == VERSION && header.generation == mGeneration ) {
+        // Se aplica hasta la primera entrada incompleta o rota: es lo que
+        // quedó a medias si el programa se cortó mientras escribía
+        valid = sizeof( header );
+        JournalEntry entry;
+        while( fread( &entry, sizeof( entry ), 1, file ) == 1
+                && entry.crc == crc32( &entry, offsetof( JournalEntry, crc ) ) && entry.index < mRecordCount ) {
+            records[ entry.index ] = entry.value;
+            ++mJournalEntries;
+            valid += sizeof( entry );
+        }
+    }
+    fclose( file );
+
+    // Un diario de otra generación se descarta; uno válido se recorta para
+    // seguir añadiendo detrás de la última entrada buena
+    if( valid == 0 ) {
+        remove( mJournalPath.c_str() );
+    } else if( truncate( mJournalPath.c_str(), valid ) != 0 ) {
+        printf( "No se pudo recortar %s: %s\n", mJournalPath.c_str(), strerror( errno ) );
+    }
+}
+
+void LSaveFile::syncDirectory() {
+    size_t slash = mPath.find_last_of( '/' );
+    std::string directory = slash == std::string::npos ? "." : mPath.substr( 0, slash );
+    int descriptor = open( directory.c_str(), O_RDONLY );
+    if( descriptor >= 0 ) {
+        fsync( descriptor );
+        ::close( descriptor );
+    }
+}
+
+Uint32 LSaveFile::crc32( const void* data, size_t length, Uint32 crc ) {
+    // Tablas de slicing-by-8: ocho bytes por iteración en lugar de uno
+    struct Tables {
+        Uint32 t[ 8 ][ 256 ];
+        Tables() {
+            for( Uint32 i = 0; i < 256; ++i ) {
+                Uint32 c = i;
+                for( int k = 0; k < 8; ++k ) {
+                    c = ( c & 1 ) ? 0xEDB88320 ^ ( c >> 1 ) : c >> 1;
+                }
+                t[ 0 ][ i ] = c;
+            }
+            for( int s = 1; s < 8; ++s ) {
+                for( int i = 0; i < 256; ++i ) {
+                    t[ s ][ i ] = ( t[ s - 1 ][ i ] >> 8 ) ^ t[ 0 ][ t[ s - 1 ][ i ] & 0xFF ];
+                }
+            }
+        }
+    };
+    static const Tables tables;
+    const Uint32 ( *t )[ 256 ] = tables.t;
+
+    const Uint8* p = (const Uint8*)data;
+    crc = ~crc;
+    while( length >= 8 ) {
+        Uint32 low, high;
+        memcpy( &low, p, 4 );
+        memcpy( &high, p + 4, 4 );
+        low = SDL_SwapLE32( low ) ^ crc;
+        high = SDL_SwapLE32( high );
+        crc = t[ 7 ][ low & 0xFF ] ^ t[ 6 ][ ( low >> 8 ) & 0xFF ] ^ t[ 5 ][ ( low >> 16 ) & 0xFF ] ^ t[ 4 ][ low >> 24 ]
+            ^ t[ 3 ][ high & 0xFF ] ^ t[ 2 ][ ( high >> 8 ) & 0xFF ] ^ t[ 1 ][ ( high >> 16 ) & 0xFF ] ^ t[ 0 ][ high >> 24 ];
+        p += 8;
+        length -= 8;
+    }
+    while( length-- > 0 ) {
+        crc = t[ 0 ][ ( crc ^ *p++ ) & 0xFF ] ^ ( crc >> 8 );
+    }
+    return ~crc;
+}
+
+LRecordStore::LRecordStore() {
+    // Inicializa las variables
+    mMapping = NULL;
+    mMappingSize = 0;
+    mRecords = NULL;
+    mCount = 0;
+}
+
+LRecordStore::~LRecordStore() {
+    close();
+}
+
+bool LRecordStore::open( std::string path, Uint64 count ) {
+    close();
+    mPath = path;
+    if( map() ) {
+        return true;
+    }
+
+    // Sólo se crea el archivo si no existe o está vacío; uno dañado se deja
+    // como está
+    struct stat info;
+    if( stat( path.c_str(), &info ) == 0 && info.st_size > 0 ) {
+        return false;
+    }
+    printf( "Nuevo archivo creado!\n" );
+    return mSave.saveSnapshot( NULL, count ) && map();
+}
+
+void LRecordStore::close() {
+    unmap();
+}
+
+Uint64 LRecordStore::getCount() {
+    return mCount;
+}
+
+Sint32 LRecordStore::get( Uint64 index ) {
+    return mRecords[ index ];
+}
+
+void LRecordStore::set( Uint64 index, Sint32 value ) {
+    mRecords[ index ] = value;
+    mSave.markDirty( index );
+}
+
+bool LRecordStore::save() {
+    if( mMapping == NULL ) {
+        return false;
+    }
+    Uint64 generation = mSave.getGeneration();
+    if( !mSave.save( mRecords, mCount ) ) {
+        return false;
+    }
+
+    // La instantánea nueva ya tiene todos los cambios; mapearla suelta las
+    // páginas copiadas
+    if( mSave.getGeneration() != generation ) {
+        unmap();
+        return map();
+    }
+    return true;
+}
+
+Uint64 LRecordStore::getBytesWritten() {
+    return mSave.getBytesWritten();
+}
+
+bool LRecordStore::map() {
+    Uint64 count, offset;
+    if( !mSave.loadHeader( mPath, count, offset ) ) {
+        return false;
+    }
+
+    int descriptor = ::open( mPath.c_str(), O_RDONLY );
+    if( descriptor < 0 ) {
+        return false;
+    }
+    struct stat info;
+    if( fstat( descriptor, &info ) != 0 || info.st_size == 0 ) {
+        ::close( descriptor );
+        return false;
+    }
+
+    // Privado: una página editada se copia en memoria y el archivo no cambia
+    void* mapping = mmap( NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0 );
+    ::close( descriptor );
+    if( mapping == MAP_FAILED ) {
+        printf( "No se pudo mapear %s: %s\n", mPath.c_str(), strerror( errno ) );
+        return false;
+    }
+    mMapping = (Uint8*)mapping;
+    mMappingSize = info.st_size;
+    mRecords = (Sint32*)( mMapping + offset );
+    mCount = count;
+
+    // Los cambios del diario sólo tocan sus páginas
+    mSave.replayJournal( mRecords );
+    return true;
+}
+
+void LRecordStore::unmap() {
+    if( mMapping != NULL ) {
+        munmap( mMapping, mMappingSize );
+        mMapping = NULL;
+        mMappingSize = 0;
+        mRecords = NULL;
+        mCount = 0;
+    }
+}
+
+LSaveQueue::LSaveQueue() {
+    // Inicializa las variables
+    mShared = NULL;
+    mThread = NULL;
+    mBytesWritten = 0;
+    mFlushes = 0;
+    mLastFlushUs = 0;
+    mMaxFlushUs = 0;
+}
+
+LSaveQueue::~LSaveQueue() {
+    stop( SDL_MUTEX_MAXWAIT );
+}
+
+bool LSaveQueue::start( std::string path ) {
+    stop( SDL_MUTEX_MAXWAIT );
+
+    Shared* shared = new Shared;
+    if( !shared->image.open( path, 0 ) ) {
+        delete shared;
+        return false;
+    }
+    shared->mutex = SDL_CreateMutex();
+    shared->wake = SDL_CreateCond();
+    shared->finishedCondition = SDL_CreateCond();
+    shared->stopping = false;
+    shared->finished = false;
+    shared->detached = false;
+    shared->depth = 0;
+    shared->bytesWritten = 0;
+    shared->flushes = 0;
+    shared->lastFlushUs = 0;
+    shared->maxFlushUs = 0;
+
+    // Todos los lotes se reservan aquí; el bucle principal sólo los cambia de
+    // lista
+    shared->free.resize( MAX_BATCHES );
+    for( int i = 0; i < MAX_BATCHES; ++i ) {
+        shared->free[ i ].reserve( BATCH_CHANGES );
+    }
+    shared->queue.reserve( MAX_BATCHES );
+    mBatch.clear();
+    mBatch.reserve( BATCH_CHANGES );
+
+    mShared = shared;
+    mThread = SDL_CreateThread( saveThread, "save", shared );
+    if( mThread == NULL ) {
+        printf( "No se pudo crear el hilo de guardado! SDL Error: %s\n", SDL_GetError() );
+        SDL_DestroyCond( shared->finishedCondition );
+        SDL_DestroyCond( shared->wake );
+        SDL_DestroyMutex( shared->mutex );
+        delete shared;
+        mShared = NULL;
+        return false;
+    }
+    return true;
+}
+
+void LSaveQueue::post( Uint64 index, Sint32 value ) {
+    Change change = { index, value };
+    mBatch.push_back( change );
+    if( mBatch.size() == BATCH_CHANGES ) {
+        submit();
+    }
+}
+
+void LSaveQueue::submit() {
+    if( mShared == NULL || mBatch.empty() ) {
+        return;
+    }
+
+    // Intercambia el lote lleno por uno libre ya reservado
+    SDL_LockMutex( mShared->mutex );
+    if( !mShared->free.empty() ) {
+        mShared->queue.push_back( std::vector<Change>() );
+        mShared->queue.back().swap( mBatch );
+        mBatch.swap( mShared->free.back() );
+        mShared->free.pop_back();
+        mShared->depth = mShared->queue.size();
+        SDL_CondSignal( mShared->wake );
+    }
+    SDL_UnlockMutex( mShared->mutex );
+}
+
+bool LSaveQueue::stop( Uint32 timeoutMs ) {
+    if( mShared == NULL ) {
+        return true;
+    }
+
+    // Lo último que se editó también se guarda; si no queda lote libre se
+    // espera a que el hilo devuelva uno
+    Uint32 start = SDL_GetTicks();
+    Shared* shared = mShared;
+    SDL_LockMutex( shared->mutex );
+    while( !mBatch.empty() && shared->free.empty() && !shared->finished
+            && ( timeoutMs == SDL_MUTEX_MAXWAIT || SDL_GetTicks() - start < timeoutMs ) ) {
+        SDL_UnlockMutex( shared->mutex );
+        SDL_Delay( 1 );
+        SDL_LockMutex( shared->mutex );
+    }
+    SDL_UnlockMutex( shared->mutex );
+    submit();
+
+    SDL_LockMutex( shared->mutex );
+    shared->stopping = true;
+    SDL_CondSignal( shared->wake );
+    while( !shared->finished ) {
+        Uint32 elapsed = SDL_GetTicks() - start;
+        if( timeoutMs == SDL_MUTEX_MAXWAIT ) {
+            SDL_CondWait( shared->finishedCondition, shared->mutex );
+        } else if( elapsed >= timeoutMs ) {
+            break;
+        } else {
+            SDL_CondWaitTimeout( shared->finishedCondition, shared->mutex, timeoutMs - elapsed );
+        }
+    }
+    bool finished = shared->finished;
+    if( !finished ) {
+        // El hilo acaba su escritura por su cuenta; el diario y las
+        // instantáneas nunca quedan a medias aunque el programa salga antes
+        shared->detached = true;
+    }
+
+    mBytesWritten = shared->bytesWritten;
+    mFlushes = shared->flushes;
+    mLastFlushUs = shared->lastFlushUs;
+    mMaxFlushUs = shared->maxFlushUs;
+    SDL_UnlockMutex( shared->mutex );
+
+    if( finished ) {
+        SDL_WaitThread( mThread, NULL );
+        SDL_DestroyCond( shared->finishedCondition );
+        SDL_DestroyCond( shared->wake );
+        SDL_DestroyMutex( shared->mutex );
+        delete shared;
+    } else {
+        SDL_DetachThread( mThread );
+    }
+    mShared = NULL;
+    mThread = NULL;
+    mBatch.clear();
+    return finished;
+}
+
+int LSaveQueue::getQueueDepth() {
+    return mShared != NULL ? (int)mShared->depth : 0;
+}
+
+Uint64 LSaveQueue::getBytesWritten() {
+    return mShared != NULL ? (Uint64)mShared->bytesWritten : mBytesWritten;
+}
+
+int LSaveQueue::getFlushes() {
+    return mShared != NULL ? (int)mShared->flushes : mFlushes;
+}
+
+double LSaveQueue::getLastFlushMs() {
+    return ( mShared != NULL ? (Uint32)mShared->lastFlushUs : mLastFlushUs ) / 1000.0;
+}
+
+double LSaveQueue::getMaxFlushMs() {
+    return ( mShared != NULL ? (Uint32)mShared->maxFlushUs : mMaxFlushUs ) / 1000.0;
+}
+
+int LSaveQueue::saveThread( void* data ) {
+    Shared* shared = (Shared*)data;
+    std::vector< std::vector<Change> > working;
+    working.reserve( MAX_BATCHES );
+
+    SDL_LockMutex( shared->mutex );
+    while( true ) {
+        while( shared->queue.empty() && !shared->stopping ) {
+            SDL_CondWait( shared->wake, shared->mutex );
+        }
+        if( shared->queue.empty() ) {
+            break;
+        }
+
+        // Espera un poco a que lleguen más lotes para escribirlos juntos; al
+        // parar se escribe enseguida
+        Uint32 start = SDL_GetTicks();
+        while( !shared->stopping && (int)shared->queue.size() < MAX_BATCHES
+                && SDL_GetTicks() - start < (Uint32)COALESCE_MS ) {
+            SDL_CondWaitTimeout( shared->wake, shared->mutex, COALESCE_MS - ( SDL_GetTicks() - start ) );
+        }
+        working.swap( shared->queue );
+        shared->depth = 0;
+        SDL_UnlockMutex( shared->mutex );
+
+        // Aplica los cambios en orden: el último valor de cada registro gana y
+        // el diario sólo lo escribe una vez
+        Uint64 count = shared->image.getCount();
+        for( size_t b = 0; b < working.size(); ++b ) {
+            for( size_t i = 0; i < working[ b ].size(); ++i ) {
+                if( working[ b ][ i ].index < count ) {
+                    shared->image.set( working[ b ][ i ].index, working[ b ][ i ].value );
+                }
+            }
+        }
+
+        Uint64 flushStart = SDL_GetPerformanceCounter();
+        if( !shared->image.save() ) {
+            printf( "Error: No se pudo guardar el archivo!\n" );
+        }
+        Uint32 flushUs = ( SDL_GetPerformanceCounter() - flushStart ) * 1000000 / SDL_GetPerformanceFrequency();
+        shared->lastFlushUs = flushUs;
+        if( flushUs > shared->maxFlushUs ) {
+            shared->maxFlushUs = flushUs;
+        }
+        shared->bytesWritten = shared->image.getBytesWritten();
+        ++shared->flushes;
+
+        // Devuelve los lotes vacíos, que conservan su reserva
+        SDL_LockMutex( shared->mutex );
+        for( size_t b = 0; b < working.size(); ++b ) {
+            working[ b ].clear();
+            shared->free.push_back( std::vector<Change>() );
+            shared->free.back().swap( working[ b ] );
+        }
+        working.clear();
+    }
+
+    shared->finished = true;
+    bool detached = shared->detached;
+    SDL_CondSignal( shared->finishedCondition );
+    SDL_UnlockMutex( shared->mutex );
+
+    // Suelto, nadie más lo va a liberar
+    if( detached ) {
+        shared->image.close();
+        SDL_DestroyCond( shared->finishedCondition );
+        SDL_DestroyCond( shared->wake );
+        SDL_DestroyMutex( shared->mutex );
+        delete shared;
+    }
+    return 0;
+}
+
+bool init() {
+    // Bandera
+    bool success = true;
+
+    // Inicia SDL
+    if( SDL_Init( SDL_INIT_VIDEO ) < 0 ) 
+    {
+        printf( "SDL no pudo inicializarse! SDL Error: %s\n", SDL_GetError() );
+        success = false; 
+    } 
+    else 
+    {
+        // Filtrado
+        if( !SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY , "1") ) 
+        {
+            printf( "Warning: Filtrado lineal de texturas no disponible!" );
+        }
+
+        // Crea la ventana
+        gWindow = SDL_CreateWindow( "SDL Tutorial 33 - Lectura y escritura de archivos", 
+                SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+        if( gWindow == NULL ) 
+        {
+            printf( "No se pudo iniciar la ventana! SDL Error: %s\n", SDL_GetError() );
+            success = false;
+        } 
+        else 
+        {
+            // Crea el renderizador
+            gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED 
+                    | SDL_RENDERER_PRESENTVSYNC );
+            if( gRenderer == NULL ) 
+            {
+                printf( "No se pudo crear el renderizador! SDL Error: %s\n", SDL_GetError() );
+                success = false;
+            } 
+            else 
+            {
+                // Inica el renderizador de color
+                SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+
+                // Inicializa la carga de PNG
+                int imgFlags = IMG_INIT_PNG;
+                if( !( IMG_Init( imgFlags ) & imgFlags ) ) 
+                {
+                    printf( "SDL_Image no pudo inicializarse! SDL_image Error: %s\n", 
+                            IMG_GetError() );
+                    success = false;
+                }
+
+            }
+            if( TTF_Init() == -1 )
+            {
+                printf( "SDL_ttf no pudo inicializarse! SDL_ttf Error: %s\n", TTF_GetError() );
+                success = false;
+            }
+        }
+    }
+
+    return success;
+}
+
+bool loadMedia() 
+{
+    // Carga la fuente
+    gFont = TTF_OpenFont( "romfs/lazy.ttf", 28 );
+    if( gFont == NULL )
+    {
+        printf( "Falló la carga de la fuente! SDL_ttf Error: %s\n", TTF_GetError() );
+        return false;
+    }
+    else 
+    {
+        // Crea el atlas; los glifos se rasterizan al usarse por primera vez
+        if( !gTextAtlas.loadFromFont( gFont ) )
+        {
+            printf( "Falló la carga del atlas de glifos!\n" );
+            return false;
+        }
+    }
+
+    // Mapea los datos guardados, con los cambios del diario aplicados; el
+    // tamaño del archivo no cambia lo que tarda
+    if( !gRecords.open( gRecordsPath, TOTAL_DATA ) )
+    {
+        printf( "Error: no se pudo abrir %s!\n", gRecordsPath );
+        return false;
+    }
+
+    // La lista y la edición suponen al menos un registro
+    if( gRecords.getCount() == 0 )
+    {
+        printf( "Error: %s no tiene registros!\n", gRecordsPath );
+        gRecords.close();
+        return false;
+    }
+    printf( "Leyendo archivo...! %llu registros\n", (unsigned long long)gRecords.getCount() );
+
+    // Los cambios se guardan mientras se edita, sin esperar a salir
+    if( !gSaveQueue.start( gRecordsPath ) )
+    {
+        printf( "Error: no se pudo iniciar el guardado de %s!\n", gRecordsPath );
+        return false;
+    }
+
+    return true;
+}
+
+void close() {
+    // Escribe lo que quede pendiente sin esperar más de SHUTDOWN_FLUSH_MS; si
+    // no da tiempo el archivo queda en el último guardado completo
+    Uint32 stopStart = SDL_GetTicks();
+    if( gSaveQueue.stop( SHUTDOWN_FLUSH_MS ) )
+    {
+        printf( "Guardado: %d escrituras, %llu bytes, peor %.2f ms; al salir %u ms\n", gSaveQueue.getFlushes(),
+                (unsigned long long)gSaveQueue.getBytesWritten(), gSaveQueue.getMaxFlushMs(), SDL_GetTicks() - stopStart );
+    }
+    else
+    {
+        printf( "Error: el guardado no terminó en %u ms, se pierden los últimos cambios!\n", SHUTDOWN_FLUSH_MS );
+    }
+    gRecords.close();
+
+    // Estadísticas del atlas de glifos
+    printf( "Atlas de glifos: %.2f%% aciertos, %.2f%% ocupado\n",
+            gTextAtlas.getHitRate() * 100.0, gTextAtlas.getOccupancy() * 100.0 );
+
+    // Libera el atlas
+    gTextAtlas.free();
+
+    // Libera la fuente global
+    TTF_CloseFont( gFont );
+    gFont = NULL;
+
+    // Destruye la ventana
+    SDL_DestroyRenderer( gRenderer );
+    SDL_DestroyWindow( gWindow );
+    gWindow = NULL;
+    gRenderer = NULL;
+
+    // Termina SDL
+    IMG_Quit();
+    TTF_Quit();
+    SDL_Quit();
+}
+
+std::string getTempPath( const char* name )
+{
+    // TMPDIR si está definido; si no, el directorio temporal del sistema
+    const char* dir = getenv( "TMPDIR" );
+    if( dir == NULL || dir[ 0 ] == '\0' )
+    {
+        dir = "/tmp";
+    }
+    std::string path = dir;
+    if( path[ path.size() - 1 ] != '/' )
+    {
+        path += '/';
+    }
+    return path + name;
+}
+
+int benchmarkSave()
+{
+    std::string tempPath = getTempPath( "bench.bin" );
+    const char* path = tempPath.c_str();
+    std::string journalPath = std::string( path ) + ".journal";
+    int errors = 0;
+
+    // Valor de referencia del CRC-32
+    if( LSaveFile::crc32( "123456789", 9 ) != 0xCBF43926 )
+    {
+        ++errors;
+    }
+
+    // Archivo del formato antiguo, sin cabecera
+    {
+        SDL_RWops* file = SDL_RWFromFile( path, "w+b" );
+        for( Sint32 i = 0; i < TOTAL_DATA; ++i )
+        {
+            SDL_RWwrite( file, &i, sizeof( Sint32 ), 1 );
+        }
+        SDL_RWclose( file );
+        LSaveFile save;
+        std::vector<Sint32> records;
+        if( !save.load( path, records ) || records.size() != TOTAL_DATA || records[ TOTAL_DATA - 1 ] != TOTAL_DATA - 1 )
+        {
+            ++errors;
+        }
+    }
+
+    // Latencia de guardar de 10 a 10M registros: el guardado antiguo con una
+    // escritura por entero sin sincronizar, una instantánea completa, un
+    // cambio añadido al diario y la carga
+    for( Uint64 count = 10; count <= 10000000; count *= 10 )
+    {
+        std::vector<Sint32> records( count );
+        Uint32 seed = 1;
+        for( Uint64 i = 0; i < count; ++i )
+        {
+            seed = seed * 1103515245 + 12345;
+            records[ i ] = (Sint32)seed;
+        }
+        int repetitions = count <= 100000 ? 20 : ( count <= 1000000 ? 5 : 2 );
+        double frequency = SDL_GetPerformanceFrequency();
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for( int r = 0; r < repetitions; ++r )
+        {
+            SDL_RWops* file = SDL_RWFromFile( path, "w+b" );
+            for( Uint64 i = 0; i < count; ++i )
+            {
+                SDL_RWwrite( file, &records[ i ], sizeof( Sint32 ), 1 );
+            }
+            SDL_RWclose( file );
+        }
+        double legacyMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency / repetitions;
+
+        remove( path );
+        remove( journalPath.c_str() );
+        LSaveFile save;
+        std::vector<Sint32> loaded;
+        save.load( path, loaded );
+        start = SDL_GetPerformanceCounter();
+        for( int r = 0; r < repetitions; ++r )
+        {
+            if( !save.saveSnapshot( records.data(), count ) )
+            {
+                ++errors;
+            }
+        }
+        double snapshotMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency / repetitions;
+
+        // Un registro distinto en cada guardado; con pocos registros el diario
+        // se compacta enseguida en una instantánea
+        start = SDL_GetPerformanceCounter();
+        for( int r = 0; r < repetitions; ++r )
+        {
+            Uint64 index = (Uint64)r * 7919 % count;
+            ++records[ index ];
+            save.markDirty( index );
+            if( !save.save( records.data(), count ) )
+            {
+                ++errors;
+            }
+        }
+        double journalMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency / repetitions;
+
+        start = SDL_GetPerformanceCounter();
+        LSaveFile reader;
+        if( !reader.load( path, loaded ) || loaded != records )
+        {
+            ++errors;
+        }
+        double loadMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+
+        double megabytes = count * sizeof( Sint32 ) / ( 1024.0 * 1024.0 );
+        printf( "%8llu registros: antiguo %.3f ms, instantánea %.3f ms (%.0f MB/s), cambio %.3f ms (%llu en el diario), carga %.3f ms\n",
+                (unsigned long long)count, legacyMs, snapshotMs, megabytes / ( snapshotMs / 1000.0 ), journalMs,
+                (unsigned long long)save.getJournalEntries(), loadMs );
+    }
+
+    // Cortes simulados: una entrada del diario escrita a medias se descarta
+    // y se sigue añadiendo detrás de la última buena, y una instantánea con
+    // un bit cambiado no se carga
+    {
+        const Uint64 count = 1000;
+        std::vector<Sint32> records( count, 7 );
+        remove( path );
+        remove( journalPath.c_str() );
+        LSaveFile save;
+        std::vector<Sint32> loaded;
+        save.load( path, loaded );
+        save.saveSnapshot( records.data(), count );
+        for( int i = 0; i < 3; ++i )
+        {
+            records[ i * 100 ] = i;
+            save.markDirty( i * 100 );
+            save.save( records.data(), count );
+        }
+        FILE* journal = fopen( journalPath.c_str(), "ab" );
+        fwrite( "torn!!!", 1, 7, journal );
+        fclose( journal );
+
+        LSaveFile reader;
+        if( !reader.load( path, loaded ) || loaded != records || reader.getJournalEntries() != 3 )
+        {
+            ++errors;
+        }
+        records[ 999 ] = -1;
+        reader.markDirty( 999 );
+        reader.save( records.data(), count );
+        LSaveFile again;
+        if( !again.load( path, loaded ) || loaded != records || again.getJournalEntries() != 4 )
+        {
+            ++errors;
+        }
+
+        FILE* file = fopen( path, "r+b" );
+        fseek( file, sizeof( Uint64 ) * 4 + 123, SEEK_SET );
+        int byte = fgetc( file );
+        fseek( file, -1, SEEK_CUR );
+        fputc( byte ^ 0x10, file );
+        fclose( file );
+        LSaveFile corrupted;
+        if( corrupted.load( path, loaded ) )
+        {
+            ++errors;
+        }
+    }
+
+    remove( path );
+    remove( journalPath.c_str() );
+    printf( "%d errores\n", errors );
+    return errors > 0 ? -1 : 0;
+}
+
+// Memoria residente del proceso en bytes
+static Uint64 residentBytes()
+{
+    Uint64 pages = 0, resident = 0;
+    FILE* file = fopen( "/proc/self/statm", "r" );
+    if( file != NULL )
+    {
+        if( fscanf( file, "%llu %llu", (unsigned long long*)&pages, (unsigned long long*)&resident ) != 2 )
+        {
+            resident = 0;
+        }
+        fclose( file );
+    }
+    return resident * sysconf( _SC_PAGESIZE );
+}
+
+int benchmarkRecords()
+{
+    std::string tempPath = getTempPath( "records.bin" );
+    const char* path = tempPath.c_str();
+    std::string journalPath = std::string( path ) + ".journal";
+    const Uint64 count = 100000000;
+    const int PAGES = 1000;
+    const int ROWS = 14;
+    double frequency = SDL_GetPerformanceFrequency();
+    int errors = 0;
+
+    remove( path );
+    remove( journalPath.c_str() );
+
+    // Crear el archivo: la instantánea a cero queda dispersa en disco
+    Uint64 start = SDL_GetPerformanceCounter();
+    {
+        LRecordStore store;
+        if( !store.open( path, count ) || store.getCount() != count )
+        {
+            ++errors;
+        }
+    }
+    double createMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+
+    // Abrirlo no lee los registros
+    Uint64 residentBefore = residentBytes();
+    start = SDL_GetPerformanceCounter();
+    LRecordStore store;
+    if( !store.open( path, count ) || store.getCount() != count )
+    {
+        printf( "No se pudo abrir %s\n", path );
+        remove( path );
+        return -1;
+    }
+    double openMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+
+    // Páginas al azar como las que pinta la lección
+    Uint32 seed = 1;
+    Sint64 sum = 0;
+    start = SDL_GetPerformanceCounter();
+    for( int page = 0; page < PAGES; ++page )
+    {
+        seed = seed * 1103515245 + 12345;
+        Uint64 first = ( (Uint64)seed * 7919 ) % ( count - ROWS );
+        for( int row = 0; row < ROWS; ++row )
+        {
+            sum += store.get( first + row );
+        }
+    }
+    double pageUs = ( SDL_GetPerformanceCounter() - start ) * 1000000.0 / frequency / PAGES;
+    double residentMB = ( residentBytes() - residentBefore ) / ( 1024.0 * 1024.0 );
+    if( sum != 0 )
+    {
+        ++errors;
+    }
+
+    // Editar unos pocos registros repartidos, guardarlos en el diario y
+    // volver a abrir
+    for( int i = 0; i < 100; ++i )
+    {
+        Uint64 index = (Uint64)i * ( count / 100 ) + i;
+        store.set( index, i + 1 );
+    }
+    start = SDL_GetPerformanceCounter();
+    if( !store.save() )
+    {
+        ++errors;
+    }
+    double saveMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+    store.close();
+
+    start = SDL_GetPerformanceCounter();
+    LRecordStore reopened;
+    if( !reopened.open( path, count ) )
+    {
+        ++errors;
+    }
+    double reopenMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+    for( int i = 0; i < 100 && reopened.getCount() == count; ++i )
+    {
+        Uint64 index = (Uint64)i * ( count / 100 ) + i;
+        if( reopened.get( index ) != i + 1 || reopened.get( index + 1 ) != 0 )
+        {
+            ++errors;
+        }
+    }
+    reopened.close();
+
+    printf( "%llu registros: crear %.1f ms, abrir %.3f ms, página %.2f us, residente +%.1f MB tras %d páginas\n",
+            (unsigned long long)count, createMs, openMs, pageUs, residentMB, PAGES );
+    printf( "100 cambios: guardar %.3f ms, volver a abrir %.3f ms\n", saveMs, reopenMs );
+
+    remove( path );
+    remove( journalPath.c_str() );
+    printf( "%d errores\n", errors );
+    return errors > 0 ? -1 : 0;
+}
+
+int benchmarkAsyncSave()
+{
+    std::string tempPath = getTempPath( "async.bin" );
+    const char* path = tempPath.c_str();
+    std::string journalPath = std::string( path ) + ".journal";
+    const Uint64 count = 10000000;
+    const int FRAMES = 300;
+    const int EDITS_PER_FRAME = 20;
+    const int OVERFLOW_FRAME = 150;
+    double frequency = SDL_GetPerformanceFrequency();
+    int errors = 0;
+
+    remove( path );
+    remove( journalPath.c_str() );
+
+    // Guardado síncrono: lo que pararía un fotograma si se guardara en él,
+    // con unos pocos cambios y con más de los que admite el diario
+    double syncTotalMs = 0.0, syncMaxMs = 0.0, syncSnapshotMs = 0.0;
+    {
+        LRecordStore store;
+        store.open( path, count );
+        Uint32 seed = 7;
+        for( int frame = 0; frame < FRAMES / 10; ++frame )
+        {
+            for( int i = 0; i < EDITS_PER_FRAME; ++i )
+            {
+                seed = seed * 1103515245 + 12345;
+                Uint64 index = ( (Uint64)seed * 7919 ) % count;
+                store.set( index, store.get( index ) + 1 );
+            }
+            Uint64 start = SDL_GetPerformanceCounter();
+            store.save();
+            double ms = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+            syncTotalMs += ms;
+            if( ms > syncMaxMs )
+            {
+                syncMaxMs = ms;
+            }
+        }
+        for( int i = 0; i <= LSaveFile::MAX_DIRTY; ++i )
+        {
+            store.set( i, 0 );
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        store.save();
+        syncSnapshotMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+    }
+
+    // Guardado en segundo plano: el fotograma sólo anota y entrega lotes. En
+    // un fotograma se cambian más registros de los que admite el diario y el
+    // hilo escribe una instantánea entera
+    LRecordStore view;
+    LSaveQueue queue;
+    if( !view.open( path, count ) || !queue.start( path ) )
+    {
+        printf( "No se pudo abrir %s\n", path );
+        remove( path );
+        return -1;
+    }
+    double frameTotalUs = 0.0, frameMaxUs = 0.0, overflowUs = 0.0;
+    int maxDepth = 0;
+    Uint64 frameAllocations = 0;
+    Uint32 seed = 11;
+    for( int frame = 0; frame < FRAMES; ++frame )
+    {
+        Uint64 allocations = gHeapAllocations;
+        Uint64 start = SDL_GetPerformanceCounter();
+        if( frame == OVERFLOW_FRAME )
+        {
+            // Los lotes no alcanzan y el actual crece: este fotograma sí reserva
+            for( int i = 0; i <= LSaveFile::MAX_DIRTY; ++i )
+            {
+                view.set( i, view.get( i ) + 1 );
+                queue.post( i, view.get( i ) );
+            }
+        }
+        else
+        {
+            for( int i = 0; i < EDITS_PER_FRAME; ++i )
+            {
+                // La mitad de los cambios repiten registro, como una tecla
+                // mantenida
+                seed = seed * 1103515245 + 12345;
+                Uint64 index = ( seed & 1 ) ? ( (Uint64)seed * 7919 ) % count : frame;
+                view.set( index, view.get( index ) + 1 );
+                queue.post( index, view.get( index ) );
+            }
+        }
+        queue.submit();
+        double us = ( SDL_GetPerformanceCounter() - start ) * 1000000.0 / frequency;
+        if( frame == OVERFLOW_FRAME )
+        {
+            overflowUs = us;
+        }
+        else
+        {
+            frameAllocations += gHeapAllocations - allocations;
+            frameTotalUs += us;
+            if( us > frameMaxUs )
+            {
+                frameMaxUs = us;
+            }
+        }
+        if( queue.getQueueDepth() > maxDepth )
+        {
+            maxDepth = queue.getQueueDepth();
+        }
+        SDL_Delay( 2 );
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    if( !queue.stop( SHUTDOWN_FLUSH_MS ) )
+    {
+        ++errors;
+    }
+    double stopMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+
+    // Lo escrito coincide con la copia del bucle
+    LRecordStore reopened;
+    if( !reopened.open( path, count ) )
+    {
+        ++errors;
+    }
+    for( Uint64 i = 0; i < count && reopened.getCount() == count; ++i )
+    {
+        if( reopened.get( i ) != view.get( i ) )
+        {
+            ++errors;
+            break;
+        }
+    }
+    reopened.close();
+
+    printf( "Guardar en el fotograma: diario media %.3f ms, peor %.3f ms; instantánea %.3f ms\n",
+            syncTotalMs / ( FRAMES / 10 ), syncMaxMs, syncSnapshotMs );
+    printf( "En segundo plano: fotograma media %.2f us, peor %.2f us, %.2f reservas por fotograma; %d cambios %.2f us\n",
+            frameTotalUs / ( FRAMES - 1 ), frameMaxUs, (double)frameAllocations / ( FRAMES - 1 ),
+            LSaveFile::MAX_DIRTY + 1, overflowUs );
+    printf( "Hilo: %d escrituras, %llu bytes, última %.3f ms, peor %.3f ms, cola máxima %d; parar %.3f ms\n",
+            queue.getFlushes(), (unsigned long long)queue.getBytesWritten(), queue.getLastFlushMs(),
+            queue.getMaxFlushMs(), maxDepth, stopMs );
+
+    // Parar sin esperar: el hilo termina suelto y el archivo nunca queda a
+    // medias
+    if( !queue.start( path ) )
+    {
+        ++errors;
+    }
+    for( Uint64 i = 0; i < (Uint64)LSaveQueue::BATCH_CHANGES * 4; ++i )
+    {
+        view.set( i, -1 );
+        queue.post( i, -1 );
+    }
+    start = SDL_GetPerformanceCounter();
+    bool stopped = queue.stop( 0 );
+    double boundedMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+    SDL_Delay( 1000 );
+    LSaveFile check;
+    std::vector<Sint32> loaded;
+    if( !check.load( path, loaded ) || loaded.size() != count )
+    {
+        ++errors;
+    }
+    else
+    {
+        bool complete = true;
+        for( Uint64 i = 0; i < count; ++i )
+        {
+            complete = complete && loaded[ i ] == view.get( i );
+        }
+        printf( "Parar sin esperar: %s en %.3f ms, archivo válido y %s\n", stopped ? "terminado" : "suelto", boundedMs,
+                complete ? "completo" : "en el guardado anterior" );
+    }
+    view.close();
+
+    remove( path );
+    remove( journalPath.c_str() );
+    printf( "%d errores\n", errors );
+    return errors > 0 ? -1 : 0;
 }
 
 int main( int argc, char* argv[] ) {
+    // Formato de guardado, sin ventana
+    if( argc > 1 && strcmp( argv[ 1 ], "--save" ) == 0 ) {
+        return benchmarkSave();
+    }
+    if( argc > 1 && strcmp( argv[ 1 ], "--records" ) == 0 ) {
+        return benchmarkRecords();
+    }
+    if( argc > 1 && strcmp( argv[ 1 ], "--async" ) == 0 ) {
+        return benchmarkAsyncSave();
+    }
+
+    // Archivo de registros a mostrar
+    if( argc > 1 ) {
+        gRecordsPath = argv[ 1 ];
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -431,8 +2173,29 @@ int main( int argc, char* argv[] ) {
     SDL_Color textColor = { 0x00, 0x00, 0x00, 0xFF };
     SDL_Color highlightColor = { 0xFF, 0x00, 0x00, 0xFF };
 
-    // Punto de entrada actual
-    int currentData = 0;
+    // Punto de entrada actual y primera fila visible
+    Uint64 totalData = gRecords.getCount();
+    Uint64 currentData = 0;
+    Uint64 firstRow = 0;
+
+    // Filas que caben bajo la instrucción
+    int textHeight = gTextAtlas.getTextHeight();
+    int visibleRows = textHeight > 0 ? ( SCREEN_HEIGHT - textHeight ) / textHeight : 1;
+    if( visibleRows > ROW_POOL ) {
+        visibleRows = ROW_POOL;
+    }
+
+    // Textos de las filas: el registro i usa el hueco i % ROW_POOL, así que
+    // al desplazar sólo se rehacen las filas que entran
+    LHudText rowTexts[ ROW_POOL ];
+    Uint64 rowRecords[ ROW_POOL ];
+    for( int i = 0; i < ROW_POOL; ++i ) {
+        rowRecords[ i ] = (Uint64)-1;
+    }
+
+    // Reservas en el heap antes del bucle principal
+    Uint64 startAllocations = gHeapAllocations;
+    int countedFrames = 0;
     
     while( !quit ) {
         bool renderText = false;
@@ -452,62 +2215,105 @@ int main( int argc, char* argv[] ) {
 
                           // Anterior Dato
                           case SDLK_UP:
-                              // Renderiza el anterior punto de entrada
-                              gDataTextures[ currentData ].loadFromRenderedText( std::to_string( gData[ currentData ] ), textColor );
-                              --currentData;
-                              if( currentData < 0 )
+                              if( currentData == 0 )
                               {
-                                  currentData = TOTAL_DATA - 1;
+                                  currentData = totalData;
                               }
-
-                              // Renderiza el punto de entrada actual
-                              gDataTextures[ currentData ].loadFromRenderedText( std::to_string( gData[ currentData ] ), highlightColor );
+                              --currentData;
                               break;
 
                           // Siguiente dato
                           case SDLK_DOWN:
-                              // Renderiza el siguiente punto de entrada
-                              gDataTextures[ currentData ].loadFromRenderedText( std::to_string( gData[ currentData ] ), textColor );
                               ++currentData;
-                              if( currentData == TOTAL_DATA )
+                              if( currentData == totalData )
                               {
                                   currentData = 0;
                               }
+                              break;
+
+                          // Una página arriba o abajo
+                          case SDLK_PAGEUP:
+                              currentData = currentData > (Uint64)visibleRows ? currentData - visibleRows : 0;
+                              break;
+
+                          case SDLK_PAGEDOWN:
+                              currentData = currentData + visibleRows < totalData ? currentData + visibleRows : totalData - 1;
+                              break;
+
+                          // Primer y último dato
+                          case SDLK_HOME:
+                              currentData = 0;
+                              break;
 
-                              // Renderiza la entrada actual
-                              gDataTextures[ currentData ].loadFromRenderedText( std::to_string( gData[ currentData ] ), highlightColor );
+                          case SDLK_END:
+                              currentData = totalData - 1;
                               break;
 
                           // Decrementa el punto de entrada
                           case SDLK_LEFT:
-                              --gData[ currentData ];
-                              gDataTextures[ currentData ].loadFromRenderedText( std::to_string( gData[ currentData ] ), highlightColor );
+                              gRecords.set( currentData, gRecords.get( currentData ) - 1 );
+                              gSaveQueue.post( currentData, gRecords.get( currentData ) );
                               break;
 
                           // Aumenta el punto de entrada
                           case SDLK_RIGHT:
-                              ++gData[ currentData ];
-                              gDataTextures[ currentData ].loadFromRenderedText( std::to_string( gData[ currentData ] ), highlightColor );
+                              gRecords.set( currentData, gRecords.get( currentData ) + 1 );
+                              gSaveQueue.post( currentData, gRecords.get( currentData ) );
                               break;
                       }
             }
         }
 
+        // Pasa los cambios del fotograma al hilo de guardado
+        gSaveQueue.submit();
+
+        // Desplaza la lista lo justo para que se vea el dato actual
+        if( currentData < firstRow )
+        {
+            firstRow = currentData;
+        }
+        else if( currentData >= firstRow + visibleRows )
+        {
+            firstRow = currentData - visibleRows + 1;
+        }
+
 
         // Limpia la pantalla
         SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
         SDL_RenderClear( gRenderer );
 
 
-        // Rendereiza las texturas del texto
-        gPromptTextTexture.render( ( SCREEN_WIDTH - gPromptTextTexture.getWidth() ) / 2, 0 );
-        for( int i = 0; i < TOTAL_DATA; ++i )
+        // Renderiza el texto desde el atlas; editar un dato no crea texturas
+        gTextAtlas.render( ( SCREEN_WIDTH - gTextAtlas.getTextWidth( gPromptText ) ) / 2, 0, gPromptText, textColor );
+        for( int row = 0; row < visibleRows && firstRow + row < totalData; ++row )
         {
-            gDataTextures[ i ].render( ( SCREEN_WIDTH - gDataTextures[ i ].getWidth() ) / 2, gPromptTextTexture.getHeight() + gDataTextures[ 0 ].getHeight() * i );
+            // Un registro que entra en pantalla toma el hueco de uno que salió
+            Uint64 index = firstRow + row;
+            LHudText& text = rowTexts[ index % ROW_POOL ];
+            if( rowRecords[ index % ROW_POOL ] != index )
+            {
+                char prefix[ 32 ];
+                std::to_chars_result result = std::to_chars( prefix, prefix + sizeof( prefix ) - 3, index );
+                memcpy( result.ptr, ": ", 3 );
+                text.setPrefix( prefix );
+                rowRecords[ index % ROW_POOL ] = index;
+            }
+
+            // Sólo se vuelve a maquetar si el dato ha cambiado
+            text.setInt( gRecords.get( index ) );
+            text.render( ( SCREEN_WIDTH - text.getWidth() ) / 2, textHeight + textHeight * row,
+                    index == currentData ? highlightColor : textColor );
         }
 
         // Actualiza la pantalla
         SDL_RenderPresent( gRenderer );
+        ++countedFrames;
+    }
+
+    // Debería ser cero: el HUD no reserva memoria
+    if( countedFrames > 0 ) {
+        printf( "Reservas en el heap por fotograma: %.3f (%d fotogramas)\n",
+                (double)( gHeapAllocations - startAllocations ) / countedFrames, countedFrames );
     }
 
     close();
@@ -1,10 +1,21 @@
 #include <stdio.h>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AUDIO_SSE2 1
+#endif
+
 // Constantes de la pantalla
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
@@ -12,11 +23,17 @@ const int SCREEN_HEIGHT = 480;
 // Numero de dispositivos de grabación soportados
 const int MAX_RECORDING_DEVICES = 10;
 
-// Tiempo máximo de grabado
-const int MAX_RECORDING_SECONDS = 5;
+// Segundos de audio que caben en el buffer circular de captura
+const int RING_BUFFER_SECONDS = 2;
+
+// Archivo donde se graba el audio, en el directorio de trabajo y no en romfs/
+const char* RECORDING_FILE = "recording.wav";
+
+// Archivo temporal de la prueba de estrés, para no pisar la grabación
+const char* STRESS_RECORDING_FILE = "recording.stress.wav";
 
-// Tiempo máximo de grabado más padding
-const int RECORDING_BUFFER_SECONDS = MAX_RECORDING_SECONDS + 1;
+// Milisegundos de audio leídos por adelantado al reproducir
+const int PLAYBACK_PREFETCH_MS = 500;
 
 // Varias acciones de grabado que se pueden manejar
 enum RecordingState
@@ -78,6 +95,499 @@ class LTexture {
         int mHeight;
 };
 
+// Buffer circular sin bloqueos entre un único productor y un único
+// consumidor. Cada índice lo escribe un solo hilo y vive en su propia línea
+// de caché, así el callback de audio nunca espera al hilo principal
+class LRingBuffer {
+    public:
+        // Tamaño de línea de caché para separar los índices
+        static const int CACHE_LINE = 64;
+
+        // Inicializa las variables
+        LRingBuffer();
+
+        // Libera la memoria
+        ~LRingBuffer();
+
+        // Reserva el buffer redondeando la capacidad a potencia de dos. Sólo
+        // se llama sin productor ni consumidor activos
+        bool allocate( Uint32 capacity );
+
+        // Vacía el buffer; mismas condiciones que allocate
+        void reset();
+
+        // Libera el buffer
+        void free();
+
+        // Productor: escribe el bloque entero o lo descarta y cuenta un desborde
+        bool write( const Uint8* data, Uint32 length );
+
+        // Consumidor: lee hasta length bytes y devuelve los leídos
+        Uint32 read( Uint8* data, Uint32 length );
+
+        // Bytes pendientes de leer y espacio libre
+        Uint32 getReadable();
+        Uint32 getWritable();
+
+        Uint32 getCapacity();
+
+        // Bloques descartados por falta de espacio
+        int getOverruns();
+
+    private:
+        Uint8* mBuffer;
+        Uint32 mCapacity;
+        Uint32 mMask;
+
+        // Lado del productor
+        alignas( CACHE_LINE ) std::atomic<Uint32> mWrite;
+        std::atomic<int> mOverruns;
+
+        // Lado del consumidor
+        alignas( CACHE_LINE ) std::atomic<Uint32> mRead;
+        char mPadding[ CACHE_LINE - sizeof( std::atomic<Uint32> ) ];
+};
+
+// Políticas de sincronización del archivo con el disco
+enum WavSyncPolicy
+{
+    WAV_SYNC_NONE,
+    WAV_SYNC_ON_CLOSE,
+    WAV_SYNC_PERIODIC
+};
+
+// Codificación del audio dentro del WAV
+enum WavCodec
+{
+    WAV_CODEC_PCM,
+    WAV_CODEC_IMA_ADPCM
+};
+
+// IMA-ADPCM con el formato de bloques de WAV: 4 bits por muestra, cada
+// bloque empieza con el valor y el índice de paso de cada canal, así que
+// se puede decodificar sin el resto del archivo
+class LAdpcmCodec {
+    public:
+        // Bytes de cada bloque por canal y canales soportados
+        static const int BLOCK_BYTES_PER_CHANNEL = 512;
+        static const int MAX_CHANNELS = 8;
+
+        // Inicializa los índices de paso
+        LAdpcmCodec();
+
+        // Vuelve al estado inicial antes de otra grabación
+        void reset();
+
+        // Bytes por bloque y frames que contiene
+        static int getBlockAlign( int channels );
+        static int getFramesPerBlock( int blockAlign, int channels );
+
+        // Codifica un bloque completo de muestras intercaladas de 16 bits
+        void encodeBlock( const Sint16* samples, int channels, Uint8* block );
+
+        // Decodifica un bloque completo de blockAlign bytes a muestras
+        // intercaladas de 16 bits
+        static void decodeBlock( const Uint8* block, int blockAlign, int channels, Sint16* samples );
+
+        // Convierte entre el formato del dispositivo y 16 bits con signo en
+        // el orden de bytes de la máquina
+        static void toS16( const Uint8* data, SDL_AudioFormat format, int values, Sint16* samples );
+        static void fromS16( const Sint16* samples, int values, SDL_AudioFormat format, Uint8* data );
+
+    private:
+        // Avanza el predictor con un código de 4 bits
+        static void step( Uint8 code, int& predictor, int& index );
+
+        // Índice de paso de cada canal, sigue de un bloque al siguiente
+        int mIndex[ MAX_CHANNELS ];
+};
+
+// Calidad del remuestreo: más coeficientes por fase filtran mejor y cuestan
+// más
+enum ResampleQuality
+{
+    RESAMPLE_FAST,
+    RESAMPLE_MEDIUM,
+    RESAMPLE_HIGH,
+    RESAMPLE_BEST
+};
+
+// Convierte audio de un formato a otro: tipo de muestra, canales y
+// frecuencia. El remuestreo es polifásico con sinc enventanada por Kaiser y
+// remuestrea con el menor número de canales de los dos formatos. Toda la
+// memoria se reserva al configurar, así que convertir bloque a bloque no
+// reserva nada
+class LAudioConverter {
+    public:
+        // Frames de entrada por llamada, fases de la tabla y canales soportados
+        static const int MAX_BLOCK_FRAMES = 4096;
+        static const int PHASES = 256;
+        static const int MAX_CHANNELS = 8;
+
+        // Inicializa las variables
+        LAudioConverter();
+
+        // Calcula los coeficientes y reserva los buffers; empieza un flujo nuevo
+        bool configure( const SDL_AudioSpec& input, const SDL_AudioSpec& output, ResampleQuality quality );
+
+        // Empieza un flujo nuevo con la misma configuración
+        void reset();
+
+        // Frames de salida que pueden salir como máximo de inFrames de entrada
+        int getMaxOutputFrames( int inFrames );
+
+        // Convierte hasta MAX_BLOCK_FRAMES frames; devuelve los frames escritos
+        int process( const Uint8* input, int inFrames, Uint8* output );
+
+        // Al final del flujo saca lo que queda dentro del filtro
+        int flush( Uint8* output );
+
+        // Coeficientes por fase de la calidad configurada
+        int getTaps();
+
+        // Usa o no la versión vectorial
+        void setSimd( bool simd );
+
+        // Pasa muestras intercaladas de cualquier formato soportado a
+        // flotantes y al revés, saturando
+        static void toFloat( const Uint8* data, SDL_AudioFormat format, int values, float* samples );
+        static void fromFloat( const float* samples, int values, SDL_AudioFormat format, Uint8* data );
+
+    private:
+        // Remuestrea la historia de cada canal hacia mResampled
+        int resample();
+
+        // Reparte los canales remuestreados a los de salida y los convierte
+        void writeOutput( const float* planar, int stride, int frames, Uint8* output );
+
+        // Núcleo interpolado entre dos fases y producto punto con la historia
+        static void interpolateScalar( const float* a, const float* b, float weight, int taps, float* kernel );
+        static float dotScalar( const float* x, const float* kernel, int taps );
+#if defined(AUDIO_SSE2)
+        static void interpolateSSE2( const float* a, const float* b, float weight, int taps, float* kernel );
+        static float dotSSE2( const float* x, const float* kernel, int taps );
+#endif
+
+        // Formatos y canales con los que se remuestrea
+        SDL_AudioSpec mInput;
+        SDL_AudioSpec mOutput;
+        int mChannels;
+        bool mResample;
+        bool mSimd;
+
+        // PHASES + 1 filas de mTaps coeficientes; la última corresponde a un
+        // frame entero y permite interpolar sin comprobar el borde
+        int mTaps;
+        std::vector<float> mCoefficients;
+        std::vector<float> mKernel;
+
+        // Paso entre frames de salida medido en frames de entrada, como
+        // entero más fracción con denominador mOutput.freq, y posición del
+        // siguiente frame de salida dentro de la historia
+        int mStep;
+        int mStepFraction;
+        int mPosition;
+        int mFraction;
+
+        // Historia de cada canal, salida remuestreada de cada canal y
+        // muestras intercaladas de entrada y salida
+        std::vector<float> mHistory;
+        int mHistoryCapacity;
+        int mAvailable;
+        std::vector<float> mResampled;
+        int mResampledCapacity;
+        std::vector<float> mInterleaved;
+        std::vector<float> mOutputSamples;
+};
+
+// Escribe en un WAV lo que llega a un buffer circular desde un hilo propio.
+// La memoria usada no depende de la duración y el callback de audio nunca
+// espera al disco
+class LWavWriter {
+    public:
+        // Tamaño de cada escritura y espera entre sondeos del buffer
+        static const Uint32 BATCH_BYTES = 64 * 1024;
+        static const int POLL_MS = 10;
+
+        // Segundos de audio entre sincronizaciones con WAV_SYNC_PERIODIC
+        static const int SYNC_SECONDS = 1;
+
+        // Inicializa las variables
+        LWavWriter();
+
+        // Cierra el archivo si sigue abierto
+        ~LWavWriter();
+
+        // Crea el archivo y arranca el hilo que consume el buffer circular.
+        // Con IMA-ADPCM el hilo comprime cada bloque antes de escribirlo
+        bool open( std::string path, const SDL_AudioSpec& spec, LRingBuffer* ring, WavSyncPolicy policy,
+                WavCodec codec );
+
+        // Vacía el buffer, corrige la cabecera y cierra el archivo. El
+        // productor debe estar detenido
+        void close();
+
+        bool isOpen();
+
+        // Bytes de audio grabados, bytes que ocupan en el archivo y número
+        // de escrituras
+        Uint64 getDataBytes();
+        Uint64 getStoredBytes();
+        int getBatches();
+
+    private:
+        // Hilo escritor
+        static int writerThread( void* data );
+
+        // Escribe un lote y sincroniza según la política
+        void writeBatch( Uint32 length );
+
+        // Pasa un lote PCM al formato de WAV: 8 bits sin signo y el resto con
+        // signo en little endian
+        void toWavLayout( Uint8* data, Uint32 length );
+
+        // Pasa el lote a 16 bits y comprime cada bloque que se completa en
+        // mEncoded; devuelve los bytes comprimidos
+        Uint32 encodeBatch( Uint32 length );
+
+        // Comprime el último bloque incompleto rellenando con silencio
+        void flushBlock();
+
+        // Escribe la cabecera con los tamaños actuales
+        void writeHeader();
+
+        FILE* mFile;
+        SDL_RWops* mStream;
+        SDL_Thread* mThread;
+        LRingBuffer* mRing;
+        WavSyncPolicy mPolicy;
+
+        // Formato del audio
+        SDL_AudioSpec mSpec;
+        Uint32 mBytesPerSecond;
+        int mFrameBytes;
+        WavCodec mCodec;
+
+        // Lote reservado una sola vez, de frames enteros
+        std::vector<Uint8> mBatch;
+        Uint32 mBatchBytes;
+
+        // Compresión: bloque en curso y bloques listos para escribir
+        LAdpcmCodec mAdpcm;
+        std::vector<Sint16> mBlock;
+        int mBlockFrames;
+        std::vector<Uint8> mEncoded;
+
+        std::atomic<bool> mStop;
+        std::atomic<Uint64> mDataBytes;
+        std::atomic<Uint64> mStoredBytes;
+        std::atomic<int> mBatches;
+        Uint64 mUnsyncedBytes;
+};
+
+// Lee un WAV desde un hilo propio y mantiene lleno un buffer circular con
+// la profundidad de lectura anticipada pedida. Con grabaciones de cualquier
+// duración sólo quedan en memoria el buffer y un lote
+class LWavReader {
+    public:
+        // Tamaño de cada lectura y espera entre sondeos del buffer
+        static const Uint32 BATCH_BYTES = 16 * 1024;
+        static const int POLL_MS = 5;
+
+        // Inicializa las variables
+        LWavReader();
+
+        // Cierra el archivo si sigue abierto
+        ~LWavReader();
+
+        // Abre el archivo, dimensiona el buffer circular para prefetchMs
+        // milisegundos, lo llena y arranca el hilo lector. El hilo decodifica
+        // los archivos comprimidos y convierte el audio al formato de
+        // outputSpec. El consumidor debe estar detenido
+        bool open( std::string path, LRingBuffer* ring, int prefetchMs, const SDL_AudioSpec& outputSpec,
+                ResampleQuality quality );
+
+        // Detiene el hilo y cierra el archivo
+        void close();
+
+        // Formato del audio del archivo, ya decodificado
+        SDL_AudioSpec getSpec();
+
+        // Codificación del archivo
+        WavCodec getCodec();
+
+        // Indica si ya se pasó todo el archivo al buffer
+        bool isFinished();
+
+        // Frames del archivo pasados al buffer y frames totales
+        Uint64 getFrames();
+        Uint64 getTotalFrames();
+
+    private:
+        // Hilo lector
+        static int readerThread( void* data );
+
+        // Lee y convierte el siguiente lote si cabe; devuelve falso si no cabía
+        bool readBatch();
+
+        // Lee y decodifica los bloques que cubren frames frames
+        int decodeBatch( int frames );
+
+        // Busca los bloques fmt, fact y data de la cabecera
+        bool readHeader();
+
+        SDL_RWops* mStream;
+        SDL_Thread* mThread;
+        LRingBuffer* mRing;
+        SDL_AudioSpec mSpec;
+        WavCodec mCodec;
+
+        // Lote reservado una sola vez, de frames enteros
+        std::vector<Uint8> mBatch;
+        int mBatchFrames;
+        int mFrameBytes;
+
+        // Compresión: bytes por bloque, bloques por lote, frames según fact
+        // y los bloques leídos y decodificados
+        int mBlockAlign;
+        int mBlocksPerBatch;
+        Uint64 mFactFrames;
+        std::vector<Uint8> mEncoded;
+        std::vector<Sint16> mDecoded;
+
+        // Conversión al formato de salida y lote convertido, con espacio
+        // para el final del filtro
+        LAudioConverter mConverter;
+        std::vector<Uint8> mOutput;
+        int mOutputFrameBytes;
+
+        Uint64 mTotalFrames;
+        std::atomic<Uint64> mFrames;
+        std::atomic<bool> mStop;
+        std::atomic<bool> mFinished;
+};
+
+// Analiza la captura en un hilo propio: medidor de nivel por canal y
+// espectro con una FFT radix-2. El callback sólo copia el bloque a un buffer
+// circular y el renderizador lee el último resultado publicado, así que
+// ninguno de los dos espera al otro
+class LSpectrumAnalyzer {
+    public:
+        // Puntos de la FFT, bandas dibujadas y muestras nuevas entre análisis
+        static const int FFT_SIZE = 2048;
+        static const int BANDS = 64;
+        static const int HOP = FFT_SIZE / 4;
+
+        // Canales del medidor de nivel y espera entre sondeos del buffer
+        static const int METER_CHANNELS = 2;
+        static const int POLL_MS = 5;
+
+        // Último análisis, con valores de 0 a 1 listos para dibujar
+        struct Result {
+            float bands[ BANDS ];
+            float level[ METER_CHANNELS ];
+            float peak[ METER_CHANNELS ];
+            Uint32 frame;
+        };
+
+        // Inicializa las variables
+        LSpectrumAnalyzer();
+
+        // Detiene el hilo
+        ~LSpectrumAnalyzer();
+
+        // Prepara las tablas para el formato de captura sin arrancar el hilo
+        bool prepare( const SDL_AudioSpec& spec );
+
+        // Prepara y arranca el hilo de análisis
+        bool open( const SDL_AudioSpec& spec );
+
+        // Detiene el hilo y libera el buffer
+        void close();
+
+        // Desde el callback: copia el bloque sin esperar. Si el hilo va
+        // atrasado, o no está abierto, el bloque se descarta
+        void feed( const Uint8* stream, int len );
+
+        // Copia el último resultado publicado; falso si todavía no hay
+        bool getResult( Result& result );
+
+        // Convierte el audio, actualiza el nivel y analiza cada HOP muestras
+        void process( const Uint8* data, Uint32 length );
+
+        // FFT in situ de FFT_SIZE puntos con las partes real e imaginaria
+        // en arreglos separados
+        void transform( float* re, float* im );
+
+        // Usa o no la versión vectorial
+        void setSimd( bool simd );
+
+        // Bloques descartados en feed y análisis no publicados porque el
+        // renderizador leía el buffer
+        int getDropped();
+        int getSkipped();
+
+    private:
+        // Hilo de análisis
+        static int analyzerThread( void* data );
+
+        // Ventana, FFT, bandas y nivel de las últimas muestras
+        void analyze();
+
+        // Escribe el resultado en el buffer libre y lo publica
+        void publish();
+
+        // Mariposas de una etapa con half puntos por grupo
+        static void butterfliesScalar( float* re, float* im, int half, const float* wr, const float* wi );
+#if defined(AUDIO_SSE2)
+        static void butterfliesSSE2( float* re, float* im, int half, const float* wr, const float* wi );
+#endif
+
+        SDL_Thread* mThread;
+        std::atomic<bool> mStop;
+        bool mSimd;
+
+        // Formato de la captura
+        SDL_AudioSpec mSpec;
+        int mFrameBytes;
+
+        // Bloques del callback y lote que lee el hilo
+        LRingBuffer mRing;
+        std::vector<Uint8> mBatch;
+        std::vector<float> mSamples;
+
+        // Últimas FFT_SIZE muestras mono en circular
+        std::vector<float> mHistory;
+        int mHistoryPos;
+        int mPending;
+
+        // Nivel y pico de cada canal desde el último análisis
+        float mSumSquares[ METER_CHANNELS ];
+        float mPeakAbs[ METER_CHANNELS ];
+
+        // Tablas: ventana de Hann, inversión de bits, giros por etapa y
+        // primer bin de cada banda
+        std::vector<float> mWindow;
+        std::vector<int> mBitReverse;
+        std::vector<float> mTwiddleRe;
+        std::vector<float> mTwiddleIm;
+        int mBandStart[ BANDS + 1 ];
+
+        // Trabajo de la FFT
+        std::vector<float> mRe;
+        std::vector<float> mIm;
+
+        // Valores mostrados, caen poco a poco después de cada pico
+        Result mDisplay;
+
+        // Doble buffer del resultado: el hilo escribe en el que no está
+        // publicado y no lo toca si el renderizador lo está leyendo
+        Result mResults[ 2 ];
+        std::atomic<int> mFront;
+        std::atomic<int> mReading;
+        std::atomic<int> mSkipped;
+};
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -91,6 +601,28 @@ void close();
 void audioRecordingCallback( void* userdata, Uint8* stream, int len );
 void audioPlaybackCallback( void* userdaa, Uint8* stream, int len );
 
+// Indica si el formato es uno de los de SDL: 8 bits con o sin signo, 16 bits
+// con o sin signo, 32 bits con signo o float, en cualquier orden de bytes
+bool isSampleFormatSupported( SDL_AudioFormat format );
+
+// Prueba de estrés del buffer circular con el driver de audio dummy
+int stressRingBuffer( int seconds );
+
+// Calcula los rectángulos del espectro y del medidor; devuelve cuántos son
+int layoutSpectrum( const LSpectrumAnalyzer::Result& result, SDL_Rect* rects );
+
+// Dibuja el espectro y el medidor de nivel
+void renderSpectrum( const LSpectrumAnalyzer::Result& result );
+
+// Comprueba la FFT y mide el costo del análisis y del dibujo por frame
+int benchmarkSpectrum();
+
+// Mide la compresión, la calidad y la velocidad de IMA-ADPCM
+int benchmarkAdpcm();
+
+// Comprueba el conversor y mide las muestras por segundo de cada calidad
+int benchmarkResample();
+
 // Ventana donde se renderizará
 SDL_Window* gWindow = NULL;
 
@@ -114,17 +646,38 @@ int gRecordingDeviceCount = 0;
 SDL_AudioSpec gReceivedRecordingSpec;
 SDL_AudioSpec gReceivedPlaybackSpec;
 
-// Recording data buffer
-Uint8* gRecordingBuffer = NULL;
+// Dispositivos de audio abiertos, close() los cierra antes de liberar lo que
+// usan sus callbacks
+SDL_AudioDeviceID gRecordingDeviceId = 0;
+SDL_AudioDeviceID gPlaybackDeviceId = 0;
+
+// Buffers circulares entre los callbacks de audio y el hilo principal
+LRingBuffer gCaptureRing;
+LRingBuffer gPlaybackRing;
+
+// Escritor de la grabación a disco
+LWavWriter gWavWriter;
+
+// Lector de la grabación para reproducirla
+LWavReader gWavReader;
+
+// Espectro y nivel de la captura
+LSpectrumAnalyzer gSpectrum;
+
+// Veces que la reproducción se quedó sin datos antes del final
+std::atomic<int> gPlaybackUnderruns( 0 );
 
-// Tamaño del buffer de datos
-Uint32 gBufferByteSize = 0;
+// Bytes por segundo del audio grabado
+int gBytesPerSecond = 0;
 
-// Posición del buffer de datos
-Uint32 gBufferBytePosition = 0;
+// Codificación de la próxima grabación, la tecla 3 la cambia
+WavCodec gCaptureCodec = WAV_CODEC_PCM;
 
-// Posición máxima del buffer de datos para la grabación
-Uint32 gBufferByteMaxPosition = 0;
+// Calidad de la conversión de la grabación al formato de reproducción
+const ResampleQuality PLAYBACK_QUALITY = RESAMPLE_HIGH;
+
+// Estado de la grabación: duración y desbordes
+LTexture gStatusTexture;
 
 LTexture::LTexture() {
     // Inicializa la textura
@@ -233,35 +786,1614 @@ void LTexture::free() {
     }
 }
 
-void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip ) {
-    // Espacio para renderizar y el render en pantalla
-    SDL_Rect renderQuad = { x, y, mWidth, mHeight };
+void LTexture::render( int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip ) {
+    // Espacio para renderizar y el render en pantalla
+    SDL_Rect renderQuad = { x, y, mWidth, mHeight };
+
+    // Establece las dimensiones del clip rendering
+    if( clip != NULL ) {
+        renderQuad.w = clip->w;
+        renderQuad.h = clip->h;
+    }
+    // Render to screen, similar a RenderCopy pero con argumentos extra para girar y rotar
+    SDL_RenderCopyEx( gRenderer, mTexture, clip, &renderQuad, angle, center, flip );
+
+}
+
+int LTexture::getWidth() {
+    return mWidth;
+}
+
+int LTexture::getHeight() {
+    return mHeight;
+}
+
+void LTexture::setWidth( int w ) {
+    mWidth = w;
+}
+
+void LTexture::setHeight( int h ) {
+    mHeight = h;
+}
+
+LRingBuffer::LRingBuffer() {
+    // Inicializa las variables
+    mBuffer = NULL;
+    mCapacity = 0;
+    mMask = 0;
+    mWrite = 0;
+    mOverruns = 0;
+    mRead = 0;
+}
+
+LRingBuffer::~LRingBuffer() {
+    // Libera la memoria
+    free();
+}
+
+bool LRingBuffer::allocate( Uint32 capacity ) {
+    free();
+
+    // Con potencia de dos la posición es el índice enmascarado, y los índices
+    // pueden crecer sin límite y desbordar sin romper la resta
+    Uint32 size = 1;
+    while( size < capacity && size < 0x80000000 ) {
+        size <<= 1;
+    }
+    mBuffer = new Uint8[ size ];
+    mCapacity = size;
+    mMask = size - 1;
+    reset();
+    return true;
+}
+
+void LRingBuffer::reset() {
+    mWrite.store( 0, std::memory_order_relaxed );
+    mRead.store( 0, std::memory_order_relaxed );
+    mOverruns.store( 0, std::memory_order_relaxed );
+}
+
+void LRingBuffer::free() {
+    if( mBuffer != NULL ) {
+        delete[] mBuffer;
+        mBuffer = NULL;
+    }
+    mCapacity = 0;
+    mMask = 0;
+}
+
+bool LRingBuffer::write( const Uint8* data, Uint32 length ) {
+    Uint32 write = mWrite.load( std::memory_order_relaxed );
+    Uint32 read = mRead.load( std::memory_order_acquire );
+
+    // Sin espacio se descarta el bloque completo para no partir muestras
+    if( mCapacity - ( write - read ) < length ) {
+        mOverruns.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+    }
+
+    // Copia en uno o dos tramos según dé la vuelta al final
+    Uint32 offset = write & mMask;
+    Uint32 first = mCapacity - offset < length ? mCapacity - offset : length;
+    memcpy( mBuffer + offset, data, first );
+    memcpy( mBuffer, data + first, length - first );
+
+    // Publica los datos al consumidor
+    mWrite.store( write + length, std::memory_order_release );
+    return true;
+}
+
+Uint32 LRingBuffer::read( Uint8* data, Uint32 length ) {
+    Uint32 read = mRead.load( std::memory_order_relaxed );
+    Uint32 write = mWrite.load( std::memory_order_acquire );
+
+    Uint32 available = write - read;
+    if( length > available ) {
+        length = available;
+    }
+
+    Uint32 offset = read & mMask;
+    Uint32 first = mCapacity - offset < length ? mCapacity - offset : length;
+    memcpy( data, mBuffer + offset, first );
+    memcpy( data + first, mBuffer, length - first );
+
+    // Devuelve el espacio al productor
+    mRead.store( read + length, std::memory_order_release );
+    return length;
+}
+
+Uint32 LRingBuffer::getReadable() {
+    return mWrite.load( std::memory_order_acquire ) - mRead.load( std::memory_order_acquire );
+}
+
+Uint32 LRingBuffer::getWritable() {
+    return mCapacity - getReadable();
+}
+
+Uint32 LRingBuffer::getCapacity() {
+    return mCapacity;
+}
+
+int LRingBuffer::getOverruns() {
+    return mOverruns.load( std::memory_order_relaxed );
+}
+
+// Tablas estándar de IMA-ADPCM: tamaño de paso por índice y cambio de
+// índice según la magnitud del código
+static const int ADPCM_STEPS[ 89 ] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+static const int ADPCM_INDEX_CHANGES[ 8 ] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+bool isSampleFormatSupported( SDL_AudioFormat format ) {
+    switch( format ) {
+        case AUDIO_U8:
+        case AUDIO_S8:
+        case AUDIO_U16LSB:
+        case AUDIO_U16MSB:
+        case AUDIO_S16LSB:
+        case AUDIO_S16MSB:
+        case AUDIO_S32LSB:
+        case AUDIO_S32MSB:
+        case AUDIO_F32LSB:
+        case AUDIO_F32MSB:
+            return true;
+        default:
+            return false;
+    }
+}
+
+LAdpcmCodec::LAdpcmCodec() {
+    reset();
+}
+
+void LAdpcmCodec::reset() {
+    memset( mIndex, 0, sizeof( mIndex ) );
+}
+
+int LAdpcmCodec::getBlockAlign( int channels ) {
+    return BLOCK_BYTES_PER_CHANNEL * channels;
+}
+
+int LAdpcmCodec::getFramesPerBlock( int blockAlign, int channels ) {
+    // El primer frame va en la cabecera de 4 bytes por canal, el resto a
+    // dos muestras por byte
+    return ( blockAlign - 4 * channels ) * 2 / channels + 1;
+}
+
+void LAdpcmCodec::step( Uint8 code, int& predictor, int& index ) {
+    int stepSize = ADPCM_STEPS[ index ];
+    int difference = stepSize >> 3;
+    if( code & 4 ) {
+        difference += stepSize;
+    }
+    if( code & 2 ) {
+        difference += stepSize >> 1;
+    }
+    if( code & 1 ) {
+        difference += stepSize >> 2;
+    }
+    predictor += ( code & 8 ) ? -difference : difference;
+    predictor = predictor < -32768 ? -32768 : ( predictor > 32767 ? 32767 : predictor );
+
+    index += ADPCM_INDEX_CHANGES[ code & 7 ];
+    index = index < 0 ? 0 : ( index > 88 ? 88 : index );
+}
+
+void LAdpcmCodec::encodeBlock( const Sint16* samples, int channels, Uint8* block ) {
+    int blockAlign = getBlockAlign( channels );
+    int frames = getFramesPerBlock( blockAlign, channels );
+    int predictor[ MAX_CHANNELS ];
+
+    // Cabecera: el primer frame sin comprimir y el índice de cada canal
+    for( int c = 0; c < channels; ++c ) {
+        predictor[ c ] = samples[ c ];
+        block[ 4 * c ] = samples[ c ] & 0xFF;
+        block[ 4 * c + 1 ] = ( samples[ c ] >> 8 ) & 0xFF;
+        block[ 4 * c + 2 ] = mIndex[ c ];
+        block[ 4 * c + 3 ] = 0;
+    }
+
+    // Grupos de 8 frames: 4 bytes de cada canal por turno, primero el
+    // nibble bajo
+    Uint8* out = block + 4 * channels;
+    for( int group = 1; group < frames; group += 8 ) {
+        for( int c = 0; c < channels; ++c ) {
+            for( int i = 0; i < 8; ++i ) {
+                int difference = samples[ ( group + i ) * channels + c ] - predictor[ c ];
+                int stepSize = ADPCM_STEPS[ mIndex[ c ] ];
+                Uint8 code = 0;
+                if( difference < 0 ) {
+                    code = 8;
+                    difference = -difference;
+                }
+                if( difference >= stepSize ) {
+                    code |= 4;
+                    difference -= stepSize;
+                }
+                if( difference >= stepSize >> 1 ) {
+                    code |= 2;
+                    difference -= stepSize >> 1;
+                }
+                if( difference >= stepSize >> 2 ) {
+                    code |= 1;
+                }
+
+                // El codificador sigue al decodificador para no acumular error
+                step( code, predictor[ c ], mIndex[ c ] );
+                if( i & 1 ) {
+                    out[ i / 2 ] |= code << 4;
+                } else {
+                    out[ i / 2 ] = code;
+                }
+            }
+            out += 4;
+        }
+    }
+}
+
+void LAdpcmCodec::decodeBlock( const Uint8* block, int blockAlign, int channels, Sint16* samples ) {
+    int frames = getFramesPerBlock( blockAlign, channels );
+    int predictor[ MAX_CHANNELS ];
+    int index[ MAX_CHANNELS ];
+
+    for( int c = 0; c < channels; ++c ) {
+        predictor[ c ] = (Sint16)( block[ 4 * c ] | ( block[ 4 * c + 1 ] << 8 ) );
+        index[ c ] = block[ 4 * c + 2 ] > 88 ? 88 : block[ 4 * c + 2 ];
+        samples[ c ] = predictor[ c ];
+    }
+
+    const Uint8* in = block + 4 * channels;
+    for( int group = 1; group < frames; group += 8 ) {
+        for( int c = 0; c < channels; ++c ) {
+            for( int i = 0; i < 8; ++i ) {
+                Uint8 code = ( i & 1 ) ? in[ i / 2 ] >> 4 : in[ i / 2 ] & 0x0F;
+                step( code, predictor[ c ], index[ c ] );
+                samples[ ( group + i ) * channels + c ] = predictor[ c ];
+            }
+            in += 4;
+        }
+    }
+}
+
+void LAdpcmCodec::toS16( const Uint8* data, SDL_AudioFormat format, int values, Sint16* samples ) {
+    // Los formatos del otro orden de bytes se invierten al leerlos, y los de
+    // 16 bits sin signo se centran invirtiendo el bit más alto
+    bool swap = SDL_AUDIO_ISBIGENDIAN( format ) != ( SDL_BYTEORDER == SDL_BIG_ENDIAN );
+    int bits = SDL_AUDIO_BITSIZE( format );
+    if( SDL_AUDIO_ISFLOAT( format ) ) {
+        const float* in = (const float*)data;
+        for( int i = 0; i < values; ++i ) {
+            float value = ( swap ? SDL_SwapFloat( in[ i ] ) : in[ i ] ) * 32767.0f;
+            value = value < -32768.0f ? -32768.0f : ( value > 32767.0f ? 32767.0f : value );
+            samples[ i ] = (Sint16)lrintf( value );
+        }
+    } else if( bits == 32 ) {
+        const Sint32* in = (const Sint32*)data;
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = (Sint16)( ( swap ? (Sint32)SDL_Swap32( in[ i ] ) : in[ i ] ) >> 16 );
+        }
+    } else if( bits == 16 && !swap && SDL_AUDIO_ISSIGNED( format ) ) {
+        memcpy( samples, data, values * sizeof( Sint16 ) );
+    } else if( bits == 16 ) {
+        const Uint16* in = (const Uint16*)data;
+        Uint16 flip = SDL_AUDIO_ISSIGNED( format ) ? 0 : 0x8000;
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = (Sint16)( ( swap ? SDL_Swap16( in[ i ] ) : in[ i ] ) ^ flip );
+        }
+    } else if( SDL_AUDIO_ISSIGNED( format ) ) {
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = (Sint16)( ( (const Sint8*)data )[ i ] * 256 );
+        }
+    } else {
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = (Sint16)( ( data[ i ] - 128 ) * 256 );
+        }
+    }
+}
+
+void LAdpcmCodec::fromS16( const Sint16* samples, int values, SDL_AudioFormat format, Uint8* data ) {
+    bool swap = SDL_AUDIO_ISBIGENDIAN( format ) != ( SDL_BYTEORDER == SDL_BIG_ENDIAN );
+    int bits = SDL_AUDIO_BITSIZE( format );
+    if( SDL_AUDIO_ISFLOAT( format ) ) {
+        float* out = (float*)data;
+        for( int i = 0; i < values; ++i ) {
+            float value = samples[ i ] / 32768.0f;
+            out[ i ] = swap ? SDL_SwapFloat( value ) : value;
+        }
+    } else if( bits == 32 ) {
+        Sint32* out = (Sint32*)data;
+        for( int i = 0; i < values; ++i ) {
+            Sint32 value = (Sint32)samples[ i ] * 65536;
+            out[ i ] = swap ? (Sint32)SDL_Swap32( value ) : value;
+        }
+    } else if( bits == 16 && !swap && SDL_AUDIO_ISSIGNED( format ) ) {
+        memcpy( data, samples, values * sizeof( Sint16 ) );
+    } else if( bits == 16 ) {
+        Uint16* out = (Uint16*)data;
+        Uint16 flip = SDL_AUDIO_ISSIGNED( format ) ? 0 : 0x8000;
+        for( int i = 0; i < values; ++i ) {
+            Uint16 value = (Uint16)samples[ i ] ^ flip;
+            out[ i ] = swap ? SDL_Swap16( value ) : value;
+        }
+    } else if( SDL_AUDIO_ISSIGNED( format ) ) {
+        for( int i = 0; i < values; ++i ) {
+            ( (Sint8*)data )[ i ] = samples[ i ] >> 8;
+        }
+    } else {
+        for( int i = 0; i < values; ++i ) {
+            data[ i ] = ( samples[ i ] >> 8 ) + 128;
+        }
+    }
+}
+
+// Coeficientes por fase, beta de la ventana de Kaiser y fracción de la banda
+// de Nyquist que se deja pasar en cada calidad de remuestreo
+static const int RESAMPLE_TAPS[ 4 ] = { 8, 16, 32, 64 };
+static const double RESAMPLE_BETA[ 4 ] = { 4.0, 6.0, 8.0, 10.0 };
+static const double RESAMPLE_ROLLOFF[ 4 ] = { 0.75, 0.85, 0.90, 0.94 };
+
+// Ventana de Kaiser en x de -1 a 1, con I0 por su serie de potencias
+static double kaiserWindow( double x, double beta ) {
+    double values[ 2 ] = { beta * sqrt( 1.0 - ( x * x < 1.0 ? x * x : 1.0 ) ), beta };
+    double bessel[ 2 ];
+    for( int v = 0; v < 2; ++v ) {
+        double sum = 1.0;
+        double term = 1.0;
+        for( int k = 1; term > 1e-12 * sum; ++k ) {
+            double factor = values[ v ] / ( 2.0 * k );
+            term *= factor * factor;
+            sum += term;
+        }
+        bessel[ v ] = sum;
+    }
+    return bessel[ 0 ] / bessel[ 1 ];
+}
+
+LAudioConverter::LAudioConverter() {
+    // Inicializa las variables
+    SDL_zero( mInput );
+    SDL_zero( mOutput );
+    mChannels = 0;
+    mResample = false;
+    mSimd = true;
+    mTaps = 0;
+    mStep = 0;
+    mStepFraction = 0;
+    mPosition = 0;
+    mFraction = 0;
+    mHistoryCapacity = 0;
+    mAvailable = 0;
+    mResampledCapacity = 0;
+}
+
+bool LAudioConverter::configure( const SDL_AudioSpec& input, const SDL_AudioSpec& output, ResampleQuality quality ) {
+    if( input.channels < 1 || input.channels > MAX_CHANNELS || output.channels < 1 || output.channels > MAX_CHANNELS
+            || input.freq <= 0 || output.freq <= 0 ) {
+        printf( "Conversión de %d canales a %d Hz a %d canales a %d Hz no soportada!\n",
+                input.channels, input.freq, output.channels, output.freq );
+        return false;
+    }
+    if( !isSampleFormatSupported( input.format ) || !isSampleFormatSupported( output.format ) ) {
+        printf( "Conversión del formato 0x%04x al 0x%04x no soportada!\n", input.format, output.format );
+        return false;
+    }
+
+    mInput = input;
+    mOutput = output;
+    mChannels = input.channels < output.channels ? input.channels : output.channels;
+    mResample = input.freq != output.freq;
+    mTaps = RESAMPLE_TAPS[ quality ];
+    mStep = input.freq / output.freq;
+    mStepFraction = input.freq % output.freq;
+
+    // Fila p: sinc centrada a p / PHASES de frame después del centro de la
+    // historia. Al bajar la frecuencia el corte baja con ella para no crear
+    // alias, y cada fila suma 1 para no cambiar el volumen
+    double cutoff = 0.5 * RESAMPLE_ROLLOFF[ quality ];
+    if( output.freq < input.freq ) {
+        cutoff *= (double)output.freq / input.freq;
+    }
+    int half = mTaps / 2;
+    mCoefficients.resize( ( PHASES + 1 ) * mTaps );
+    for( int p = 0; p <= PHASES; ++p ) {
+        float* row = &mCoefficients[ p * mTaps ];
+        double sum = 0.0;
+        for( int k = 0; k < mTaps; ++k ) {
+            double x = k - ( half - 1 ) - (double)p / PHASES;
+            double y = 2.0 * cutoff * x;
+            double sinc = y == 0.0 ? 1.0 : sin( M_PI * y ) / ( M_PI * y );
+            double value = 2.0 * cutoff * sinc * kaiserWindow( x / half, RESAMPLE_BETA[ quality ] );
+            row[ k ] = value;
+            sum += value;
+        }
+        for( int k = 0; k < mTaps; ++k ) {
+            row[ k ] /= sum;
+        }
+    }
+    mKernel.resize( mTaps );
+
+    // La historia guarda menos de mTaps frames entre llamadas
+    mHistoryCapacity = mTaps + MAX_BLOCK_FRAMES;
+    mHistory.resize( mChannels * mHistoryCapacity );
+    mResampledCapacity = getMaxOutputFrames( MAX_BLOCK_FRAMES );
+    mResampled.resize( mChannels * mResampledCapacity );
+    mInterleaved.resize( MAX_BLOCK_FRAMES * input.channels );
+    mOutputSamples.resize( mResampledCapacity * output.channels );
+
+    reset();
+    return true;
+}
+
+void LAudioConverter::reset() {
+    // Silencio antes del primer frame para que quede en el centro del filtro
+    mPosition = 0;
+    mFraction = 0;
+    mAvailable = mResample ? mTaps / 2 - 1 : 0;
+    std::fill( mHistory.begin(), mHistory.end(), 0.0f );
+}
+
+int LAudioConverter::getMaxOutputFrames( int inFrames ) {
+    if( !mResample ) {
+        return inFrames;
+    }
+    return (int)( (Uint64)( inFrames + mTaps ) * mOutput.freq / mInput.freq ) + 2;
+}
+
+int LAudioConverter::process( const Uint8* input, int inFrames, Uint8* output ) {
+    int inChannels = mInput.channels;
+    toFloat( input, mInput.format, inFrames * inChannels, mInterleaved.data() );
+
+    // Separa los canales; si sobran, cada canal promedia los de entrada que
+    // le tocan alternando: estéreo a mono promedia izquierda y derecha
+    for( int c = 0; c < mChannels; ++c ) {
+        float* history = &mHistory[ c * mHistoryCapacity + mAvailable ];
+        float scale = 1.0f / ( ( inChannels - c + mChannels - 1 ) / mChannels );
+        for( int i = 0; i < inFrames; ++i ) {
+            const float* frame = &mInterleaved[ i * inChannels ];
+            float sum = 0.0f;
+            for( int j = c; j < inChannels; j += mChannels ) {
+                sum += frame[ j ];
+            }
+            history[ i ] = sum * scale;
+        }
+    }
+    mAvailable += inFrames;
+
+    // Con la misma frecuencia la historia pasa directo a la salida
+    if( !mResample ) {
+        int frames = mAvailable;
+        writeOutput( mHistory.data(), mHistoryCapacity, frames, output );
+        mAvailable = 0;
+        return frames;
+    }
+
+    int frames = resample();
+    writeOutput( mResampled.data(), mResampledCapacity, frames, output );
+    return frames;
+}
+
+int LAudioConverter::flush( Uint8* output ) {
+    if( !mResample ) {
+        return 0;
+    }
+
+    // Silencio hasta que el último frame llega al centro del filtro
+    for( int c = 0; c < mChannels; ++c ) {
+        float* history = &mHistory[ c * mHistoryCapacity + mAvailable ];
+        std::fill( history, history + mTaps / 2, 0.0f );
+    }
+    mAvailable += mTaps / 2;
+
+    int frames = resample();
+    writeOutput( mResampled.data(), mResampledCapacity, frames, output );
+    return frames;
+}
+
+int LAudioConverter::getTaps() {
+    return mTaps;
+}
+
+void LAudioConverter::setSimd( bool simd ) {
+    mSimd = simd;
+}
+
+int LAudioConverter::resample() {
+#if defined(AUDIO_SSE2)
+    static bool hasSSE2 = __builtin_cpu_supports( "sse2" );
+    bool simd = mSimd && hasSSE2;
+#endif
+
+    int frames = 0;
+    while( mPosition + mTaps <= mAvailable ) {
+        // Núcleo de la fracción actual, interpolado entre las dos fases
+        // vecinas y compartido por todos los canales
+        double phase = (double)mFraction * PHASES / mOutput.freq;
+        int row = (int)phase;
+        float weight = phase - row;
+        const float* a = &mCoefficients[ row * mTaps ];
+        const float* b = a + mTaps;
+#if defined(AUDIO_SSE2)
+        if( simd ) {
+            interpolateSSE2( a, b, weight, mTaps, mKernel.data() );
+            for( int c = 0; c < mChannels; ++c ) {
+                mResampled[ c * mResampledCapacity + frames ] =
+                    dotSSE2( &mHistory[ c * mHistoryCapacity + mPosition ], mKernel.data(), mTaps );
+            }
+        } else
+#endif
+        {
+            interpolateScalar( a, b, weight, mTaps, mKernel.data() );
+            for( int c = 0; c < mChannels; ++c ) {
+                mResampled[ c * mResampledCapacity + frames ] =
+                    dotScalar( &mHistory[ c * mHistoryCapacity + mPosition ], mKernel.data(), mTaps );
+            }
+        }
+        ++frames;
+
+        // Avanza sin acumular error: la fracción es exacta
+        mPosition += mStep;
+        mFraction += mStepFraction;
+        if( mFraction >= mOutput.freq ) {
+            mFraction -= mOutput.freq;
+            ++mPosition;
+        }
+    }
+
+    // Descarta la historia que ya no usará ningún frame de salida; al bajar
+    // la frecuencia la posición puede pasar del final
+    if( mPosition >= mAvailable ) {
+        mPosition -= mAvailable;
+        mAvailable = 0;
+    } else {
+        for( int c = 0; c < mChannels; ++c ) {
+            float* history = &mHistory[ c * mHistoryCapacity ];
+            memmove( history, history + mPosition, ( mAvailable - mPosition ) * sizeof( float ) );
+        }
+        mAvailable -= mPosition;
+        mPosition = 0;
+    }
+    return frames;
+}
+
+void LAudioConverter::writeOutput( const float* planar, int stride, int frames, Uint8* output ) {
+    // Si sobran canales de salida se repiten los remuestreados: mono va a
+    // todos y estéreo alterna izquierda y derecha
+    int outChannels = mOutput.channels;
+    for( int c = 0; c < outChannels; ++c ) {
+        const float* source = planar + ( c % mChannels ) * stride;
+        for( int i = 0; i < frames; ++i ) {
+            mOutputSamples[ i * outChannels + c ] = source[ i ];
+        }
+    }
+    fromFloat( mOutputSamples.data(), frames * outChannels, mOutput.format, output );
+}
+
+void LAudioConverter::toFloat( const Uint8* data, SDL_AudioFormat format, int values, float* samples ) {
+    // Los formatos del otro orden de bytes se invierten al leerlos, y los de
+    // 16 bits sin signo se centran invirtiendo el bit más alto
+    bool swap = SDL_AUDIO_ISBIGENDIAN( format ) != ( SDL_BYTEORDER == SDL_BIG_ENDIAN );
+    int bits = SDL_AUDIO_BITSIZE( format );
+    if( SDL_AUDIO_ISFLOAT( format ) && !swap ) {
+        memcpy( samples, data, values * sizeof( float ) );
+    } else if( SDL_AUDIO_ISFLOAT( format ) ) {
+        const float* in = (const float*)data;
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = SDL_SwapFloat( in[ i ] );
+        }
+    } else if( bits == 32 ) {
+        const Sint32* in = (const Sint32*)data;
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = ( swap ? (Sint32)SDL_Swap32( in[ i ] ) : in[ i ] ) / 2147483648.0f;
+        }
+    } else if( bits == 16 && !swap && SDL_AUDIO_ISSIGNED( format ) ) {
+        const Sint16* in = (const Sint16*)data;
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = in[ i ] / 32768.0f;
+        }
+    } else if( bits == 16 ) {
+        const Uint16* in = (const Uint16*)data;
+        Uint16 flip = SDL_AUDIO_ISSIGNED( format ) ? 0 : 0x8000;
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = (Sint16)( ( swap ? SDL_Swap16( in[ i ] ) : in[ i ] ) ^ flip ) / 32768.0f;
+        }
+    } else if( SDL_AUDIO_ISSIGNED( format ) ) {
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = ( (const Sint8*)data )[ i ] / 128.0f;
+        }
+    } else {
+        for( int i = 0; i < values; ++i ) {
+            samples[ i ] = ( data[ i ] - 128 ) / 128.0f;
+        }
+    }
+}
+
+void LAudioConverter::fromFloat( const float* samples, int values, SDL_AudioFormat format, Uint8* data ) {
+    // Misma escala que toFloat, así un formato entero vuelve sin cambios
+    bool swap = SDL_AUDIO_ISBIGENDIAN( format ) != ( SDL_BYTEORDER == SDL_BIG_ENDIAN );
+    int bits = SDL_AUDIO_BITSIZE( format );
+    if( SDL_AUDIO_ISFLOAT( format ) && !swap ) {
+        memcpy( data, samples, values * sizeof( float ) );
+    } else if( SDL_AUDIO_ISFLOAT( format ) ) {
+        float* out = (float*)data;
+        for( int i = 0; i < values; ++i ) {
+            out[ i ] = SDL_SwapFloat( samples[ i ] );
+        }
+    } else if( bits == 32 ) {
+        Sint32* out = (Sint32*)data;
+        for( int i = 0; i < values; ++i ) {
+            double value = samples[ i ] * 2147483648.0;
+            value = value < -2147483648.0 ? -2147483648.0 : ( value > 2147483647.0 ? 2147483647.0 : value );
+            Sint32 sample = (Sint32)lrint( value );
+            out[ i ] = swap ? (Sint32)SDL_Swap32( sample ) : sample;
+        }
+    } else if( bits == 16 ) {
+        Uint16* out = (Uint16*)data;
+        Uint16 flip = SDL_AUDIO_ISSIGNED( format ) ? 0 : 0x8000;
+        for( int i = 0; i < values; ++i ) {
+            float value = samples[ i ] * 32768.0f;
+            value = value < -32768.0f ? -32768.0f : ( value > 32767.0f ? 32767.0f : value );
+            Uint16 sample = (Uint16)(Sint16)lrintf( value ) ^ flip;
+            out[ i ] = swap ? SDL_Swap16( sample ) : sample;
+        }
+    } else {
+        // 8 bits con o sin signo
+        int offset = SDL_AUDIO_ISSIGNED( format ) ? 0 : 128;
+        for( int i = 0; i < values; ++i ) {
+            float value = samples[ i ] * 128.0f;
+            value = value < -128.0f ? -128.0f : ( value > 127.0f ? 127.0f : value );
+            data[ i ] = (Uint8)( lrintf( value ) + offset );
+        }
+    }
+}
+
+void LAudioConverter::interpolateScalar( const float* a, const float* b, float weight, int taps, float* kernel ) {
+    for( int k = 0; k < taps; ++k ) {
+        kernel[ k ] = a[ k ] + weight * ( b[ k ] - a[ k ] );
+    }
+}
+
+float LAudioConverter::dotScalar( const float* x, const float* kernel, int taps ) {
+    float sum = 0.0f;
+    for( int k = 0; k < taps; ++k ) {
+        sum += x[ k ] * kernel[ k ];
+    }
+    return sum;
+}
+
+#if defined(AUDIO_SSE2)
+__attribute__(( target( "sse2" ) ))
+void LAudioConverter::interpolateSSE2( const float* a, const float* b, float weight, int taps, float* kernel ) {
+    // taps es múltiplo de 8 en todas las calidades
+    __m128 w = _mm_set1_ps( weight );
+    for( int k = 0; k < taps; k += 4 ) {
+        __m128 x = _mm_loadu_ps( a + k );
+        __m128 y = _mm_loadu_ps( b + k );
+        _mm_storeu_ps( kernel + k, _mm_add_ps( x, _mm_mul_ps( w, _mm_sub_ps( y, x ) ) ) );
+    }
+}
+
+__attribute__(( target( "sse2" ) ))
+float LAudioConverter::dotSSE2( const float* x, const float* kernel, int taps ) {
+    // Dos acumuladores para no esperar a la suma anterior
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for( int k = 0; k < taps; k += 8 ) {
+        sum0 = _mm_add_ps( sum0, _mm_mul_ps( _mm_loadu_ps( x + k ), _mm_loadu_ps( kernel + k ) ) );
+        sum1 = _mm_add_ps( sum1, _mm_mul_ps( _mm_loadu_ps( x + k + 4 ), _mm_loadu_ps( kernel + k + 4 ) ) );
+    }
+
+    // Suma horizontal de los cuatro carriles
+    __m128 sum = _mm_add_ps( sum0, sum1 );
+    sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+    sum = _mm_add_ss( sum, _mm_shuffle_ps( sum, sum, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+    return _mm_cvtss_f32( sum );
+}
+#endif
+
+LWavWriter::LWavWriter() {
+    // Inicializa las variables
+    mFile = NULL;
+    mStream = NULL;
+    mThread = NULL;
+    mRing = NULL;
+    mPolicy = WAV_SYNC_NONE;
+    SDL_zero( mSpec );
+    mBytesPerSecond = 0;
+    mFrameBytes = 0;
+    mCodec = WAV_CODEC_PCM;
+    mBatchBytes = 0;
+    mBlockFrames = 0;
+    mStop = false;
+    mDataBytes = 0;
+    mStoredBytes = 0;
+    mBatches = 0;
+    mUnsyncedBytes = 0;
+}
+
+LWavWriter::~LWavWriter() {
+    close();
+}
+
+bool LWavWriter::open( std::string path, const SDL_AudioSpec& spec, LRingBuffer* ring, WavSyncPolicy policy,
+        WavCodec codec ) {
+    close();
+
+    if( !isSampleFormatSupported( spec.format ) ) {
+        printf( "Formato de audio 0x%04x no soportado!\n", spec.format );
+        return false;
+    }
+    if( codec == WAV_CODEC_IMA_ADPCM && spec.channels > LAdpcmCodec::MAX_CHANNELS ) {
+        printf( "IMA-ADPCM no soporta %d canales!\n", spec.channels );
+        return false;
+    }
+
+    // Sin buffer de stdio: los lotes ya son grandes y así fsync ve todo
+    mFile = fopen( path.c_str(), "wb" );
+    if( mFile == NULL ) {
+        printf( "No se pudo crear %s!\n", path.c_str() );
+        return false;
+    }
+    setvbuf( mFile, NULL, _IONBF, 0 );
+    mStream = SDL_RWFromFP( mFile, SDL_FALSE );
+    if( mStream == NULL ) {
+        printf( "No se pudo abrir %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+        fclose( mFile );
+        mFile = NULL;
+        return false;
+    }
+
+    mSpec = spec;
+    mFrameBytes = spec.channels * ( SDL_AUDIO_BITSIZE( spec.format ) / 8 );
+    mBytesPerSecond = spec.freq * mFrameBytes;
+    mCodec = codec;
+    mRing = ring;
+    mPolicy = policy;
+
+    // Los lotes son de frames enteros para poder convertirlos
+    mBatchBytes = BATCH_BYTES / mFrameBytes * mFrameBytes;
+    mBatch.resize( mBatchBytes );
+    if( codec == WAV_CODEC_IMA_ADPCM ) {
+        int blockAlign = LAdpcmCodec::getBlockAlign( spec.channels );
+        int framesPerBlock = LAdpcmCodec::getFramesPerBlock( blockAlign, spec.channels );
+        mAdpcm.reset();
+        mBlock.assign( framesPerBlock * spec.channels, 0 );
+        mBlockFrames = 0;
+        mEncoded.resize( ( mBatchBytes / mFrameBytes / framesPerBlock + 1 ) * blockAlign );
+    }
+
+    mStop = false;
+    mDataBytes = 0;
+    mStoredBytes = 0;
+    mBatches = 0;
+    mUnsyncedBytes = 0;
+
+    // Cabecera provisional; los tamaños se corrigen al cerrar
+    writeHeader();
+
+    mThread = SDL_CreateThread( writerThread, "wav writer", this );
+    if( mThread == NULL ) {
+        printf( "No se pudo crear el hilo escritor! SDL Error: %s\n", SDL_GetError() );
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LWavWriter::close() {
+    if( mStream == NULL ) {
+        return;
+    }
+
+    // El hilo termina al vaciar el buffer
+    if( mThread != NULL ) {
+        mStop = true;
+        SDL_WaitThread( mThread, NULL );
+        mThread = NULL;
+    }
+
+    flushBlock();
+    writeHeader();
+    if( mPolicy != WAV_SYNC_NONE ) {
+        fsync( fileno( mFile ) );
+    }
+
+    SDL_RWclose( mStream );
+    fclose( mFile );
+    mStream = NULL;
+    mFile = NULL;
+}
+
+bool LWavWriter::isOpen() {
+    return mStream != NULL;
+}
+
+Uint64 LWavWriter::getDataBytes() {
+    return mDataBytes;
+}
+
+Uint64 LWavWriter::getStoredBytes() {
+    return mStoredBytes;
+}
+
+int LWavWriter::getBatches() {
+    return mBatches;
+}
+
+int LWavWriter::writerThread( void* data ) {
+    LWavWriter* writer = (LWavWriter*)data;
+    while( true ) {
+        // Se lee la bandera antes que el buffer para no perder el final
+        bool stopping = writer->mStop;
+        Uint32 readable = writer->mRing->getReadable();
+
+        if( readable >= writer->mBatchBytes || ( stopping && readable > 0 ) ) {
+            writer->writeBatch( writer->mRing->read( writer->mBatch.data(), writer->mBatchBytes ) );
+        } else if( stopping ) {
+            break;
+        } else {
+            SDL_Delay( POLL_MS );
+        }
+    }
+    return 0;
+}
+
+void LWavWriter::writeBatch( Uint32 length ) {
+    // Comprimido sólo se escriben los bloques que se completaron
+    const Uint8* data = mBatch.data();
+    Uint32 stored = length;
+    if( mCodec == WAV_CODEC_IMA_ADPCM ) {
+        stored = encodeBatch( length );
+        data = mEncoded.data();
+    } else {
+        toWavLayout( mBatch.data(), length );
+    }
+
+    if( stored > 0 && SDL_RWwrite( mStream, data, 1, stored ) != stored ) {
+        printf( "Error al escribir la grabación! SDL Error: %s\n", SDL_GetError() );
+    }
+    mDataBytes += length;
+    mStoredBytes += stored;
+    ++mBatches;
+
+    // Con sincronización periódica el archivo queda válido hasta el último
+    // segundo escrito aunque el programa termine de golpe
+    mUnsyncedBytes += length;
+    if( mPolicy == WAV_SYNC_PERIODIC && mUnsyncedBytes >= (Uint64)SYNC_SECONDS * mBytesPerSecond ) {
+        writeHeader();
+        fsync( fileno( mFile ) );
+        mUnsyncedBytes = 0;
+    }
+}
+
+void LWavWriter::toWavLayout( Uint8* data, Uint32 length ) {
+    // Byte a byte para no depender del orden de la máquina: los formatos big
+    // endian se invierten y los que no tienen el signo de WAV invierten el
+    // bit más alto, que en little endian está en el último byte
+    int bytes = SDL_AUDIO_BITSIZE( mSpec.format ) / 8;
+    bool swap = SDL_AUDIO_ISBIGENDIAN( mSpec.format );
+    bool flip = bytes == 1 ? SDL_AUDIO_ISSIGNED( mSpec.format ) : !SDL_AUDIO_ISSIGNED( mSpec.format );
+    if( !swap && !flip ) {
+        return;
+    }
+    for( Uint32 i = 0; i + bytes <= length; i += bytes ) {
+        Uint8* sample = data + i;
+        if( swap ) {
+            std::reverse( sample, sample + bytes );
+        }
+        if( flip ) {
+            sample[ bytes - 1 ] ^= 0x80;
+        }
+    }
+}
+
+Uint32 LWavWriter::encodeBatch( Uint32 length ) {
+    int channels = mSpec.channels;
+    int framesPerBlock = mBlock.size() / channels;
+    int blockAlign = LAdpcmCodec::getBlockAlign( channels );
+
+    const Uint8* data = mBatch.data();
+    Uint32 frames = length / mFrameBytes;
+    Uint32 encoded = 0;
+    while( frames > 0 ) {
+        // Completa el bloque en curso
+        Uint32 count = frames < (Uint32)( framesPerBlock - mBlockFrames ) ? frames : framesPerBlock - mBlockFrames;
+        LAdpcmCodec::toS16( data, mSpec.format, count * channels, &mBlock[ mBlockFrames * channels ] );
+        data += count * mFrameBytes;
+        frames -= count;
+        mBlockFrames += count;
+
+        if( mBlockFrames == framesPerBlock ) {
+            mAdpcm.encodeBlock( mBlock.data(), channels, &mEncoded[ encoded ] );
+            encoded += blockAlign;
+            mBlockFrames = 0;
+        }
+    }
+    return encoded;
+}
+
+void LWavWriter::flushBlock() {
+    if( mCodec != WAV_CODEC_IMA_ADPCM || mBlockFrames == 0 ) {
+        return;
+    }
+
+    // El bloque siempre es completo; fact dice cuántos frames valen
+    std::fill( mBlock.begin() + mBlockFrames * mSpec.channels, mBlock.end(), 0 );
+    Uint32 blockAlign = LAdpcmCodec::getBlockAlign( mSpec.channels );
+    mAdpcm.encodeBlock( mBlock.data(), mSpec.channels, mEncoded.data() );
+    if( SDL_RWwrite( mStream, mEncoded.data(), 1, blockAlign ) != blockAlign ) {
+        printf( "Error al escribir la grabación! SDL Error: %s\n", SDL_GetError() );
+    }
+    mStoredBytes += blockAlign;
+    mBlockFrames = 0;
+}
+
+void LWavWriter::writeHeader() {
+    // IMA-ADPCM lleva fmt extendido y un bloque fact con los frames
+    bool adpcm = mCodec == WAV_CODEC_IMA_ADPCM;
+    Uint32 headerBytes = adpcm ? 60 : 44;
+
+    // Los tamaños de RIFF son de 32 bits
+    Uint64 storedBytes = mStoredBytes;
+    Uint32 dataSize = storedBytes > 0xFFFFFFFF - headerBytes ? 0xFFFFFFFF - headerBytes : (Uint32)storedBytes;
+
+    Sint64 end = SDL_RWtell( mStream );
+    SDL_RWseek( mStream, 0, RW_SEEK_SET );
+    SDL_RWwrite( mStream, "RIFF", 4, 1 );
+    SDL_WriteLE32( mStream, headerBytes - 8 + dataSize );
+    SDL_RWwrite( mStream, "WAVEfmt ", 8, 1 );
+    if( adpcm ) {
+        int blockAlign = LAdpcmCodec::getBlockAlign( mSpec.channels );
+        int framesPerBlock = LAdpcmCodec::getFramesPerBlock( blockAlign, mSpec.channels );
+        Uint64 frames = mDataBytes / mFrameBytes;
+        SDL_WriteLE32( mStream, 20 );
+        SDL_WriteLE16( mStream, 0x11 );
+        SDL_WriteLE16( mStream, mSpec.channels );
+        SDL_WriteLE32( mStream, mSpec.freq );
+        SDL_WriteLE32( mStream, (Uint64)mSpec.freq * blockAlign / framesPerBlock );
+        SDL_WriteLE16( mStream, blockAlign );
+        SDL_WriteLE16( mStream, 4 );
+        SDL_WriteLE16( mStream, 2 );
+        SDL_WriteLE16( mStream, framesPerBlock );
+        SDL_RWwrite( mStream, "fact", 4, 1 );
+        SDL_WriteLE32( mStream, 4 );
+        SDL_WriteLE32( mStream, frames > 0xFFFFFFFF ? 0xFFFFFFFF : (Uint32)frames );
+    } else {
+        Uint16 bitsPerSample = SDL_AUDIO_BITSIZE( mSpec.format );
+        SDL_WriteLE32( mStream, 16 );
+        SDL_WriteLE16( mStream, SDL_AUDIO_ISFLOAT( mSpec.format ) ? 3 : 1 );
+        SDL_WriteLE16( mStream, mSpec.channels );
+        SDL_WriteLE32( mStream, mSpec.freq );
+        SDL_WriteLE32( mStream, mBytesPerSecond );
+        SDL_WriteLE16( mStream, mFrameBytes );
+        SDL_WriteLE16( mStream, bitsPerSample );
+    }
+    SDL_RWwrite( mStream, "data", 4, 1 );
+    SDL_WriteLE32( mStream, dataSize );
+
+    // Vuelve al final para seguir añadiendo audio
+    if( end > headerBytes ) {
+        SDL_RWseek( mStream, end, RW_SEEK_SET );
+    }
+}
+
+LWavReader::LWavReader() {
+    // Inicializa las variables
+    mStream = NULL;
+    mThread = NULL;
+    mRing = NULL;
+    SDL_zero( mSpec );
+    mCodec = WAV_CODEC_PCM;
+    mBatchFrames = 0;
+    mFrameBytes = 0;
+    mBlockAlign = 0;
+    mBlocksPerBatch = 0;
+    mFactFrames = 0;
+    mOutputFrameBytes = 0;
+    mTotalFrames = 0;
+    mFrames = 0;
+    mStop = false;
+    mFinished = false;
+}
+
+LWavReader::~LWavReader() {
+    close();
+}
+
+bool LWavReader::open( std::string path, LRingBuffer* ring, int prefetchMs, const SDL_AudioSpec& outputSpec,
+        ResampleQuality quality ) {
+    close();
+
+    mStream = SDL_RWFromFile( path.c_str(), "rb" );
+    if( mStream == NULL ) {
+        printf( "No se pudo abrir %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+        return false;
+    }
+    if( !readHeader() ) {
+        printf( "%s no es un WAV válido!\n", path.c_str() );
+        close();
+        return false;
+    }
+    if( !mConverter.configure( mSpec, outputSpec, quality ) ) {
+        close();
+        return false;
+    }
+
+    // Cada lote cabe en una llamada al conversor; comprimido son bloques
+    // enteros decodificados
+    mFrameBytes = mSpec.channels * ( SDL_AUDIO_BITSIZE( mSpec.format ) / 8 );
+    mBatchFrames = BATCH_BYTES / mFrameBytes;
+    if( mBatchFrames > LAudioConverter::MAX_BLOCK_FRAMES ) {
+        mBatchFrames = LAudioConverter::MAX_BLOCK_FRAMES;
+    }
+    if( mCodec == WAV_CODEC_IMA_ADPCM ) {
+        int framesPerBlock = LAdpcmCodec::getFramesPerBlock( mBlockAlign, mSpec.channels );
+        mBlocksPerBatch = LAudioConverter::MAX_BLOCK_FRAMES / framesPerBlock;
+        mBatchFrames = mBlocksPerBatch * framesPerBlock;
+        mEncoded.resize( mBlocksPerBatch * mBlockAlign );
+        mDecoded.resize( mBatchFrames * mSpec.channels );
+    } else {
+        mBatch.resize( mBatchFrames * mFrameBytes );
+    }
+
+    // El lote convertido y el final del filtro se escriben juntos
+    mOutputFrameBytes = outputSpec.channels * ( SDL_AUDIO_BITSIZE( outputSpec.format ) / 8 );
+    mOutput.resize( ( mConverter.getMaxOutputFrames( mBatchFrames )
+                + mConverter.getMaxOutputFrames( mConverter.getTaps() ) ) * mOutputFrameBytes );
+
+    // El buffer cubre la lectura anticipada y al menos dos lotes
+    Uint32 bytesPerSecond = outputSpec.freq * mOutputFrameBytes;
+    Uint32 prefetchBytes = (Uint64)bytesPerSecond * prefetchMs / 1000;
+    mRing = ring;
+    mRing->allocate( prefetchBytes > 2 * mOutput.size() ? prefetchBytes : 2 * mOutput.size() );
+    mFrames = 0;
+    mStop = false;
+    mFinished = false;
+
+    // Llena el buffer antes de que empiece la reproducción
+    while( !mFinished && readBatch() ) {
+    }
+
+    mThread = SDL_CreateThread( readerThread, "wav reader", this );
+    if( mThread == NULL ) {
+        printf( "No se pudo crear el hilo lector! SDL Error: %s\n", SDL_GetError() );
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LWavReader::close() {
+    if( mThread != NULL ) {
+        mStop = true;
+        SDL_WaitThread( mThread, NULL );
+        mThread = NULL;
+    }
+    if( mStream != NULL ) {
+        SDL_RWclose( mStream );
+        mStream = NULL;
+    }
+}
+
+SDL_AudioSpec LWavReader::getSpec() {
+    return mSpec;
+}
+
+WavCodec LWavReader::getCodec() {
+    return mCodec;
+}
+
+bool LWavReader::isFinished() {
+    return mFinished;
+}
+
+Uint64 LWavReader::getFrames() {
+    return mFrames;
+}
+
+Uint64 LWavReader::getTotalFrames() {
+    return mTotalFrames;
+}
+
+int LWavReader::readerThread( void* data ) {
+    LWavReader* reader = (LWavReader*)data;
+    while( !reader->mStop && !reader->mFinished ) {
+        if( !reader->readBatch() ) {
+            SDL_Delay( POLL_MS );
+        }
+    }
+    return 0;
+}
+
+bool LWavReader::readBatch() {
+    if( mRing->getWritable() < mOutput.size() ) {
+        return false;
+    }
+    Uint64 remaining = mTotalFrames - mFrames;
+    int frames = remaining < (Uint64)mBatchFrames ? remaining : mBatchFrames;
+
+    // Un archivo más corto de lo que dice la cabecera termina ahí
+    int read;
+    const Uint8* source;
+    if( mCodec == WAV_CODEC_IMA_ADPCM ) {
+        read = decodeBatch( frames );
+        source = (const Uint8*)mDecoded.data();
+    } else {
+        read = SDL_RWread( mStream, mBatch.data(), mFrameBytes, frames );
+        source = mBatch.data();
+    }
+    mFrames += read;
+
+    // Al final el filtro entrega lo que le queda junto con el último lote;
+    // un lote vacío también es el final, para no repetirlo sin avanzar
+    int converted = mConverter.process( source, read, mOutput.data() );
+    bool finished = read == 0 || read < frames || mFrames == mTotalFrames;
+    if( finished ) {
+        converted += mConverter.flush( &mOutput[ converted * mOutputFrameBytes ] );
+    }
+    mRing->write( mOutput.data(), converted * mOutputFrameBytes );
+    if( finished ) {
+        mFinished = true;
+    }
+    return true;
+}
+
+int LWavReader::decodeBatch( int frames ) {
+    int channels = mSpec.channels;
+    int framesPerBlock = LAdpcmCodec::getFramesPerBlock( mBlockAlign, channels );
+
+    // Bloques que cubren frames; el último puede quedar a medias
+    int blocks = ( frames + framesPerBlock - 1 ) / framesPerBlock;
+    int read = SDL_RWread( mStream, mEncoded.data(), mBlockAlign, blocks );
+    for( int b = 0; b < read; ++b ) {
+        LAdpcmCodec::decodeBlock( &mEncoded[ b * mBlockAlign ], mBlockAlign, channels,
+                &mDecoded[ b * framesPerBlock * channels ] );
+    }
+    return read * framesPerBlock < frames ? read * framesPerBlock : frames;
+}
+
+bool LWavReader::readHeader() {
+    char id[ 4 ];
+    if( SDL_RWread( mStream, id, 4, 1 ) != 1 || memcmp( id, "RIFF", 4 ) != 0 ) {
+        return false;
+    }
+    SDL_ReadLE32( mStream );
+    if( SDL_RWread( mStream, id, 4, 1 ) != 1 || memcmp( id, "WAVE", 4 ) != 0 ) {
+        return false;
+    }
+
+    // Recorre los bloques hasta llegar a los datos
+    bool hasFormat = false;
+    mFactFrames = 0;
+    while( SDL_RWread( mStream, id, 4, 1 ) == 1 ) {
+        Uint32 size = SDL_ReadLE32( mStream );
+        if( memcmp( id, "fmt ", 4 ) == 0 && size >= 16 ) {
+            Uint16 tag = SDL_ReadLE16( mStream );
+            mSpec.channels = SDL_ReadLE16( mStream );
+            mSpec.freq = SDL_ReadLE32( mStream );
+            SDL_ReadLE32( mStream );
+            Uint16 blockAlign = SDL_ReadLE16( mStream );
+            Uint16 bits = SDL_ReadLE16( mStream );
+
+            // IMA-ADPCM agrega los frames por bloque
+            Uint32 extra = 16;
+            int framesPerBlock = 0;
+            if( tag == 0x11 && size >= 20 ) {
+                SDL_ReadLE16( mStream );
+                framesPerBlock = SDL_ReadLE16( mStream );
+                extra = 20;
+            }
+            SDL_RWseek( mStream, size - extra + ( size & 1 ), RW_SEEK_CUR );
+
+            // Los formatos que puede escribir LWavWriter
+            mCodec = WAV_CODEC_PCM;
+            if( tag == 0x11 && bits == 4 ) {
+                // Un bloque tiene que caber entero en un lote del conversor
+                if( mSpec.channels < 1 || mSpec.channels > LAdpcmCodec::MAX_CHANNELS
+                        || blockAlign <= 4 * mSpec.channels
+                        || framesPerBlock != LAdpcmCodec::getFramesPerBlock( blockAlign, mSpec.channels )
+                        || framesPerBlock > LAudioConverter::MAX_BLOCK_FRAMES ) {
+                    return false;
+                }
+                mCodec = WAV_CODEC_IMA_ADPCM;
+                mBlockAlign = blockAlign;
+                mSpec.format = AUDIO_S16SYS;
+            } else if( tag == 3 && bits == 32 ) {
+                mSpec.format = AUDIO_F32;
+            } else if( tag == 1 && bits == 32 ) {
+                mSpec.format = AUDIO_S32;
+            } else if( tag == 1 && bits == 16 ) {
+                mSpec.format = AUDIO_S16;
+            } else if( tag == 1 && bits == 8 ) {
+                mSpec.format = AUDIO_U8;
+            } else {
+                return false;
+            }
+            hasFormat = true;
+        } else if( memcmp( id, "fact", 4 ) == 0 && size >= 4 ) {
+            mFactFrames = SDL_ReadLE32( mStream );
+            SDL_RWseek( mStream, size - 4 + ( size & 1 ), RW_SEEK_CUR );
+        } else if( memcmp( id, "data", 4 ) == 0 ) {
+            if( !hasFormat ) {
+                return false;
+            }
+
+            // Si la cabecera no se llegó a corregir el tamaño se toma del archivo
+            Sint64 available = SDL_RWsize( mStream ) - SDL_RWtell( mStream );
+            Uint64 dataSize = size == 0 || size > available ? available : size;
+            if( mCodec == WAV_CODEC_PCM ) {
+                mTotalFrames = dataSize / ( mSpec.channels * ( SDL_AUDIO_BITSIZE( mSpec.format ) / 8 ) );
+                return true;
+            }
+
+            // Comprimido se cuentan sólo bloques completos, recortados a los
+            // frames de fact si los hay
+            mTotalFrames = dataSize / mBlockAlign * LAdpcmCodec::getFramesPerBlock( mBlockAlign, mSpec.channels );
+            if( mFactFrames > 0 && mFactFrames < mTotalFrames ) {
+                mTotalFrames = mFactFrames;
+            }
+            return true;
+        } else {
+            SDL_RWseek( mStream, size + ( size & 1 ), RW_SEEK_CUR );
+        }
+    }
+    return false;
+}
+
+LSpectrumAnalyzer::LSpectrumAnalyzer() {
+    // Inicializa las variables
+    mThread = NULL;
+    mStop = false;
+    mSimd = true;
+    SDL_zero( mSpec );
+    mFrameBytes = 0;
+    mHistoryPos = 0;
+    mPending = 0;
+    memset( mSumSquares, 0, sizeof( mSumSquares ) );
+    memset( mPeakAbs, 0, sizeof( mPeakAbs ) );
+    memset( mBandStart, 0, sizeof( mBandStart ) );
+    memset( &mDisplay, 0, sizeof( mDisplay ) );
+    memset( mResults, 0, sizeof( mResults ) );
+    mFront = 0;
+    mReading = -1;
+    mSkipped = 0;
+}
+
+LSpectrumAnalyzer::~LSpectrumAnalyzer() {
+    close();
+}
+
+bool LSpectrumAnalyzer::prepare( const SDL_AudioSpec& spec ) {
+    mSpec = spec;
+    mFrameBytes = spec.channels * ( SDL_AUDIO_BITSIZE( spec.format ) / 8 );
+    if( mFrameBytes == 0 || !isSampleFormatSupported( spec.format ) ) {
+        printf( "Formato de captura no soportado por el analizador!\n" );
+        return false;
+    }
+
+    mBatch.resize( HOP * mFrameBytes );
+    mSamples.resize( HOP * spec.channels );
+    mHistory.assign( FFT_SIZE, 0.0f );
+    mHistoryPos = 0;
+    mPending = 0;
+    memset( mSumSquares, 0, sizeof( mSumSquares ) );
+    memset( mPeakAbs, 0, sizeof( mPeakAbs ) );
+    mRe.resize( FFT_SIZE );
+    mIm.resize( FFT_SIZE );
+
+    // Ventana de Hann periódica
+    mWindow.resize( FFT_SIZE );
+    for( int i = 0; i < FFT_SIZE; ++i ) {
+        mWindow[ i ] = 0.5f - 0.5f * cosf( 2.0f * (float)M_PI * i / FFT_SIZE );
+    }
+
+    // Posición de cada muestra después de invertir sus bits
+    int bits = 0;
+    while( ( 1 << bits ) < FFT_SIZE ) {
+        ++bits;
+    }
+    mBitReverse.resize( FFT_SIZE );
+    for( int i = 0; i < FFT_SIZE; ++i ) {
+        int reversed = 0;
+        for( int b = 0; b < bits; ++b ) {
+            reversed |= ( ( i >> b ) & 1 ) << ( bits - 1 - b );
+        }
+        mBitReverse[ i ] = reversed;
+    }
+
+    // Los giros de la etapa con grupos de half puntos empiezan en half, así
+    // cada etapa lee su tabla de forma contigua
+    mTwiddleRe.assign( FFT_SIZE, 0.0f );
+    mTwiddleIm.assign( FFT_SIZE, 0.0f );
+    for( int half = 1; half < FFT_SIZE; half <<= 1 ) {
+        for( int k = 0; k < half; ++k ) {
+            double angle = -M_PI * k / half;
+            mTwiddleRe[ half + k ] = cos( angle );
+            mTwiddleIm[ half + k ] = sin( angle );
+        }
+    }
+
+    // Bandas espaciadas en escala logarítmica desde 50 Hz hasta Nyquist,
+    // cada una con al menos un bin
+    double lowest = 50.0;
+    double nyquist = spec.freq / 2.0;
+    for( int b = 0; b <= BANDS; ++b ) {
+        double frequency = lowest * pow( nyquist / lowest, (double)b / BANDS );
+        int bin = (int)( frequency * FFT_SIZE / spec.freq + 0.5 );
+        if( b > 0 && bin <= mBandStart[ b - 1 ] ) {
+            bin = mBandStart[ b - 1 ] + 1;
+        }
+        mBandStart[ b ] = bin < 1 ? 1 : bin;
+    }
+    if( mBandStart[ BANDS ] > FFT_SIZE / 2 + 1 ) {
+        mBandStart[ BANDS ] = FFT_SIZE / 2 + 1;
+    }
+
+    memset( &mDisplay, 0, sizeof( mDisplay ) );
+    memset( mResults, 0, sizeof( mResults ) );
+    mFront = 0;
+    mReading = -1;
+    mSkipped = 0;
+    return true;
+}
+
+bool LSpectrumAnalyzer::open( const SDL_AudioSpec& spec ) {
+    close();
+    if( !prepare( spec ) ) {
+        return false;
+    }
+
+    // Medio segundo de margen antes de descartar bloques
+    mRing.allocate( spec.freq * mFrameBytes / 2 );
+    mStop = false;
+    mThread = SDL_CreateThread( analyzerThread, "spectrum", this );
+    if( mThread == NULL ) {
+        printf( "No se pudo crear el hilo del analizador! SDL Error: %s\n", SDL_GetError() );
+        mRing.free();
+        return false;
+    }
+    return true;
+}
+
+void LSpectrumAnalyzer::close() {
+    if( mThread != NULL ) {
+        mStop = true;
+        SDL_WaitThread( mThread, NULL );
+        mThread = NULL;
+    }
+    mRing.free();
+}
+
+void LSpectrumAnalyzer::feed( const Uint8* stream, int len ) {
+    // Sin reservar, el buffer no tiene espacio y descarta el bloque
+    mRing.write( stream, len );
+}
+
+bool LSpectrumAnalyzer::getResult( Result& result ) {
+    // Marca el buffer publicado como en lectura y confirma que sigue siendo
+    // el publicado; si cambió entre medio se vuelve a intentar
+    int front;
+    do {
+        front = mFront.load();
+        mReading.store( front );
+    } while( mFront.load() != front );
+
+    result = mResults[ front ];
+    mReading.store( -1 );
+    return result.frame > 0;
+}
+
+void LSpectrumAnalyzer::setSimd( bool simd ) {
+    mSimd = simd;
+}
+
+int LSpectrumAnalyzer::getDropped() {
+    return mRing.getOverruns();
+}
+
+int LSpectrumAnalyzer::getSkipped() {
+    return mSkipped;
+}
+
+int LSpectrumAnalyzer::analyzerThread( void* data ) {
+    LSpectrumAnalyzer* analyzer = (LSpectrumAnalyzer*)data;
+    while( !analyzer->mStop ) {
+        // El lote es de frames enteros y el callback escribe bloques enteros
+        Uint32 read = analyzer->mRing.read( analyzer->mBatch.data(), analyzer->mBatch.size() );
+        if( read > 0 ) {
+            analyzer->process( analyzer->mBatch.data(), read );
+        } else {
+            SDL_Delay( POLL_MS );
+        }
+    }
+    return 0;
+}
+
+void LSpectrumAnalyzer::process( const Uint8* data, Uint32 length ) {
+    int channels = mSpec.channels;
+    int meterChannels = channels < METER_CHANNELS ? channels : METER_CHANNELS;
+    Uint32 frames = length / mFrameBytes;
+
+    while( frames > 0 ) {
+        // Hasta completar el salto actual
+        int count = frames < (Uint32)( HOP - mPending ) ? frames : HOP - mPending;
+        int values = count * channels;
+
+        // Convierte el bloque a flotantes de -1 a 1
+        float* samples = mSamples.data();
+        LAudioConverter::toFloat( data, mSpec.format, values, samples );
+
+        // Nivel por canal y mezcla mono para la FFT
+        for( int i = 0; i < count; ++i ) {
+            const float* frame = samples + i * channels;
+            float mono = 0.0f;
+            for( int c = 0; c < channels; ++c ) {
+                mono += frame[ c ];
+            }
+            for( int c = 0; c < meterChannels; ++c ) {
+                mSumSquares[ c ] += frame[ c ] * frame[ c ];
+                float magnitude = fabsf( frame[ c ] );
+                if( magnitude > mPeakAbs[ c ] ) {
+                    mPeakAbs[ c ] = magnitude;
+                }
+            }
+            mHistory[ mHistoryPos ] = mono / channels;
+            mHistoryPos = ( mHistoryPos + 1 ) & ( FFT_SIZE - 1 );
+        }
+
+        data += count * mFrameBytes;
+        frames -= count;
+        mPending += count;
+        if( mPending == HOP ) {
+            analyze();
+            mPending = 0;
+        }
+    }
+}
+
+void LSpectrumAnalyzer::analyze() {
+    // Rangos en dB que ocupan la altura de las barras, y caída de las barras
+    // en alturas completas por segundo
+    const float SPECTRUM_RANGE_DB = 72.0f;
+    const float LEVEL_RANGE_DB = 60.0f;
+    const float FALL_PER_SECOND = 1.5f;
+    float fall = FALL_PER_SECOND * HOP / mSpec.freq;
+
+    // Las muestras más viejas primero, con la ventana aplicada
+    for( int i = 0; i < FFT_SIZE; ++i ) {
+        mRe[ i ] = mHistory[ ( mHistoryPos + i ) & ( FFT_SIZE - 1 ) ] * mWindow[ i ];
+        mIm[ i ] = 0.0f;
+    }
+    transform( mRe.data(), mIm.data() );
+
+    // Un seno de escala completa con la ventana de Hann da N/4 en su bin
+    float reference = ( FFT_SIZE / 4.0f ) * ( FFT_SIZE / 4.0f );
+    for( int b = 0; b < BANDS; ++b ) {
+        float power = 0.0f;
+        for( int bin = mBandStart[ b ]; bin < mBandStart[ b + 1 ]; ++bin ) {
+            float binPower = mRe[ bin ] * mRe[ bin ] + mIm[ bin ] * mIm[ bin ];
+            if( binPower > power ) {
+                power = binPower;
+            }
+        }
+        float value = ( 10.0f * log10f( power / reference + 1e-12f ) + SPECTRUM_RANGE_DB ) / SPECTRUM_RANGE_DB;
+        value = value < 0.0f ? 0.0f : ( value > 1.0f ? 1.0f : value );
+        mDisplay.bands[ b ] = value > mDisplay.bands[ b ] - fall ? value : mDisplay.bands[ b ] - fall;
+    }
 
-    // Establece las dimensiones del clip rendering
-    if( clip != NULL ) {
-        renderQuad.w = clip->w;
-        renderQuad.h = clip->h;
+    // Con captura mono los dos medidores muestran el mismo canal
+    for( int c = 0; c < METER_CHANNELS; ++c ) {
+        int source = c < mSpec.channels ? c : 0;
+        float rms = sqrtf( mSumSquares[ source ] / HOP );
+        float level = ( 20.0f * log10f( rms + 1e-9f ) + LEVEL_RANGE_DB ) / LEVEL_RANGE_DB;
+        float peak = ( 20.0f * log10f( mPeakAbs[ source ] + 1e-9f ) + LEVEL_RANGE_DB ) / LEVEL_RANGE_DB;
+        level = level < 0.0f ? 0.0f : ( level > 1.0f ? 1.0f : level );
+        peak = peak < 0.0f ? 0.0f : ( peak > 1.0f ? 1.0f : peak );
+
+        // El pico se sostiene más que el nivel
+        mDisplay.level[ c ] = level > mDisplay.level[ c ] - fall ? level : mDisplay.level[ c ] - fall;
+        mDisplay.peak[ c ] = peak > mDisplay.peak[ c ] - fall / 4 ? peak : mDisplay.peak[ c ] - fall / 4;
     }
-    // Render to screen, similar a RenderCopy pero con argumentos extra para girar y rotar
-    SDL_RenderCopyEx( gRenderer, mTexture, clip, &renderQuad, angle, center, flip );
+    memset( mSumSquares, 0, sizeof( mSumSquares ) );
+    memset( mPeakAbs, 0, sizeof( mPeakAbs ) );
 
+    ++mDisplay.frame;
+    publish();
 }
 
-int LTexture::getWidth() {
-    return mWidth;
+void LSpectrumAnalyzer::publish() {
+    // Si el renderizador todavía lee el otro buffer este análisis se pierde;
+    // el siguiente llega en unos milisegundos
+    int back = 1 - mFront.load();
+    if( mReading.load() == back ) {
+        ++mSkipped;
+        return;
+    }
+    mResults[ back ] = mDisplay;
+    mFront.store( back );
 }
 
-int LTexture::getHeight() {
-    return mHeight;
+void LSpectrumAnalyzer::transform( float* re, float* im ) {
+    // Reordena las muestras según la inversión de bits
+    for( int i = 0; i < FFT_SIZE; ++i ) {
+        int j = mBitReverse[ i ];
+        if( i < j ) {
+            float t = re[ i ];
+            re[ i ] = re[ j ];
+            re[ j ] = t;
+            t = im[ i ];
+            im[ i ] = im[ j ];
+            im[ j ] = t;
+        }
+    }
+
+#if defined(AUDIO_SSE2)
+    static bool hasSSE2 = __builtin_cpu_supports( "sse2" );
+    bool simd = mSimd && hasSSE2;
+#endif
+
+    // Etapas de mariposas con grupos cada vez más grandes
+    for( int half = 1; half < FFT_SIZE; half <<= 1 ) {
+#if defined(AUDIO_SSE2)
+        if( simd && half >= 4 ) {
+            butterfliesSSE2( re, im, half, &mTwiddleRe[ half ], &mTwiddleIm[ half ] );
+        } else
+#endif
+        {
+            butterfliesScalar( re, im, half, &mTwiddleRe[ half ], &mTwiddleIm[ half ] );
+        }
+    }
 }
 
-void LTexture::setWidth( int w ) {
-    mWidth = w;
+void LSpectrumAnalyzer::butterfliesScalar( float* re, float* im, int half, const float* wr, const float* wi ) {
+    for( int start = 0; start < FFT_SIZE; start += 2 * half ) {
+        float* ar = re + start;
+        float* ai = im + start;
+        float* br = ar + half;
+        float* bi = ai + half;
+        for( int k = 0; k < half; ++k ) {
+            float tr = br[ k ] * wr[ k ] - bi[ k ] * wi[ k ];
+            float ti = br[ k ] * wi[ k ] + bi[ k ] * wr[ k ];
+            br[ k ] = ar[ k ] - tr;
+            bi[ k ] = ai[ k ] - ti;
+            ar[ k ] += tr;
+            ai[ k ] += ti;
+        }
+    }
 }
 
-void LTexture::setHeight( int h ) {
-    mHeight = h;
+#if defined(AUDIO_SSE2)
+__attribute__(( target( "sse2" ) ))
+void LSpectrumAnalyzer::butterfliesSSE2( float* re, float* im, int half, const float* wr, const float* wi ) {
+    // Cuatro mariposas por instrucción; half es potencia de dos y al menos 4
+    for( int start = 0; start < FFT_SIZE; start += 2 * half ) {
+        float* ar = re + start;
+        float* ai = im + start;
+        float* br = ar + half;
+        float* bi = ai + half;
+        for( int k = 0; k < half; k += 4 ) {
+            __m128 xr = _mm_loadu_ps( br + k );
+            __m128 xi = _mm_loadu_ps( bi + k );
+            __m128 cr = _mm_loadu_ps( wr + k );
+            __m128 ci = _mm_loadu_ps( wi + k );
+            __m128 tr = _mm_sub_ps( _mm_mul_ps( xr, cr ), _mm_mul_ps( xi, ci ) );
+            __m128 ti = _mm_add_ps( _mm_mul_ps( xr, ci ), _mm_mul_ps( xi, cr ) );
+            __m128 yr = _mm_loadu_ps( ar + k );
+            __m128 yi = _mm_loadu_ps( ai + k );
+            _mm_storeu_ps( br + k, _mm_sub_ps( yr, tr ) );
+            _mm_storeu_ps( bi + k, _mm_sub_ps( yi, ti ) );
+            _mm_storeu_ps( ar + k, _mm_add_ps( yr, tr ) );
+            _mm_storeu_ps( ai + k, _mm_add_ps( yi, ti ) );
+        }
+    }
 }
+#endif
 
 bool init() {
     // Bandera
@@ -394,13 +2526,29 @@ void close()
     gWindow = NULL;
     gRenderer = NULL;
 
-    // free audio playback
-    if( gRecordingBuffer != NULL )
+    // Detiene los callbacks antes de liberar los buffers, el escritor y el
+    // analizador que usan
+    if( gRecordingDeviceId != 0 )
+    {
+        SDL_PauseAudioDevice( gRecordingDeviceId, SDL_TRUE );
+        SDL_CloseAudioDevice( gRecordingDeviceId );
+        gRecordingDeviceId = 0;
+    }
+    if( gPlaybackDeviceId != 0 )
     {
-        delete[] gRecordingBuffer;
-        gRecordingBuffer = NULL;
+        SDL_PauseAudioDevice( gPlaybackDeviceId, SDL_TRUE );
+        SDL_CloseAudioDevice( gPlaybackDeviceId );
+        gPlaybackDeviceId = 0;
     }
 
+    // free audio playback
+    gStatusTexture.free();
+    gWavWriter.close();
+    gCaptureRing.free();
+    gSpectrum.close();
+    gWavReader.close();
+    gPlaybackRing.free();
+
     // Termina SDL
     IMG_Quit();
     TTF_Quit();
@@ -409,23 +2557,648 @@ void close()
 
 void audioRecordingCallback( void* userdata, Uint8* stream, int len )
 {
-    // Copia el audio del stream
-    memcpy( &gRecordingBuffer[ gBufferBytePosition ], stream, len );
-
-    // Se mueve a traves del buffer
-    gBufferBytePosition += len;
+    // Copia el audio del stream sin esperar al hilo principal ni al analizador
+    gCaptureRing.write( stream, len );
+    gSpectrum.feed( stream, len );
 }
 
 void audioPlaybackCallback( void* userdata, Uint8* stream, int len )
 {
-    // Copia el audio al stream
-    memcpy( stream, &gRecordingBuffer[ gBufferBytePosition ], len );
+    // Copia el audio al stream y completa con silencio si no hay suficiente
+    Uint32 read = gPlaybackRing.read( stream, len );
+    if( read < (Uint32)len )
+    {
+        // Antes del final del archivo es que el lector no llegó a tiempo
+        if( !gWavReader.isFinished() )
+        {
+            ++gPlaybackUnderruns;
+        }
+        memset( stream + read, gReceivedPlaybackSpec.silence, len - read );
+    }
+}
+
+// Hilo productor de la prueba: escribe bloques con un contador creciente
+// tan rápido como puede
+struct StressProducer
+{
+    LRingBuffer* ring;
+    Uint32 blockValues;
+    Uint32 blocks;
+    std::atomic<bool> done;
+};
+
+int stressProducerThread( void* data )
+{
+    StressProducer* producer = (StressProducer*)data;
+    std::vector<Uint32> block( producer->blockValues );
+    Uint32 counter = 0;
+    for( Uint32 i = 0; i < producer->blocks; ++i )
+    {
+        for( Uint32 j = 0; j < producer->blockValues; ++j )
+        {
+            block[ j ] = counter++;
+        }
+
+        // Como el callback real, un bloque que no cabe se pierde y el
+        // siguiente llega un periodo después
+        if( !producer->ring->write( (Uint8*)block.data(), producer->blockValues * sizeof( Uint32 ) ) )
+        {
+            SDL_Delay( 1 );
+        }
+    }
+    producer->done = true;
+    return 0;
+}
+
+int stressRingBuffer( int seconds )
+{
+    int errors = 0;
+
+    // Primera parte: productor sintético contra el hilo principal. Un
+    // bloque descartado deja un hueco exacto en el contador; cualquier otra
+    // discontinuidad es un error
+    LRingBuffer ring;
+    ring.allocate( 64 * 1024 );
+    StressProducer producer;
+    producer.ring = &ring;
+    producer.blockValues = 256;
+    producer.blocks = 200000;
+    producer.done = false;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    SDL_Thread* thread = SDL_CreateThread( stressProducerThread, "stress", &producer );
+    if( thread == NULL )
+    {
+        printf( "No se pudo crear el hilo! SDL Error: %s\n", SDL_GetError() );
+        return -1;
+    }
+
+    std::vector<Uint32> values( 4096 );
+    Uint32 expected = 0;
+    Uint64 received = 0;
+    Uint32 seed = 1;
+    while( true )
+    {
+        bool finished = producer.done;
+
+        // Lecturas de tamaño variable, que no coinciden con los bloques
+        seed = seed * 1103515245 + 12345;
+        Uint32 count = 1 + ( seed >> 16 ) % values.size();
+        Uint32 read = ring.read( (Uint8*)values.data(), count * sizeof( Uint32 ) ) / sizeof( Uint32 );
+        for( Uint32 i = 0; i < read; ++i )
+        {
+            if( values[ i ] != expected )
+            {
+                // Sólo se aceptan huecos de bloques completos
+                if( values[ i ] < expected || ( values[ i ] - expected ) % producer.blockValues != 0 )
+                {
+                    ++errors;
+                }
+            }
+            expected = values[ i ] + 1;
+        }
+        received += read;
+
+        // De vez en cuando el consumidor se retrasa, como un frame lento
+        if( ( seed >> 8 ) % 64 == 0 )
+        {
+            SDL_Delay( 1 );
+        }
+        if( finished && read == 0 )
+        {
+            break;
+        }
+    }
+    SDL_WaitThread( thread, NULL );
+    double elapsed = (double)( SDL_GetPerformanceCounter() - start ) / SDL_GetPerformanceFrequency();
+
+    Uint64 produced = (Uint64)producer.blocks * producer.blockValues;
+    Uint64 dropped = (Uint64)ring.getOverruns() * producer.blockValues;
+    if( received + dropped != produced )
+    {
+        ++errors;
+    }
+    printf( "Sintético: %.1f MB/s, %d desbordes, %llu de %llu muestras, %d errores\n",
+            received * sizeof( Uint32 ) / elapsed / ( 1024.0 * 1024.0 ), ring.getOverruns(),
+            (unsigned long long)received, (unsigned long long)produced, errors );
+
+    // Segunda y tercera parte, sin comprimir y con IMA-ADPCM: captura real
+    // con el driver dummy y buffers pequeños escrita a disco por el hilo
+    // escritor, y reproducción del archivo con lectura anticipada que debe
+    // llegar entera al dispositivo. La reproducción comprimida pide otro
+    // formato para pasar por el conversor
+    WavCodec codecs[ 2 ] = { WAV_CODEC_PCM, WAV_CODEC_IMA_ADPCM };
+    const char* codecNames[ 2 ] = { "PCM", "IMA-ADPCM" };
+    for( int c = 0; c < 2; ++c )
+    {
+        SDL_AudioSpec desiredSpec;
+        SDL_zero( desiredSpec );
+        desiredSpec.freq = 44100;
+        desiredSpec.format = AUDIO_F32;
+        desiredSpec.channels = 2;
+        desiredSpec.samples = 256;
+        desiredSpec.callback = audioRecordingCallback;
+        SDL_AudioDeviceID deviceId = SDL_OpenAudioDevice( NULL, SDL_TRUE, &desiredSpec,
+                &gReceivedRecordingSpec, SDL_AUDIO_ALLOW_ANY_CHANGE );
+        if( deviceId == 0 )
+        {
+            printf( "El driver %s no permite capturar: %s\n", SDL_GetCurrentAudioDriver(), SDL_GetError() );
+            return errors > 0 ? -1 : 0;
+        }
+
+        gBytesPerSecond = gReceivedRecordingSpec.freq * gReceivedRecordingSpec.channels
+            * ( SDL_AUDIO_BITSIZE( gReceivedRecordingSpec.format ) / 8 );
+        gCaptureRing.allocate( RING_BUFFER_SECONDS * gBytesPerSecond );
+        if( !gWavWriter.open( STRESS_RECORDING_FILE, gReceivedRecordingSpec, &gCaptureRing, WAV_SYNC_PERIODIC, codecs[ c ] ) )
+        {
+            SDL_CloseAudioDevice( deviceId );
+            return -1;
+        }
+
+        start = SDL_GetPerformanceCounter();
+        SDL_PauseAudioDevice( deviceId, SDL_FALSE );
+        SDL_Delay( seconds * 1000 );
+        SDL_PauseAudioDevice( deviceId, SDL_TRUE );
+        gWavWriter.close();
+        elapsed = (double)( SDL_GetPerformanceCounter() - start ) / SDL_GetPerformanceFrequency();
+        SDL_CloseAudioDevice( deviceId );
+
+        printf( "Captura %s (%s): %.2f s grabados en %.2f s, %.1f:1, %d escrituras, %d desbordes\n",
+                codecNames[ c ], SDL_GetCurrentAudioDriver(), (double)gWavWriter.getDataBytes() / gBytesPerSecond,
+                elapsed, (double)gWavWriter.getDataBytes() / gWavWriter.getStoredBytes(),
+                gWavWriter.getBatches(), gCaptureRing.getOverruns() );
+        gCaptureRing.free();
+
+        desiredSpec.callback = audioPlaybackCallback;
+        if( codecs[ c ] == WAV_CODEC_IMA_ADPCM )
+        {
+            desiredSpec.freq = 48000;
+            desiredSpec.format = AUDIO_S16;
+            desiredSpec.channels = 1;
+        }
+        deviceId = SDL_OpenAudioDevice( NULL, SDL_FALSE, &desiredSpec, &gReceivedPlaybackSpec,
+                SDL_AUDIO_ALLOW_ANY_CHANGE );
+        if( deviceId == 0 || !gWavReader.open( STRESS_RECORDING_FILE, &gPlaybackRing, PLAYBACK_PREFETCH_MS,
+                    gReceivedPlaybackSpec, PLAYBACK_QUALITY ) )
+        {
+            printf( "No se pudo reproducir la grabación! SDL Error: %s\n", SDL_GetError() );
+            return -1;
+        }
+
+        gPlaybackUnderruns = 0;
+        start = SDL_GetPerformanceCounter();
+        SDL_PauseAudioDevice( deviceId, SDL_FALSE );
+        while( !gWavReader.isFinished() || gPlaybackRing.getReadable() > 0 )
+        {
+            SDL_Delay( 16 );
+        }
+        SDL_PauseAudioDevice( deviceId, SDL_TRUE );
+        elapsed = (double)( SDL_GetPerformanceCounter() - start ) / SDL_GetPerformanceFrequency();
+        SDL_CloseAudioDevice( deviceId );
+
+        int frameBytes = gReceivedRecordingSpec.channels * ( SDL_AUDIO_BITSIZE( gReceivedRecordingSpec.format ) / 8 );
+        if( gWavReader.getFrames() != gWavWriter.getDataBytes() / frameBytes )
+        {
+            ++errors;
+        }
+        printf( "Reproducción %s a %d Hz y %d canales: %.2f s en %.2f s con %u bytes de buffer, %d vacíos, %d errores\n",
+                codecNames[ c ], gReceivedPlaybackSpec.freq, gReceivedPlaybackSpec.channels,
+                (double)gWavReader.getFrames() / gReceivedRecordingSpec.freq, elapsed,
+                gPlaybackRing.getCapacity(), (int)gPlaybackUnderruns, errors );
+
+        gWavReader.close();
+        gPlaybackRing.free();
+    }
+    return errors > 0 ? -1 : 0;
+}
+
+int layoutSpectrum( const LSpectrumAnalyzer::Result& result, SDL_Rect* rects )
+{
+    // Medidores arriba, bajo el texto, y el espectro hasta el estado
+    const int left = 20;
+    const int width = SCREEN_WIDTH - 2 * left;
+    const int meterTop = 60;
+    const int meterHeight = 10;
+    const int spectrumTop = 100;
+    const int spectrumBottom = SCREEN_HEIGHT - 60;
+
+    int count = 0;
+    for( int b = 0; b < LSpectrumAnalyzer::BANDS; ++b )
+    {
+        int height = (int)( result.bands[ b ] * ( spectrumBottom - spectrumTop ) );
+        rects[ count ].x = left + b * width / LSpectrumAnalyzer::BANDS;
+        rects[ count ].y = spectrumBottom - height;
+        rects[ count ].w = width / LSpectrumAnalyzer::BANDS - 1;
+        rects[ count ].h = height;
+        ++count;
+    }
+    for( int c = 0; c < LSpectrumAnalyzer::METER_CHANNELS; ++c )
+    {
+        rects[ count ].x = left;
+        rects[ count ].y = meterTop + c * ( meterHeight + 4 );
+        rects[ count ].w = (int)( result.level[ c ] * width );
+        rects[ count ].h = meterHeight;
+        ++count;
+    }
+    for( int c = 0; c < LSpectrumAnalyzer::METER_CHANNELS; ++c )
+    {
+        rects[ count ].x = left + (int)( result.peak[ c ] * width ) - 2;
+        rects[ count ].y = meterTop + c * ( meterHeight + 4 );
+        rects[ count ].w = 3;
+        rects[ count ].h = meterHeight;
+        ++count;
+    }
+    return count;
+}
+
+void renderSpectrum( const LSpectrumAnalyzer::Result& result )
+{
+    SDL_Rect rects[ LSpectrumAnalyzer::BANDS + 2 * LSpectrumAnalyzer::METER_CHANNELS ];
+    layoutSpectrum( result, rects );
+
+    // Un solo llamado por color: bandas, niveles y picos
+    SDL_SetRenderDrawColor( gRenderer, 0x30, 0x60, 0xD0, 0xFF );
+    SDL_RenderFillRects( gRenderer, rects, LSpectrumAnalyzer::BANDS );
+    SDL_SetRenderDrawColor( gRenderer, 0x20, 0xB0, 0x40, 0xFF );
+    SDL_RenderFillRects( gRenderer, rects + LSpectrumAnalyzer::BANDS, LSpectrumAnalyzer::METER_CHANNELS );
+    SDL_SetRenderDrawColor( gRenderer, 0xD0, 0x20, 0x20, 0xFF );
+    SDL_RenderFillRects( gRenderer, rects + LSpectrumAnalyzer::BANDS + LSpectrumAnalyzer::METER_CHANNELS,
+            LSpectrumAnalyzer::METER_CHANNELS );
+}
+
+int benchmarkSpectrum()
+{
+    const int N = LSpectrumAnalyzer::FFT_SIZE;
+    int errors = 0;
+
+    SDL_AudioSpec spec;
+    SDL_zero( spec );
+    spec.freq = 44100;
+    spec.format = AUDIO_F32;
+    spec.channels = 2;
+    LSpectrumAnalyzer* analyzer = new LSpectrumAnalyzer();
+    analyzer->prepare( spec );
+
+    // Señal al azar contra la DFT directa en doble precisión
+    std::vector<float> inputRe( N ), inputIm( N );
+    Uint32 seed = 1;
+    for( int i = 0; i < N; ++i )
+    {
+        seed = seed * 1103515245 + 12345;
+        inputRe[ i ] = ( ( seed >> 8 ) & 0xFFFF ) / 32768.0f - 1.0f;
+        seed = seed * 1103515245 + 12345;
+        inputIm[ i ] = ( ( seed >> 8 ) & 0xFFFF ) / 32768.0f - 1.0f;
+    }
+    std::vector<double> dftRe( N, 0.0 ), dftIm( N, 0.0 );
+    double magnitude = 0.0;
+    for( int k = 0; k < N; ++k )
+    {
+        for( int n = 0; n < N; ++n )
+        {
+            double angle = -2.0 * M_PI * ( ( (long long)k * n ) % N ) / N;
+            dftRe[ k ] += inputRe[ n ] * cos( angle ) - inputIm[ n ] * sin( angle );
+            dftIm[ k ] += inputRe[ n ] * sin( angle ) + inputIm[ n ] * cos( angle );
+        }
+        magnitude = fmax( magnitude, hypot( dftRe[ k ], dftIm[ k ] ) );
+    }
+
+    std::vector<float> re( N ), im( N );
+    const char* names[ 2 ] = { "escalar", "SIMD" };
+    for( int simd = 0; simd < 2; ++simd )
+    {
+        analyzer->setSimd( simd == 1 );
+        re = inputRe;
+        im = inputIm;
+        analyzer->transform( re.data(), im.data() );
+        double error = 0.0;
+        for( int k = 0; k < N; ++k )
+        {
+            error = fmax( error, hypot( re[ k ] - dftRe[ k ], im[ k ] - dftIm[ k ] ) / magnitude );
+        }
+        if( error > 1e-4 )
+        {
+            ++errors;
+        }
+
+        // Tiempo por transformada
+        const int repetitions = 2000;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for( int r = 0; r < repetitions; ++r )
+        {
+            // Se restaura la entrada para no medir con valores desbordados
+            memcpy( re.data(), inputRe.data(), N * sizeof( float ) );
+            memcpy( im.data(), inputIm.data(), N * sizeof( float ) );
+            analyzer->transform( re.data(), im.data() );
+        }
+        double us = (double)( SDL_GetPerformanceCounter() - start ) * 1e6 / SDL_GetPerformanceFrequency() / repetitions;
+        printf( "FFT %d puntos %s: %.2f us, error relativo %.2g\n", N, names[ simd ], us, error );
+    }
+    analyzer->setSimd( true );
+
+    // Seno de 1 kHz a media escala: -9 dB de nivel, -6 dB de pico y la banda
+    // más alta cerca de -6 dB
+    std::vector<float> sine( spec.freq / 2 * spec.channels );
+    for( int i = 0; i < spec.freq / 2; ++i )
+    {
+        sine[ 2 * i ] = sine[ 2 * i + 1 ] = 0.5f * sinf( 2.0f * (float)M_PI * 1000.0f * i / spec.freq );
+    }
+    analyzer->process( (const Uint8*)sine.data(), sine.size() * sizeof( float ) );
+
+    LSpectrumAnalyzer::Result result;
+    analyzer->getResult( result );
+    float strongest = 0.0f;
+    for( int b = 0; b < LSpectrumAnalyzer::BANDS; ++b )
+    {
+        strongest = fmax( strongest, result.bands[ b ] );
+    }
+    if( fabs( result.level[ 0 ] - ( 60.0 - 9.03 ) / 60.0 ) > 0.02 || fabs( result.peak[ 0 ] - ( 60.0 - 6.02 ) / 60.0 ) > 0.02
+            || fabs( strongest - ( 72.0 - 6.02 ) / 72.0 ) > 0.03 )
+    {
+        ++errors;
+    }
+    printf( "Seno de 1 kHz: nivel %.3f, pico %.3f, banda más alta %.3f\n",
+            result.level[ 0 ], result.peak[ 0 ], strongest );
+
+    // Análisis completo por salto: conversión, nivel, ventana, FFT y bandas
+    const int hops = 2000;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int h = 0; h < hops; ++h )
+    {
+        int offset = ( h * LSpectrumAnalyzer::HOP ) % ( spec.freq / 2 - LSpectrumAnalyzer::HOP );
+        analyzer->process( (const Uint8*)( sine.data() + offset * spec.channels ),
+                LSpectrumAnalyzer::HOP * spec.channels * sizeof( float ) );
+    }
+    double analysisMs = (double)( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency() / hops;
+
+    // Lado del renderizador: copiar el resultado y calcular los rectángulos
+    SDL_Rect rects[ LSpectrumAnalyzer::BANDS + 2 * LSpectrumAnalyzer::METER_CHANNELS ];
+    const int frames = 100000;
+    start = SDL_GetPerformanceCounter();
+    for( int f = 0; f < frames; ++f )
+    {
+        analyzer->getResult( result );
+        layoutSpectrum( result, rects );
+    }
+    double frameMs = (double)( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency() / frames;
+
+    // A 60 frames por segundo cada frame carga con los análisis de su
+    // sesenteavo de segundo más su propia lectura
+    double analysesPerFrame = (double)spec.freq / LSpectrumAnalyzer::HOP / 60.0;
+    double perFrame = analysisMs * analysesPerFrame + frameMs;
+    printf( "Por frame a 60 Hz: %.4f ms (%.2f análisis de %.4f ms y %.5f ms del renderizador), objetivo 0.5 ms%s\n",
+            perFrame, analysesPerFrame, analysisMs, frameMs, perFrame > 0.5 ? ", excedido" : "" );
+    printf( "%d errores\n", errors );
+
+    delete analyzer;
+    return errors > 0 ? -1 : 0;
+}
+
+int benchmarkAdpcm()
+{
+    const int FREQUENCY = 44100;
+    const int CHANNELS = 2;
+    const int SECONDS = 20;
+    int errors = 0;
+
+    // Señal de prueba: barrido de 100 Hz a 8 kHz con un segundo tono y ruido
+    int frames = FREQUENCY * SECONDS;
+    std::vector<float> input( frames * CHANNELS );
+    Uint32 seed = 1;
+    double phase = 0.0;
+    for( int i = 0; i < frames; ++i )
+    {
+        double frequency = 100.0 * pow( 80.0, (double)i / frames );
+        phase += 2.0 * M_PI * frequency / FREQUENCY;
+        seed = seed * 1103515245 + 12345;
+        float noise = ( ( seed >> 8 ) & 0xFFFF ) / 65536.0f - 0.5f;
+        float sample = 0.4f * sinf( phase ) + 0.2f * sinf( 2.0 * M_PI * 330.0 * i / FREQUENCY ) + 0.02f * noise;
+        input[ i * CHANNELS ] = sample;
+        input[ i * CHANNELS + 1 ] = 0.8f * sample;
+    }
+
+    int blockAlign = LAdpcmCodec::getBlockAlign( CHANNELS );
+    int framesPerBlock = LAdpcmCodec::getFramesPerBlock( blockAlign, CHANNELS );
+    int blocks = frames / framesPerBlock;
+    std::vector<Sint16> pcm( framesPerBlock * CHANNELS );
+    std::vector<Uint8> encoded( blocks * blockAlign );
+    std::vector<Sint16> reference( blocks * framesPerBlock * CHANNELS );
+    std::vector<float> output( blocks * framesPerBlock * CHANNELS );
+
+    // Codifica igual que el hilo escritor: conversión a 16 bits y bloques
+    LAdpcmCodec codec;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int b = 0; b < blocks; ++b )
+    {
+        LAdpcmCodec::toS16( (const Uint8*)&input[ b * framesPerBlock * CHANNELS ], AUDIO_F32,
+                framesPerBlock * CHANNELS, pcm.data() );
+        codec.encodeBlock( pcm.data(), CHANNELS, &encoded[ b * blockAlign ] );
+    }
+    double encodeSeconds = (double)( SDL_GetPerformanceCounter() - start ) / SDL_GetPerformanceFrequency();
+
+    // Decodifica igual que el hilo lector
+    start = SDL_GetPerformanceCounter();
+    for( int b = 0; b < blocks; ++b )
+    {
+        LAdpcmCodec::decodeBlock( &encoded[ b * blockAlign ], blockAlign, CHANNELS, pcm.data() );
+        LAdpcmCodec::fromS16( pcm.data(), framesPerBlock * CHANNELS, AUDIO_F32,
+                (Uint8*)&output[ b * framesPerBlock * CHANNELS ] );
+    }
+    double decodeSeconds = (double)( SDL_GetPerformanceCounter() - start ) / SDL_GetPerformanceFrequency();
+
+    // Relación señal a ruido del audio decodificado
+    double signal = 0.0;
+    double noise = 0.0;
+    for( size_t i = 0; i < output.size(); ++i )
+    {
+        signal += (double)input[ i ] * input[ i ];
+        noise += ( (double)input[ i ] - output[ i ] ) * ( (double)input[ i ] - output[ i ] );
+    }
+    double snr = 10.0 * log10( signal / noise );
+    if( snr < 20.0 )
+    {
+        ++errors;
+    }
+
+    double inputBytes = (double)blocks * framesPerBlock * CHANNELS * sizeof( float );
+    double audioSeconds = (double)blocks * framesPerBlock / FREQUENCY;
+    printf( "IMA-ADPCM: %.2f:1 frente a flotante, %.2f:1 frente a 16 bits, SNR %.1f dB\n",
+            inputBytes / encoded.size(), inputBytes / 2 / encoded.size(), snr );
+    printf( "Codificación: %.1f MB/s de entrada, %.0fx tiempo real\n",
+            inputBytes / encodeSeconds / ( 1024.0 * 1024.0 ), audioSeconds / encodeSeconds );
+    printf( "Decodificación: %.1f MB/s de salida, %.0fx tiempo real\n",
+            inputBytes / decodeSeconds / ( 1024.0 * 1024.0 ), audioSeconds / decodeSeconds );
+    printf( "%d errores\n", errors );
+    return errors > 0 ? -1 : 0;
+}
+
+int benchmarkResample()
+{
+    const int SECONDS = 10;
+    const int CHANNELS = 2;
+    const double TONE = 1000.0;
+    const char* qualityNames[ 4 ] = { "rápida", "media", "alta", "máxima" };
+    const char* names[ 2 ] = { "escalar", "SIMD" };
+    int errors = 0;
+
+    // Formatos sin remuestreo: 16 bits vuelve idéntico y estéreo a mono
+    // promedia los canales
+    {
+        SDL_AudioSpec input;
+        SDL_zero( input );
+        input.freq = 44100;
+        input.format = AUDIO_S16;
+        input.channels = 2;
+        SDL_AudioSpec output = input;
+        output.channels = 1;
+
+        std::vector<Sint16> samples( LAudioConverter::MAX_BLOCK_FRAMES * 2 );
+        Uint32 seed = 1;
+        for( size_t i = 0; i < samples.size(); ++i )
+        {
+            seed = seed * 1103515245 + 12345;
+            samples[ i ] = (Sint16)( seed >> 16 );
+        }
+        std::vector<Sint16> converted( samples.size() );
+        LAudioConverter converter;
+        converter.configure( input, input, RESAMPLE_HIGH );
+        int frames = converter.process( (const Uint8*)samples.data(), LAudioConverter::MAX_BLOCK_FRAMES,
+                (Uint8*)converted.data() );
+        if( frames != LAudioConverter::MAX_BLOCK_FRAMES || converted != samples )
+        {
+            ++errors;
+        }
+
+        converter.configure( input, output, RESAMPLE_HIGH );
+        converter.process( (const Uint8*)samples.data(), LAudioConverter::MAX_BLOCK_FRAMES, (Uint8*)converted.data() );
+        for( int i = 0; i < LAudioConverter::MAX_BLOCK_FRAMES; ++i )
+        {
+            int average = ( samples[ 2 * i ] + samples[ 2 * i + 1 ] ) / 2;
+            if( abs( converted[ i ] - average ) > 1 )
+            {
+                ++errors;
+                break;
+            }
+        }
+        printf( "Formato y canales: %d errores\n", errors );
+    }
+
+    // Seno de 1 kHz a media escala en estéreo flotante, subiendo y bajando
+    // la frecuencia con cada calidad
+    int rates[ 2 ][ 2 ] = { { 44100, 48000 }, { 48000, 44100 } };
+    for( int r = 0; r < 2; ++r )
+    {
+        SDL_AudioSpec input;
+        SDL_zero( input );
+        input.freq = rates[ r ][ 0 ];
+        input.format = AUDIO_F32;
+        input.channels = CHANNELS;
+        SDL_AudioSpec output = input;
+        output.freq = rates[ r ][ 1 ];
+
+        int frames = input.freq * SECONDS;
+        std::vector<float> signal( frames * CHANNELS );
+        for( int i = 0; i < frames; ++i )
+        {
+            float sample = 0.5f * sin( 2.0 * M_PI * TONE * i / input.freq );
+            signal[ i * CHANNELS ] = sample;
+            signal[ i * CHANNELS + 1 ] = -sample;
+        }
+
+        // La salida dura lo mismo que la entrada, redondeando hacia arriba
+        int expected = (int)( ( (Uint64)frames * output.freq + input.freq - 1 ) / input.freq );
+        for( int q = RESAMPLE_FAST; q <= RESAMPLE_BEST; ++q )
+        {
+            LAudioConverter converter;
+            converter.configure( input, output, (ResampleQuality)q );
+            std::vector<float> results[ 2 ];
+            double rate[ 2 ];
+            for( int simd = 0; simd < 2; ++simd )
+            {
+                // Bloques del tamaño máximo, como el hilo lector
+                converter.setSimd( simd == 1 );
+                converter.reset();
+                results[ simd ].resize( ( expected + converter.getMaxOutputFrames( LAudioConverter::MAX_BLOCK_FRAMES ) )
+                        * CHANNELS );
+                int produced = 0;
+                Uint64 start = SDL_GetPerformanceCounter();
+                for( int offset = 0; offset < frames; offset += LAudioConverter::MAX_BLOCK_FRAMES )
+                {
+                    int count = frames - offset < LAudioConverter::MAX_BLOCK_FRAMES ? frames - offset
+                        : LAudioConverter::MAX_BLOCK_FRAMES;
+                    produced += converter.process( (const Uint8*)&signal[ offset * CHANNELS ], count,
+                            (Uint8*)&results[ simd ][ produced * CHANNELS ] );
+                }
+                produced += converter.flush( (Uint8*)&results[ simd ][ produced * CHANNELS ] );
+                double seconds = (double)( SDL_GetPerformanceCounter() - start ) / SDL_GetPerformanceFrequency();
+                rate[ simd ] = (double)produced * CHANNELS / seconds;
+                if( produced != expected )
+                {
+                    ++errors;
+                }
+                results[ simd ].resize( produced * CHANNELS );
+            }
 
-    // Se mueve a traves del buffer
-    gBufferBytePosition += len;
+            // Error frente al seno ideal, sin los bordes que el filtro ve
+            // contra silencio, y diferencia entre las dos versiones
+            double power = 0.0;
+            double noise = 0.0;
+            double difference = 0.0;
+            int edge = converter.getTaps() * 2;
+            for( int i = edge; i < expected - edge; ++i )
+            {
+                double ideal = 0.5 * sin( 2.0 * M_PI * TONE * i / output.freq );
+                power += 2.0 * ideal * ideal;
+                noise += ( results[ 1 ][ i * CHANNELS ] - ideal ) * ( results[ 1 ][ i * CHANNELS ] - ideal );
+                noise += ( results[ 1 ][ i * CHANNELS + 1 ] + ideal ) * ( results[ 1 ][ i * CHANNELS + 1 ] + ideal );
+                for( int c = 0; c < CHANNELS; ++c )
+                {
+                    difference = fmax( difference,
+                            fabs( results[ 1 ][ i * CHANNELS + c ] - results[ 0 ][ i * CHANNELS + c ] ) );
+                }
+            }
+            double snr = 10.0 * log10( power / noise );
+            if( snr < 40.0 || difference > 1e-5 )
+            {
+                ++errors;
+            }
+            printf( "%d a %d Hz, calidad %s (%d coeficientes): SNR %.1f dB, %s %.1f M muestras/s, %s %.1f M muestras/s\n",
+                    input.freq, output.freq, qualityNames[ q ], converter.getTaps(), snr,
+                    names[ 0 ], rate[ 0 ] / 1e6, names[ 1 ], rate[ 1 ] / 1e6 );
+        }
+    }
+    printf( "%d errores\n", errors );
+    return errors > 0 ? -1 : 0;
 }
 
 int main( int argc, char* argv[] ) {
+    // Prueba de estrés sin ventana; por defecto con el driver dummy
+    if( argc > 1 && strcmp( argv[ 1 ], "--stress" ) == 0 ) {
+        SDL_setenv( "SDL_AUDIODRIVER", "dummy", 0 );
+        if( SDL_Init( SDL_INIT_AUDIO ) < 0 ) {
+            printf( "SDL no pudo inicializarse! SDL Error: %s\n", SDL_GetError() );
+            return -1;
+        }
+        int result = stressRingBuffer( argc > 2 ? atoi( argv[ 2 ] ) : 5 );
+        remove( STRESS_RECORDING_FILE );
+        SDL_Quit();
+        return result;
+    }
+
+    // Comprobación y costo del analizador de espectro, sin audio ni ventana
+    if( argc > 1 && strcmp( argv[ 1 ], "--spectrum" ) == 0 ) {
+        return benchmarkSpectrum();
+    }
+
+    // Compresión de la grabación, sin audio ni ventana
+    if( argc > 1 && strcmp( argv[ 1 ], "--adpcm" ) == 0 ) {
+        return benchmarkAdpcm();
+    }
+
+    // Conversión entre formatos de captura y reproducción, sin audio ni ventana
+    if( argc > 1 && strcmp( argv[ 1 ], "--resample" ) == 0 ) {
+        return benchmarkResample();
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -444,10 +3217,6 @@ int main( int argc, char* argv[] ) {
     // Set the default recording state
     RecordingState currentState = SELECTING_DEVICE;
 
-    // Audio device ID's
-    SDL_AudioDeviceID recordingDeviceId = 0;
-    SDL_AudioDeviceID playbackDeviceId = 0;
-
     while( !quit ) {
         bool renderText = false;
         while( SDL_PollEvent( &e ) != 0 ) {
@@ -481,12 +3250,14 @@ int main( int argc, char* argv[] ) {
                                 desiredRecordingSpec.callback = audioRecordingCallback;
     
                                 // Open recording device
-                                recordingDeviceId = SDL_OpenAudioDevice( SDL_GetAudioDeviceName
+                                // Se acepta el formato nativo del dispositivo; el lector
+                                // convierte la grabación al de reproducción
+                                gRecordingDeviceId = SDL_OpenAudioDevice( SDL_GetAudioDeviceName
                                         ( index, SDL_TRUE ), SDL_TRUE, &desiredRecordingSpec, 
-                                        &gReceivedRecordingSpec, SDL_AUDIO_ALLOW_FORMAT_CHANGE );
+                                        &gReceivedRecordingSpec, SDL_AUDIO_ALLOW_ANY_CHANGE );
     
                                 // Device failed to open
-                                if( recordingDeviceId == 0 )
+                                if( gRecordingDeviceId == 0 )
                                 {
                                     // Reporta el error
                                     printf( "Falló en abrir el dispositivo de grabación! SDL Error: %s\n", SDL_GetError() );
@@ -503,13 +3274,13 @@ int main( int argc, char* argv[] ) {
                                     desiredPlaybackSpec.format = AUDIO_F32;
                                     desiredPlaybackSpec.channels = 2;
                                     desiredPlaybackSpec.samples = 4096;
-                                    desiredPlaybackSpec.callback = audioRecordingCallback;
+                                    desiredPlaybackSpec.callback = audioPlaybackCallback;
                                     
                                     // Open playback device
-                                    playbackDeviceId = SDL_OpenAudioDevice( NULL, SDL_FALSE, &desiredPlaybackSpec, &gReceivedPlaybackSpec, SDL_AUDIO_ALLOW_FORMAT_CHANGE );
+                                    gPlaybackDeviceId = SDL_OpenAudioDevice( NULL, SDL_FALSE, &desiredPlaybackSpec, &gReceivedPlaybackSpec, SDL_AUDIO_ALLOW_ANY_CHANGE );
     
                                     // Device failed to open
-                                    if( playbackDeviceId == 0 )
+                                    if( gPlaybackDeviceId == 0 )
                                     {
                                         // Reporta el error
                                         printf( "Falló en abrir el dispositivo de repoducción! SDL Erorr: %s\n", SDL_GetError() );
@@ -523,17 +3294,17 @@ int main( int argc, char* argv[] ) {
                                         int bytesPerSample = gReceivedRecordingSpec.channels * ( SDL_AUDIO_BITSIZE( gReceivedRecordingSpec.format ) / 8 );
     
                                         // Calculate bytes per second
-                                        int bytesPerSecond = gReceivedRecordingSpec.freq * bytesPerSample;
-    
-                                        // Calculate max buffer use
-                                        gBufferByteMaxPosition = MAX_RECORDING_SECONDS * bytesPerSecond;
+                                        gBytesPerSecond = gReceivedRecordingSpec.freq * bytesPerSample;
     
-                                        // Allocate and initialize byte buffer
-                                        gRecordingBuffer = new Uint8[ gBufferByteSize ];
-                                        memset( gRecordingBuffer, 0, gBufferByteSize );
+                                        // El buffer de captura sólo cubre unos segundos; el
+                                        // hilo escritor lo va vaciando a disco
+                                        gCaptureRing.allocate( RING_BUFFER_SECONDS * gBytesPerSecond );
+
+                                        // Sin analizador se graba igual, sólo falta el medidor
+                                        gSpectrum.open( gReceivedRecordingSpec );
     
                                         // Go on to next state
-                                        gPromptTexture.loadFromRenderedText( "Press 1 to record for 5 seconds", gTextColor );
+                                        gPromptTexture.loadFromRenderedText( "Press 1 to record, 3 for ADPCM", gTextColor );
                                         currentState = STOPPED;
                                     }
                                 }
@@ -551,18 +3322,45 @@ int main( int argc, char* argv[] ) {
                         if( e.key.keysym.sym == SDLK_1 )
                         {
                             // Go back to beginning of buffer
-                            gBufferBytePosition = 0;
+                            gCaptureRing.reset();
+                            if( !gWavWriter.open( RECORDING_FILE, gReceivedRecordingSpec, &gCaptureRing, WAV_SYNC_ON_CLOSE, gCaptureCodec ) )
+                            {
+                                gPromptTexture.loadFromRenderedText( "Failed to create the recording file!", gTextColor );
+                                currentState = ERROR;
+                                break;
+                            }
     
                             // Start recording
-                            SDL_PauseAudioDevice( recordingDeviceId, SDL_FALSE );
+                            SDL_PauseAudioDevice( gRecordingDeviceId, SDL_FALSE );
     
                             // Go on the next state
-                            gPromptTexture.loadFromRenderedText( "Recording...", gTextColor );
+                            gPromptTexture.loadFromRenderedText( "Recording... Press 1 to stop.", gTextColor );
     
                             currentState = RECORDING;
                         }
+
+                        // Cambia entre PCM y IMA-ADPCM para la próxima grabación
+                        if( e.key.keysym.sym == SDLK_3 )
+                        {
+                            gCaptureCodec = gCaptureCodec == WAV_CODEC_PCM ? WAV_CODEC_IMA_ADPCM : WAV_CODEC_PCM;
+                        }
                     }
                 break;
+
+                // User is recording
+                case RECORDING:
+                    // Stop recording
+                    if( e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_1 )
+                    {
+                        // Una vez pausado el callback ya no escribe; el escritor
+                        // vacía lo que quede y corrige la cabecera
+                        SDL_PauseAudioDevice( gRecordingDeviceId, SDL_TRUE );
+                        gWavWriter.close();
+
+                        gPromptTexture.loadFromRenderedText( "Press 1 to play back. Press 2 to record again.", gTextColor );
+                        currentState = RECORDED;
+                    }
+                    break;
     
                 // User has finished recording
                 case RECORDED:
@@ -572,11 +3370,17 @@ int main( int argc, char* argv[] ) {
                         // Start playback
                         if( e.key.keysym.sym == SDLK_1 )
                         {
-                            // Go back to beginning of buffer
-                            gBufferBytePosition = 0;
+                            // Abre la grabación, convertida al formato del dispositivo,
+                            // y llena la lectura anticipada
+                            if( !gWavReader.open( RECORDING_FILE, &gPlaybackRing, PLAYBACK_PREFETCH_MS,
+                                        gReceivedPlaybackSpec, PLAYBACK_QUALITY ) )
+                            {
+                                break;
+                            }
+                            gPlaybackUnderruns = 0;
     
                             // Start playback
-                            SDL_PauseAudioDevice( playbackDeviceId, SDL_FALSE );
+                            SDL_PauseAudioDevice( gPlaybackDeviceId, SDL_FALSE );
     
                             // Go on to the next state
                             gPromptTexture.loadFromRenderedText( "Playing...", gTextColor );
@@ -587,61 +3391,75 @@ int main( int argc, char* argv[] ) {
                         if( e.key.keysym.sym == SDLK_2 )
                         {
                             // Reset the buffer
-                            gBufferBytePosition = 0;
-                            memset( gRecordingBuffer, 0, gBufferByteSize );
+                            gCaptureRing.reset();
+                            if( !gWavWriter.open( RECORDING_FILE, gReceivedRecordingSpec, &gCaptureRing, WAV_SYNC_ON_CLOSE, gCaptureCodec ) )
+                            {
+                                gPromptTexture.loadFromRenderedText( "Failed to create the recording file!", gTextColor );
+                                currentState = ERROR;
+                                break;
+                            }
     
                             // Start recording
-                            SDL_PauseAudioDevice( recordingDeviceId, SDL_FALSE );
+                            SDL_PauseAudioDevice( gRecordingDeviceId, SDL_FALSE );
     
                             // Go on to next state
-                            gPromptTexture.loadFromRenderedText( "Recording...", gTextColor );
+                            gPromptTexture.loadFromRenderedText( "Recording... Press 1 to stop.", gTextColor );
 
                             currentState = RECORDING;
                         }
+
+                        // Cambia entre PCM y IMA-ADPCM para la próxima grabación
+                        if( e.key.keysym.sym == SDLK_3 )
+                        {
+                            gCaptureCodec = gCaptureCodec == WAV_CODEC_PCM ? WAV_CODEC_IMA_ADPCM : WAV_CODEC_PCM;
+                        }
                     }
                     break;
                 }
         }
 
-        // Actualizando la grabación
-        if( currentState == RECORDING )
-        {
-            // Lock Callback
-            SDL_LockAudioDevice( recordingDeviceId );
-
-            // Finished recording
-            if( gBufferBytePosition > gBufferByteMaxPosition )
-            {
-                // Stop recording audio
-                SDL_PauseAudioDevice( recordingDeviceId, SDL_TRUE );
-
-                // go on to next stage
-                gPromptTexture.loadFromRenderedText( "Press 1 to play back. Press 2 to record again.", gTextColor );
-                currentState = RECORDED;
-            }
-            
-            // Unlock Callback
-            SDL_UnlockAudioDevice( recordingDeviceId );
-        }
-        // Actualizando playback
-        else if( currentState == PLAYBACK )
+        // Actualizando playback; los buffers los mantienen los hilos de disco
+        if( currentState == PLAYBACK )
         {
-            // Lock playback
-            SDL_LockAudioDevice( playbackDeviceId );
-
             // Finished playback
-            if( gBufferBytePosition > gBufferByteMaxPosition )
+            if( gWavReader.isFinished() && gPlaybackRing.getReadable() == 0 )
             {
                 // Stop playing audio
-                SDL_PauseAudioDevice( playbackDeviceId, SDL_TRUE );
+                SDL_PauseAudioDevice( gPlaybackDeviceId, SDL_TRUE );
+                gWavReader.close();
 
                 // Go on to next state
                 gPromptTexture.loadFromRenderedText( "Press 1 to playback. Press 2 to record again.", gTextColor );
                 currentState = RECORDED;
             }
+        }
 
-            // Unlock callback
-            SDL_UnlockAudioDevice( playbackDeviceId );
+        // Actualiza el estado cuando cambia el segundo grabado, los desbordes,
+        // los vacíos de la reproducción o la codificación
+        static int shownSeconds = -1;
+        static int shownOverruns = -1;
+        static int shownUnderruns = -1;
+        static int shownCodec = -1;
+        if( gBytesPerSecond > 0 && ( (int)( gWavWriter.getDataBytes() / gBytesPerSecond ) != shownSeconds
+                    || gCaptureRing.getOverruns() != shownOverruns || gPlaybackUnderruns != shownUnderruns
+                    || gCaptureCodec != shownCodec ) )
+        {
+            shownSeconds = gWavWriter.getDataBytes() / gBytesPerSecond;
+            shownOverruns = gCaptureRing.getOverruns();
+            shownUnderruns = gPlaybackUnderruns;
+            shownCodec = gCaptureCodec;
+            std::stringstream statusText;
+            statusText << ( gCaptureCodec == WAV_CODEC_IMA_ADPCM ? "ADPCM, " : "PCM, " ) << shownSeconds << " s";
+
+            // Relación de compresión de la grabación actual
+            Uint64 storedBytes = gWavWriter.getStoredBytes();
+            if( storedBytes > 0 && storedBytes < gWavWriter.getDataBytes() )
+            {
+                int tenths = gWavWriter.getDataBytes() * 10 / storedBytes;
+                statusText << " (" << tenths / 10 << "." << tenths % 10 << ":1)";
+            }
+            statusText << ", " << shownOverruns << " overruns, " << shownUnderruns << " underruns";
+            gStatusTexture.loadFromRenderedText( statusText.str().c_str(), gTextColor );
         }
 
         // Limpia la pantalla
@@ -650,7 +3468,22 @@ int main( int argc, char* argv[] ) {
 
         // Rendereiza las texturas del texto
         gPromptTexture.render( ( SCREEN_WIDTH - gPromptTexture.getWidth() ) / 2, 0 );
+        if( currentState != SELECTING_DEVICE )
+        {
+            gStatusTexture.render( ( SCREEN_WIDTH - gStatusTexture.getWidth() ) / 2,
+                    SCREEN_HEIGHT - gStatusTexture.getHeight() );
+        }
     
+        // Espectro y nivel de lo que se está grabando
+        if( currentState == RECORDING )
+        {
+            LSpectrumAnalyzer::Result result;
+            if( gSpectrum.getResult( result ) )
+            {
+                renderSpectrum( result );
+            }
+        }
+
         // User is selecting
         if( currentState == SELECTING_DEVICE )
         {
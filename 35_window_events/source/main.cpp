@@ -1,8 +1,12 @@
 #include <stdio.h>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <string.h>
+#include <math.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
 
 
 // Constantes de la pantalla
@@ -20,11 +24,6 @@ class LTexture {
 
         // Carga la imagen en el path especificado
         bool loadFromFile( std::string path );
- 
-        #if defined(SDL_TTF_MAJOR_VERSION)
-        // Crea una imagen desde un font string
-        bool loadFromRenderedText( std::string textureText, SDL_Color textColor );
-        #endif
 
         // Establece la modulación de color
         void setColor( Uint8 red, Uint8 green, Uint8 blue );
@@ -100,6 +99,120 @@ class LWindow
         bool mMinimized;
 };
 
+// Atlas de campos de distancia con signo (SDF) de los caracteres ASCII. Se
+// genera una sola vez desde la TTF a gran tamaño y se guarda en un archivo;
+// después el texto se reconstruye a cualquier tamaño sin volver a rasterizar
+class LSDFFont {
+    public:
+        // Tamaño de fuente del atlas y factor de sobremuestreo al generarlo
+        static const int SDF_SIZE = 32;
+        static const int SDF_SCALE = 4;
+
+        // Pixeles del atlas que cubre el campo a cada lado del borde
+        static const int SPREAD = 4;
+
+        // Dimensiones del atlas
+        static const int ATLAS_SIZE = 512;
+
+        // Caracteres ASCII imprimibles
+        static const int FIRST_CHAR = 32;
+        static const int GLYPH_COUNT = 95;
+
+        // Inicializa las variables
+        LSDFFont();
+
+        // Genera el atlas rasterizando la fuente una sola vez
+        bool generate( std::string fontPath );
+
+        // Carga o guarda el atlas ya generado; al cargar se rechaza si la
+        // fuente ya no es la misma con la que se generó
+        bool loadFromFile( std::string path, std::string fontPath );
+        bool saveToFile( std::string path );
+
+        // Dimensiones del texto al tamaño en pixeles dado
+        float getTextWidth( const char* text, float pixelSize );
+        float getLineHeight( float pixelSize );
+
+        // Reconstruye el texto en un buffer alpha con umbral sobre la distancia
+        void reconstruct( const char* text, float pixelSize, float originX, float originY,
+                Uint8* alpha, int width, int height );
+
+    private:
+        // Celda del glifo en el atlas; el avance está en pixeles de generación
+        struct Glyph {
+            Sint32 x;
+            Sint32 y;
+            Sint32 w;
+            Sint32 h;
+            Sint32 advance;
+        };
+
+        // Obtiene el glifo de un caracter
+        Glyph& getGlyph( char ch );
+
+        // Muestreo bilineal de la distancia dentro de una celda
+        float sample( Glyph& glyph, float u, float v );
+
+        // Transformada de distancia 8SSEDT sobre una rejilla de desplazamientos
+        static void distanceTransform( std::vector<SDL_Point>& grid, int w, int h );
+
+        // Tamaño y CRC-32 del archivo de la fuente
+        static bool getFontFingerprint( std::string fontPath, Uint32 fingerprint[ 2 ] );
+
+        Glyph mGlyphs[ GLYPH_COUNT ];
+        std::vector<Uint8> mAtlas;
+
+        // Alto de línea en pixeles de generación
+        Sint32 mLineHeight;
+
+        // Huella de la fuente con la que se generó el atlas
+        Uint32 mFontFingerprint[ 2 ];
+};
+
+// Texto reconstruido desde un LSDFFont en una textura streaming. Cambiar el
+// tamaño sólo repite la pasada de umbral en CPU, nunca rasteriza la fuente
+class LSDFText {
+    public:
+        // Inicializa las variables
+        LSDFText();
+
+        // Libera la memoria
+        ~LSDFText();
+
+        // Establece el texto y su tamaño; sólo reconstruye si cambian
+        void setText( LSDFFont& font, std::string text, int pixelSize );
+
+        // Renderiza el texto con su esquina superior izquierda en x, y
+        void render( int x, int y, SDL_Color color );
+
+        // Dimensiones del texto
+        int getWidth();
+        int getHeight();
+
+        // Veces que se ha reconstruido
+        int getReconstructions();
+
+        // Libera la textura
+        void free();
+
+    private:
+        // Textura streaming, sólo crece
+        SDL_Texture* mTexture;
+        int mTextureWidth;
+        int mTextureHeight;
+
+        // Texto actual y su caja con el margen del campo
+        std::string mText;
+        int mPixelSize;
+        int mWidth;
+        int mHeight;
+        int mPad;
+
+        // Buffer alpha de la reconstrucción
+        std::vector<Uint8> mAlpha;
+        int mReconstructions;
+};
+
 // Inicia SDL y crea la ventana
 bool init();
 
@@ -118,6 +231,14 @@ SDL_Renderer* gRenderer = NULL;
 // Texturas de la escena
 LTexture gSceneTexture;
 
+// Atlas SDF de la fuente y textos que escalan con la ventana
+LSDFFont gSDFFont;
+LSDFText gTitleText;
+LSDFText gSizeText;
+
+// Indica si el atlas se leyó del archivo o se tuvo que generar
+bool gSDFGenerated = false;
+
 LTexture::LTexture() {
     // Inicializa la textura
     mTexture = NULL;
@@ -169,37 +290,6 @@ bool LTexture::loadFromFile( std::string path ) {
     return mTexture != NULL;
 }
 
-#if defined(SDL_TTF_MAJOR_VERSION)
-bool LTexture::loadFromRenderedText( std::string textureText, SDL_Color textColor ) {
-    // Manejar la textura existente
-    free();
-
-    // Renderiza desde la superficie del texto
-    SDL_Surface* textSurface = TTF_RenderText_Solid( gFont, textureText.c_str(), textColor );
-    if( textSurface == NULL ) {
-        printf( "No se pudo renderizar la superficie del texto! SDL_ttf Error: %s\n", 
-                TTF_GetError() );
-    } else {
-        // Crea una textura desde la superficie de pixeles
-        mTexture = SDL_CreateTextureFromSurface( gRenderer, textSurface );
-        if( mTexture == NULL ) {
-            printf( "No se pudo crear la textura desde el texto renderizado! SDL Error: %s\n",
-                    SDL_GetError() );
-        } else {
-            // Obtiene las dimensiones de la imagen
-            mWidth = textSurface->w;
-            mHeight = textSurface->h;
-        }
-
-        // Manejar la anterior superficie
-        SDL_FreeSurface( textSurface );
-    }
-
-    // Devuelve la textura
-    return mTexture != NULL;
-}
-#endif
-
 void LTexture::setColor( Uint8 red, Uint8 green, Uint8 blue ) {
     // Textura modulada
     SDL_SetTextureColorMod( mTexture, red, green, blue );
@@ -419,6 +509,449 @@ bool LWindow::isMinimized()
     return mMinimized;
 }
 
+LSDFFont::LSDFFont() {
+    // Inicializa las variables
+    memset( mGlyphs, 0, sizeof( mGlyphs ) );
+    mLineHeight = 0;
+    mFontFingerprint[ 0 ] = 0;
+    mFontFingerprint[ 1 ] = 0;
+}
+
+void LSDFFont::distanceTransform( std::vector<SDL_Point>& grid, int w, int h ) {
+    // Cada celda guarda el desplazamiento al pixel semilla más cercano y se
+    // propaga con dos pasadas, una hacia delante y otra hacia atrás
+    const int INF = 9999;
+    #define SDF_DIST( p ) ( (p).x * (p).x + (p).y * (p).y )
+    #define SDF_COMPARE( x, y, ox, oy ) \
+    { \
+        int nx = ( x ) + ( ox ); \
+        int ny = ( y ) + ( oy ); \
+        SDL_Point other = { INF, INF }; \
+        if( nx >= 0 && nx < w && ny >= 0 && ny < h ) { \
+            other = grid[ ny * w + nx ]; \
+            other.x += ( ox ); \
+            other.y += ( oy ); \
+        } \
+        if( SDF_DIST( other ) < SDF_DIST( grid[ ( y ) * w + ( x ) ] ) ) { \
+            grid[ ( y ) * w + ( x ) ] = other; \
+        } \
+    }
+
+    for( int y = 0; y < h; ++y ) {
+        for( int x = 0; x < w; ++x ) {
+            SDF_COMPARE( x, y, -1, 0 );
+            SDF_COMPARE( x, y, 0, -1 );
+            SDF_COMPARE( x, y, -1, -1 );
+            SDF_COMPARE( x, y, 1, -1 );
+        }
+        for( int x = w - 1; x >= 0; --x ) {
+            SDF_COMPARE( x, y, 1, 0 );
+        }
+    }
+    for( int y = h - 1; y >= 0; --y ) {
+        for( int x = w - 1; x >= 0; --x ) {
+            SDF_COMPARE( x, y, 1, 0 );
+            SDF_COMPARE( x, y, 0, 1 );
+            SDF_COMPARE( x, y, -1, 1 );
+            SDF_COMPARE( x, y, 1, 1 );
+        }
+        for( int x = 0; x < w; ++x ) {
+            SDF_COMPARE( x, y, -1, 0 );
+        }
+    }
+
+    #undef SDF_COMPARE
+    #undef SDF_DIST
+}
+
+bool LSDFFont::getFontFingerprint( std::string fontPath, Uint32 fingerprint[ 2 ] ) {
+    SDL_RWops* file = SDL_RWFromFile( fontPath.c_str(), "rb" );
+    if( file == NULL ) {
+        return false;
+    }
+
+    // CRC-32 bit a bit por bloques, sin cargar la fuente entera
+    Uint32 size = 0;
+    Uint32 crc = 0xFFFFFFFF;
+    Uint8 buffer[ 4096 ];
+    size_t read;
+    while( ( read = SDL_RWread( file, buffer, 1, sizeof( buffer ) ) ) > 0 ) {
+        for( size_t i = 0; i < read; ++i ) {
+            crc ^= buffer[ i ];
+            for( int bit = 0; bit < 8; ++bit ) {
+                crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ) );
+            }
+        }
+        size += (Uint32)read;
+    }
+    SDL_RWclose( file );
+
+    fingerprint[ 0 ] = size;
+    fingerprint[ 1 ] = ~crc;
+    return true;
+}
+
+bool LSDFFont::generate( std::string fontPath ) {
+    // Fuente a gran tamaño para que el campo sea preciso
+    TTF_Font* font = TTF_OpenFont( fontPath.c_str(), SDF_SIZE * SDF_SCALE );
+    if( font == NULL ) {
+        printf( "Falló la carga de la fuente! SDL_ttf Error: %s\n", TTF_GetError() );
+        return false;
+    }
+    if( !getFontFingerprint( fontPath, mFontFingerprint ) ) {
+        mFontFingerprint[ 0 ] = 0;
+        mFontFingerprint[ 1 ] = 0;
+    }
+    mLineHeight = TTF_FontHeight( font );
+    mAtlas.assign( ATLAS_SIZE * ATLAS_SIZE, 0 );
+
+    // Empaquetado por estantes
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfHeight = 0;
+    int pad = SPREAD * SDF_SCALE;
+    bool success = true;
+
+    for( int i = 0; i < GLYPH_COUNT && success; ++i ) {
+        Glyph& glyph = mGlyphs[ i ];
+        char text[ 2 ] = { (char)( FIRST_CHAR + i ), '\0' };
+
+        int minX, maxX, minY, maxY, advance;
+        TTF_GlyphMetrics( font, text[ 0 ], &minX, &maxX, &minY, &maxY, &advance );
+        glyph.advance = advance;
+
+        // Rasteriza el caracter con la misma colocación que una cadena
+        SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+        SDL_Surface* glyphSurface = TTF_RenderUTF8_Solid( font, text, white );
+        int sourceW = glyphSurface != NULL ? glyphSurface->w : advance;
+        int sourceH = glyphSurface != NULL ? glyphSurface->h : mLineHeight;
+
+        // Celda con margen para el campo a cada lado
+        glyph.w = ( sourceW + SDF_SCALE - 1 ) / SDF_SCALE + 2 * SPREAD;
+        glyph.h = ( sourceH + SDF_SCALE - 1 ) / SDF_SCALE + 2 * SPREAD;
+        if( shelfX + glyph.w > ATLAS_SIZE ) {
+            shelfX = 0;
+            shelfY += shelfHeight;
+            shelfHeight = 0;
+        }
+        if( shelfY + glyph.h > ATLAS_SIZE ) {
+            printf( "El atlas SDF está lleno!\n" );
+            success = false;
+        }
+        glyph.x = shelfX;
+        glyph.y = shelfY;
+        shelfX += glyph.w;
+        if( glyph.h > shelfHeight ) {
+            shelfHeight = glyph.h;
+        }
+
+        if( glyphSurface == NULL || !success ) {
+            SDL_FreeSurface( glyphSurface );
+            continue;
+        }
+
+        // Semillas: los pixeles de dentro para una rejilla y los de fuera
+        // para la otra
+        int w = glyph.w * SDF_SCALE;
+        int h = glyph.h * SDF_SCALE;
+        SDL_Point seed = { 0, 0 };
+        SDL_Point empty = { 9999, 9999 };
+        std::vector<SDL_Point> inside( w * h, empty );
+        std::vector<SDL_Point> outside( w * h, seed );
+        Uint8* pixels = (Uint8*)glyphSurface->pixels;
+        for( int y = 0; y < sourceH; ++y ) {
+            for( int x = 0; x < sourceW; ++x ) {
+                if( pixels[ y * glyphSurface->pitch + x ] != 0 ) {
+                    inside[ ( y + pad ) * w + x + pad ] = seed;
+                    outside[ ( y + pad ) * w + x + pad ] = empty;
+                }
+            }
+        }
+        SDL_FreeSurface( glyphSurface );
+
+        distanceTransform( inside, w, h );
+        distanceTransform( outside, w, h );
+
+        // Baja el campo a la resolución del atlas promediando los cuatro
+        // pixeles alrededor del centro de cada celda: positivo dentro, 128 en
+        // el borde. La distancia entre centros de pixel sobra medio pixel
+        for( int cy = 0; cy < glyph.h; ++cy ) {
+            for( int cx = 0; cx < glyph.w; ++cx ) {
+                float distance = 0.0f;
+                for( int i = 0; i < 4; ++i ) {
+                    int index = ( cy * SDF_SCALE + SDF_SCALE / 2 - 1 + i / 2 ) * w
+                        + cx * SDF_SCALE + SDF_SCALE / 2 - 1 + i % 2;
+                    SDL_Point in = inside[ index ];
+                    SDL_Point out = outside[ index ];
+                    if( in.x == 0 && in.y == 0 ) {
+                        distance += sqrtf( (float)( out.x * out.x + out.y * out.y ) ) - 0.5f;
+                    } else {
+                        distance -= sqrtf( (float)( in.x * in.x + in.y * in.y ) ) - 0.5f;
+                    }
+                }
+                distance /= 4.0f;
+                float value = 128.0f + distance / SDF_SCALE * 127.0f / SPREAD;
+                value = value < 0.0f ? 0.0f : ( value > 255.0f ? 255.0f : value );
+                mAtlas[ ( glyph.y + cy ) * ATLAS_SIZE + glyph.x + cx ] = (Uint8)value;
+            }
+        }
+    }
+
+    TTF_CloseFont( font );
+    return success;
+}
+
+bool LSDFFont::loadFromFile( std::string path, std::string fontPath ) {
+    // Sin la huella de la fuente no se puede saber si el atlas sigue valiendo
+    Uint32 fingerprint[ 2 ];
+    if( !getFontFingerprint( fontPath, fingerprint ) ) {
+        return false;
+    }
+
+    SDL_RWops* file = SDL_RWFromFile( path.c_str(), "rb" );
+    if( file == NULL ) {
+        return false;
+    }
+
+    // La cabecera debe coincidir con los parámetros de este programa y con
+    // la fuente actual
+    char magic[ 4 ];
+    Sint32 header[ 5 ];
+    Sint32 expected[ 5 ] = { ATLAS_SIZE, SDF_SIZE, SDF_SCALE, SPREAD, GLYPH_COUNT };
+    bool success = SDL_RWread( file, magic, 4, 1 ) == 1 && memcmp( magic, "SDF2", 4 ) == 0
+        && SDL_RWread( file, header, sizeof( header ), 1 ) == 1
+        && memcmp( header, expected, sizeof( header ) ) == 0
+        && SDL_RWread( file, mFontFingerprint, sizeof( mFontFingerprint ), 1 ) == 1
+        && memcmp( mFontFingerprint, fingerprint, sizeof( fingerprint ) ) == 0
+        && SDL_RWread( file, &mLineHeight, sizeof( Sint32 ), 1 ) == 1
+        && SDL_RWread( file, mGlyphs, sizeof( mGlyphs ), 1 ) == 1
+        && mLineHeight > 0 && mLineHeight <= ATLAS_SIZE * SDF_SCALE;
+
+    // Cada celda tiene que caber en el atlas; sample() indexa sin comprobar
+    for( int i = 0; i < GLYPH_COUNT && success; ++i ) {
+        Glyph& glyph = mGlyphs[ i ];
+        success = glyph.w >= 1 && glyph.h >= 1
+            && glyph.x >= 0 && glyph.x <= ATLAS_SIZE - glyph.w
+            && glyph.y >= 0 && glyph.y <= ATLAS_SIZE - glyph.h
+            && glyph.advance >= 0 && glyph.advance <= ATLAS_SIZE * SDF_SCALE;
+    }
+    if( success ) {
+        mAtlas.resize( ATLAS_SIZE * ATLAS_SIZE );
+        success = SDL_RWread( file, mAtlas.data(), mAtlas.size(), 1 ) == 1;
+    }
+    if( !success ) {
+        printf( "Warning: El atlas SDF %s no es válido!\n", path.c_str() );
+    }
+
+    SDL_RWclose( file );
+    return success;
+}
+
+bool LSDFFont::saveToFile( std::string path ) {
+    SDL_RWops* file = SDL_RWFromFile( path.c_str(), "wb" );
+    if( file == NULL ) {
+        printf( "Error: No se pudo guardar el atlas SDF! SDL Error: %s\n", SDL_GetError() );
+        return false;
+    }
+
+    Sint32 header[ 5 ] = { ATLAS_SIZE, SDF_SIZE, SDF_SCALE, SPREAD, GLYPH_COUNT };
+    SDL_RWwrite( file, "SDF2", 4, 1 );
+    SDL_RWwrite( file, header, sizeof( header ), 1 );
+    SDL_RWwrite( file, mFontFingerprint, sizeof( mFontFingerprint ), 1 );
+    SDL_RWwrite( file, &mLineHeight, sizeof( Sint32 ), 1 );
+    SDL_RWwrite( file, mGlyphs, sizeof( mGlyphs ), 1 );
+    SDL_RWwrite( file, mAtlas.data(), mAtlas.size(), 1 );
+
+    SDL_RWclose( file );
+    return true;
+}
+
+LSDFFont::Glyph& LSDFFont::getGlyph( char ch ) {
+    // Los caracteres fuera de ASCII se muestran como '?'
+    int index = (Uint8)ch - FIRST_CHAR;
+    if( index < 0 || index >= GLYPH_COUNT ) {
+        index = '?' - FIRST_CHAR;
+    }
+    return mGlyphs[ index ];
+}
+
+float LSDFFont::getTextWidth( const char* text, float pixelSize ) {
+    float width = 0.0f;
+    for( const char* c = text; *c != '\0'; ++c ) {
+        width += getGlyph( *c ).advance;
+    }
+    return width * pixelSize / ( SDF_SIZE * SDF_SCALE );
+}
+
+float LSDFFont::getLineHeight( float pixelSize ) {
+    return mLineHeight * pixelSize / ( SDF_SIZE * SDF_SCALE );
+}
+
+float LSDFFont::sample( Glyph& glyph, float u, float v ) {
+    // Coordenadas de la celda con los centros en +0.5, sin salir de ella
+    u -= 0.5f;
+    v -= 0.5f;
+    u = u < 0.0f ? 0.0f : ( u > glyph.w - 1 ? glyph.w - 1 : u );
+    v = v < 0.0f ? 0.0f : ( v > glyph.h - 1 ? glyph.h - 1 : v );
+    int x = (int)u;
+    int y = (int)v;
+    int x1 = x + 1 < glyph.w ? x + 1 : x;
+    int y1 = y + 1 < glyph.h ? y + 1 : y;
+    float fx = u - x;
+    float fy = v - y;
+
+    const Uint8* row0 = &mAtlas[ ( glyph.y + y ) * ATLAS_SIZE + glyph.x ];
+    const Uint8* row1 = &mAtlas[ ( glyph.y + y1 ) * ATLAS_SIZE + glyph.x ];
+    float top = row0[ x ] + ( row0[ x1 ] - row0[ x ] ) * fx;
+    float bottom = row1[ x ] + ( row1[ x1 ] - row1[ x ] ) * fx;
+    return top + ( bottom - top ) * fy;
+}
+
+void LSDFFont::reconstruct( const char* text, float pixelSize, float originX, float originY,
+        Uint8* alpha, int width, int height ) {
+    // Pixeles de salida por pixel del atlas
+    float scale = pixelSize / SDF_SIZE;
+    float penX = originX;
+
+    for( const char* c = text; *c != '\0'; ++c ) {
+        Glyph& glyph = getGlyph( *c );
+
+        // Rectángulo de la celda en la salida, recortado al buffer
+        float cellX = penX - SPREAD * scale;
+        float cellY = originY - SPREAD * scale;
+        int x0 = (int)cellX > 0 ? (int)cellX : 0;
+        int y0 = (int)cellY > 0 ? (int)cellY : 0;
+        int x1 = (int)ceilf( cellX + glyph.w * scale );
+        int y1 = (int)ceilf( cellY + glyph.h * scale );
+        x1 = x1 < width ? x1 : width;
+        y1 = y1 < height ? y1 : height;
+
+        for( int y = y0; y < y1; ++y ) {
+            float v = ( y + 0.5f - cellY ) / scale;
+            for( int x = x0; x < x1; ++x ) {
+                float u = ( x + 0.5f - cellX ) / scale;
+
+                // Distancia en pixeles de salida; el borde queda suavizado
+                // en un pixel alrededor del umbral
+                float distance = ( sample( glyph, u, v ) - 128.0f ) * SPREAD / 127.0f * scale;
+                float coverage = distance + 0.5f;
+                coverage = coverage < 0.0f ? 0.0f : ( coverage > 1.0f ? 1.0f : coverage );
+
+                Uint8 a = (Uint8)( coverage * 255.0f );
+                if( a > alpha[ y * width + x ] ) {
+                    alpha[ y * width + x ] = a;
+                }
+            }
+        }
+
+        penX += glyph.advance * pixelSize / ( SDF_SIZE * SDF_SCALE );
+    }
+}
+
+LSDFText::LSDFText() {
+    // Inicializa las variables
+    mTexture = NULL;
+    mTextureWidth = 0;
+    mTextureHeight = 0;
+    mPixelSize = 0;
+    mWidth = 0;
+    mHeight = 0;
+    mPad = 0;
+    mReconstructions = 0;
+}
+
+LSDFText::~LSDFText() {
+    // Libera la memoria
+    free();
+}
+
+void LSDFText::free() {
+    // Libera la textura si existe
+    if( mTexture != NULL ) {
+        SDL_DestroyTexture( mTexture );
+        mTexture = NULL;
+        mTextureWidth = 0;
+        mTextureHeight = 0;
+    }
+    mText.clear();
+    mPixelSize = 0;
+}
+
+void LSDFText::setText( LSDFFont& font, std::string text, int pixelSize ) {
+    // Nada que hacer si no cambia
+    if( mTexture != NULL && text == mText && pixelSize == mPixelSize ) {
+        return;
+    }
+    mText = text;
+    mPixelSize = pixelSize;
+
+    // Caja del texto con margen para los bordes suavizados
+    mPad = (int)ceilf( LSDFFont::SPREAD * pixelSize / (float)LSDFFont::SDF_SIZE );
+    int boxW = (int)ceilf( font.getTextWidth( text.c_str(), pixelSize ) ) + 2 * mPad;
+    int boxH = (int)ceilf( font.getLineHeight( pixelSize ) ) + 2 * mPad;
+    mWidth = boxW - 2 * mPad;
+    mHeight = boxH - 2 * mPad;
+
+    // La textura sólo se vuelve a crear si la caja ya no cabe
+    if( boxW > mTextureWidth || boxH > mTextureHeight ) {
+        if( mTexture != NULL ) {
+            SDL_DestroyTexture( mTexture );
+        }
+        mTextureWidth = boxW > mTextureWidth ? boxW : mTextureWidth;
+        mTextureHeight = boxH > mTextureHeight ? boxH : mTextureHeight;
+        mTexture = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                mTextureWidth, mTextureHeight );
+        if( mTexture == NULL ) {
+            printf( "No se pudo crear la textura del texto SDF! SDL Error: %s\n", SDL_GetError() );
+            return;
+        }
+        SDL_SetTextureBlendMode( mTexture, SDL_BLENDMODE_BLEND );
+    }
+
+    // Pasada de umbral sobre el campo de distancia
+    mAlpha.assign( boxW * boxH, 0 );
+    font.reconstruct( text.c_str(), pixelSize, mPad, mPad, mAlpha.data(), boxW, boxH );
+    ++mReconstructions;
+
+    // Copia el alpha a la textura en blanco; el color se aplica con la modulación
+    SDL_Rect box = { 0, 0, boxW, boxH };
+    void* pixels;
+    int pitch;
+    if( SDL_LockTexture( mTexture, &box, &pixels, &pitch ) == 0 ) {
+        for( int y = 0; y < boxH; ++y ) {
+            Uint32* row = (Uint32*)( (Uint8*)pixels + y * pitch );
+            for( int x = 0; x < boxW; ++x ) {
+                row[ x ] = ( (Uint32)mAlpha[ y * boxW + x ] << 24 ) | 0x00FFFFFF;
+            }
+        }
+        SDL_UnlockTexture( mTexture );
+    }
+}
+
+void LSDFText::render( int x, int y, SDL_Color color ) {
+    if( mTexture == NULL ) {
+        return;
+    }
+
+    // La caja incluye el margen alrededor del texto
+    SDL_Rect clip = { 0, 0, mWidth + 2 * mPad, mHeight + 2 * mPad };
+    SDL_Rect renderQuad = { x - mPad, y - mPad, clip.w, clip.h };
+    SDL_SetTextureColorMod( mTexture, color.r, color.g, color.b );
+    SDL_RenderCopy( gRenderer, mTexture, &clip, &renderQuad );
+}
+
+int LSDFText::getWidth() {
+    return mWidth;
+}
+
+int LSDFText::getHeight() {
+    return mHeight;
+}
+
+int LSDFText::getReconstructions() {
+    return mReconstructions;
+}
+
 bool init() {
     // Bandera
     bool success = true;
@@ -454,6 +987,11 @@ bool init() {
                     success = false;
                 }
 
+                // Inicializa SDL_ttf
+                if( TTF_Init() == -1 ) {
+                    printf( "SDL_ttf no pudo inicializarse! SDL_ttf Error: %s\n", TTF_GetError() );
+                    success = false;
+                }
             }
 
         }
@@ -471,7 +1009,17 @@ bool loadMedia() {
         printf( "Falló la carga de la textura de la ventana!\n" );
         success = false;
     }
-    
+
+    // Carga el atlas SDF; si no existe o la fuente cambió se genera desde ella
+    if( !gSDFFont.loadFromFile( "romfs/lazy.sdf", "romfs/lazy.ttf" ) ) {
+        if( !gSDFFont.generate( "romfs/lazy.ttf" ) ) {
+            printf( "Falló la generación del atlas SDF!\n" );
+            success = false;
+        } else {
+            gSDFGenerated = true;
+            gSDFFont.saveToFile( "romfs/lazy.sdf" );
+        }
+    }
 
     return success;
 }
@@ -479,17 +1027,36 @@ bool loadMedia() {
 void close() {
     // Libera la textura cargada
     gSceneTexture.free();
+    printf( "Atlas SDF %s, %d reconstrucciones de texto\n", gSDFGenerated ? "generado" : "cargado",
+            gTitleText.getReconstructions() + gSizeText.getReconstructions() );
+    gTitleText.free();
+    gSizeText.free();
 
     // Destruye la ventana
     SDL_DestroyRenderer( gRenderer );
     gWindow.free();
 
     // Termina SDL
+    TTF_Quit();
     IMG_Quit();
     SDL_Quit();
 }
 
 int main( int argc, char* argv[] ) {
+    // Generador offline: escribe el atlas SDF y termina
+    if( argc > 1 && strcmp( argv[ 1 ], "--generate-sdf" ) == 0 ) {
+        if( SDL_Init( 0 ) < 0 || TTF_Init() == -1 ) {
+            printf( "SDL no pudo inicializarse! SDL Error: %s\n", SDL_GetError() );
+            return -1;
+        }
+        LSDFFont font;
+        bool success = font.generate( "romfs/lazy.ttf" ) && font.saveToFile( "romfs/lazy.sdf" );
+        printf( success ? "Atlas SDF guardado en romfs/lazy.sdf\n" : "Falló la generación del atlas SDF!\n" );
+        TTF_Quit();
+        SDL_Quit();
+        return success ? 0 : -1;
+    }
+
     // Inicia SDL y crea la ventana
     if( !init() ) {
         printf( "Falló la inicialización!\n" );
@@ -528,6 +1095,19 @@ int main( int argc, char* argv[] ) {
             gSceneTexture.render( ( gWindow.getWidth() - gSceneTexture.getWidth() ) / 2,
                     ( gWindow.getHeight() - gSceneTexture.getHeight() ) / 2 );
 
+            // El tamaño del texto sigue al alto de la ventana; sólo se
+            // reconstruye desde el atlas cuando cambia
+            int textSize = gWindow.getHeight() / 10 > 8 ? gWindow.getHeight() / 10 : 8;
+            char sizeText[ 32 ];
+            snprintf( sizeText, sizeof( sizeText ), "%d x %d", gWindow.getWidth(), gWindow.getHeight() );
+            gTitleText.setText( gSDFFont, "Eventos de ventana", textSize );
+            gSizeText.setText( gSDFFont, sizeText, textSize / 2 );
+
+            SDL_Color textColor = { 0, 0, 0, 0xFF };
+            gTitleText.render( ( gWindow.getWidth() - gTitleText.getWidth() ) / 2, textSize / 4, textColor );
+            gSizeText.render( ( gWindow.getWidth() - gSizeText.getWidth() ) / 2,
+                    gWindow.getHeight() - gSizeText.getHeight() - textSize / 4, textColor );
+
             // Actualiza la pantalla
             SDL_RenderPresent( gRenderer );
         }
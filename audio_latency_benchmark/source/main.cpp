@@ -0,0 +1,628 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+// Mide la latencia de audio de las lecciones 21 y 34 sin abrir ventana. Usa el
+// driver dummy salvo que SDL_AUDIODRIVER pida otro, por ejemplo disk
+// LRingBuffer y audioPlaybackCallback son copias de la lección 34, cada
+// lección es un programa aparte
+
+// Frecuencia que piden las lecciones
+const int FREQUENCY = 44100;
+
+// Disparos por medición
+const int TRIGGERS = 40;
+
+// Tiempo máximo esperando que un disparo suene
+const int TRIGGER_TIMEOUT_MS = 1000;
+
+// Callbacks guardados por medición para el jitter
+const int MAX_CALLBACKS = 4096;
+
+// Duración del impulso en frames
+const int IMPULSE_FRAMES = 256;
+
+// Buffer circular de un productor y un consumidor
+class LRingBuffer {
+    public:
+        // Tamaño de línea de caché para separar los índices
+        static const int CACHE_LINE = 64;
+
+        // Inicializa las variables
+        LRingBuffer();
+
+        // Libera la memoria
+        ~LRingBuffer();
+
+        // Reserva el buffer redondeando la capacidad a potencia de dos. Sólo
+        // se llama sin productor ni consumidor activos
+        bool allocate( Uint32 capacity );
+
+        // Vacía el buffer; mismas condiciones que allocate
+        void reset();
+
+        // Libera el buffer
+        void free();
+
+        // Productor: escribe el bloque entero o lo descarta y cuenta un desborde
+        bool write( const Uint8* data, Uint32 length );
+
+        // Consumidor: lee hasta length bytes y devuelve los leídos
+        Uint32 read( Uint8* data, Uint32 length );
+
+        // Bytes pendientes de leer y espacio libre
+        Uint32 getReadable();
+        Uint32 getWritable();
+
+        Uint32 getCapacity();
+
+        // Bloques descartados por falta de espacio
+        int getOverruns();
+
+    private:
+        Uint8* mBuffer;
+        Uint32 mCapacity;
+        Uint32 mMask;
+
+        // Lado del productor
+        alignas( CACHE_LINE ) std::atomic<Uint32> mWrite;
+        std::atomic<int> mOverruns;
+
+        // Lado del consumidor
+        alignas( CACHE_LINE ) std::atomic<Uint32> mRead;
+        char mPadding[ CACHE_LINE - sizeof( std::atomic<Uint32> ) ];
+};
+
+// Marcas de tiempo tomadas desde el hilo de audio. El hilo principal sólo
+// escribe el disparo y lee el resultado cuando found está activo
+struct LatencyProbe
+{
+    // Frames por callback y bytes por frame del formato obtenido
+    int frequency;
+    int samples;
+    int frameBytes;
+    Uint8 silence;
+
+    // Disparo pendiente, 0 si no hay
+    std::atomic<Uint64> triggerTicks;
+
+    // Resultado del último disparo
+    std::atomic<bool> found;
+    Uint64 readyTicks;
+    int frameOffset;
+
+    // Inicio de cada callback, reservado antes de abrir el dispositivo
+    std::vector<Uint64> callbackTicks;
+    std::atomic<int> callbacks;
+};
+
+// Estadísticas de una serie de valores en milisegundos
+struct Stats
+{
+    double min, mean, p95, max, stddev;
+};
+
+// Resultado de una medición
+struct LatencyResult
+{
+    const char* path;
+    int requestedSamples;
+    int samples;
+    int frequency;
+    const char* format;
+    int triggers;
+    int measured;
+    Stats callbackLatency;
+    Stats outputLatency;
+    Stats interval;
+    double maxDeviation;
+};
+
+// Buffer de la lección 34 y formato obtenido
+LRingBuffer gPlaybackRing;
+SDL_AudioSpec gReceivedPlaybackSpec;
+
+// Medición en curso
+LatencyProbe gProbe;
+
+// Callback de la lección 34
+void audioPlaybackCallback( void* userdata, Uint8* stream, int len );
+
+LRingBuffer::LRingBuffer() {
+    // Inicializa las variables
+    mBuffer = NULL;
+    mCapacity = 0;
+    mMask = 0;
+    mWrite = 0;
+    mOverruns = 0;
+    mRead = 0;
+}
+
+LRingBuffer::~LRingBuffer() {
+    // Libera la memoria
+    free();
+}
+
+bool LRingBuffer::allocate( Uint32 capacity ) {
+    free();
+
+    // Con potencia de dos la posición es el índice enmascarado, y los índices
+    // pueden crecer sin límite y desbordar sin romper la resta
+    Uint32 size = 1;
+    while( size < capacity && size < 0x80000000 ) {
+        size <<= 1;
+    }
+    mBuffer = new Uint8[ size ];
+    mCapacity = size;
+    mMask = size - 1;
+    reset();
+    return true;
+}
+
+void LRingBuffer::reset() {
+    mWrite.store( 0, std::memory_order_relaxed );
+    mRead.store( 0, std::memory_order_relaxed );
+    mOverruns.store( 0, std::memory_order_relaxed );
+}
+
+void LRingBuffer::free() {
+    if( mBuffer != NULL ) {
+        delete[] mBuffer;
+        mBuffer = NULL;
+    }
+    mCapacity = 0;
+    mMask = 0;
+}
+
+bool LRingBuffer::write( const Uint8* data, Uint32 length ) {
+    Uint32 write = mWrite.load( std::memory_order_relaxed );
+    Uint32 read = mRead.load( std::memory_order_acquire );
+
+    // Sin espacio se descarta el bloque completo para no partir muestras
+    if( mCapacity - ( write - read ) < length ) {
+        mOverruns.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+    }
+
+    // Copia en uno o dos tramos según dé la vuelta al final
+    Uint32 offset = write & mMask;
+    Uint32 first = mCapacity - offset < length ? mCapacity - offset : length;
+    memcpy( mBuffer + offset, data, first );
+    memcpy( mBuffer, data + first, length - first );
+
+    // Publica los datos al consumidor
+    mWrite.store( write + length, std::memory_order_release );
+    return true;
+}
+
+Uint32 LRingBuffer::read( Uint8* data, Uint32 length ) {
+    Uint32 read = mRead.load( std::memory_order_relaxed );
+    Uint32 write = mWrite.load( std::memory_order_acquire );
+
+    Uint32 available = write - read;
+    if( length > available ) {
+        length = available;
+    }
+
+    Uint32 offset = read & mMask;
+    Uint32 first = mCapacity - offset < length ? mCapacity - offset : length;
+    memcpy( data, mBuffer + offset, first );
+    memcpy( data + first, mBuffer, length - first );
+
+    // Devuelve el espacio al productor
+    mRead.store( read + length, std::memory_order_release );
+    return length;
+}
+
+Uint32 LRingBuffer::getReadable() {
+    return mWrite.load( std::memory_order_acquire ) - mRead.load( std::memory_order_acquire );
+}
+
+Uint32 LRingBuffer::getWritable() {
+    return mCapacity - getReadable();
+}
+
+Uint32 LRingBuffer::getCapacity() {
+    return mCapacity;
+}
+
+int LRingBuffer::getOverruns() {
+    return mOverruns.load( std::memory_order_relaxed );
+}
+
+void audioPlaybackCallback( void* userdata, Uint8* stream, int len )
+{
+    // Copia el audio al stream y completa con silencio si no hay suficiente.
+    // Aquí no hay lector de archivo, así que no se cuentan vaciados
+    Uint32 read = gPlaybackRing.read( stream, len );
+    if( read < (Uint32)len )
+    {
+        memset( stream + read, gReceivedPlaybackSpec.silence, len - read );
+    }
+}
+
+double ticksToMs( Uint64 ticks ) {
+    return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// Prepara la sonda para un formato y reinicia los contadores
+void resetProbe( int frequency, int samples, int frameBytes, Uint8 silence ) {
+    gProbe.frequency = frequency;
+    gProbe.samples = samples;
+    gProbe.frameBytes = frameBytes;
+    gProbe.silence = silence;
+    gProbe.triggerTicks = 0;
+    gProbe.found = false;
+    gProbe.readyTicks = 0;
+    gProbe.frameOffset = 0;
+    gProbe.callbackTicks.assign( MAX_CALLBACKS, 0 );
+    gProbe.callbacks = 0;
+}
+
+// Se llama desde el hilo de audio con el buffer ya mezclado. Guarda la hora
+// del callback y, si hay un disparo pendiente, busca su primer frame audible
+void probeStream( Uint8* stream, int len ) {
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    int callback = gProbe.callbacks.load( std::memory_order_relaxed );
+    if( callback < MAX_CALLBACKS ) {
+        gProbe.callbackTicks[ callback ] = now;
+        gProbe.callbacks.store( callback + 1, std::memory_order_release );
+    }
+
+    if( gProbe.found.load( std::memory_order_acquire ) ||
+        gProbe.triggerTicks.load( std::memory_order_acquire ) == 0 ) {
+        return;
+    }
+
+    // Cualquier byte distinto del silencio marca el inicio del impulso
+    for( int i = 0; i < len; ++i ) {
+        if( stream[ i ] != gProbe.silence ) {
+            gProbe.readyTicks = now;
+            gProbe.frameOffset = i / gProbe.frameBytes;
+            gProbe.found.store( true, std::memory_order_release );
+            return;
+        }
+    }
+}
+
+// Callback de la lección 34 con la sonda detrás
+void measuredPlaybackCallback( void* userdata, Uint8* stream, int len ) {
+    audioPlaybackCallback( userdata, stream, len );
+    probeStream( stream, len );
+}
+
+// Efecto de SDL_mixer que se aplica después de mezclar todos los canales
+void mixerPostMix( void* userdata, Uint8* stream, int len ) {
+    probeStream( stream, len );
+}
+
+// Espera a que la sonda vea el disparo o se acabe el tiempo
+bool waitTrigger() {
+    Uint32 start = SDL_GetTicks();
+    while( !gProbe.found.load( std::memory_order_acquire ) ) {
+        if( SDL_GetTicks() - start > (Uint32)TRIGGER_TIMEOUT_MS ) {
+            return false;
+        }
+        SDL_Delay( 1 );
+    }
+    return true;
+}
+
+// Calcula las estadísticas de una serie
+Stats computeStats( std::vector<double> values ) {
+    Stats stats = { 0, 0, 0, 0, 0 };
+    if( values.empty() ) {
+        return stats;
+    }
+
+    std::sort( values.begin(), values.end() );
+    double sum = 0;
+    for( size_t i = 0; i < values.size(); ++i ) {
+        sum += values[ i ];
+    }
+    stats.mean = sum / values.size();
+
+    double variance = 0;
+    for( size_t i = 0; i < values.size(); ++i ) {
+        variance += ( values[ i ] - stats.mean ) * ( values[ i ] - stats.mean );
+    }
+    stats.stddev = sqrt( variance / values.size() );
+
+    stats.min = values.front();
+    stats.max = values.back();
+    stats.p95 = values[ ( values.size() * 95 ) / 100 < values.size() ? ( values.size() * 95 ) / 100 : values.size() - 1 ];
+    return stats;
+}
+
+// Dispara TRIGGERS veces con esperas al azar y junta las latencias. El disparo
+// se hace con trigger y se calla con silence
+void measureTriggers( LatencyResult& result, void (*trigger)(), void (*silence)() ) {
+    std::vector<double> callbackLatency;
+    std::vector<double> outputLatency;
+
+    double periodMs = result.samples * 1000.0 / result.frequency;
+
+    for( int i = 0; i < TRIGGERS; ++i ) {
+        // Espera al azar de hasta dos periodos para no caer siempre en la
+        // misma fase del callback
+        SDL_Delay( 1 + rand() % (int)( 2 * periodMs + 1 ) );
+
+        gProbe.found.store( false, std::memory_order_release );
+        gProbe.triggerTicks.store( SDL_GetPerformanceCounter(), std::memory_order_release );
+        trigger();
+
+        if( waitTrigger() ) {
+            Uint64 triggerTicks = gProbe.triggerTicks.load( std::memory_order_relaxed );
+            double ready = ticksToMs( gProbe.readyTicks - triggerTicks );
+
+            // El frame sale cuando el dispositivo consume los anteriores del
+            // mismo buffer, más un buffer ya encolado como en un dispositivo
+            // de doble buffer. El driver dummy no tiene hardware, es una estimación
+            double output = ready + ( gProbe.frameOffset + result.samples ) * 1000.0 / result.frequency;
+
+            callbackLatency.push_back( ready );
+            outputLatency.push_back( output );
+            ++result.measured;
+        }
+        ++result.triggers;
+
+        // Calla el disparo y deja pasar un par de callbacks de silencio
+        gProbe.triggerTicks.store( 0, std::memory_order_release );
+        silence();
+        SDL_Delay( (Uint32)( 2 * periodMs ) + 1 );
+    }
+
+    result.callbackLatency = computeStats( callbackLatency );
+    result.outputLatency = computeStats( outputLatency );
+}
+
+// Calcula el jitter con los intervalos entre callbacks
+void measureJitter( LatencyResult& result ) {
+    int callbacks = gProbe.callbacks.load( std::memory_order_acquire );
+    double periodMs = result.samples * 1000.0 / result.frequency;
+
+    // Ignora el primer intervalo, incluye el arranque del dispositivo
+    std::vector<double> intervals;
+    result.maxDeviation = 0;
+    for( int i = 2; i < callbacks; ++i ) {
+        double interval = ticksToMs( gProbe.callbackTicks[ i ] - gProbe.callbackTicks[ i - 1 ] );
+        intervals.push_back( interval );
+        if( fabs( interval - periodMs ) > result.maxDeviation ) {
+            result.maxDeviation = fabs( interval - periodMs );
+        }
+    }
+    result.interval = computeStats( intervals );
+}
+
+const char* formatName( Uint16 format ) {
+    switch( format ) {
+        case AUDIO_S16LSB: return "S16LSB";
+        case AUDIO_S16MSB: return "S16MSB";
+        case AUDIO_F32LSB: return "F32LSB";
+        case AUDIO_F32MSB: return "F32MSB";
+        case AUDIO_S32LSB: return "S32LSB";
+        case AUDIO_U8: return "U8";
+        case AUDIO_S8: return "S8";
+    }
+    return "other";
+}
+
+// Impulso en el formato del dispositivo: la mitad del valor máximo. Con
+// formatos sin signo el silencio no es cero, por eso se suma al silencio
+std::vector<Uint8> buildImpulse( Uint16 format, int channels ) {
+    int values = IMPULSE_FRAMES * channels;
+    std::vector<Uint8> impulse( values * SDL_AUDIO_BITSIZE( format ) / 8 );
+    for( int i = 0; i < values; ++i ) {
+        Uint8* value = &impulse[ i * SDL_AUDIO_BITSIZE( format ) / 8 ];
+        if( SDL_AUDIO_ISFLOAT( format ) ) {
+            float sample = 0.5f;
+            memcpy( value, &sample, sizeof( sample ) );
+        } else if( SDL_AUDIO_BITSIZE( format ) == 16 ) {
+            Sint16 sample = SDL_AUDIO_ISSIGNED( format ) ? 0x4000 : 0xC000;
+            memcpy( value, &sample, sizeof( sample ) );
+        } else if( SDL_AUDIO_BITSIZE( format ) == 32 ) {
+            Sint32 sample = 0x40000000;
+            memcpy( value, &sample, sizeof( sample ) );
+        } else {
+            *value = SDL_AUDIO_ISSIGNED( format ) ? 0x40 : 0xC0;
+        }
+    }
+
+    // Los formatos de orden de bytes distinto al del sistema se invierten
+    if( SDL_AUDIO_ISBIGENDIAN( format ) != ( SDL_BYTEORDER == SDL_BIG_ENDIAN ) ) {
+        int bytes = SDL_AUDIO_BITSIZE( format ) / 8;
+        for( size_t i = 0; i < impulse.size(); i += bytes ) {
+            std::reverse( impulse.begin() + i, impulse.begin() + i + bytes );
+        }
+    }
+    return impulse;
+}
+
+// Estado de la medición de SDL_mixer
+Mix_Chunk* gImpulseChunk = NULL;
+
+void mixerTrigger() {
+    Mix_PlayChannel( -1, gImpulseChunk, 0 );
+}
+
+void mixerSilence() {
+    Mix_HaltChannel( -1 );
+}
+
+// Mide la ruta de la lección 21: Mix_OpenAudio y Mix_PlayChannel
+bool measureMixer( int samples, LatencyResult& result ) {
+    if( Mix_OpenAudio( FREQUENCY, MIX_DEFAULT_FORMAT, 2, samples ) < 0 ) {
+        printf( "SDL_mixer no pudo abrir el audio! SDL_mixer Error: %s\n", Mix_GetError() );
+        return false;
+    }
+
+    // SDL_mixer no dice el tamaño obtenido, se asume el pedido
+    int frequency = 0;
+    Uint16 format = 0;
+    int channels = 0;
+    Mix_QuerySpec( &frequency, &format, &channels );
+
+    std::vector<Uint8> impulse = buildImpulse( format, channels );
+    gImpulseChunk = Mix_QuickLoad_RAW( &impulse[ 0 ], impulse.size() );
+    if( gImpulseChunk == NULL ) {
+        printf( "No se pudo crear el impulso! SDL_mixer Error: %s\n", Mix_GetError() );
+        Mix_CloseAudio();
+        return false;
+    }
+
+    result.path = "sdl_mixer";
+    result.samples = samples;
+    result.frequency = frequency;
+    result.format = formatName( format );
+
+    // Mix_SetPostMix bloquea el audio, la sonda queda lista antes del primer uso
+    resetProbe( frequency, samples, SDL_AUDIO_BITSIZE( format ) / 8 * channels,
+            SDL_AUDIO_ISSIGNED( format ) ? 0 : 0x80 );
+    Mix_SetPostMix( mixerPostMix, NULL );
+
+    measureTriggers( result, mixerTrigger, mixerSilence );
+
+    Mix_SetPostMix( NULL, NULL );
+    measureJitter( result );
+
+    Mix_FreeChunk( gImpulseChunk );
+    gImpulseChunk = NULL;
+    Mix_CloseAudio();
+    return true;
+}
+
+// Estado de la medición de la lección 34
+std::vector<Uint8> gImpulse;
+
+void ringTrigger() {
+    gPlaybackRing.write( &gImpulse[ 0 ], gImpulse.size() );
+}
+
+void ringSilence() {
+    // El impulso es más corto que un buffer, basta con esperar que se consuma
+}
+
+// Mide la ruta de la lección 34: el buffer circular leído en el callback
+bool measureRing( int samples, LatencyResult& result ) {
+    SDL_AudioSpec desiredPlaybackSpec;
+    SDL_zero( desiredPlaybackSpec );
+    desiredPlaybackSpec.freq = FREQUENCY;
+    desiredPlaybackSpec.format = AUDIO_F32;
+    desiredPlaybackSpec.channels = 2;
+    desiredPlaybackSpec.samples = samples;
+    desiredPlaybackSpec.callback = measuredPlaybackCallback;
+
+    // Se abre pausado, la sonda se prepara antes de arrancar
+    SDL_AudioDeviceID device = SDL_OpenAudioDevice( NULL, SDL_FALSE, &desiredPlaybackSpec, &gReceivedPlaybackSpec, SDL_AUDIO_ALLOW_FORMAT_CHANGE );
+    if( device == 0 ) {
+        printf( "No se pudo abrir el dispositivo! SDL Error: %s\n", SDL_GetError() );
+        return false;
+    }
+
+    result.path = "lesson34_ring";
+    result.samples = gReceivedPlaybackSpec.samples;
+    result.frequency = gReceivedPlaybackSpec.freq;
+    result.format = formatName( gReceivedPlaybackSpec.format );
+
+    gImpulse = buildImpulse( gReceivedPlaybackSpec.format, gReceivedPlaybackSpec.channels );
+    gPlaybackRing.allocate( gReceivedPlaybackSpec.size * 4 );
+    resetProbe( gReceivedPlaybackSpec.freq, gReceivedPlaybackSpec.samples,
+            SDL_AUDIO_BITSIZE( gReceivedPlaybackSpec.format ) / 8 * gReceivedPlaybackSpec.channels,
+            gReceivedPlaybackSpec.silence );
+
+    SDL_PauseAudioDevice( device, SDL_FALSE );
+
+    measureTriggers( result, ringTrigger, ringSilence );
+
+    SDL_CloseAudioDevice( device );
+    measureJitter( result );
+    gPlaybackRing.free();
+    return true;
+}
+
+void printStats( FILE* out, const char* name, Stats stats ) {
+    fprintf( out, "\"%s\": {\"min\": %.3f, \"mean\": %.3f, \"p95\": %.3f, \"max\": %.3f, \"stddev\": %.3f}",
+            name, stats.min, stats.mean, stats.p95, stats.max, stats.stddev );
+}
+
+void printResult( FILE* out, LatencyResult& result, bool first ) {
+    fprintf( out, "%s\n    {\"path\": \"%s\", \"requested_samples\": %d, \"samples\": %d, ",
+            first ? "" : ",", result.path, result.requestedSamples, result.samples );
+    fprintf( out, "\"frequency\": %d, \"format\": \"%s\", \"buffer_ms\": %.3f, ",
+            result.frequency, result.format, result.samples * 1000.0 / result.frequency );
+    fprintf( out, "\"triggers\": %d, \"measured\": %d,\n     ", result.triggers, result.measured );
+    printStats( out, "trigger_to_callback_ms", result.callbackLatency );
+    fprintf( out, ",\n     " );
+    printStats( out, "trigger_to_output_ms", result.outputLatency );
+    fprintf( out, ",\n     " );
+    printStats( out, "callback_interval_ms", result.interval );
+    fprintf( out, ", \"max_jitter_ms\": %.3f}", result.maxDeviation );
+}
+
+int main( int argc, char* argv[] ) {
+    // El primer argumento opcional es el archivo de salida, si no se usa la consola
+    FILE* out = stdout;
+    if( argc > 1 ) {
+        out = fopen( argv[ 1 ], "w" );
+        if( out == NULL ) {
+            printf( "No se pudo abrir %s!\n", argv[ 1 ] );
+            return -1;
+        }
+    }
+
+    // Sin tarjeta de sonido: dummy consume el audio al ritmo del reloj. No
+    // reemplaza un SDL_AUDIODRIVER ya puesto
+    SDL_setenv( "SDL_AUDIODRIVER", "dummy", 0 );
+
+    if( SDL_Init( SDL_INIT_AUDIO ) < 0 ) {
+        printf( "SDL no pudo inicializarse! SDL Error: %s\n", SDL_GetError() );
+        return -1;
+    }
+
+    // Semilla fija para que las esperas sean iguales entre corridas
+    srand( 1 );
+
+    // Tamaños de buffer a medir, 2048 es el de la lección 21
+    int sizes[] = { 256, 512, 1024, 2048, 4096 };
+
+    fprintf( out, "{\n  \"benchmark\": \"audio_latency\",\n" );
+    fprintf( out, "  \"driver\": \"%s\",\n", SDL_GetCurrentAudioDriver() );
+    fprintf( out, "  \"results\": [" );
+
+    bool first = true;
+    for( int s = 0; s < 5; ++s )
+    {
+        LatencyResult result;
+        memset( &result, 0, sizeof( result ) );
+        result.requestedSamples = sizes[ s ];
+        if( measureMixer( sizes[ s ], result ) )
+        {
+            printResult( out, result, first );
+            first = false;
+        }
+
+        memset( &result, 0, sizeof( result ) );
+        result.requestedSamples = sizes[ s ];
+        if( measureRing( sizes[ s ], result ) )
+        {
+            printResult( out, result, first );
+            first = false;
+        }
+    }
+
+    fprintf( out, "\n  ]\n}\n" );
+
+    if( out != stdout ) {
+        fclose( out );
+    }
+
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,680 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <SDL2/SDL.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLLIDERS_AVX2 1
+#endif
+
+// Mide las pruebas de colisión de las lecciones 27, 28, 29 y 39 sin abrir ventana
+// Las funciones son copias de las lecciones, cada lección es un programa aparte
+
+// Pruebas por medición
+const int TESTS = 1000000;
+
+// Las pruebas contra el nivel revisan todos los tiles, se hacen menos
+const int WALL_TESTS = 100000;
+
+// Constantes del nivel de la lección 39
+const int LEVEL_WIDTH = 1280;
+const int LEVEL_HEIGHT = 960;
+const int TILE_WIDTH = 80;
+const int TILE_HEIGHT = 80;
+const int TOTAL_TILES = 192;
+const int TILE_CENTER = 3;
+const int TILE_TOPLEFT = 11;
+
+// Estructura del circulo
+struct Circle
+{
+    int x, y;
+    int r;
+};
+
+// Cajas de colisión en formato SoA con los lados ya calculados
+struct ColliderSet
+{
+    std::vector<int> minX, minY;
+    std::vector<int> maxX, maxY;
+
+    // Caja que envuelve a todas las demás
+    int boundsMinX, boundsMinY;
+    int boundsMaxX, boundsMaxY;
+};
+
+class Tile
+{
+    public:
+        // Inicialza la posición y el tipo
+        Tile( int x, int y, int tileType );
+
+        // Obtiene el tipo del tile
+        int getType();
+
+        // Obtiene la caja de colisiones
+        SDL_Rect getBox();
+
+    private:
+        // Atributos del tile
+        SDL_Rect mBox;
+
+        // Tipo del tile
+        int mType;
+};
+
+// Escena generada para las mediciones
+struct Scene
+{
+    // Número de figuras
+    int shapes;
+
+    // Fracción del mundo cubierta por figuras
+    double density;
+
+    // Porcentaje de circulos, el resto son cajas
+    int circlePercent;
+
+    // Lado del mundo cuadrado
+    int worldSize;
+
+    std::vector<SDL_Rect> rects;
+    std::vector<Circle> circles;
+
+    // Cuerpos de la lección 28, cada uno con su set local y su offset
+    std::vector<ColliderSet> sets;
+    std::vector<SDL_Point> offsets;
+
+    // Pares a revisar, en orden o al azar
+    std::vector<int> sequentialPairs;
+    std::vector<int> randomPairs;
+};
+
+// Resultado de una medición
+struct BenchResult
+{
+    const char* variant;
+    int lesson;
+    const char* access;
+    Uint64 tests;
+    Uint64 hits;
+    Uint64 ticks;
+
+    // Bytes de figuras que recorre la medición y bytes leídos por prueba
+    size_t workingSetBytes;
+    int bytesPerTest;
+};
+
+// Obliga a usar la versión escalar del detector de la lección 28
+bool gForceScalar = false;
+
+// Lección 27: caja contra caja
+bool checkCollision( SDL_Rect a, SDL_Rect b );
+
+// Lección 28: sets de cajas en coordenadas locales
+void setColliders( ColliderSet& set, std::vector<SDL_Rect>& boxes );
+bool checkCollision( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY );
+bool checkCollisionScalar( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY );
+#if defined(COLLIDERS_AVX2)
+bool checkCollisionAVX2( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY );
+#endif
+
+// Lección 29: circulo contra circulo y circulo contra caja
+bool checkCollision( Circle& a, Circle& b );
+bool checkCollision( Circle& a, SDL_Rect& b );
+int distanceSquared( int x1, int y1, int x2, int y2 );
+
+// Lección 39: caja contra los muros del nivel
+bool touchesWall( SDL_Rect box, Tile* tiles[] );
+
+// Genera una escena
+void buildScene( Scene& scene, int shapes, double density, int circlePercent );
+
+// Mediciones de cada variante
+BenchResult benchRectRect( Scene& scene, std::vector<int>& pairs, const char* access );
+BenchResult benchMultiRect( Scene& scene, std::vector<int>& pairs, const char* access, bool simd );
+BenchResult benchCircleMixed( Scene& scene, std::vector<int>& pairs, const char* access );
+BenchResult benchTouchesWall( Scene& scene, Tile* tiles[] );
+
+// Escribe un resultado como objeto JSON
+void printResult( FILE* out, BenchResult& result, Scene& scene, bool first );
+
+Tile::Tile( int x, int y, int tileType )
+{
+    // Obtiene los offsets
+    mBox.x = x;
+    mBox.y = y;
+
+    // Establece la caja de colisiones
+    mBox.w = TILE_WIDTH;
+    mBox.h = TILE_HEIGHT;
+
+    // Obtiene el tipo de tile
+    mType = tileType;
+}
+
+int Tile::getType()
+{
+    return mType;
+}
+
+SDL_Rect Tile::getBox()
+{
+    return mBox;
+}
+
+bool checkCollision( SDL_Rect a, SDL_Rect b )
+{
+    // Lados del rectangulo
+    int leftA, leftB;
+    int rightA, rightB;
+    int topA, topB;
+    int bottomA, bottomB;
+
+    // Calcula los lados del rect A
+    leftA = a.x;
+    rightA = a.x + a.w;
+    topA = a.y;
+    bottomA = a.y + a.h;
+
+    // Calcula los lados del rect B
+    leftB = b.x;
+    rightB = b.x + b.w;
+    topB = b.y;
+    bottomB = b.y + b.h;
+
+    // Si alguno de los lados desde A está fuera de B
+    if( bottomA <= topB )
+        return false;
+
+    if( topA >= bottomB )
+        return false;
+
+    if( rightA <= leftB )
+        return false;
+
+    if( leftA >= rightB )
+        return false;
+
+    // Si ninguno de los lados desde A está fuera de B
+    return true;
+}
+
+void setColliders( ColliderSet& set, std::vector<SDL_Rect>& boxes )
+{
+    // Tamaño redondeado a un múltiplo de 8
+    int padded = ( boxes.size() + 7 ) & ~7;
+
+    // El relleno usa min = INT_MAX y max = INT_MIN, así nunca se traslapa
+    set.minX.assign( padded, INT_MAX );
+    set.minY.assign( padded, INT_MAX );
+    set.maxX.assign( padded, INT_MIN );
+    set.maxY.assign( padded, INT_MIN );
+
+    set.boundsMinX = INT_MAX;
+    set.boundsMinY = INT_MAX;
+    set.boundsMaxX = INT_MIN;
+    set.boundsMaxY = INT_MIN;
+
+    for( size_t i = 0; i < boxes.size(); ++i )
+    {
+        set.minX[ i ] = boxes[ i ].x;
+        set.minY[ i ] = boxes[ i ].y;
+        set.maxX[ i ] = boxes[ i ].x + boxes[ i ].w;
+        set.maxY[ i ] = boxes[ i ].y + boxes[ i ].h;
+
+        // Agranda la caja envolvente
+        if( set.minX[ i ] < set.boundsMinX ) set.boundsMinX = set.minX[ i ];
+        if( set.minY[ i ] < set.boundsMinY ) set.boundsMinY = set.minY[ i ];
+        if( set.maxX[ i ] > set.boundsMaxX ) set.boundsMaxX = set.maxX[ i ];
+        if( set.maxY[ i ] > set.boundsMaxY ) set.boundsMaxY = set.maxY[ i ];
+    }
+}
+
+bool checkCollision( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY )
+{
+    // Offset de A relativo a B, las cajas B se revisan en su espacio local
+    int dx = aX - bX;
+    int dy = aY - bY;
+
+    // Si las cajas envolventes no se tocan ninguna caja lo hará
+    if( ( a.boundsMaxY + dy <= b.boundsMinY ) || ( a.boundsMinY + dy >= b.boundsMaxY )
+            || ( a.boundsMaxX + dx <= b.boundsMinX ) || ( a.boundsMinX + dx >= b.boundsMaxX ) )
+    {
+        return false;
+    }
+
+#if defined(COLLIDERS_AVX2)
+    // Revisa una sola vez si el procesador soporta AVX2
+    static bool hasAVX2 = __builtin_cpu_supports( "avx2" );
+    if( hasAVX2 && !gForceScalar )
+    {
+        return checkCollisionAVX2( a, aX, aY, b, bX, bY );
+    }
+#endif
+
+    return checkCollisionScalar( a, aX, aY, b, bX, bY );
+}
+
+bool checkCollisionScalar( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY )
+{
+    // Lados del rectangulo
+    int leftA, rightA, topA, bottomA;
+
+    // Offset de A relativo a B
+    int dx = aX - bX;
+    int dy = aY - bY;
+
+    // Avanza a traves de las cajas A
+    for( size_t Abox = 0; Abox < a.minX.size(); Abox++ )
+    {
+        // Las cajas de relleno de A no se traslapan con nada, y sumarles el
+        // offset desbordaría INT_MAX
+        if( a.minX[ Abox ] == INT_MAX )
+        {
+            break;
+        }
+
+        // Calcula los lados de Rect A en el espacio de B
+        leftA = a.minX[ Abox ] + dx;
+        rightA = a.maxX[ Abox ] + dx;
+        topA = a.minY[ Abox ] + dy;
+        bottomA = a.maxY[ Abox ] + dy;
+
+        // Avanza a travez de las cajas B, sus lados ya están calculados
+        for( size_t Bbox = 0; Bbox < b.minX.size(); Bbox++ )
+        {
+            // Si ningun lado de A está fuera de B
+            if( ( bottomA > b.minY[ Bbox ] ) && ( topA < b.maxY[ Bbox ] )
+                    && ( rightA > b.minX[ Bbox ] ) && ( leftA < b.maxX[ Bbox ] ) )
+            {
+                // Colisión detectada
+                return true;
+            }
+        }
+    }
+
+    // Si ninguna set de cajas de colision se están tocando
+    return false;
+}
+
+#if defined(COLLIDERS_AVX2)
+__attribute__(( target( "avx2" ) ))
+bool checkCollisionAVX2( ColliderSet& a, int aX, int aY, ColliderSet& b, int bX, int bY )
+{
+    // Offset de A relativo a B
+    int dx = aX - bX;
+    int dy = aY - bY;
+
+    // Avanza a traves de las cajas A
+    for( size_t Abox = 0; Abox < a.minX.size(); Abox++ )
+    {
+        // Las cajas de relleno de A no se traslapan con nada
+        if( a.minX[ Abox ] == INT_MAX )
+        {
+            break;
+        }
+
+        // Copia los lados de A en los 8 carriles
+        __m256i leftA = _mm256_set1_epi32( a.minX[ Abox ] + dx );
+        __m256i rightA = _mm256_set1_epi32( a.maxX[ Abox ] + dx );
+        __m256i topA = _mm256_set1_epi32( a.minY[ Abox ] + dy );
+        __m256i bottomA = _mm256_set1_epi32( a.maxY[ Abox ] + dy );
+
+        // Revisa 8 cajas B por instrucción
+        for( size_t Bbox = 0; Bbox < b.minX.size(); Bbox += 8 )
+        {
+            __m256i leftB = _mm256_loadu_si256( (const __m256i*)&b.minX[ Bbox ] );
+            __m256i rightB = _mm256_loadu_si256( (const __m256i*)&b.maxX[ Bbox ] );
+            __m256i topB = _mm256_loadu_si256( (const __m256i*)&b.minY[ Bbox ] );
+            __m256i bottomB = _mm256_loadu_si256( (const __m256i*)&b.maxY[ Bbox ] );
+
+            // Mascara de los carriles donde ningún lado de A está fuera de B
+            __m256i hit = _mm256_and_si256(
+                    _mm256_and_si256( _mm256_cmpgt_epi32( bottomA, topB ),
+                        _mm256_cmpgt_epi32( bottomB, topA ) ),
+                    _mm256_and_si256( _mm256_cmpgt_epi32( rightA, leftB ),
+                        _mm256_cmpgt_epi32( rightB, leftA ) ) );
+
+            // Colisión detectada en algún carril
+            if( !_mm256_testz_si256( hit, hit ) )
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+#endif
+
+bool checkCollision( Circle& a, Circle& b )
+{
+    // Calcula el radio total al cuadrado
+    int totalRadiusSquared = a.r + b.r;
+    totalRadiusSquared = totalRadiusSquared * totalRadiusSquared;
+
+    // Si la distancia entre los centros de los circulos es menor que la suma de sus radios
+    return distanceSquared( a.x, a.y, b.x, b.y ) < totalRadiusSquared;
+}
+
+bool checkCollision( Circle& a, SDL_Rect& b )
+{
+    // Punto más cercano a la caja de colision
+    int cX = std::max( b.x, std::min( a.x, b.x + b.w ) );
+    int cY = std::max( b.y, std::min( a.y, b.y + b.h ) );
+
+    // Si el punto más cercano está dentro del circulo
+    return distanceSquared( a.x, a.y, cX, cY ) < a.r * a.r;
+}
+
+int distanceSquared( int x1, int y1, int x2, int y2 )
+{
+    int deltaX = x2 - x1;
+    int deltaY = y2 - y1;
+    return deltaX * deltaX + deltaY * deltaY;
+}
+
+bool touchesWall( SDL_Rect box, Tile* tiles[] )
+{
+    // Avanza a través de los tiles
+    for( int i = 0; i < TOTAL_TILES; ++i )
+    {
+        // Si el tile es de tipo tile muro
+        if( ( tiles[ i ]->getType() > TILE_CENTER ) && ( tiles[ i ]->getType() <= TILE_TOPLEFT) )
+        {
+            // Revisa si la caja de colisiones toca el muro
+            if( checkCollision( box, tiles[ i ]->getBox() ) )
+            {
+                return true;
+            }
+        }
+    }
+
+    // Si no se tocó ningún muro
+    return false;
+}
+
+void buildScene( Scene& scene, int shapes, double density, int circlePercent )
+{
+    scene.shapes = shapes;
+    scene.density = density;
+    scene.circlePercent = circlePercent;
+
+    // Las figuras miden 12x12 en promedio, el mundo crece hasta tener la densidad pedida
+    scene.worldSize = (int)sqrt( shapes * 144.0 / density );
+
+    // Forma del punto de la lección 28, 11 cajas centradas
+    int widths[ 11 ] = { 6, 10, 14, 16, 18, 20, 18, 6, 14, 10, 6 };
+    int heights[ 11 ] = { 1, 1, 1, 2, 2, 6, 2, 2, 1, 1, 1 };
+    std::vector<SDL_Rect> dotBoxes( 11 );
+    int r = 0;
+    for( int i = 0; i < 11; ++i )
+    {
+        dotBoxes[ i ].x = ( 20 - widths[ i ] ) / 2;
+        dotBoxes[ i ].y = r;
+        dotBoxes[ i ].w = widths[ i ];
+        dotBoxes[ i ].h = heights[ i ];
+        r += heights[ i ];
+    }
+
+    scene.rects.resize( shapes );
+    scene.circles.resize( shapes );
+    scene.sets.resize( shapes );
+    scene.offsets.resize( shapes );
+    for( int i = 0; i < shapes; ++i )
+    {
+        scene.rects[ i ].x = rand() % scene.worldSize;
+        scene.rects[ i ].y = rand() % scene.worldSize;
+        scene.rects[ i ].w = 4 + rand() % 17;
+        scene.rects[ i ].h = 4 + rand() % 17;
+
+        scene.circles[ i ].x = rand() % scene.worldSize;
+        scene.circles[ i ].y = rand() % scene.worldSize;
+        scene.circles[ i ].r = 2 + rand() % 9;
+
+        setColliders( scene.sets[ i ], dotBoxes );
+        scene.offsets[ i ].x = rand() % scene.worldSize;
+        scene.offsets[ i ].y = rand() % scene.worldSize;
+    }
+
+    // Pares vecinos en memoria y pares al azar
+    scene.sequentialPairs.resize( TESTS * 2 );
+    scene.randomPairs.resize( TESTS * 2 );
+    for( int t = 0; t < TESTS; ++t )
+    {
+        scene.sequentialPairs[ t * 2 ] = t % shapes;
+        scene.sequentialPairs[ t * 2 + 1 ] = ( t + 1 ) % shapes;
+        scene.randomPairs[ t * 2 ] = rand() % shapes;
+        scene.randomPairs[ t * 2 + 1 ] = rand() % shapes;
+    }
+}
+
+BenchResult benchRectRect( Scene& scene, std::vector<int>& pairs, const char* access )
+{
+    BenchResult result;
+    result.variant = "rect_rect";
+    result.lesson = 27;
+    result.access = access;
+    result.tests = TESTS;
+    result.hits = 0;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int t = 0; t < TESTS; ++t )
+    {
+        result.hits += checkCollision( scene.rects[ pairs[ t * 2 ] ], scene.rects[ pairs[ t * 2 + 1 ] ] );
+    }
+    result.ticks = SDL_GetPerformanceCounter() - start;
+
+    result.workingSetBytes = scene.rects.size() * sizeof( SDL_Rect );
+    result.bytesPerTest = 2 * sizeof( SDL_Rect ) + 2 * sizeof( int );
+    return result;
+}
+
+BenchResult benchMultiRect( Scene& scene, std::vector<int>& pairs, const char* access, bool simd )
+{
+    BenchResult result;
+    result.variant = simd ? "multi_rect" : "multi_rect_scalar";
+    result.lesson = 28;
+    result.access = access;
+    result.tests = TESTS;
+    result.hits = 0;
+
+    gForceScalar = !simd;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int t = 0; t < TESTS; ++t )
+    {
+        int a = pairs[ t * 2 ];
+        int b = pairs[ t * 2 + 1 ];
+        result.hits += checkCollision( scene.sets[ a ], scene.offsets[ a ].x, scene.offsets[ a ].y,
+                scene.sets[ b ], scene.offsets[ b ].x, scene.offsets[ b ].y );
+    }
+    result.ticks = SDL_GetPerformanceCounter() - start;
+
+    gForceScalar = false;
+
+    // Cada set guarda 16 cajas con relleno, 4 enteros por caja
+    int setBytes = sizeof( ColliderSet ) + 16 * 4 * sizeof( int );
+    result.workingSetBytes = scene.sets.size() * ( setBytes + sizeof( SDL_Point ) );
+    result.bytesPerTest = 2 * ( setBytes + sizeof( SDL_Point ) ) + 2 * sizeof( int );
+    return result;
+}
+
+BenchResult benchCircleMixed( Scene& scene, std::vector<int>& pairs, const char* access )
+{
+    BenchResult result;
+    result.variant = "circle_mixed";
+    result.lesson = 29;
+    result.access = access;
+    result.tests = TESTS;
+    result.hits = 0;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int t = 0; t < TESTS; ++t )
+    {
+        int a = pairs[ t * 2 ];
+        int b = pairs[ t * 2 + 1 ];
+
+        // El porcentaje de circulos decide contra qué figura se prueba
+        if( b % 100 < scene.circlePercent )
+        {
+            result.hits += checkCollision( scene.circles[ a ], scene.circles[ b ] );
+        }
+        else
+        {
+            result.hits += checkCollision( scene.circles[ a ], scene.rects[ b ] );
+        }
+    }
+    result.ticks = SDL_GetPerformanceCounter() - start;
+
+    result.workingSetBytes = scene.circles.size() * sizeof( Circle ) + scene.rects.size() * sizeof( SDL_Rect );
+    result.bytesPerTest = sizeof( Circle ) + std::max( sizeof( Circle ), sizeof( SDL_Rect ) ) + 2 * sizeof( int );
+    return result;
+}
+
+BenchResult benchTouchesWall( Scene& scene, Tile* tiles[] )
+{
+    BenchResult result;
+    result.variant = "touches_wall";
+    result.lesson = 39;
+    result.access = "level";
+    result.tests = WALL_TESTS;
+    result.hits = 0;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for( int t = 0; t < WALL_TESTS; ++t )
+    {
+        // Las cajas de la escena se reparten por el nivel
+        SDL_Rect box = scene.rects[ t % scene.shapes ];
+        box.x %= LEVEL_WIDTH;
+        box.y %= LEVEL_HEIGHT;
+        result.hits += touchesWall( box, tiles );
+    }
+    result.ticks = SDL_GetPerformanceCounter() - start;
+
+    result.workingSetBytes = TOTAL_TILES * ( sizeof( Tile ) + sizeof( Tile* ) );
+    result.bytesPerTest = TOTAL_TILES * ( sizeof( Tile ) + sizeof( Tile* ) );
+    return result;
+}
+
+void printResult( FILE* out, BenchResult& result, Scene& scene, bool first )
+{
+    double freq = SDL_GetPerformanceFrequency();
+    double seconds = result.ticks / freq;
+    if( seconds <= 0.0 )
+    {
+        seconds = 1.0 / freq;
+    }
+
+    fprintf( out, "%s\n    {\"variant\": \"%s\", \"lesson\": %d, \"access\": \"%s\", ",
+            first ? "" : ",", result.variant, result.lesson, result.access );
+    fprintf( out, "\"shapes\": %d, \"density\": %.3f, \"circle_percent\": %d, ",
+            scene.shapes, scene.density, scene.circlePercent );
+    fprintf( out, "\"tests\": %llu, \"hits\": %llu, \"ns_per_test\": %.3f, \"pairs_per_second\": %.0f, ",
+            (unsigned long long)result.tests, (unsigned long long)result.hits,
+            seconds * 1000000000.0 / result.tests, result.tests / seconds );
+    fprintf( out, "\"working_set_bytes\": %llu, \"bytes_per_test\": %d}",
+            (unsigned long long)result.workingSetBytes, result.bytesPerTest );
+}
+
+int main( int argc, char* argv[] ) {
+    // El primer argumento opcional es el archivo de salida, si no se usa la consola
+    FILE* out = stdout;
+    if( argc > 1 ) {
+        out = fopen( argv[ 1 ], "w" );
+        if( out == NULL ) {
+            printf( "No se pudo abrir %s!\n", argv[ 1 ] );
+            return -1;
+        }
+    }
+
+    // Semilla fija para que las escenas sean iguales entre corridas
+    srand( 1 );
+
+    // Tamaños, densidades y mezclas de figuras a medir
+    int sizes[] = { 1000, 10000, 100000 };
+    double densities[] = { 0.05, 0.5 };
+    int mixes[] = { 0, 50, 100 };
+
+    // Nivel de la lección 39 con una fracción de tiles muro al azar
+    Tile* tiles[ TOTAL_TILES ];
+    for( int i = 0; i < TOTAL_TILES; ++i )
+    {
+        int type = ( rand() % 100 ) < 30 ? TILE_CENTER + 1 + rand() % 8 : rand() % ( TILE_CENTER + 1 );
+        tiles[ i ] = new Tile( ( i % ( LEVEL_WIDTH / TILE_WIDTH ) ) * TILE_WIDTH,
+                ( i / ( LEVEL_WIDTH / TILE_WIDTH ) ) * TILE_HEIGHT, type );
+    }
+
+    fprintf( out, "{\n  \"benchmark\": \"collision\",\n" );
+    fprintf( out, "  \"avx2\": %s,\n",
+#if defined(COLLIDERS_AVX2)
+            __builtin_cpu_supports( "avx2" ) ? "true" : "false"
+#else
+            "false"
+#endif
+            );
+    fprintf( out, "  \"results\": [" );
+
+    bool first = true;
+    for( int s = 0; s < 3; ++s )
+    {
+        for( int d = 0; d < 2; ++d )
+        {
+            for( int m = 0; m < 3; ++m )
+            {
+                Scene scene;
+                buildScene( scene, sizes[ s ], densities[ d ], mixes[ m ] );
+
+                BenchResult result;
+
+                // Las variantes de cajas no dependen de la mezcla, solo se miden una vez
+                if( m == 0 )
+                {
+                    const char* accessNames[ 2 ] = { "sequential", "random" };
+                    std::vector<int>* accessPairs[ 2 ] = { &scene.sequentialPairs, &scene.randomPairs };
+                    for( int a = 0; a < 2; ++a )
+                    {
+                        result = benchRectRect( scene, *accessPairs[ a ], accessNames[ a ] );
+                        printResult( out, result, scene, first );
+                        first = false;
+
+                        result = benchMultiRect( scene, *accessPairs[ a ], accessNames[ a ], false );
+                        printResult( out, result, scene, first );
+
+                        result = benchMultiRect( scene, *accessPairs[ a ], accessNames[ a ], true );
+                        printResult( out, result, scene, first );
+                    }
+
+                    result = benchTouchesWall( scene, tiles );
+                    printResult( out, result, scene, first );
+                }
+
+                result = benchCircleMixed( scene, scene.sequentialPairs, "sequential" );
+                printResult( out, result, scene, first );
+                first = false;
+
+                result = benchCircleMixed( scene, scene.randomPairs, "random" );
+                printResult( out, result, scene, first );
+            }
+        }
+    }
+
+    fprintf( out, "\n  ]\n}\n" );
+
+    // Libera el nivel
+    for( int i = 0; i < TOTAL_TILES; ++i )
+    {
+        delete tiles[ i ];
+    }
+
+    if( out != stdout ) {
+        fclose( out );
+    }
+
+    return 0;
+}
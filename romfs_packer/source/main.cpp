@@ -0,0 +1,887 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
+#if defined(ROMFS_BENCH)
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include <SDL2/SDL_mixer.h>
+#endif
+
+// Empaqueta el directorio romfs/ de una lección en un solo archivo que las
+// lecciones mapean en memoria, en vez de abrir y leer cada archivo suelto:
+//     bin <romfs> <paquete> [--lz4]
+// Empaquetar sólo usa SDL. make bench compila aparte, con ROMFS_BENCH y los
+// cargadores de las lecciones, la comparación del arranque con archivos
+// sueltos y con el paquete, en frío y en caliente:
+//     bench --bench <romfs> <paquete> [repeticiones]
+// LPackFile es una copia de la de las lecciones 16 y 21, cada lección es un
+// programa aparte
+
+// Una entrada comprimida sólo se guarda así si ahorra al menos 1/8
+const int MIN_SAVING_SHIFT = 3;
+
+#if defined(ROMFS_BENCH)
+// Repeticiones por defecto de cada medición
+const int BENCH_REPETITIONS = 10;
+
+// Tamaño de letra con el que se abren las fuentes al medir, el de las lecciones
+const int FONT_SIZE = 28;
+#endif
+
+// Archivo empaquetado con el contenido de romfs/: una cabecera, un índice
+// ordenado por el hash del nombre, los nombres y los datos de cada entrada
+// alineados a 4 KB. Se mapea entero y cada entrada se abre como un SDL_RWops
+// sobre el mapeo, sin copias ni llamadas al sistema; las comprimidas con LZ4
+// se descomprimen a un buffer que libera el propio SDL_RWops. Los enteros van
+// en el orden de bytes de la máquina
+class LPackFile {
+    public:
+        // Versión del formato y alineación de los datos de cada entrada
+        static const Uint32 VERSION = 1;
+        static const Uint64 ALIGN = 4096;
+
+        // Cómo están guardados los datos de una entrada
+        enum Codec {
+            CODEC_NONE = 0,
+            CODEC_LZ4 = 1
+        };
+
+        // El CRC del índice cubre las entradas y los nombres; el de la
+        // cabecera, los campos anteriores
+        struct Header {
+            char magic[ 4 ];
+            Uint32 version;
+            Uint32 count;
+            Uint32 namesSize;
+            Uint32 indexCrc;
+            Uint32 headerCrc;
+        };
+
+        // Entrada del índice; el nombre no termina en cero
+        struct Entry {
+            Uint64 hash;
+            Uint64 offset;
+            Uint64 size;
+            Uint64 storedSize;
+            Uint32 nameOffset;
+            Uint16 nameLength;
+            Uint8 codec;
+            Uint8 reserved;
+        };
+
+        // Inicializa las variables
+        LPackFile();
+
+        // Libera el mapeo
+        ~LPackFile();
+
+        // Mapea el paquete y comprueba el índice. Los nombres que empiezan por
+        // root/ se buscan sin ese prefijo. Falso si no existe o está dañado
+        bool open( std::string path, std::string root );
+
+        // Libera el mapeo; los SDL_RWops abiertos sin comprimir dejan de valer
+        void close();
+
+        bool isOpen();
+
+        // Abre name desde el paquete, o el archivo suelto si no hay paquete o
+        // no está en él. Se cierra con SDL_RWclose o con el freesrc de quien
+        // lo lea. Se puede llamar desde varios hilos a la vez
+        SDL_RWops* openRW( std::string name );
+
+        // Entradas del índice, en orden de hash
+        int getEntryCount();
+        const Entry* getEntry( int index );
+        std::string getName( int index );
+
+        // FNV-1a de 64 bits del nombre
+        static Uint64 hashName( const char* name, size_t length );
+
+        // CRC-32 de zlib; sólo se usa con el índice, sin tabla
+        static Uint32 crc32( const void* data, size_t length );
+
+        // Descomprime un bloque LZ4 que debe ocupar exactamente destinationSize
+        static bool decompressLZ4( const Uint8* source, size_t sourceSize, Uint8* destination, size_t destinationSize );
+
+    private:
+        // Busca un nombre sin el prefijo de root
+        const Entry* find( const char* name, size_t length );
+
+        // Cierre de un SDL_RWops sobre un buffer descomprimido
+        static int closeDecompressed( SDL_RWops* context );
+
+        std::string mRoot;
+
+        // Mapeo del paquete e índice dentro de él
+        Uint8* mMapping;
+        size_t mMappingSize;
+        const Header* mHeader;
+        const Entry* mEntries;
+        const char* mNames;
+};
+
+// Comprime en formato de bloque LZ4 con una tabla hash de una posición por
+// cubeta, como el modo rápido de la referencia. Devuelve los bytes escritos o
+// 0 si no caben en capacity
+size_t compressLZ4( const Uint8* source, size_t size, Uint8* destination, size_t capacity );
+
+// Tamaño máximo de size bytes comprimidos
+size_t boundLZ4( size_t size );
+
+// Nombres de los archivos bajo directory, relativos a él y ordenados
+void listFiles( std::string directory, std::string prefix, std::vector<std::string>& names );
+
+// Lee un archivo entero
+bool readFile( std::string path, std::vector<Uint8>& data );
+
+// Escribe el paquete de directory en path
+int pack( std::string directory, std::string path, bool lz4 );
+
+#if defined(ROMFS_BENCH)
+// Compara el arranque con archivos sueltos y con el paquete
+int benchmarkStartup( std::string directory, std::string path, int repetitions );
+#endif
+
+LPackFile::LPackFile() {
+    // Inicializa las variables
+    mMapping = NULL;
+    mMappingSize = 0;
+    mHeader = NULL;
+    mEntries = NULL;
+    mNames = NULL;
+}
+
+LPackFile::~LPackFile() {
+    close();
+}
+
+bool LPackFile::open( std::string path, std::string root ) {
+    close();
+
+    int descriptor = ::open( path.c_str(), O_RDONLY );
+    if( descriptor < 0 ) {
+        return false;
+    }
+    struct stat info;
+    if( fstat( descriptor, &info ) != 0 || info.st_size < (off_t)sizeof( Header ) ) {
+        ::close( descriptor );
+        return false;
+    }
+    void* mapping = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+    ::close( descriptor );
+    if( mapping == MAP_FAILED ) {
+        printf( "No se pudo mapear %s: %s\n", path.c_str(), strerror( errno ) );
+        return false;
+    }
+    mMapping = (Uint8*)mapping;
+    mMappingSize = info.st_size;
+
+    // La cabecera y el índice se comprueban antes de usarlos; los datos de
+    // las entradas no se tocan hasta abrirlas
+    const Header* header = (const Header*)mMapping;
+    Uint64 indexSize = (Uint64)header->count * sizeof( Entry ) + header->namesSize;
+    bool valid = memcmp( header->magic, "RPAK", 4 ) == 0 && header->version == VERSION
+        && header->headerCrc == crc32( header, offsetof( Header, headerCrc ) )
+        && indexSize <= mMappingSize - sizeof( Header )
+        && header->indexCrc == crc32( mMapping + sizeof( Header ), indexSize );
+    const Entry* entries = (const Entry*)( mMapping + sizeof( Header ) );
+    for( Uint32 i = 0; i < header->count && valid; ++i ) {
+        const Entry& entry = entries[ i ];
+        valid = entry.offset <= mMappingSize && entry.storedSize <= mMappingSize - entry.offset
+            && (Uint64)entry.nameOffset + entry.nameLength <= header->namesSize
+            && ( entry.codec == CODEC_LZ4 || ( entry.codec == CODEC_NONE && entry.storedSize == entry.size ) )
+            && ( i == 0 || entries[ i - 1 ].hash <= entry.hash );
+    }
+    if( !valid ) {
+        printf( "%s no es un paquete válido!\n", path.c_str() );
+        close();
+        return false;
+    }
+
+    mHeader = header;
+    mEntries = entries;
+    mNames = (const char*)( mMapping + sizeof( Header ) + (Uint64)header->count * sizeof( Entry ) );
+    mRoot = root.empty() ? root : root + "/";
+    return true;
+}
+
+void LPackFile::close() {
+    if( mMapping != NULL ) {
+        munmap( mMapping, mMappingSize );
+        mMapping = NULL;
+        mMappingSize = 0;
+        mHeader = NULL;
+        mEntries = NULL;
+        mNames = NULL;
+    }
+}
+
+bool LPackFile::isOpen() {
+    return mHeader != NULL;
+}
+
+SDL_RWops* LPackFile::openRW( std::string name ) {
+    const Entry* entry = NULL;
+    if( mHeader != NULL && name.compare( 0, mRoot.size(), mRoot ) == 0 ) {
+        entry = find( name.c_str() + mRoot.size(), name.size() - mRoot.size() );
+    }
+    if( entry == NULL || entry->size == 0 ) {
+        return SDL_RWFromFile( name.c_str(), "rb" );
+    }
+
+    // Sin comprimir se lee directamente del mapeo; como la entrada empieza en
+    // una página se puede pedir que se lea por adelantado
+    const Uint8* data = mMapping + entry->offset;
+    if( entry->codec == CODEC_NONE ) {
+        madvise( (void*)data, entry->storedSize, MADV_WILLNEED );
+        return SDL_RWFromConstMem( data, entry->size );
+    }
+
+    Uint8* buffer = (Uint8*)malloc( entry->size );
+    if( buffer == NULL || !decompressLZ4( data, entry->storedSize, buffer, entry->size ) ) {
+        ::free( buffer );
+        SDL_SetError( "%s está dañado en el paquete", name.c_str() );
+        return NULL;
+    }
+    SDL_RWops* context = SDL_RWFromConstMem( buffer, entry->size );
+    if( context == NULL ) {
+        ::free( buffer );
+        return NULL;
+    }
+    context->close = closeDecompressed;
+    return context;
+}
+
+int LPackFile::getEntryCount() {
+    return mHeader != NULL ? mHeader->count : 0;
+}
+
+const LPackFile::Entry* LPackFile::getEntry( int index ) {
+    return &mEntries[ index ];
+}
+
+std::string LPackFile::getName( int index ) {
+    return std::string( mNames + mEntries[ index ].nameOffset, mEntries[ index ].nameLength );
+}
+
+const LPackFile::Entry* LPackFile::find( const char* name, size_t length ) {
+    // Búsqueda binaria del hash; con colisiones se compara el nombre
+    Uint64 hash = hashName( name, length );
+    size_t low = 0, high = mHeader->count;
+    while( low < high ) {
+        size_t middle = ( low + high ) / 2;
+        if( mEntries[ middle ].hash < hash ) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for( size_t i = low; i < mHeader->count && mEntries[ i ].hash == hash; ++i ) {
+        if( mEntries[ i ].nameLength == length && memcmp( mNames + mEntries[ i ].nameOffset, name, length ) == 0 ) {
+            return &mEntries[ i ];
+        }
+    }
+    return NULL;
+}
+
+int LPackFile::closeDecompressed( SDL_RWops* context ) {
+    ::free( context->hidden.mem.base );
+    SDL_FreeRW( context );
+    return 0;
+}
+
+Uint64 LPackFile::hashName( const char* name, size_t length ) {
+    Uint64 hash = 14695981039346656037ull;
+    for( size_t i = 0; i < length; ++i ) {
+        hash = ( hash ^ (Uint8)name[ i ] ) * 1099511628211ull;
+    }
+    return hash;
+}
+
+Uint32 LPackFile::crc32( const void* data, size_t length ) {
+    const Uint8* p = (const Uint8*)data;
+    Uint32 crc = 0xFFFFFFFF;
+    while( length-- > 0 ) {
+        crc ^= *p++;
+        for( int bit = 0; bit < 8; ++bit ) {
+            crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ) );
+        }
+    }
+    return ~crc;
+}
+
+bool LPackFile::decompressLZ4( const Uint8* source, size_t sourceSize, Uint8* destination, size_t destinationSize ) {
+    size_t in = 0, out = 0;
+    while( in < sourceSize ) {
+        // Token: literales en los 4 bits altos, coincidencia en los bajos; 15
+        // sigue en bytes de 255 hasta uno menor
+        Uint8 token = source[ in++ ];
+        size_t literals = token >> 4;
+        if( literals == 15 ) {
+            Uint8 extra;
+            do {
+                if( in >= sourceSize ) {
+                    return false;
+                }
+                extra = source[ in++ ];
+                literals += extra;
+            } while( extra == 255 );
+        }
+        if( literals > sourceSize - in || literals > destinationSize - out ) {
+            return false;
+        }
+        if( literals <= 16 && sourceSize - in >= 16 && destinationSize - out >= 16 ) {
+            // Casi siempre son pocos: se copian 16 de golpe, lo que sobra se
+            // pisa después
+            memcpy( destination + out, source + in, 16 );
+        } else {
+            memcpy( destination + out, source + in, literals );
+        }
+        in += literals;
+        out += literals;
+
+        // La última secuencia sólo lleva literales
+        if( in == sourceSize ) {
+            break;
+        }
+        if( sourceSize - in < 2 ) {
+            return false;
+        }
+        size_t offset = source[ in ] | ( source[ in + 1 ] << 8 );
+        in += 2;
+        size_t length = ( token & 15 ) + 4;
+        if( ( token & 15 ) == 15 ) {
+            Uint8 extra;
+            do {
+                if( in >= sourceSize ) {
+                    return false;
+                }
+                extra = source[ in++ ];
+                length += extra;
+            } while( extra == 255 );
+        }
+        if( offset == 0 || offset > out || length > destinationSize - out ) {
+            return false;
+        }
+
+        // Una coincidencia cercana se solapa con lo que va copiando: se copia
+        // en trozos del tamaño de la distancia, que crece con cada copia
+        Uint8* target = destination + out;
+        const Uint8* match = target - offset;
+        if( offset >= 16 && destinationSize - out >= length + 16 ) {
+            for( size_t i = 0; i < length; i += 16 ) {
+                memcpy( target + i, match + i, 16 );
+            }
+        } else if( offset >= length ) {
+            memcpy( target, match, length );
+        } else {
+            size_t copied = 0;
+            while( copied < length ) {
+                size_t chunk = offset + copied < length - copied ? offset + copied : length - copied;
+                memcpy( target + copied, match, chunk );
+                copied += chunk;
+            }
+        }
+        out += length;
+    }
+    return out == destinationSize;
+}
+
+// Escribe una secuencia LZ4; sin coincidencia es la última
+static bool writeSequence( Uint8* destination, size_t capacity, size_t& out, const Uint8* literals,
+        size_t literalCount, size_t offset, size_t matchLength )
+{
+    size_t needed = 1 + literalCount / 255 + 1 + literalCount + ( matchLength > 0 ? 2 + ( matchLength - 4 ) / 255 + 1 : 0 );
+    if( out + needed > capacity )
+    {
+        return false;
+    }
+
+    Uint8* token = destination + out++;
+    *token = ( literalCount >= 15 ? 15 : literalCount ) << 4;
+    if( literalCount >= 15 )
+    {
+        size_t rest = literalCount - 15;
+        for( ; rest >= 255; rest -= 255 )
+        {
+            destination[ out++ ] = 255;
+        }
+        destination[ out++ ] = rest;
+    }
+    memcpy( destination + out, literals, literalCount );
+    out += literalCount;
+
+    if( matchLength > 0 )
+    {
+        destination[ out++ ] = offset & 0xFF;
+        destination[ out++ ] = offset >> 8;
+        size_t code = matchLength - 4;
+        *token |= code >= 15 ? 15 : code;
+        if( code >= 15 )
+        {
+            size_t rest = code - 15;
+            for( ; rest >= 255; rest -= 255 )
+            {
+                destination[ out++ ] = 255;
+            }
+            destination[ out++ ] = rest;
+        }
+    }
+    return true;
+}
+
+size_t compressLZ4( const Uint8* source, size_t size, Uint8* destination, size_t capacity )
+{
+    // Límites del formato: coincidencias de al menos 4 bytes a menos de 64 KB,
+    // la última empieza 12 bytes antes del final y los 5 últimos son literales
+    const int HASH_BITS = 12;
+    const size_t MIN_MATCH = 4;
+    const size_t MATCH_LIMIT = 12;
+    const size_t LAST_LITERALS = 5;
+    const size_t MAX_OFFSET = 65535;
+
+    // Posición + 1 de la última vez que se vio cada hash, 0 si ninguna
+    std::vector<Uint32> table( 1 << HASH_BITS, 0 );
+    size_t in = 0, anchor = 0, out = 0;
+    if( size > MATCH_LIMIT )
+    {
+        size_t limit = size - MATCH_LIMIT;
+        while( in < limit )
+        {
+            Uint32 sequence;
+            memcpy( &sequence, source + in, 4 );
+            Uint32 hash = ( sequence * 2654435761u ) >> ( 32 - HASH_BITS );
+            size_t candidate = table[ hash ];
+            table[ hash ] = in + 1;
+
+            Uint32 previous = 0;
+            if( candidate > 0 )
+            {
+                memcpy( &previous, source + candidate - 1, 4 );
+            }
+            if( candidate == 0 || in - ( candidate - 1 ) > MAX_OFFSET || previous != sequence )
+            {
+                // Sin coincidencia; en tramos largos sin ninguna se avanza más
+                // deprisa, que es lo que pasa con datos ya comprimidos
+                in += 1 + ( ( in - anchor ) >> 6 );
+                continue;
+            }
+
+            size_t match = candidate - 1;
+            size_t length = MIN_MATCH;
+            while( in + length < size - LAST_LITERALS && source[ match + length ] == source[ in + length ] )
+            {
+                ++length;
+            }
+            if( !writeSequence( destination, capacity, out, source + anchor, in - anchor, in - match, length ) )
+            {
+                return 0;
+            }
+            in += length;
+            anchor = in;
+        }
+    }
+
+    if( !writeSequence( destination, capacity, out, source + anchor, size - anchor, 0, 0 ) )
+    {
+        return 0;
+    }
+    return out;
+}
+
+size_t boundLZ4( size_t size )
+{
+    return size + size / 255 + 16;
+}
+
+void listFiles( std::string directory, std::string prefix, std::vector<std::string>& names )
+{
+    DIR* dir = opendir( directory.c_str() );
+    if( dir == NULL )
+    {
+        return;
+    }
+    struct dirent* item;
+    while( ( item = readdir( dir ) ) != NULL )
+    {
+        // Sin ocultos ni las cachés que las lecciones generan al ejecutarse
+        std::string name = item->d_name;
+        if( name[ 0 ] == '.' || ( name.size() > 6 && name.compare( name.size() - 6, 6, ".cache" ) == 0 ) )
+        {
+            continue;
+        }
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if( stat( path.c_str(), &info ) != 0 )
+        {
+            continue;
+        }
+        if( S_ISDIR( info.st_mode ) )
+        {
+            listFiles( path, prefix + name + "/", names );
+        }
+        else if( S_ISREG( info.st_mode ) )
+        {
+            names.push_back( prefix + name );
+        }
+    }
+    closedir( dir );
+    std::sort( names.begin(), names.end() );
+}
+
+bool readFile( std::string path, std::vector<Uint8>& data )
+{
+    FILE* file = fopen( path.c_str(), "rb" );
+    if( file == NULL )
+    {
+        return false;
+    }
+    fseek( file, 0, SEEK_END );
+    long size = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    data.resize( size > 0 ? size : 0 );
+    bool complete = size >= 0 && ( size == 0 || fread( data.data(), 1, size, file ) == (size_t)size );
+    fclose( file );
+    return complete;
+}
+
+int pack( std::string directory, std::string path, bool lz4 )
+{
+    std::vector<std::string> names;
+    listFiles( directory, "", names );
+    if( names.empty() )
+    {
+        printf( "No hay archivos en %s!\n", directory.c_str() );
+        return -1;
+    }
+
+    // Datos de cada entrada tal como se guardan
+    std::vector<LPackFile::Entry> entries( names.size() );
+    std::vector< std::vector<Uint8> > stored( names.size() );
+    std::string namesBlob;
+    for( size_t i = 0; i < names.size(); ++i )
+    {
+        std::vector<Uint8> data;
+        if( !readFile( directory + "/" + names[ i ], data ) )
+        {
+            printf( "No se pudo leer %s/%s!\n", directory.c_str(), names[ i ].c_str() );
+            return -1;
+        }
+
+        LPackFile::Entry& entry = entries[ i ];
+        memset( &entry, 0, sizeof( entry ) );
+        entry.hash = LPackFile::hashName( names[ i ].c_str(), names[ i ].size() );
+        entry.size = data.size();
+        entry.nameOffset = namesBlob.size();
+        entry.nameLength = names[ i ].size();
+        entry.codec = LPackFile::CODEC_NONE;
+        namesBlob += names[ i ];
+
+        // PNG y similares ya vienen comprimidos y no ganan nada
+        if( lz4 && !data.empty() )
+        {
+            std::vector<Uint8> compressed( boundLZ4( data.size() ) );
+            size_t length = compressLZ4( data.data(), data.size(), compressed.data(), compressed.size() );
+            if( length > 0 && length <= data.size() - ( data.size() >> MIN_SAVING_SHIFT ) )
+            {
+                compressed.resize( length );
+                data.swap( compressed );
+                entry.codec = LPackFile::CODEC_LZ4;
+            }
+        }
+        entry.storedSize = data.size();
+        stored[ i ].swap( data );
+    }
+
+    // El índice va ordenado por hash para buscar con una búsqueda binaria
+    std::vector<size_t> order( names.size() );
+    for( size_t i = 0; i < order.size(); ++i )
+    {
+        order[ i ] = i;
+    }
+    std::sort( order.begin(), order.end(), [ & ]( size_t a, size_t b ) {
+        return entries[ a ].hash != entries[ b ].hash ? entries[ a ].hash < entries[ b ].hash : names[ a ] < names[ b ];
+    } );
+    std::vector<LPackFile::Entry> index( names.size() );
+    Uint64 offset = sizeof( LPackFile::Header ) + index.size() * sizeof( LPackFile::Entry ) + namesBlob.size();
+    for( size_t i = 0; i < order.size(); ++i )
+    {
+        // Cada entrada empieza en una página
+        offset = ( offset + LPackFile::ALIGN - 1 ) / LPackFile::ALIGN * LPackFile::ALIGN;
+        index[ i ] = entries[ order[ i ] ];
+        index[ i ].offset = offset;
+        offset += index[ i ].storedSize;
+    }
+
+    LPackFile::Header header;
+    memcpy( header.magic, "RPAK", 4 );
+    header.version = LPackFile::VERSION;
+    header.count = index.size();
+    header.namesSize = namesBlob.size();
+    std::vector<Uint8> indexBytes( index.size() * sizeof( LPackFile::Entry ) + namesBlob.size() );
+    memcpy( indexBytes.data(), index.data(), index.size() * sizeof( LPackFile::Entry ) );
+    memcpy( indexBytes.data() + index.size() * sizeof( LPackFile::Entry ), namesBlob.data(), namesBlob.size() );
+    header.indexCrc = LPackFile::crc32( indexBytes.data(), indexBytes.size() );
+    header.headerCrc = LPackFile::crc32( &header, offsetof( LPackFile::Header, headerCrc ) );
+
+    // Se escribe aparte y se renombra, así una lección nunca ve un paquete a
+    // medias
+    std::string temp = path + ".tmp";
+    FILE* file = fopen( temp.c_str(), "wb" );
+    if( file == NULL )
+    {
+        printf( "No se pudo crear %s: %s\n", temp.c_str(), strerror( errno ) );
+        return -1;
+    }
+    bool written = fwrite( &header, sizeof( header ), 1, file ) == 1
+        && fwrite( indexBytes.data(), 1, indexBytes.size(), file ) == indexBytes.size();
+    Uint64 totalSize = 0, totalStored = 0;
+    for( size_t i = 0; i < order.size() && written; ++i )
+    {
+        const std::vector<Uint8>& data = stored[ order[ i ] ];
+        written = fseek( file, index[ i ].offset, SEEK_SET ) == 0
+            && ( data.empty() || fwrite( data.data(), 1, data.size(), file ) == data.size() );
+        totalSize += index[ i ].size;
+        totalStored += index[ i ].storedSize;
+        printf( "  %-24s %10llu -> %10llu %s\n", names[ order[ i ] ].c_str(), (unsigned long long)index[ i ].size,
+                (unsigned long long)index[ i ].storedSize, index[ i ].codec == LPackFile::CODEC_LZ4 ? "lz4" : "" );
+    }
+    written = fclose( file ) == 0 && written;
+    if( !written || rename( temp.c_str(), path.c_str() ) != 0 )
+    {
+        printf( "No se pudo escribir %s: %s\n", path.c_str(), strerror( errno ) );
+        remove( temp.c_str() );
+        return -1;
+    }
+
+    printf( "%s: %d entradas, %llu bytes -> %llu guardados, %llu el paquete\n", path.c_str(), (int)index.size(),
+            (unsigned long long)totalSize, (unsigned long long)totalStored, (unsigned long long)offset );
+    return 0;
+}
+
+#if defined(ROMFS_BENCH)
+// Saca un archivo de la caché de páginas para medir en frío
+static void evict( std::string path )
+{
+    int descriptor = open( path.c_str(), O_RDONLY );
+    if( descriptor >= 0 )
+    {
+        posix_fadvise( descriptor, 0, 0, POSIX_FADV_DONTNEED );
+        close( descriptor );
+    }
+}
+
+// Llamadas al sistema de lectura hechas por el proceso
+static Uint64 readSyscalls()
+{
+    Uint64 count = 0;
+    FILE* file = fopen( "/proc/self/io", "r" );
+    if( file != NULL )
+    {
+        char line[ 128 ];
+        while( fgets( line, sizeof( line ), file ) != NULL )
+        {
+            if( strncmp( line, "syscr:", 6 ) == 0 )
+            {
+                count = strtoull( line + 6, NULL, 10 );
+            }
+        }
+        fclose( file );
+    }
+    return count;
+}
+
+// Carga una entrada con el cargador que le toca, como haría una lección
+static bool loadEntry( SDL_RWops* source, std::string name, bool mixerOpen )
+{
+    if( source == NULL )
+    {
+        return false;
+    }
+    std::string extension = name.substr( name.find_last_of( '.' ) + 1 );
+    if( extension == "png" || extension == "bmp" || extension == "jpg" )
+    {
+        SDL_Surface* surface = IMG_Load_RW( source, 1 );
+        SDL_FreeSurface( surface );
+        return surface != NULL;
+    }
+    if( extension == "ttf" )
+    {
+        TTF_Font* font = TTF_OpenFontRW( source, 1, FONT_SIZE );
+        TTF_CloseFont( font );
+        return font != NULL;
+    }
+    if( extension == "wav" && mixerOpen )
+    {
+        Mix_Chunk* chunk = Mix_LoadWAV_RW( source, 1 );
+        Mix_FreeChunk( chunk );
+        return chunk != NULL;
+    }
+
+    // El resto, como lazy.map, se lee entero
+    Sint64 size = SDL_RWsize( source );
+    std::vector<Uint8> data( size > 0 ? size : 0 );
+    bool complete = size >= 0 && ( size == 0 || SDL_RWread( source, data.data(), size, 1 ) == 1 );
+    SDL_RWclose( source );
+    return complete;
+}
+
+int benchmarkStartup( std::string directory, std::string path, int repetitions )
+{
+    // Los cargadores de las lecciones; el audio con el driver dummy
+    SDL_setenv( "SDL_AUDIODRIVER", "dummy", 0 );
+    if( SDL_Init( SDL_INIT_AUDIO ) < 0 )
+    {
+        printf( "SDL no pudo inicializarse! SDL Error: %s\n", SDL_GetError() );
+        return -1;
+    }
+    IMG_Init( IMG_INIT_PNG );
+    TTF_Init();
+    bool mixerOpen = Mix_OpenAudio( 44100, MIX_DEFAULT_FORMAT, 2, 2048 ) == 0;
+
+    std::vector<std::string> names;
+    listFiles( directory, "", names );
+    int errors = 0;
+
+    // Cada entrada del paquete es idéntica al archivo suelto, y un nombre que
+    // no está se abre suelto
+    LPackFile packFile;
+    if( !packFile.open( path, directory ) || packFile.getEntryCount() != (int)names.size() )
+    {
+        printf( "%s no corresponde a %s, vuelve a empaquetarlo\n", path.c_str(), directory.c_str() );
+        return -1;
+    }
+    for( size_t i = 0; i < names.size(); ++i )
+    {
+        std::vector<Uint8> expected, actual;
+        readFile( directory + "/" + names[ i ], expected );
+        SDL_RWops* source = packFile.openRW( directory + "/" + names[ i ] );
+        Sint64 size = source != NULL ? SDL_RWsize( source ) : -1;
+        actual.resize( size > 0 ? size : 0 );
+        if( source == NULL || ( size > 0 && SDL_RWread( source, actual.data(), size, 1 ) != 1 ) || actual != expected )
+        {
+            printf( "%s no coincide con el archivo suelto!\n", names[ i ].c_str() );
+            ++errors;
+        }
+        if( source != NULL )
+        {
+            SDL_RWclose( source );
+        }
+    }
+    if( packFile.openRW( directory + "/no-existe.bin" ) != NULL )
+    {
+        ++errors;
+    }
+
+    // Un bit cambiado en el índice invalida el paquete
+    {
+        std::vector<Uint8> data;
+        readFile( path, data );
+        data[ sizeof( LPackFile::Header ) + 3 ] ^= 0x10;
+        std::string damaged = path + ".damaged";
+        FILE* file = fopen( damaged.c_str(), "wb" );
+        fwrite( data.data(), 1, data.size(), file );
+        fclose( file );
+        LPackFile check;
+        if( check.open( damaged, directory ) )
+        {
+            ++errors;
+        }
+        remove( damaged.c_str() );
+    }
+    packFile.close();
+
+    // Arranque: abrir el paquete si toca y cargar cada entrada. En frío se
+    // sacan antes de la caché de páginas los archivos sueltos y el paquete
+    double frequency = SDL_GetPerformanceFrequency();
+    const char* modes[] = { "sueltos", "paquete" };
+    Uint64 probeReads = readSyscalls();
+    probeReads = readSyscalls() - probeReads;
+    for( int mode = 0; mode < 2; ++mode )
+    {
+        for( int cold = 1; cold >= 0; --cold )
+        {
+            double totalMs = 0.0, bestMs = 1e30;
+            Uint64 reads = 0;
+            for( int r = 0; r <= repetitions; ++r )
+            {
+                if( cold )
+                {
+                    for( size_t i = 0; i < names.size(); ++i )
+                    {
+                        evict( directory + "/" + names[ i ] );
+                    }
+                    evict( path );
+                }
+
+                Uint64 startReads = readSyscalls();
+                Uint64 start = SDL_GetPerformanceCounter();
+                LPackFile startup;
+                if( mode == 1 && !startup.open( path, directory ) )
+                {
+                    ++errors;
+                }
+                for( size_t i = 0; i < names.size(); ++i )
+                {
+                    if( !loadEntry( startup.openRW( directory + "/" + names[ i ] ), names[ i ], mixerOpen ) )
+                    {
+                        ++errors;
+                    }
+                }
+                startup.close();
+                double ms = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / frequency;
+
+                // En caliente la primera vuelta sólo llena la caché
+                if( cold || r > 0 )
+                {
+                    totalMs += ms;
+                    bestMs = ms < bestMs ? ms : bestMs;
+                    reads += readSyscalls() - startReads - probeReads;
+                }
+            }
+            int counted = cold ? repetitions + 1 : repetitions;
+            printf( "%s, %s: media %.3f ms, mejor %.3f ms, %.1f lecturas del sistema\n", modes[ mode ],
+                    cold ? "en frío" : "en caliente", totalMs / counted, bestMs, (double)reads / counted );
+        }
+    }
+
+    if( mixerOpen )
+    {
+        Mix_CloseAudio();
+    }
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+    printf( "%d errores\n", errors );
+    return errors > 0 ? -1 : 0;
+}
+#endif
+
+int main( int argc, char* argv[] ) {
+#if defined(ROMFS_BENCH)
+    if( argc >= 4 && strcmp( argv[ 1 ], "--bench" ) == 0 ) {
+        int repetitions = argc > 4 ? atoi( argv[ 4 ] ) : BENCH_REPETITIONS;
+        return benchmarkStartup( argv[ 2 ], argv[ 3 ], repetitions > 0 ? repetitions : BENCH_REPETITIONS );
+    }
+#endif
+    if( argc >= 3 && argv[ 1 ][ 0 ] != '-' ) {
+        return pack( argv[ 1 ], argv[ 2 ], argc > 3 && strcmp( argv[ 3 ], "--lz4" ) == 0 );
+    }
+
+    printf( "Uso: %s <romfs> <paquete> [--lz4]\n", argv[ 0 ] );
+#if defined(ROMFS_BENCH)
+    printf( "     %s --bench <romfs> <paquete> [repeticiones]\n", argv[ 0 ] );
+#endif
+    return -1;
+}